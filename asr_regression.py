@@ -12,6 +12,16 @@ Usage examples:
   # Run regression checks against existing references
   ./asr_regression.py
 
+  # Performance regression against perf_baseline.json (record with
+  # --perf-update-baseline on a known-good build first)
+  ./asr_regression.py --perf
+
+  # int8 encoder accuracy: --enc-int8 error rate vs the f32 path
+  ./asr_regression.py --int8-check-only
+
+  # 2:4 sparse decoder MLP accuracy report (converts the model on first use)
+  ./asr_regression.py --sparse-check-only
+
 The harness always prints two distances per sample:
   1) exact character-level distance (case/punctuation preserved)
   2) normalized character-level distance
@@ -21,12 +31,17 @@ The harness always prints two distances per sample:
 from __future__ import annotations
 
 import argparse
+import json
+import math
 import os
+import platform
+import re
+import statistics
 import subprocess
 import sys
 import time
 from pathlib import Path
-from typing import Iterable, List, Sequence, Tuple
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple
 
 # ---- ANSI colors (auto-disabled when stdout is not a tty) ----
 
@@ -54,6 +69,13 @@ STREAM_CACHE_DEFAULT_SAMPLES = (
     "night_of_the_living_dead_1968/10s_back_down_the_road.wav",
     "night_of_the_living_dead_1968/45s_dont_be_afraid_of_me.wav",
 )
+PERF_DEFAULT_SAMPLES = (
+    "jfk.wav",
+    "night_of_the_living_dead_1968/45s_dont_be_afraid_of_me.wav",
+)
+PERF_DEFAULT_BASELINE = "perf_baseline.json"
+# Timings below this many ms are too noisy to gate on; they are still recorded.
+PERF_MIN_MS = 50.0
 
 
 def levenshtein(seq_a: Sequence[str], seq_b: Sequence[str]) -> int:
@@ -391,6 +413,7 @@ def run_stream_cache_once(
     enc_window_sec: float,
     threads: int,
     cache_on: bool,
+    silent: bool = True,
 ) -> Tuple[int, str, str, float]:
     cmd = [
         str(binary),
@@ -399,8 +422,9 @@ def run_stream_cache_once(
         "-i", str(wav),
         "--stream",
         "--enc-window-sec", f"{enc_window_sec:g}",
-        "--silent",
     ]
+    if silent:
+        cmd.append("--silent")
     env = os.environ.copy()
     if cache_on:
         env.pop("QWEN_STREAM_NO_ENC_CACHE", None)
@@ -511,6 +535,437 @@ def run_stream_cache_regression(
     return 0
 
 
+# ---- performance regression ----
+
+PERF_INFER_RE = re.compile(
+    r"Inference: (\d+) ms, (\d+) text tokens \(([\d.]+) tok/s, "
+    r"encoding: (\d+)ms, decoding: (\d+)ms\)"
+)
+PERF_AUDIO_RE = re.compile(r"Audio: ([\d.]+) s processed in ([\d.]+) s \(([\d.]+)x realtime\)")
+
+# metric -> True when higher is better
+PERF_METRICS = (
+    ("encode_ms", False),
+    ("decode_ms", False),
+    ("tok_s", True),
+    ("realtime_x", True),
+)
+
+
+def cpu_model() -> str:
+    try:
+        with open("/proc/cpuinfo", encoding="utf-8", errors="replace") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return " ".join(line.split(":", 1)[1].split())
+    except OSError:
+        pass
+    if sys.platform == "darwin":
+        try:
+            cp = subprocess.run(["sysctl", "-n", "machdep.cpu.brand_string"],
+                                stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                                text=True, check=False)
+            if cp.returncode == 0 and cp.stdout.strip():
+                return cp.stdout.strip()
+        except OSError:
+            pass
+    return platform.processor() or platform.machine() or "unknown"
+
+
+def read_text(path: str) -> Optional[str]:
+    try:
+        with open(path, encoding="utf-8", errors="replace") as f:
+            return f.read().strip()
+    except OSError:
+        return None
+
+
+def cgroup_walk_quota(mount: str, cg_path: str, v2: bool) -> float:
+    """Smallest CPU quota (in CPUs) from cg_path up to the mount root, 0 = none.
+
+    Same walk as cgroup_walk_quota() in qwen_asr_topology.c.
+    """
+    best = 0.0
+    d = cg_path or "/"
+    while True:
+        rel = "" if d == "/" else d
+        quota, period = -1, 0
+        if v2:
+            text = read_text(f"{mount}{rel}/cpu.max")
+            if text and not text.startswith("max"):
+                parts = text.split()
+                try:
+                    quota, period = int(parts[0]), int(parts[1])
+                except (IndexError, ValueError):
+                    pass
+        else:
+            q = read_text(f"{mount}{rel}/cpu.cfs_quota_us")
+            p = read_text(f"{mount}{rel}/cpu.cfs_period_us")
+            try:
+                quota = int(q) if q else -1
+                period = int(p) if p else 0
+            except ValueError:
+                pass
+        if quota > 0 and period > 0:
+            q_cpus = quota / period
+            if best == 0.0 or q_cpus < best:
+                best = q_cpus
+        if d == "/" or "/" not in d:
+            break
+        d = d.rsplit("/", 1)[0] or "/"
+    return best
+
+
+def cgroup_cpu_quota() -> float:
+    """cgroup v2 cpu.max or v1 CFS quota of this process in CPUs, 0 = unlimited."""
+    text = read_text("/proc/self/cgroup")
+    if not text:
+        return 0.0
+    v2_path = v1_path = ""
+    for line in text.splitlines():
+        parts = line.split(":", 2)
+        if len(parts) != 3:
+            continue
+        if parts[1] == "":
+            v2_path = parts[2]
+        elif "cpu" in parts[1].split(","):
+            v1_path = parts[2]
+    quota = cgroup_walk_quota("/sys/fs/cgroup", v2_path, True) if v2_path else 0.0
+    if quota == 0.0 and v1_path:
+        quota = cgroup_walk_quota("/sys/fs/cgroup/cpu,cpuacct", v1_path, False)
+        if quota == 0.0:
+            quota = cgroup_walk_quota("/sys/fs/cgroup/cpu", v1_path, False)
+    return quota
+
+
+def default_perf_threads() -> int:
+    """Usable CPUs as qwen_asr counts them: affinity mask capped by the cgroup quota."""
+    if hasattr(os, "sched_getaffinity"):
+        n = max(1, len(os.sched_getaffinity(0)))
+    else:
+        n = max(1, os.cpu_count() or 1)
+    quota = cgroup_cpu_quota() if sys.platform.startswith("linux") else 0.0
+    if quota > 0.0:
+        n = min(n, max(1, math.ceil(quota - 1e-6)))
+    return n
+
+
+def parse_perf(stderr: str) -> Optional[Dict[str, float]]:
+    """Pull the Inference:/Audio: summary lines out of qwen_asr stderr."""
+    m = PERF_INFER_RE.search(stderr)
+    if not m:
+        return None
+    perf = {
+        "total_ms": float(m.group(1)),
+        "tokens": float(m.group(2)),
+        "tok_s": float(m.group(3)),
+        "encode_ms": float(m.group(4)),
+        "decode_ms": float(m.group(5)),
+        "realtime_x": 0.0,
+    }
+    a = PERF_AUDIO_RE.search(stderr)
+    if a:
+        perf["realtime_x"] = float(a.group(3))
+    return perf
+
+
+def perf_median(runs: Sequence[Dict[str, float]]) -> Dict[str, float]:
+    return {k: statistics.median(r[k] for r in runs) for k in runs[0]}
+
+
+def perf_compare(
+    cur: Dict[str, float],
+    base: Optional[Dict[str, float]],
+    threshold: float,
+) -> Tuple[bool, str]:
+    """Compare medians against a baseline entry.
+
+    Each metric is reported as a slowdown (+ is worse): cur/base - 1 for
+    times, base/cur - 1 for rates. Returns (ok, formatted summary)."""
+    ok = True
+    parts = []
+    for key, higher_better in PERF_METRICS:
+        val = cur[key]
+        text = f"{key} {val:.2f}" if higher_better else f"{key} {val:.0f}"
+        ref = base.get(key) if base else None
+        if ref and val > 0:
+            slow = (ref / val - 1.0) if higher_better else (val / ref - 1.0)
+            gated = higher_better or ref >= PERF_MIN_MS
+            bad = gated and slow > threshold
+            if bad:
+                ok = False
+            color = C_RED if bad else (C_GREEN if slow <= 0 else C_DIM)
+            text += f" ({color}{slow * 100:+.1f}%{C_RESET})"
+        parts.append(text)
+    return ok, " | ".join(parts)
+
+
+def load_perf_baseline(path: Path) -> dict:
+    if not path.exists():
+        return {"version": 1, "hosts": {}}
+    data = json.loads(path.read_text(encoding="utf-8"))
+    data.setdefault("hosts", {})
+    return data
+
+
+def perf_sample_name(wav: Path, samples_root: Path) -> str:
+    try:
+        return str(wav.relative_to(samples_root))
+    except ValueError:
+        return wav.name
+
+
+def run_perf_regression(
+    samples_root: Path,
+    binary: Path,
+    model_dir: Path,
+    stream_cache_model_dir: Optional[Path],
+    timeout_s: int,
+    extra_args: Sequence[str],
+    threads: int,
+    runs: int,
+    threshold: float,
+    baseline_path: Path,
+    update_baseline: bool,
+    sample_args: Sequence[str],
+    enc_window_sec: float,
+) -> int:
+    """Time each sample `runs` times and compare medians with the baseline.
+
+    Baselines are keyed by CPU model and thread count; each host entry maps
+    "<model>/<sample> <mode>" to the median metrics of the recorded run."""
+    if sample_args:
+        wavs = [Path(p).resolve() for p in sample_args]
+    else:
+        wavs = [(samples_root / rel).resolve() for rel in PERF_DEFAULT_SAMPLES]
+    missing = [w for w in wavs if not w.exists()]
+    if missing:
+        print(f"{C_BYELLOW}[SKIP perf]{C_RESET} missing sample(s):")
+        for w in missing:
+            print(f"       - {w}")
+        return 0
+
+    cpu = cpu_model()
+    host_key = f"{cpu} | threads={threads}"
+    baseline = load_perf_baseline(baseline_path)
+    host = baseline["hosts"].get(host_key, {}).get("samples", {})
+    recorded: Dict[str, Dict[str, float]] = {}
+
+    # (label, one timed run -> (rc, stdout, stderr))
+    jobs = []
+    for wav in wavs:
+        name = f"{model_dir.name}/{perf_sample_name(wav, samples_root)} offline"
+        cmd = [str(binary), "-t", str(threads), "-d", str(model_dir), "-i", str(wav)]
+        cmd += list(extra_args)
+        jobs.append((name, wav, lambda cmd=cmd: run_once(cmd, timeout_s)))
+    if stream_cache_model_dir is not None:
+        for rel in STREAM_CACHE_DEFAULT_SAMPLES:
+            wav = (samples_root / rel).resolve()
+            if not wav.exists():
+                continue
+            for cache_on in (True, False):
+                mode = "stream cache=on" if cache_on else "stream cache=off"
+                name = f"{stream_cache_model_dir.name}/{rel} {mode}"
+
+                def one(wav=wav, cache_on=cache_on):
+                    rc, out, err, _ = run_stream_cache_once(
+                        binary=binary,
+                        model_dir=stream_cache_model_dir,
+                        wav=wav,
+                        timeout_s=timeout_s,
+                        enc_window_sec=enc_window_sec,
+                        threads=threads,
+                        cache_on=cache_on,
+                        silent=False,
+                    )
+                    return rc, out, err
+
+                jobs.append((name, wav, one))
+
+    total = len(jobs)
+    failures = 0
+    stream_outputs: Dict[Path, Dict[bool, str]] = {}
+    print(
+        f"{C_BCYAN}[.... perf]{C_RESET} {runs} run(s)/sample, threshold {threshold * 100:.0f}% "
+        f"({cpu}, threads={threads})"
+    )
+    for idx, (name, wav, one) in enumerate(jobs, 1):
+        print(f"[START perf {idx}/{total}] {C_BWHITE}{name}{C_RESET} ...", flush=True)
+        samples = []
+        err = ""
+        out = ""
+        t0 = time.monotonic()
+        for _ in range(runs):
+            rc, out, err = one()
+            perf = parse_perf(err) if rc == 0 else None
+            if perf is None:
+                break
+            samples.append(perf)
+        elapsed = time.monotonic() - t0
+        if len(samples) != runs:
+            failures += 1
+            print(f"[DONE: {C_RED}FAIL{C_RESET} perf {idx}/{total}] {C_BWHITE}{name}{C_RESET} | "
+                  "run failed or no Inference: line")
+            if err:
+                print(f"       stderr: {err[-220:]}")
+            continue
+
+        if name.endswith(" stream cache=on") or name.endswith(" stream cache=off"):
+            stream_outputs.setdefault(wav, {})[name.endswith("=on")] = out
+
+        med = perf_median(samples)
+        recorded[name] = med
+        ok, summary = perf_compare(med, host.get(name), threshold)
+        if update_baseline:
+            ok = True
+        if not ok:
+            failures += 1
+        status = f"{C_GREEN}OK{C_RESET}" if ok else f"{C_RED}FAIL{C_RESET}"
+        note = "" if host.get(name) or update_baseline else f" | {C_YELLOW}no baseline{C_RESET}"
+        print(
+            f"[DONE: {status} perf {idx}/{total}] {C_BWHITE}{name}{C_RESET} | {summary}{note} | "
+            f"{C_DIM}{fmt_time(elapsed)}{C_RESET}"
+        )
+
+    # The cache-on and cache-off streams must still agree exactly.
+    for wav, outs in stream_outputs.items():
+        if len(outs) == 2 and outs[True] != outs[False]:
+            failures += 1
+            print(f"{C_BRED}[FAIL perf]{C_RESET} stream cache on/off outputs differ: {wav.name}")
+            show_text_diff("cache on", outs[True], "cache off", outs[False])
+
+    if update_baseline:
+        if failures:
+            print(f"{C_BRED}[FAIL perf]{C_RESET} baseline not written ({failures} failed job(s))")
+            return 1
+        entry = baseline["hosts"].setdefault(host_key, {"cpu": cpu, "threads": threads, "samples": {}})
+        entry["samples"].update(
+            {k: {m: round(v, 3) for m, v in med.items()} for k, med in recorded.items()}
+        )
+        entry["runs"] = runs
+        entry["updated"] = time.strftime("%Y-%m-%dT%H:%M:%S%z")
+        baseline_path.write_text(json.dumps(baseline, indent=2, sort_keys=True) + "\n", encoding="utf-8")
+        print(f"{C_BGREEN}[ OK  perf]{C_RESET} wrote {len(recorded)} entries for '{host_key}' "
+              f"to {baseline_path}")
+        return 0
+
+    if failures:
+        print(f"{C_BRED}[FAIL perf]{C_RESET} {failures}/{total} jobs regressed or failed")
+        return 1
+    if not host:
+        print(f"{C_BYELLOW}[ OK  perf]{C_RESET} no baseline for '{host_key}' in {baseline_path}; "
+              "record one with --perf-update-baseline")
+        return 0
+    print(f"{C_BGREEN}[ OK  perf]{C_RESET} {total}/{total} jobs within {threshold * 100:.0f}% of baseline")
+    return 0
+
+
+def run_variant_regression(
+    wavs: Sequence[Path],
+    binary: Path,
+    model_dir: Path,
+    timeout_s: int,
+    extra_args: Sequence[str],
+    max_delta: float,
+    label: str,
+    base_label: str,
+    variant_args: Sequence[str],
+    title: str,
+) -> int:
+    """Transcribe each referenced sample with the baseline and a variant
+    (baseline args + variant_args) and fail when the variant's normalized
+    error rate exceeds the baseline's by more than max_delta."""
+    total = len(wavs)
+    failures = 0
+    base_dist = var_dist = den_sum = 0
+    print(f"{C_BCYAN}[.... {label}-check]{C_RESET} {title} (model={model_dir.name}, max delta={max_delta:.3f})")
+    for idx, wav in enumerate(wavs, 1):
+        target = normalize_text(ref_for_wav(wav).read_text(encoding="utf-8").strip())
+        den = max(1, len(target))
+        print(f"[START {label} {idx}/{total}] {C_BWHITE}{wav.name}{C_RESET} ...", flush=True)
+        try:
+            t0 = time.monotonic()
+            pred_base = transcribe(binary, model_dir, wav, timeout_s, extra_args)
+            t_base = time.monotonic() - t0
+            t0 = time.monotonic()
+            pred_var = transcribe(binary, model_dir, wav, timeout_s, list(extra_args) + list(variant_args))
+            t_var = time.monotonic() - t0
+        except RuntimeError as e:
+            print(f"[DONE: {C_RED}FAIL{C_RESET} {label} {idx}/{total}] {C_BWHITE}{wav.name}{C_RESET} | {e}")
+            failures += 1
+            continue
+
+        d_base = levenshtein(normalize_text(pred_base), target)
+        d_var = levenshtein(normalize_text(pred_var), target)
+        base_dist += d_base
+        var_dist += d_var
+        den_sum += den
+        rate_base = d_base / den
+        rate_var = d_var / den
+        ok = rate_var <= rate_base + max_delta
+        if not ok:
+            failures += 1
+        status = f"{C_GREEN}OK{C_RESET}" if ok else f"{C_RED}FAIL{C_RESET}"
+        print(
+            f"[DONE: {status} {label} {idx}/{total}] {C_BWHITE}{wav.name}{C_RESET} | "
+            f"norm {base_label} {rate_base:.3f} {label} {rate_var:.3f} | "
+            f"{C_DIM}{base_label} {fmt_time(t_base)} {label} {fmt_time(t_var)}{C_RESET}"
+        )
+        if not ok:
+            show_text_diff(base_label, pred_base, label, pred_var)
+
+    if den_sum:
+        print(f"       overall norm {base_label} {base_dist / den_sum:.3f} {label} {var_dist / den_sum:.3f}")
+    if failures:
+        print(f"{C_BRED}[FAIL {label}-check]{C_RESET} {failures}/{total} samples out of threshold")
+        return 1
+    print(f"{C_BGREEN}[ OK  {label}-check]{C_RESET} {total}/{total} samples within {max_delta:.3f} of {base_label}")
+    return 0
+
+
+def run_int8_regression(
+    wavs: Sequence[Path],
+    binary: Path,
+    model_dir: Path,
+    timeout_s: int,
+    extra_args: Sequence[str],
+    max_delta: float,
+) -> int:
+    """Transcribe each referenced sample with the f32 and the int8 encoder and
+    fail when the int8 normalized error rate exceeds f32's by more than max_delta."""
+    return run_variant_regression(
+        wavs, binary, model_dir, timeout_s, extra_args, max_delta,
+        label="int8", base_label="f32", variant_args=["--enc-int8"],
+        title="--enc-int8 vs f32 encoder",
+    )
+
+
+def run_sparse_regression(
+    wavs: Sequence[Path],
+    binary: Path,
+    model_dir: Path,
+    timeout_s: int,
+    extra_args: Sequence[str],
+    max_delta: float,
+    sparse_file: Path,
+) -> int:
+    """Accuracy report for the 2:4 sparse decoder MLP: dense vs --sparse-mlp
+    error rate per sample. Writes the sidecar with --sparse-mlp-convert first
+    when it does not exist."""
+    if not sparse_file.exists():
+        print(f"{C_BCYAN}[.... sparse-check]{C_RESET} writing {sparse_file} (--sparse-mlp-convert)")
+        cmd = [str(binary), "-d", str(model_dir), "--silent", "--sparse-mlp-convert", str(sparse_file)]
+        proc = subprocess.run(cmd, capture_output=True, text=True, timeout=timeout_s)
+        if proc.returncode != 0:
+            print(f"{C_BRED}[FAIL sparse-check]{C_RESET} conversion failed: {proc.stderr.strip()}")
+            return 1
+    return run_variant_regression(
+        wavs, binary, model_dir, timeout_s, extra_args, max_delta,
+        label="sparse", base_label="dense", variant_args=["--sparse-mlp", str(sparse_file)],
+        title="--sparse-mlp (2:4 decoder MLP) vs dense",
+    )
+
+
 def generate_refs(
     wavs: Iterable[Path],
     binary: Path,
@@ -741,6 +1196,78 @@ def parse_args() -> argparse.Namespace:
         default=[],
         help="WAV path for stream cache check (repeatable; default uses built-in samples)",
     )
+    ap.add_argument(
+        "--perf",
+        action="store_true",
+        help="Run only the performance regression check (timed runs vs baseline JSON)",
+    )
+    ap.add_argument(
+        "--perf-runs",
+        type=int,
+        default=5,
+        help="Timed runs per perf sample; the median is compared (default: 5)",
+    )
+    ap.add_argument(
+        "--perf-threads",
+        type=int,
+        default=0,
+        help="Threads for perf runs, part of the baseline key (default: usable CPUs)",
+    )
+    ap.add_argument(
+        "--perf-threshold",
+        type=float,
+        default=0.10,
+        help="Max allowed median slowdown per metric vs baseline (default: 0.10 = 10%%)",
+    )
+    ap.add_argument(
+        "--perf-baseline",
+        default=PERF_DEFAULT_BASELINE,
+        help=f"Perf baseline JSON keyed by CPU model and threads (default: {PERF_DEFAULT_BASELINE})",
+    )
+    ap.add_argument(
+        "--perf-update-baseline",
+        action="store_true",
+        help="Record this run's medians as the baseline for this CPU/thread count",
+    )
+    ap.add_argument(
+        "--perf-sample",
+        action="append",
+        default=[],
+        help="WAV path for perf check (repeatable; default uses built-in samples)",
+    )
+    ap.add_argument(
+        "--int8-check-only",
+        action="store_true",
+        help="Run only the int8 encoder accuracy check (--enc-int8 vs f32 error rate)",
+    )
+    ap.add_argument(
+        "--int8-max-delta",
+        type=float,
+        default=0.02,
+        help="Max normalized error rate increase of --enc-int8 over f32 (default: 0.02)",
+    )
+    ap.add_argument(
+        "--int8-sample",
+        action="append",
+        default=[],
+        help="WAV path (with sibling .txt) for int8 check (repeatable; default: all referenced WAVs)",
+    )
+    ap.add_argument(
+        "--sparse-check-only",
+        action="store_true",
+        help="Run only the 2:4 sparse decoder MLP accuracy check (--sparse-mlp vs dense error rate)",
+    )
+    ap.add_argument(
+        "--sparse-file",
+        default="",
+        help="2:4 sparse MLP sidecar (default: <model-dir>/mlp_sparse24.safetensors; created if missing)",
+    )
+    ap.add_argument(
+        "--sparse-max-delta",
+        type=float,
+        default=0.05,
+        help="Max normalized error rate increase of --sparse-mlp over dense (default: 0.05)",
+    )
     ap.add_argument(
         "--segment-min-ratio",
         type=float,
@@ -784,12 +1311,116 @@ def main() -> int:
     )
 
     focused_count = sum(
-        1 for f in (args.segment_check_only, args.stream_check_only, args.stream_cache_check_only) if f
+        1 for f in (args.segment_check_only, args.stream_check_only, args.stream_cache_check_only,
+                    args.perf, args.int8_check_only, args.sparse_check_only) if f
     )
     if focused_count > 1:
-        print("--segment-check-only, --stream-check-only and --stream-cache-check-only are mutually exclusive",
-              file=sys.stderr)
+        print("--segment-check-only, --stream-check-only, --stream-cache-check-only, --perf, "
+              "--int8-check-only and --sparse-check-only are mutually exclusive", file=sys.stderr)
+        return 2
+    if args.perf and (args.generate_missing or args.refresh_refs):
+        print("--perf cannot be combined with reference generation", file=sys.stderr)
         return 2
+    if args.perf_runs <= 0:
+        print("--perf-runs must be > 0", file=sys.stderr)
+        return 2
+    if args.perf_threads < 0 or args.perf_threshold < 0:
+        print("--perf-threads and --perf-threshold must be >= 0", file=sys.stderr)
+        return 2
+
+    if args.perf:
+        model_dir = Path(args.model_dir).resolve()
+        if not model_dir.exists():
+            print(f"missing model dir: {model_dir}", file=sys.stderr)
+            return 2
+        stream_cache_model_dir: Optional[Path] = None
+        if not args.skip_stream_cache_check:
+            stream_cache_model_dir = Path(args.stream_cache_model_dir).resolve()
+            if not stream_cache_model_dir.exists():
+                print(f"{C_BYELLOW}[SKIP perf stream-cache]{C_RESET} missing model dir: "
+                      f"{stream_cache_model_dir}")
+                stream_cache_model_dir = None
+        rc = run_perf_regression(
+            samples_root=samples_root,
+            binary=binary,
+            model_dir=model_dir,
+            stream_cache_model_dir=stream_cache_model_dir,
+            timeout_s=args.timeout_s,
+            extra_args=args.arg,
+            threads=args.perf_threads or default_perf_threads(),
+            runs=args.perf_runs,
+            threshold=args.perf_threshold,
+            baseline_path=Path(args.perf_baseline).resolve(),
+            update_baseline=args.perf_update_baseline,
+            sample_args=args.perf_sample,
+            enc_window_sec=args.stream_cache_enc_window_sec,
+        )
+        if rc:
+            print(f"\n{C_BRED}Performance regression FAILED{C_RESET}")
+            return 1
+        print(f"\n{C_BGREEN}Performance regression PASSED{C_RESET}")
+        return 0
+
+    if args.int8_check_only:
+        if args.generate_missing or args.refresh_refs:
+            print("--int8-check-only cannot be combined with reference generation", file=sys.stderr)
+            return 2
+        if args.int8_max_delta < 0:
+            print("--int8-max-delta must be >= 0", file=sys.stderr)
+            return 2
+        model_dir = Path(args.model_dir).resolve()
+        if not model_dir.exists():
+            print(f"missing model dir: {model_dir}", file=sys.stderr)
+            return 2
+        int8_wavs = [Path(p).resolve() for p in args.int8_sample] or wavs_with_refs
+        missing = [w for w in int8_wavs if not ref_for_wav(w).exists()]
+        if missing or not int8_wavs:
+            print("--int8-check-only needs WAV files with sibling .txt references", file=sys.stderr)
+            return 2
+        rc = run_int8_regression(
+            int8_wavs,
+            binary=binary,
+            model_dir=model_dir,
+            timeout_s=args.timeout_s,
+            extra_args=args.arg,
+            max_delta=args.int8_max_delta,
+        )
+        if rc:
+            print(f"\n{C_BRED}Focused regression checks FAILED{C_RESET}")
+            return 1
+        print(f"\n{C_BGREEN}Focused regression checks PASSED{C_RESET}")
+        return 0
+
+    if args.sparse_check_only:
+        if args.generate_missing or args.refresh_refs:
+            print("--sparse-check-only cannot be combined with reference generation", file=sys.stderr)
+            return 2
+        if args.sparse_max_delta < 0:
+            print("--sparse-max-delta must be >= 0", file=sys.stderr)
+            return 2
+        model_dir = Path(args.model_dir).resolve()
+        if not model_dir.exists():
+            print(f"missing model dir: {model_dir}", file=sys.stderr)
+            return 2
+        if not wavs_with_refs:
+            print("--sparse-check-only needs WAV files with sibling .txt references", file=sys.stderr)
+            return 2
+        sparse_file = Path(args.sparse_file).resolve() if args.sparse_file else \
+            model_dir / "mlp_sparse24.safetensors"
+        rc = run_sparse_regression(
+            wavs_with_refs,
+            binary=binary,
+            model_dir=model_dir,
+            timeout_s=args.timeout_s,
+            extra_args=args.arg,
+            max_delta=args.sparse_max_delta,
+            sparse_file=sparse_file,
+        )
+        if rc:
+            print(f"\n{C_BRED}Focused regression checks FAILED{C_RESET}")
+            return 1
+        print(f"\n{C_BGREEN}Focused regression checks PASSED{C_RESET}")
+        return 0
 
     if args.segment_check_only and (args.generate_missing or args.refresh_refs):
         print("--segment-check-only cannot be combined with reference generation", file=sys.stderr)
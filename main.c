@@ -7,18 +7,421 @@
 #include "qwen_asr.h"
 #include "qwen_asr_audio.h"
 #include "qwen_asr_kernels.h"
+#include "qwen_asr_prefetch.h"
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* Set when stdout ends at a line break (endpointed stream output) */
+static int stdout_at_line_start = 0;
 
 /* Token streaming callback: print each piece as it's decoded */
 static void stream_token(const char *piece, void *userdata) {
     (void)userdata;
+    stdout_at_line_start = 0;
     fputs(piece, stdout);
     fflush(stdout);
 }
 
+/* Endpoint callback: end the line of the finalized utterance */
+static void stream_endpoint(const char *utterance, void *userdata) {
+    (void)utterance;
+    (void)userdata;
+    if (stdout_at_line_start) return;
+    stdout_at_line_start = 1;
+    fputs("\n", stdout);
+    fflush(stdout);
+}
+
+/* --chunk-stats: one machine-readable line per streaming chunk */
+static void stream_chunk_stats(const qwen_chunk_stats_t *cs, void *userdata) {
+    (void)userdata;
+    fprintf(stderr, "chunk_stats chunk=%d audio=%.3f enc_ms=%.1f dec_ms=%.1f total_ms=%.1f\n",
+            cs->chunk, cs->audio_sec, cs->encode_ms, cs->decode_ms, cs->total_ms);
+    fflush(stderr);
+}
+
+/* --save-state: SIGTERM/SIGINT checkpoint the running live stream */
+static pthread_mutex_t drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+static qwen_ctx_t *drain_ctx = NULL;
+static qwen_live_audio_t *drain_live = NULL;
+static sigset_t drain_sigs;
+
+static void *drain_signal_thread(void *arg) {
+    (void)arg;
+    int sig = 0;
+    if (sigwait(&drain_sigs, &sig) != 0) return NULL;
+    pthread_mutex_lock(&drain_mutex);
+    if (drain_ctx && drain_live)
+        qwen_stream_request_checkpoint(drain_ctx, drain_live, 0);
+    pthread_mutex_unlock(&drain_mutex);
+    return NULL;
+}
+
+/* SIGUSR1 in --stream mode: dump the flight recorder as JSON */
+static pthread_mutex_t flight_mutex = PTHREAD_MUTEX_INITIALIZER;
+static qwen_ctx_t *flight_ctx = NULL;
+static const char *flight_dump_path = NULL;
+static sigset_t flight_sigs;
+
+static void *flight_signal_thread(void *arg) {
+    (void)arg;
+    int sig = 0;
+    while (sigwait(&flight_sigs, &sig) == 0) {
+        pthread_mutex_lock(&flight_mutex);
+        char *json = flight_ctx ? qwen_flight_dump_json(flight_ctx) : NULL;
+        pthread_mutex_unlock(&flight_mutex);
+        if (!json) continue;
+        FILE *f = flight_dump_path ? fopen(flight_dump_path, "w") : stderr;
+        if (f) {
+            fputs(json, f);
+            if (f != stderr) fclose(f);
+            else fflush(f);
+        } else {
+            fprintf(stderr, "Failed to write flight recorder to %s\n", flight_dump_path);
+        }
+        free(json);
+    }
+    return NULL;
+}
+
+static void *read_file(const char *path, size_t *out_size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void *data = n > 0 ? malloc((size_t)n) : NULL;
+    if (data && fread(data, 1, (size_t)n, f) != (size_t)n) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data) *out_size = (size_t)n;
+    return data;
+}
+
+/* ========================================================================
+ * Pre-fork Workers (--workers N)
+ *
+ * The parent loads and converts the model once, runs a short warm-up so
+ * lazily built state exists too, parks its thread pool and forks N
+ * workers. Workers inherit the weights copy-on-write and never write them,
+ * so the pages stay shared; each starts its own pool. Input paths are read
+ * from stdin, one per line, and handed to workers with free queue room over
+ * their job pipes; results come back as one line per job and are printed as
+ * "<path>\t<text>" in completion order. With --prefetch K each worker queues
+ * 1 + K jobs and loads the next K files on reader threads while its pool
+ * transcribes the current one.
+ * ======================================================================== */
+
+typedef struct {
+    pid_t pid;
+    int job_fd;                        /* parent -> worker: one path per line */
+    int res_fd;                        /* worker -> parent: "1 <text>" or "0" */
+    FILE *res;
+    char **jobs;                       /* queued paths in dispatch order */
+    int n_jobs;                        /* 0 = idle */
+} worker_t;
+
+static char *transcribe_path(qwen_ctx_t *ctx, const char *path, int stream_mode) {
+    if (!stream_mode) return qwen_transcribe(ctx, path);
+    int ns = 0;
+    float *samps = qwen_load_wav(path, &ns);
+    if (!samps) return NULL;
+    char *text = qwen_transcribe_stream(ctx, samps, ns);
+    free(samps);
+    return text;
+}
+
+static char *transcribe_samples(qwen_ctx_t *ctx, const float *samples, int n_samples,
+                                int stream_mode) {
+    if (stream_mode) return qwen_transcribe_stream(ctx, samples, n_samples);
+    return qwen_transcribe_audio(ctx, samples, n_samples);
+}
+
+static int write_all(int fd, const char *buf, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, buf, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static void strip_newline(char *line) {
+    size_t n = strlen(line);
+    while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+}
+
+/* Send one result line: "1 <text>" or "0" */
+static int write_result(int res_fd, char *text) {
+    if (!text) return write_all(res_fd, "0\n", 2);
+    for (char *c = text; *c; c++)
+        if (*c == '\n' || *c == '\r') *c = ' ';
+    int rc = write_all(res_fd, "1 ", 2);
+    if (rc == 0) rc = write_all(res_fd, text, strlen(text));
+    if (rc == 0) rc = write_all(res_fd, "\n", 1);
+    return rc;
+}
+
+/* Worker process: transcribe paths from job_fd until the parent closes it */
+static int worker_main(qwen_ctx_t *ctx, int job_fd, int res_fd, int n_threads,
+                       int stream_mode, int prefetch, size_t prefetch_mem) {
+    qwen_set_threads(n_threads);
+    FILE *jobs = fdopen(job_fd, "r");
+    if (!jobs) return 1;
+
+    if (prefetch > 0) {
+        qwen_prefetch_t *pf = qwen_prefetch_start(jobs, prefetch, prefetch_mem);
+        if (pf) {
+            char *path;
+            float *samples;
+            int n_samples;
+            while (qwen_prefetch_next(pf, &path, &samples, &n_samples)) {
+                char *text = samples ? transcribe_samples(ctx, samples, n_samples, stream_mode) : NULL;
+                int rc = write_result(res_fd, text);
+                free(text);
+                free(samples);
+                free(path);
+                /* Parent gone: readers may be blocked on the job pipe, so
+                 * leave them to process exit. */
+                if (rc != 0) return 0;
+            }
+            qwen_prefetch_free(pf);
+            fclose(jobs);
+            return 0;
+        }
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    while (getline(&line, &cap, jobs) > 0) {
+        strip_newline(line);
+        char *text = transcribe_path(ctx, line, stream_mode);
+        int rc = write_result(res_fd, text);
+        free(text);
+        if (rc != 0) break;
+    }
+    free(line);
+    fclose(jobs);
+    return 0;
+}
+
+static int spawn_worker(worker_t *workers, int idx, qwen_ctx_t *ctx, int n_threads,
+                        int stream_mode, int prefetch, size_t prefetch_mem) {
+    int job_pipe[2], res_pipe[2];
+    if (pipe(job_pipe) != 0) return -1;
+    if (pipe(res_pipe) != 0) {
+        close(job_pipe[0]);
+        close(job_pipe[1]);
+        return -1;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        /* Keep only this worker's pipe ends: a stray copy of another
+         * worker's job pipe would hide the parent's EOF from it. */
+        for (int i = 0; i < idx; i++) {
+            close(workers[i].job_fd);
+            close(workers[i].res_fd);
+        }
+        close(job_pipe[1]);
+        close(res_pipe[0]);
+        int devnull = open("/dev/null", O_RDONLY);
+        if (devnull >= 0) {
+            dup2(devnull, 0);
+            close(devnull);
+        }
+        _exit(worker_main(ctx, job_pipe[0], res_pipe[1], n_threads, stream_mode,
+                          prefetch, prefetch_mem));
+    }
+    close(job_pipe[0]);
+    close(res_pipe[1]);
+    if (pid < 0) {
+        close(job_pipe[1]);
+        close(res_pipe[0]);
+        return -1;
+    }
+    workers[idx].pid = pid;
+    workers[idx].job_fd = job_pipe[1];
+    workers[idx].res_fd = res_pipe[0];
+    workers[idx].res = fdopen(res_pipe[0], "r");
+    workers[idx].n_jobs = 0;
+    if (!workers[idx].res) return -1;
+    /* Unbuffered: with several jobs queued, a second result line left in a
+     * stdio buffer would be invisible to poll(). */
+    setvbuf(workers[idx].res, NULL, _IONBF, 0);
+    return 0;
+}
+
+/* Hand the next stdin path to a worker with queue room. Returns 1 if a job
+ * was sent, 0 at end of input, -1 if the worker is gone. */
+static int dispatch_next(worker_t *w, char **line, size_t *cap) {
+    for (;;) {
+        if (getline(line, cap, stdin) <= 0) return 0;
+        strip_newline(*line);
+        if ((*line)[0]) break;
+    }
+    size_t n = strlen(*line);
+    (*line)[n] = '\n';
+    int rc = write_all(w->job_fd, *line, n + 1);
+    (*line)[n] = '\0';
+    if (rc != 0) {
+        fprintf(stderr, "Transcription failed: %s (worker %d exited)\n", *line, (int)w->pid);
+        return -1;
+    }
+    w->jobs[w->n_jobs++] = strdup(*line);
+    return 1;
+}
+
+static int run_workers(qwen_ctx_t *ctx, int n_workers, int n_threads, int stream_mode,
+                       int prefetch, size_t prefetch_mem) {
+    /* Warm-up: build whatever the first transcription creates lazily, so
+     * the workers share it instead of each converting their own. */
+    float *warm = (float *)calloc(QWEN_SAMPLE_RATE, sizeof(float));
+    if (warm) {
+        char *text = qwen_transcribe_audio(ctx, warm, QWEN_SAMPLE_RATE);
+        free(text);
+        free(warm);
+    }
+
+    worker_t *workers = (worker_t *)calloc((size_t)n_workers, sizeof(worker_t));
+    int *alive = (int *)calloc((size_t)n_workers, sizeof(int));
+    struct pollfd *pfd = (struct pollfd *)calloc((size_t)n_workers, sizeof(struct pollfd));
+    int depth = 1 + prefetch;
+    char **job_slots = (char **)calloc((size_t)n_workers * (size_t)depth, sizeof(char *));
+    if (!workers || !alive || !pfd || !job_slots) {
+        free(workers);
+        free(alive);
+        free(pfd);
+        free(job_slots);
+        return 1;
+    }
+    for (int i = 0; i < n_workers; i++) workers[i].jobs = job_slots + (size_t)i * depth;
+
+    /* Pool threads do not survive fork(): each child starts with an empty
+     * pool (reset by the kernels' atfork handler) and spawns its own. The
+     * parent's workers are only parked until it exits. */
+    qwen_set_threads(1);
+    signal(SIGPIPE, SIG_IGN);
+
+    int n_spawned = 0;
+    for (; n_spawned < n_workers; n_spawned++) {
+        if (spawn_worker(workers, n_spawned, ctx, n_threads, stream_mode,
+                         prefetch, prefetch_mem) != 0) {
+            fprintf(stderr, "Failed to start worker %d\n", n_spawned);
+            break;
+        }
+    }
+    if (qwen_verbose >= 1)
+        fprintf(stderr, "Started %d workers x %d threads\n", n_spawned, n_threads);
+
+    int failed = n_spawned < n_workers;
+    int at_eof = n_spawned == 0;
+    char *line = NULL, *res = NULL;
+    size_t line_cap = 0, res_cap = 0;
+    for (int i = 0; i < n_spawned; i++) alive[i] = 1;
+
+    for (;;) {
+        /* Fill idle workers first, then their prefetch queues */
+        for (int d = 0; d < depth && !at_eof; d++) {
+            for (int i = 0; i < n_spawned && !at_eof; i++) {
+                if (!alive[i] || workers[i].n_jobs != d) continue;
+                int rc = dispatch_next(&workers[i], &line, &line_cap);
+                if (rc == 0) at_eof = 1;
+                else if (rc < 0) alive[i] = 0, failed = 1;
+            }
+        }
+
+        int n_busy = 0;
+        for (int i = 0; i < n_spawned; i++) {
+            pfd[i].fd = workers[i].n_jobs ? workers[i].res_fd : -1;
+            pfd[i].events = POLLIN;
+            pfd[i].revents = 0;
+            if (workers[i].n_jobs) n_busy++;
+        }
+        if (n_busy == 0) {
+            int n_alive = 0;
+            for (int i = 0; i < n_spawned; i++) n_alive += alive[i];
+            if (at_eof || n_alive == 0) break;
+            continue;
+        }
+        if (poll(pfd, (nfds_t)n_spawned, -1) < 0) {
+            if (errno == EINTR) continue;
+            failed = 1;
+            break;
+        }
+
+        for (int i = 0; i < n_spawned; i++) {
+            if (!pfd[i].revents) continue;
+            worker_t *w = &workers[i];
+            ssize_t n = getline(&res, &res_cap, w->res);
+            if (n <= 0) {
+                for (int j = 0; j < w->n_jobs; j++) {
+                    fprintf(stderr, "Transcription failed: %s (worker %d exited)\n",
+                            w->jobs[j], (int)w->pid);
+                    free(w->jobs[j]);
+                }
+                w->n_jobs = 0;
+                alive[i] = 0;
+                failed = 1;
+                continue;
+            }
+            if (res[0] == '1') {
+                strip_newline(res);
+                printf("%s\t%s\n", w->jobs[0], res + 2);
+                fflush(stdout);
+            } else {
+                fprintf(stderr, "Transcription failed: %s\n", w->jobs[0]);
+                failed = 1;
+            }
+            free(w->jobs[0]);
+            memmove(w->jobs, w->jobs + 1, (size_t)(w->n_jobs - 1) * sizeof(char *));
+            w->n_jobs--;
+        }
+    }
+
+    /* Inputs left after every worker died */
+    if (!at_eof) {
+        while (getline(&line, &line_cap, stdin) > 0) {
+            strip_newline(line);
+            if (line[0]) fprintf(stderr, "Transcription failed: %s (no workers)\n", line);
+        }
+    }
+
+    for (int i = 0; i < n_spawned; i++) {
+        close(workers[i].job_fd);
+        fclose(workers[i].res);
+        int status = 0;
+        if (waitpid(workers[i].pid, &status, 0) < 0 ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed = 1;
+        for (int j = 0; j < workers[i].n_jobs; j++) free(workers[i].jobs[j]);
+    }
+    free(line);
+    free(res);
+    free(pfd);
+    free(alive);
+    free(job_slots);
+    free(workers);
+    return failed ? 1 : 0;
+}
+
 /* Parse --past-text value.
  * out_mode:  1=yes, 0=no, -1=auto */
 static int parse_past_text_mode(const char *s, int *out_mode) {
@@ -50,18 +453,56 @@ static void usage(const char *prog) {
     fprintf(stderr, "Usage: %s -d <model_dir> (-i <input.wav> | --stdin) [options]\n\n", prog);
     fprintf(stderr, "Required:\n");
     fprintf(stderr, "  -d <dir>      Model directory (with *.safetensors, vocab.json)\n");
-    fprintf(stderr, "  -i <file>     Input WAV file (16-bit PCM, any sample rate)\n");
-    fprintf(stderr, "  --stdin       Read audio from stdin (auto-detect WAV or raw s16le 16kHz mono)\n");
+    fprintf(stderr, "  -i <file>     Input WAV (16-bit PCM) or FLAC file, any sample rate\n");
+    fprintf(stderr, "  --stdin       Read audio from stdin (auto-detect WAV, FLAC or raw s16le 16kHz mono)\n");
+    fprintf(stderr, "  --shm <file>  With --stream: read float32 16kHz mono audio from a shared-memory\n");
+    fprintf(stderr, "                ring written by another process (qwen_asr_shm.h, Linux)\n");
+    fprintf(stderr, "  --stdin-format <fmt>  Headerless stdin format: s16le (16kHz, default), ulaw or\n");
+    fprintf(stderr, "                alaw (G.711, 8kHz; upsampled to 16kHz)\n");
     fprintf(stderr, "\nOptions:\n");
-    fprintf(stderr, "  -t <n>        Number of threads (default: all CPUs)\n");
+    fprintf(stderr, "  -t <n>        Number of threads (default: all usable CPUs, honoring affinity\n");
+    fprintf(stderr, "                and cgroup CPU quota)\n");
+    fprintf(stderr, "  --decode-threads <n>       Threads for single-token decode steps (default: physical cores)\n");
+    fprintf(stderr, "  --workers <n>              Load once, fork <n> worker processes sharing the weights and\n");
+    fprintf(stderr, "                             transcribe the input paths read from stdin (one per line),\n");
+    fprintf(stderr, "                             printing \"<path>\\t<text>\" lines; -t is then per worker\n");
+    fprintf(stderr, "  --prefetch <k>             With --workers: each worker reads and decodes its next <k>\n");
+    fprintf(stderr, "                             files while transcribing (default: 1, 0 = off)\n");
+    fprintf(stderr, "  --prefetch-mb <mb>         Cap on prefetched samples per worker (default: 256)\n");
+    fprintf(stderr, "  --autotune                 Benchmark kernel settings for this CPU and model, save them\n");
+    fprintf(stderr, "                             to the tuning profile and exit (no input needed)\n");
+    fprintf(stderr, "  --tune-file <file>         Tuning profile to read/write (default: $QWEN_TUNE_FILE or\n");
+    fprintf(stderr, "                             ~/.cache/qwen_asr/tuning.txt)\n");
     fprintf(stderr, "  -S <secs>     Segment target seconds (default: 0 = full-audio decode)\n");
     fprintf(stderr, "  -W <secs>     Segment-cutting silence search window ± seconds (default: 3.0)\n");
     fprintf(stderr, "  --stream      Streaming mode: process in chunks with prefix rollback\n");
     fprintf(stderr, "  --stream-max-new-tokens <n>  Max generated tokens per stream step (default: 32)\n");
+    fprintf(stderr, "  --stream-draft-layers <n>  Two-pass streaming: interim chunks are cheap drafts through\n");
+    fprintf(stderr, "                             the first <n> decoder layers; only full passes commit text\n");
+    fprintf(stderr, "                             (0 = off, default; the CLI prints no drafts, so they only encode)\n");
+    fprintf(stderr, "  --stream-final-every <k>   With --stream-draft-layers: full pass every <k> chunks (default: 3)\n");
+    fprintf(stderr, "  --endpoint-ms <ms>         Finalize a stream utterance after <ms> of trailing silence\n");
+    fprintf(stderr, "                             (0 = off, default)\n");
+    fprintf(stderr, "  --idle-trim <secs>         Release decoder memory after a live stream pauses for <secs>\n");
+    fprintf(stderr, "                             (0 = off, default)\n");
+    fprintf(stderr, "  --save-state <file>        With --stream --stdin/--shm: on SIGTERM/SIGINT save the\n");
+    fprintf(stderr, "                             session state to <file> and exit\n");
+    fprintf(stderr, "  --resume-state <file>      Resume a live --stream session saved by --save-state\n");
+    fprintf(stderr, "  --chunk-stats              Print per-chunk timing lines (chunk_stats ...) to stderr\n");
+    fprintf(stderr, "  --flight-dump <file>       With --stream: write the flight recorder (last %d chunks'\n", QWEN_FLIGHT_SLOTS);
+    fprintf(stderr, "                             timings, as JSON) to <file> on SIGUSR1 (default: stderr)\n");
+    fprintf(stderr, "  --perf-counters            Count cycles, instructions and LLC misses per phase (mel,\n");
+    fprintf(stderr, "                             encoder, prefill, decode, argmax) and print IPC and\n");
+    fprintf(stderr, "                             approximate DRAM GB/s (perf_counters ...) to stderr\n");
     fprintf(stderr, "  --enc-window-sec <secs>    Encoder attention window in seconds (1..8, default 8)\n");
     fprintf(stderr, "  --past-text <yes|no|auto>  Reuse previously decoded text as context for the next\n");
     fprintf(stderr, "                             segment/chunk (continuity bias; auto=yes for --stream)\n");
     fprintf(stderr, "  --skip-silence              Drop long silent spans before inference (off by default)\n");
+    fprintf(stderr, "  --enc-int8                 Run encoder linear layers as int8 GEMMs (faster on long\n");
+    fprintf(stderr, "                             inputs, slightly less accurate; off by default)\n");
+    fprintf(stderr, "  --sparse-mlp <file>        Run the decoder MLP on 2:4 sparse weights from <file> (lossy)\n");
+    fprintf(stderr, "  --sparse-mlp-convert <file>  Magnitude-prune the decoder MLP to 2:4 sparsity, write\n");
+    fprintf(stderr, "                             the weights to <file> and exit (no input needed)\n");
     fprintf(stderr, "  --prompt <text>            System prompt for biasing (example: \"Preserve spelling: CPU, CUDA, PostgreSQL, Redis\")\n");
     fprintf(stderr, "  --language <lang>          Force output language via token conditioning\n");
     fprintf(stderr, "                             (usually auto-detected if omitted)\n");
@@ -77,16 +518,34 @@ int main(int argc, char **argv) {
     const char *input_wav = NULL;
     int verbosity = 1;
     int use_stdin = 0;
+    const char *shm_path = NULL;
     int n_threads = 0; /* 0 = auto-detect */
+    int decode_threads = 0; /* 0 = physical cores */
+    int autotune = 0;
+    int chunk_stats = 0;
+    int perf_counters = 0;
+    const char *tune_file = NULL;
     float segment_sec = -1; /* -1 = use default (0) */
     float search_sec = -1;  /* -1 = use default (3) */
     int stream_mode = 0;
     int stream_max_new_tokens = -1; /* -1 = use default (32) */
     float enc_window_sec = -1;   /* -1 = use default (8s) */
+    int endpoint_ms = 0;
+    int stream_draft_layers = 0;
+    int stream_final_every = -1;  /* -1 = use default (3) */
+    float idle_trim_sec = 0;
+    const char *save_state_path = NULL;
+    const char *resume_state_path = NULL;
     const char *prompt_text = NULL;
     const char *force_language = NULL;
     int past_text_conditioning_mode = -1; /* -1 auto, 0 off, 1 on */
     int skip_silence = 0;
+    int enc_int8 = 0;
+    const char *sparse_mlp_path = NULL;
+    const char *sparse_convert_path = NULL;
+    int n_workers = 0;
+    int prefetch = -1;            /* -1 = use default (1) */
+    int prefetch_mb = 256;
     int emit_tokens = 1;
 
     for (int i = 1; i < argc; i++) {
@@ -96,6 +555,36 @@ int main(int argc, char **argv) {
             input_wav = argv[++i];
         } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
             n_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            n_workers = atoi(argv[++i]);
+            if (n_workers < 1) {
+                fprintf(stderr, "Error: --workers must be >= 1\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) {
+            prefetch = atoi(argv[++i]);
+            if (prefetch < 0 || prefetch > 64) {
+                fprintf(stderr, "Error: --prefetch must be in [0,64]\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--prefetch-mb") == 0 && i + 1 < argc) {
+            prefetch_mb = atoi(argv[++i]);
+            if (prefetch_mb < 1) {
+                fprintf(stderr, "Error: --prefetch-mb must be >= 1\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--decode-threads") == 0 && i + 1 < argc) {
+            decode_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--chunk-stats") == 0) {
+            chunk_stats = 1;
+        } else if (strcmp(argv[i], "--flight-dump") == 0 && i + 1 < argc) {
+            flight_dump_path = argv[++i];
+        } else if (strcmp(argv[i], "--perf-counters") == 0) {
+            perf_counters = 1;
+        } else if (strcmp(argv[i], "--autotune") == 0) {
+            autotune = 1;
+        } else if (strcmp(argv[i], "--tune-file") == 0 && i + 1 < argc) {
+            tune_file = argv[++i];
         } else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
             segment_sec = (float)atof(argv[++i]);
         } else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc) {
@@ -104,6 +593,18 @@ int main(int argc, char **argv) {
             stream_mode = 1;
         } else if (strcmp(argv[i], "--stream-max-new-tokens") == 0 && i + 1 < argc) {
             stream_max_new_tokens = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stream-draft-layers") == 0 && i + 1 < argc) {
+            stream_draft_layers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stream-final-every") == 0 && i + 1 < argc) {
+            stream_final_every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--endpoint-ms") == 0 && i + 1 < argc) {
+            endpoint_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--save-state") == 0 && i + 1 < argc) {
+            save_state_path = argv[++i];
+        } else if (strcmp(argv[i], "--resume-state") == 0 && i + 1 < argc) {
+            resume_state_path = argv[++i];
+        } else if (strcmp(argv[i], "--idle-trim") == 0 && i + 1 < argc) {
+            idle_trim_sec = (float)atof(argv[++i]);
         } else if (strcmp(argv[i], "--enc-window-sec") == 0 && i + 1 < argc) {
             enc_window_sec = (float)atof(argv[++i]);
         } else if (strcmp(argv[i], "--past-text") == 0 && i + 1 < argc) {
@@ -117,12 +618,29 @@ int main(int argc, char **argv) {
             return 1;
         } else if (strcmp(argv[i], "--skip-silence") == 0) {
             skip_silence = 1;
+        } else if (strcmp(argv[i], "--enc-int8") == 0) {
+            enc_int8 = 1;
+        } else if (strcmp(argv[i], "--sparse-mlp") == 0 && i + 1 < argc) {
+            sparse_mlp_path = argv[++i];
+        } else if (strcmp(argv[i], "--sparse-mlp-convert") == 0 && i + 1 < argc) {
+            sparse_convert_path = argv[++i];
         } else if (strcmp(argv[i], "--prompt") == 0 && i + 1 < argc) {
             prompt_text = argv[++i];
         } else if (strcmp(argv[i], "--language") == 0 && i + 1 < argc) {
             force_language = argv[++i];
         } else if (strcmp(argv[i], "--stdin") == 0) {
             use_stdin = 1;
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_path = argv[++i];
+        } else if (strcmp(argv[i], "--stdin-format") == 0 && i + 1 < argc) {
+            const char *fmt = argv[++i];
+            if (strcmp(fmt, "s16le") == 0) qwen_set_stdin_raw_format(QWEN_STDIN_S16LE);
+            else if (strcmp(fmt, "ulaw") == 0) qwen_set_stdin_raw_format(QWEN_STDIN_ULAW);
+            else if (strcmp(fmt, "alaw") == 0) qwen_set_stdin_raw_format(QWEN_STDIN_ALAW);
+            else {
+                fprintf(stderr, "Error: --stdin-format must be one of s16le|ulaw|alaw, got '%s'\n", fmt);
+                return 1;
+            }
         } else if (strcmp(argv[i], "--monitor") == 0) {
             qwen_monitor = 1;
         } else if (strcmp(argv[i], "--debug") == 0) {
@@ -139,7 +657,8 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (!model_dir || (!input_wav && !use_stdin)) {
+    if (!model_dir || (!input_wav && !use_stdin && !shm_path && !autotune && !n_workers &&
+                       !sparse_convert_path)) {
         usage(argv[0]);
         return 1;
     }
@@ -151,25 +670,125 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Error: --stream-max-new-tokens must be > 0\n");
         return 1;
     }
+    if (endpoint_ms < 0) {
+        fprintf(stderr, "Error: --endpoint-ms must be >= 0\n");
+        return 1;
+    }
+    if (stream_draft_layers < 0) {
+        fprintf(stderr, "Error: --stream-draft-layers must be >= 0\n");
+        return 1;
+    }
+    if (stream_final_every == 0 || stream_final_every < -1) {
+        fprintf(stderr, "Error: --stream-final-every must be > 0\n");
+        return 1;
+    }
+    if (idle_trim_sec < 0) {
+        fprintf(stderr, "Error: --idle-trim must be >= 0\n");
+        return 1;
+    }
     if (input_wav && use_stdin) {
         fprintf(stderr, "Error: -i and --stdin are mutually exclusive\n");
         return 1;
     }
+    if (shm_path && (input_wav || use_stdin || !stream_mode)) {
+        fprintf(stderr, "Error: --shm requires --stream and excludes -i and --stdin\n");
+        return 1;
+    }
+    if ((save_state_path || resume_state_path) && !(stream_mode && (use_stdin || shm_path))) {
+        fprintf(stderr, "Error: --save-state/--resume-state require --stream --stdin (or --shm)\n");
+        return 1;
+    }
+    if (flight_dump_path && !stream_mode) {
+        fprintf(stderr, "Error: --flight-dump requires --stream\n");
+        return 1;
+    }
+    if (sparse_convert_path && (sparse_mlp_path || autotune)) {
+        fprintf(stderr, "Error: --sparse-mlp-convert excludes --sparse-mlp and --autotune\n");
+        return 1;
+    }
+    if (n_workers && (input_wav || use_stdin || shm_path || autotune)) {
+        fprintf(stderr, "Error: --workers reads input paths from stdin; it excludes -i, --stdin, --shm and --autotune\n");
+        return 1;
+    }
+    if (prefetch >= 0 && !n_workers) {
+        fprintf(stderr, "Error: --prefetch requires --workers\n");
+        return 1;
+    }
+    if (prefetch < 0) prefetch = 1;
 
     qwen_verbose = verbosity;
     emit_tokens = (verbosity > 0);
 
-    /* Initialize thread pool */
-    if (n_threads <= 0) n_threads = qwen_get_num_cpus();
-    qwen_set_threads(n_threads);
+    /* Route drain signals to one thread (before any thread is created, so
+     * every thread inherits the mask). */
+    pthread_t drain_thread;
+    if (save_state_path) {
+        sigemptyset(&drain_sigs);
+        sigaddset(&drain_sigs, SIGTERM);
+        sigaddset(&drain_sigs, SIGINT);
+        pthread_sigmask(SIG_BLOCK, &drain_sigs, NULL);
+        if (pthread_create(&drain_thread, NULL, drain_signal_thread, NULL) == 0)
+            pthread_detach(drain_thread);
+    }
+    pthread_t flight_thread;
+    if (stream_mode) {
+        sigemptyset(&flight_sigs);
+        sigaddset(&flight_sigs, SIGUSR1);
+        pthread_sigmask(SIG_BLOCK, &flight_sigs, NULL);
+        if (pthread_create(&flight_thread, NULL, flight_signal_thread, NULL) == 0)
+            pthread_detach(flight_thread);
+    }
+
+    /* Counters follow threads created after they are opened: open them
+     * before the pool starts. */
+    if (perf_counters) {
+        unsigned mask = qwen_perf_counters_open();
+        if (!mask)
+            fprintf(stderr, "Warning: performance counters unavailable (perf_event_open failed)\n");
+        else if ((mask & (QWEN_PERF_CYCLES | QWEN_PERF_INSTRUCTIONS | QWEN_PERF_LLC_MISSES)) !=
+                 (QWEN_PERF_CYCLES | QWEN_PERF_INSTRUCTIONS | QWEN_PERF_LLC_MISSES))
+            fprintf(stderr, "Warning: some hardware counters unavailable (no PMU access?); "
+                    "reporting the rest\n");
+    }
 
-    /* Load model */
+    /* Initialize thread pool. With --workers, -t is per worker (default: the
+     * usable CPUs split between workers) and the parent loads with all. */
+    if (n_workers) {
+        if (n_threads <= 0) n_threads = qwen_get_num_cpus() / n_workers;
+        if (n_threads < 1) n_threads = 1;
+        qwen_set_threads(qwen_get_num_cpus());
+    } else {
+        if (n_threads <= 0) n_threads = qwen_get_num_cpus();
+        qwen_set_threads(n_threads);
+    }
+
+    /* Load model (applies this host's tuning profile, if any) */
     qwen_ctx_t *ctx = qwen_load(model_dir);
     if (!ctx) {
         fprintf(stderr, "Failed to load model from %s\n", model_dir);
         return 1;
     }
 
+    if (autotune) {
+        int rc = qwen_autotune(ctx, tune_file);
+        qwen_free(ctx);
+        return rc == 0 ? 0 : 1;
+    }
+    if (sparse_convert_path) {
+        int rc = qwen_write_sparse_mlp(ctx, sparse_convert_path);
+        if (rc == 0 && qwen_verbose >= 1)
+            fprintf(stderr, "Wrote 2:4 sparse MLP weights to %s\n", sparse_convert_path);
+        qwen_free(ctx);
+        return rc == 0 ? 0 : 1;
+    }
+    if (sparse_mlp_path && qwen_load_sparse_mlp(ctx, sparse_mlp_path) != 0) {
+        qwen_free(ctx);
+        return 1;
+    }
+    if (tune_file && qwen_tune_apply(ctx, tune_file) < 0)
+        fprintf(stderr, "Warning: cannot read tuning profile %s\n", tune_file);
+    if (decode_threads > 0) qwen_set_decode_threads(decode_threads);
+
     /* Apply segmentation settings */
     if (segment_sec >= 0) ctx->segment_sec = segment_sec;
     if (search_sec >= 0) ctx->search_sec = search_sec;
@@ -187,6 +806,13 @@ int main(int argc, char **argv) {
          * Keep segmented mode default unchanged (off). */
         ctx->past_text_conditioning = 1;
     if (skip_silence) ctx->skip_silence = 1;
+    if (enc_int8 && qwen_set_encoder_int8(ctx, 1) != 0) {
+        qwen_free(ctx);
+        return 1;
+    }
+    qwen_set_stream_endpoint_ms(ctx, endpoint_ms);
+    qwen_set_stream_draft(ctx, stream_draft_layers, 0, stream_final_every);
+    qwen_set_trim_idle_sec(ctx, idle_trim_sec);
     if (prompt_text && qwen_set_prompt(ctx, prompt_text) != 0) {
         fprintf(stderr, "Failed to set --prompt text\n");
         qwen_free(ctx);
@@ -200,36 +826,84 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    if (n_workers) {
+        /* Workers report whole transcripts; no token or endpoint callbacks */
+        if (chunk_stats) qwen_set_chunk_callback(ctx, stream_chunk_stats, NULL);
+        int rc = run_workers(ctx, n_workers, n_threads, stream_mode,
+                             prefetch, (size_t)prefetch_mb << 20);
+        qwen_free(ctx);
+        return rc;
+    }
+
     /* Stream tokens to stdout only in non-silent mode.
      * In silent mode we print the final string returned by the API. */
     if (emit_tokens) qwen_set_token_callback(ctx, stream_token, NULL);
     else qwen_set_token_callback(ctx, NULL, NULL);
+    if (emit_tokens && endpoint_ms > 0) qwen_set_endpoint_callback(ctx, stream_endpoint, NULL);
+    if (chunk_stats) qwen_set_chunk_callback(ctx, stream_chunk_stats, NULL);
+    if (resume_state_path) {
+        size_t blob_size = 0;
+        void *blob = read_file(resume_state_path, &blob_size);
+        if (!blob || qwen_stream_restore(ctx, blob, blob_size) != 0) {
+            fprintf(stderr, "Failed to resume stream state from %s\n", resume_state_path);
+            free(blob);
+            qwen_free(ctx);
+            return 1;
+        }
+        free(blob);
+    }
 
     /* Transcribe */
     char *text = NULL;
-    if (stream_mode && use_stdin) {
-        /* Live incremental streaming from stdin */
-        qwen_live_audio_t *live = qwen_live_audio_start_stdin();
+    pthread_mutex_lock(&flight_mutex);
+    flight_ctx = ctx;
+    pthread_mutex_unlock(&flight_mutex);
+    if (stream_mode && (use_stdin || shm_path)) {
+        /* Live incremental streaming from stdin or a producer's ring */
+        qwen_live_audio_t *live = shm_path ? qwen_live_audio_attach_shm(shm_path)
+                                           : qwen_live_audio_start_stdin();
         if (live) {
+            pthread_mutex_lock(&drain_mutex);
+            drain_ctx = ctx;
+            drain_live = live;
+            pthread_mutex_unlock(&drain_mutex);
             text = qwen_transcribe_stream_live(ctx, live);
-            qwen_live_audio_free(live);
-        }
-    } else if (stream_mode) {
-        /* File-based streaming: load audio fully, then stream-transcribe */
-        int ns = 0;
-        float *samps = qwen_load_wav(input_wav, &ns);
-        if (samps) {
-            text = qwen_transcribe_stream(ctx, samps, ns);
-            free(samps);
+            pthread_mutex_lock(&drain_mutex);
+            drain_live = NULL;
+            pthread_mutex_unlock(&drain_mutex);
+
+            size_t blob_size = 0;
+            void *blob = qwen_stream_take_checkpoint(ctx, &blob_size);
+            if (blob) {
+                /* Drained mid-stream: the reader may still block on stdin,
+                 * so leave it to process exit. */
+                FILE *f = fopen(save_state_path, "wb");
+                if (!f || fwrite(blob, 1, blob_size, f) != blob_size) {
+                    fprintf(stderr, "Failed to write stream state to %s\n", save_state_path);
+                } else if (verbosity >= 1) {
+                    fprintf(stderr, "Saved stream state to %s (%zu bytes)\n",
+                            save_state_path, blob_size);
+                }
+                if (f) fclose(f);
+                free(blob);
+            } else {
+                qwen_live_audio_free(live);
+            }
         }
     } else if (use_stdin) {
         text = qwen_transcribe_stdin(ctx);
     } else {
-        text = qwen_transcribe(ctx, input_wav);
+        /* File-based streaming loads the audio fully, then stream-transcribes */
+        text = transcribe_path(ctx, input_wav, stream_mode);
     }
+    pthread_mutex_lock(&flight_mutex);
+    flight_ctx = NULL;
+    pthread_mutex_unlock(&flight_mutex);
 
     if (text) {
-        if (emit_tokens) printf("\n");
+        if (emit_tokens) {
+            if (!stdout_at_line_start) printf("\n");
+        }
         else printf("%s\n", text);
         free(text);
     } else {
@@ -255,6 +929,7 @@ int main(int argc, char **argv) {
                     audio_s, infer_s, realtime_x);
         }
     }
+    if (perf_counters) qwen_perf_print_phases(stderr, ctx->perf_phase);
 
     qwen_free(ctx);
     return 0;
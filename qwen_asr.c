@@ -14,19 +14,72 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
 #include <math.h>
 #include <limits.h>
+#include <errno.h>
+#include <time.h>
 #include <sys/time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
-/* Global verbose flag */
-int qwen_verbose = 0;
-int qwen_monitor = 0;
+/* Verbose/monitor flags: thread-local so embedders can set them per call */
+__thread int qwen_verbose = 0;
+__thread int qwen_monitor = 0;
+
+static double get_time_ms(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/* ========================================================================
+ * Internal load functions (defined in encoder/decoder .c files)
+ * ======================================================================== */
+
+extern int qwen_encoder_load(qwen_encoder_t *enc, multi_safetensors_t *ms,
+                              const qwen_config_t *cfg);
+extern int qwen_decoder_load(qwen_decoder_t *dec, multi_safetensors_t *ms,
+                              const qwen_config_t *cfg);
+extern int qwen_encoder_quantize_int8(qwen_encoder_t *enc, const qwen_config_t *cfg);
+extern void qwen_encoder_free_int8(qwen_encoder_t *enc, const qwen_config_t *cfg);
+extern int qwen_decoder_write_sp24(const qwen_decoder_t *dec, const qwen_config_t *cfg,
+                                   const char *path);
+extern int qwen_decoder_load_sp24(qwen_decoder_t *dec, const qwen_config_t *cfg,
+                                  const safetensors_file_t *sf);
 
 void qwen_set_token_callback(qwen_ctx_t *ctx, qwen_token_cb cb, void *userdata) {
     ctx->token_cb = cb;
     ctx->token_cb_userdata = userdata;
 }
 
+void qwen_set_endpoint_callback(qwen_ctx_t *ctx, qwen_endpoint_cb cb, void *userdata) {
+    ctx->endpoint_cb = cb;
+    ctx->endpoint_cb_userdata = userdata;
+}
+
+void qwen_set_stream_endpoint_ms(qwen_ctx_t *ctx, int silence_ms) {
+    if (ctx) ctx->stream_endpoint_ms = silence_ms > 0 ? silence_ms : 0;
+}
+
+void qwen_set_stream_draft(qwen_ctx_t *ctx, int n_layers, int max_new_tokens, int final_every) {
+    if (!ctx) return;
+    if (n_layers >= 0) ctx->stream_draft_layers = n_layers;
+    if (max_new_tokens >= 0) ctx->stream_draft_tokens = max_new_tokens;
+    if (final_every >= 1) ctx->stream_final_every = final_every;
+}
+
+void qwen_set_partial_callback(qwen_ctx_t *ctx, qwen_partial_cb cb, void *userdata) {
+    ctx->partial_cb = cb;
+    ctx->partial_cb_userdata = userdata;
+}
+
+void qwen_set_chunk_callback(qwen_ctx_t *ctx, qwen_chunk_cb cb, void *userdata) {
+    ctx->chunk_cb = cb;
+    ctx->chunk_cb_userdata = userdata;
+}
+
 static const char *QWEN_SUPPORTED_LANGUAGES[] = {
     "Chinese", "English", "Cantonese", "Arabic", "German", "French",
     "Spanish", "Portuguese", "Indonesian", "Italian", "Korean", "Russian",
@@ -147,14 +200,81 @@ void qwen_set_dec_layers_limit(qwen_ctx_t *ctx, int n_layers) {
     }
 }
 
-/* ========================================================================
- * Internal load functions (defined in encoder/decoder .c files)
- * ======================================================================== */
+void qwen_set_stream_pipeline(qwen_ctx_t *ctx, int enable) {
+    if (ctx) ctx->stream_pipeline = enable ? 1 : 0;
+}
 
-extern int qwen_encoder_load(qwen_encoder_t *enc, multi_safetensors_t *ms,
-                              const qwen_config_t *cfg);
-extern int qwen_decoder_load(qwen_decoder_t *dec, multi_safetensors_t *ms,
-                              const qwen_config_t *cfg);
+int qwen_set_encoder_int8(qwen_ctx_t *ctx, int enable) {
+    if (!ctx) return -1;
+    if (enable && !ctx->encoder.q8) {
+        if (!ctx->owns_weights) {
+            fprintf(stderr, "qwen_set_encoder_int8: quantize on the model before qwen_clone()\n");
+            return -1;
+        }
+        if (qwen_encoder_quantize_int8(&ctx->encoder, &ctx->config) != 0) {
+            fprintf(stderr, "qwen_set_encoder_int8: out of memory\n");
+            return -1;
+        }
+    }
+    ctx->enc_int8 = enable ? 1 : 0;
+    return 0;
+}
+
+int qwen_write_sparse_mlp(qwen_ctx_t *ctx, const char *path) {
+    if (!ctx || !path) return -1;
+    return qwen_decoder_write_sp24(&ctx->decoder, &ctx->config, path);
+}
+
+int qwen_load_sparse_mlp(qwen_ctx_t *ctx, const char *path) {
+    if (!ctx || !path) return -1;
+    if (!ctx->owns_weights || ctx->sparse_mlp) {
+        fprintf(stderr, "qwen_load_sparse_mlp: load once, on the model before qwen_clone()\n");
+        return -1;
+    }
+    safetensors_file_t *sf = safetensors_open(path);
+    if (!sf) {
+        fprintf(stderr, "qwen_load_sparse_mlp: cannot open %s\n", path);
+        return -1;
+    }
+    if (qwen_decoder_load_sp24(&ctx->decoder, &ctx->config, sf) != 0) {
+        safetensors_close(sf);
+        return -1;
+    }
+    ctx->sparse_mlp = sf;
+    return 0;
+}
+
+void qwen_set_priority(qwen_ctx_t *ctx, int priority) {
+    if (!ctx) return;
+    if (priority == QWEN_PRIORITY_INTERACTIVE || priority == QWEN_PRIORITY_BATCH)
+        ctx->priority = priority;
+}
+
+void qwen_set_job_threads(qwen_ctx_t *ctx, int n_threads) {
+    if (ctx && n_threads >= 0) ctx->job_threads = n_threads;
+}
+
+void qwen_set_trim_policy(qwen_ctx_t *ctx, int policy, int baseline_tokens) {
+    if (!ctx) return;
+    if (policy == QWEN_TRIM_NONE || policy == QWEN_TRIM_AFTER_JOB)
+        ctx->trim_policy = policy;
+    ctx->trim_baseline_tokens = baseline_tokens > 0 ? baseline_tokens : 0;
+}
+
+void qwen_set_trim_idle_sec(qwen_ctx_t *ctx, float idle_sec) {
+    if (ctx) ctx->trim_idle_sec = idle_sec > 0.0f ? idle_sec : 0.0f;
+}
+
+void qwen_trim(qwen_ctx_t *ctx) {
+    if (!ctx) return;
+    /* Both are private to this context / the calling thread: no need to
+     * wait for pool threads. */
+    qwen_decoder_trim(ctx, ctx->trim_baseline_tokens);
+    qwen_release_scratch();
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
 
 /* ========================================================================
  * Config Detection
@@ -223,15 +343,35 @@ static int detect_config(qwen_ctx_t *ctx) {
  * Model Loading
  * ======================================================================== */
 
+typedef struct {
+    qwen_ctx_t *ctx;
+    int verbose;               /* loader's qwen_verbose (it is per thread) */
+    int rc;
+    double ms;
+} decoder_load_job_t;
+
+static void *decoder_load_main(void *arg) {
+    decoder_load_job_t *job = (decoder_load_job_t *)arg;
+    qwen_verbose = job->verbose;
+    double t0 = get_time_ms();
+    job->rc = qwen_decoder_load(&job->ctx->decoder,
+                                (multi_safetensors_t *)job->ctx->safetensors,
+                                &job->ctx->config);
+    job->ms = get_time_ms() - t0;
+    return NULL;
+}
+
 qwen_ctx_t *qwen_load(const char *model_dir) {
     qwen_ctx_t *ctx = (qwen_ctx_t *)calloc(1, sizeof(qwen_ctx_t));
     if (!ctx) return NULL;
     snprintf(ctx->model_dir, sizeof(ctx->model_dir), "%s", model_dir);
+    ctx->owns_weights = 1;
 
     /* Open safetensors (multi-shard) */
     if (qwen_verbose >= 1)
         fprintf(stderr, "Loading model from %s\n", model_dir);
 
+    double t_load = get_time_ms();
     multi_safetensors_t *ms = multi_safetensors_open(model_dir);
     if (!ms) {
         fprintf(stderr, "qwen_load: cannot open safetensors in %s\n", model_dir);
@@ -242,18 +382,31 @@ qwen_ctx_t *qwen_load(const char *model_dir) {
 
     /* Detect model configuration */
     detect_config(ctx);
+    double open_ms = get_time_ms() - t_load;
+
+    /* The decoder keeps its bf16 weights mmapped: a helper thread builds the
+     * fused gate/up weights and faults the rest in while the pool converts
+     * the encoder weights to f32. */
+    if (qwen_verbose >= 1) fprintf(stderr, "Loading encoder and decoder weights...\n");
+    decoder_load_job_t dec_job = { .ctx = ctx, .verbose = qwen_verbose };
+    pthread_t dec_thread;
+    int dec_async = pthread_create(&dec_thread, NULL, decoder_load_main, &dec_job) == 0;
 
-    /* Load encoder weights */
-    if (qwen_verbose >= 1) fprintf(stderr, "Loading encoder weights...\n");
-    if (qwen_encoder_load(&ctx->encoder, ms, &ctx->config) != 0) {
+    double t0 = get_time_ms();
+    int enc_rc = qwen_encoder_load(&ctx->encoder, ms, &ctx->config);
+    double enc_ms = get_time_ms() - t0;
+
+    t0 = get_time_ms();
+    if (dec_async) pthread_join(dec_thread, NULL);
+    else decoder_load_main(&dec_job);
+    double dec_wait_ms = get_time_ms() - t0;
+
+    if (enc_rc != 0) {
         fprintf(stderr, "qwen_load: failed to load encoder\n");
         qwen_free(ctx);
         return NULL;
     }
-
-    /* Load decoder weights */
-    if (qwen_verbose >= 1) fprintf(stderr, "Loading decoder weights...\n");
-    if (qwen_decoder_load(&ctx->decoder, ms, &ctx->config) != 0) {
+    if (dec_job.rc != 0) {
         fprintf(stderr, "qwen_load: failed to load decoder\n");
         qwen_free(ctx);
         return NULL;
@@ -268,11 +421,72 @@ qwen_ctx_t *qwen_load(const char *model_dir) {
     ctx->stream_rollback = 5;
     ctx->stream_unfixed_chunks = 2;
     ctx->stream_max_new_tokens = 32;
+    ctx->stream_draft_layers = 0;  /* two-pass streaming off */
+    ctx->stream_final_every = 3;
     ctx->past_text_conditioning = 0;
     ctx->skip_silence = 0;
     ctx->dec_layers_limit = 0;  /* 0 = use all layers */
+    ctx->stream_pipeline = 1;
 
-    if (qwen_verbose >= 1) fprintf(stderr, "Model loaded.\n");
+    t0 = get_time_ms();
+    if (qwen_tune_apply(ctx, NULL) < 0 && qwen_verbose >= 1)
+        fprintf(stderr, "qwen_load: cannot read tuning profile %s\n", qwen_tune_default_path());
+    double tune_ms = get_time_ms() - t0;
+
+    if (qwen_verbose >= 1) {
+        fprintf(stderr,
+                "Load: %.0f ms (open %.0f ms, encoder %.0f ms, decoder %.0f ms "
+                "with %.0f ms not overlapped, tuning %.0f ms)\n",
+                get_time_ms() - t_load, open_ms, enc_ms, dec_job.ms,
+                dec_async ? dec_wait_ms : dec_job.ms, tune_ms);
+        fprintf(stderr, "Model loaded.\n");
+    }
+    return ctx;
+}
+
+qwen_ctx_t *qwen_clone(const qwen_ctx_t *model) {
+    if (!model) return NULL;
+    qwen_ctx_t *ctx = (qwen_ctx_t *)malloc(sizeof(qwen_ctx_t));
+    if (!ctx) return NULL;
+
+    /* Config, weights and settings are copied; everything a transcription
+     * allocates or caches starts empty. */
+    *ctx = *model;
+    ctx->owns_weights = 0;
+
+    ctx->kv_cache_k = ctx->kv_cache_v = NULL;
+    ctx->kv_cache_len = ctx->kv_cache_max = 0;
+    ctx->dec_x = ctx->dec_x_norm = ctx->dec_q = ctx->dec_k = ctx->dec_v = NULL;
+    ctx->dec_attn_out = ctx->dec_proj_out = NULL;
+    ctx->dec_gate = ctx->dec_up = ctx->dec_ffn_out = NULL;
+    ctx->dec_rope_cos = ctx->dec_rope_sin = NULL;
+    ctx->pref_x = ctx->pref_x_norm = ctx->pref_q = ctx->pref_k = ctx->pref_v = NULL;
+    ctx->pref_attn_out = ctx->pref_proj_out = ctx->pref_ffn_out = NULL;
+    ctx->pref_gate = ctx->pref_gate_up = NULL;
+    ctx->pref_seq_cap = 0;
+    ctx->rope_cache_cos = ctx->rope_cache_sin = ctx->rope_inv_freq = NULL;
+    ctx->rope_cache_cap = ctx->rope_inv_freq_half = 0;
+
+    ctx->token_cb = NULL;
+    ctx->partial_cb = NULL;
+    ctx->endpoint_cb = NULL;
+    ctx->chunk_cb = NULL;
+
+    ctx->prompt = NULL;
+    ctx->force_language = NULL;
+    ctx->prompt_tokens = ctx->force_prompt_tokens = NULL;
+    ctx->n_prompt_tokens = ctx->n_force_prompt_tokens = 0;
+    ctx->prompt_tokens_ready = 0;
+    if ((model->prompt && qwen_set_prompt(ctx, model->prompt) != 0) ||
+        (model->force_language && qwen_set_force_language(ctx, model->force_language) != 0)) {
+        qwen_free(ctx);
+        return NULL;
+    }
+
+    ctx->checkpoint_requested = 0;
+    ctx->checkpoint_blob = ctx->restore_blob = NULL;
+    ctx->checkpoint_size = ctx->restore_size = 0;
+    ctx->flight = NULL;
     return ctx;
 }
 
@@ -285,36 +499,40 @@ void qwen_free(qwen_ctx_t *ctx) {
 
     #define FREE0(p) do { free(p); (p) = NULL; } while (0)
 
-    /* Encoder conv stem */
-    FREE0(ctx->encoder.conv1_weight); FREE0(ctx->encoder.conv1_bias);
-    FREE0(ctx->encoder.conv2_weight); FREE0(ctx->encoder.conv2_bias);
-    FREE0(ctx->encoder.conv3_weight); FREE0(ctx->encoder.conv3_bias);
-    FREE0(ctx->encoder.conv_out_weight);
-
-    /* Encoder layers (weights are pre-converted f32, all allocated) */
-    for (int i = 0; i < ctx->config.enc_layers; i++) {
-        qwen_enc_layer_t *l = &ctx->encoder.layers[i];
-        FREE0(l->wq_weight); FREE0(l->wq_bias);
-        FREE0(l->wk_weight); FREE0(l->wk_bias);
-        FREE0(l->wv_weight); FREE0(l->wv_bias);
-        FREE0(l->wo_weight); FREE0(l->wo_bias);
-        FREE0(l->attn_norm_weight); FREE0(l->attn_norm_bias);
-        FREE0(l->fc1_weight); FREE0(l->fc1_bias);
-        FREE0(l->fc2_weight); FREE0(l->fc2_bias);
-        FREE0(l->ffn_norm_weight); FREE0(l->ffn_norm_bias);
-    }
-    FREE0(ctx->encoder.ln_post_weight); FREE0(ctx->encoder.ln_post_bias);
-    FREE0(ctx->encoder.proj1_weight); FREE0(ctx->encoder.proj1_bias);
-    FREE0(ctx->encoder.proj2_weight); FREE0(ctx->encoder.proj2_bias);
-
-    /* Decoder layers */
-    for (int i = 0; i < ctx->config.dec_layers; i++) {
-        qwen_dec_layer_t *l = &ctx->decoder.layers[i];
-        FREE0(l->q_norm_weight); FREE0(l->k_norm_weight);
-        FREE0(l->input_norm); FREE0(l->post_attn_norm);
-        FREE0(l->gate_up_fused_bf16);
-    }
-    FREE0(ctx->decoder.norm);
+    /* Weights are shared with qwen_clone() contexts and owned by the model */
+    if (ctx->owns_weights) {
+        /* Encoder conv stem */
+        FREE0(ctx->encoder.conv1_weight); FREE0(ctx->encoder.conv1_bias);
+        FREE0(ctx->encoder.conv2_weight); FREE0(ctx->encoder.conv2_bias);
+        FREE0(ctx->encoder.conv3_weight); FREE0(ctx->encoder.conv3_bias);
+        FREE0(ctx->encoder.conv_out_weight);
+
+        /* Encoder layers (weights are pre-converted f32, all allocated) */
+        for (int i = 0; i < ctx->config.enc_layers; i++) {
+            qwen_enc_layer_t *l = &ctx->encoder.layers[i];
+            FREE0(l->wq_weight); FREE0(l->wq_bias);
+            FREE0(l->wk_weight); FREE0(l->wk_bias);
+            FREE0(l->wv_weight); FREE0(l->wv_bias);
+            FREE0(l->wo_weight); FREE0(l->wo_bias);
+            FREE0(l->attn_norm_weight); FREE0(l->attn_norm_bias);
+            FREE0(l->fc1_weight); FREE0(l->fc1_bias);
+            FREE0(l->fc2_weight); FREE0(l->fc2_bias);
+            FREE0(l->ffn_norm_weight); FREE0(l->ffn_norm_bias);
+        }
+        FREE0(ctx->encoder.ln_post_weight); FREE0(ctx->encoder.ln_post_bias);
+        FREE0(ctx->encoder.proj1_weight); FREE0(ctx->encoder.proj1_bias);
+        FREE0(ctx->encoder.proj2_weight); FREE0(ctx->encoder.proj2_bias);
+        qwen_encoder_free_int8(&ctx->encoder, &ctx->config);
+
+        /* Decoder layers */
+        for (int i = 0; i < ctx->config.dec_layers; i++) {
+            qwen_dec_layer_t *l = &ctx->decoder.layers[i];
+            FREE0(l->q_norm_weight); FREE0(l->k_norm_weight);
+            FREE0(l->input_norm); FREE0(l->post_attn_norm);
+            FREE0(l->gate_up_fused_bf16);
+        }
+        FREE0(ctx->decoder.norm);
+    }
 
     #undef FREE0
 
@@ -345,10 +563,18 @@ void qwen_free(qwen_ctx_t *ctx) {
     free(ctx->prompt_tokens);
     free(ctx->force_prompt_tokens);
 
+    /* Stream checkpoint state */
+    free(ctx->checkpoint_blob);
+    free(ctx->restore_blob);
+    free(ctx->flight);
+
     /* Close safetensors */
-    if (ctx->safetensors) {
+    if (ctx->owns_weights && ctx->safetensors) {
         multi_safetensors_close((multi_safetensors_t *)ctx->safetensors);
     }
+    if (ctx->owns_weights && ctx->sparse_mlp) {
+        safetensors_close((safetensors_file_t *)ctx->sparse_mlp);
+    }
 
     free(ctx);
 }
@@ -379,22 +605,20 @@ static const int PROMPT_SUFFIX_BASE[] = {
 #define PREFIX_TAIL_LEN 6
 #define SUFFIX_BASE_LEN 6
 
-/* Convert a single token embedding from bf16 to f32 */
-static void tok_embed_bf16_to_f32(float *dst, const uint16_t *tok_emb_bf16,
-                                  int token_id, int dim) {
-    const uint16_t *src = tok_emb_bf16 + (size_t)token_id * dim;
+/* Convert a single token embedding (bf16, or fp16 checkpoint) to f32 */
+static void tok_embed_to_f32(float *dst, const qwen_decoder_t *dec,
+                             int token_id, int dim) {
+    const uint16_t *src = dec->tok_embeddings_bf16 + (size_t)token_id * dim;
+    if (dec->f16) {
+        qwen_f16_to_f32(dst, src, (size_t)dim);
+        return;
+    }
     for (int i = 0; i < dim; i++) {
         uint32_t f32_bits = ((uint32_t)src[i]) << 16;
         memcpy(&dst[i], &f32_bits, sizeof(float));
     }
 }
 
-static double get_time_ms(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
-}
-
 static int cmp_float_asc(const void *a, const void *b) {
     float fa = *(const float *)a;
     float fb = *(const float *)b;
@@ -403,6 +627,45 @@ static int cmp_float_asc(const void *a, const void *b) {
     return 0;
 }
 
+/* Length in samples of the low-energy run that ends the span. Uses the
+ * same 10 ms RMS windows and adaptive noise-floor threshold as
+ * compact_silence(). Only the last max_samples are looked at, so the cost
+ * per chunk does not grow with the utterance. */
+static int trailing_silence_samples(const float *samples, int n_samples, int max_samples) {
+    const int win = 160;
+    const float base_thresh = 0.002f;
+    const float max_thresh = 0.025f;
+    if (n_samples > max_samples) {
+        samples += n_samples - max_samples;
+        n_samples = max_samples;
+    }
+    int n_win = n_samples / win;
+    if (n_win <= 0) return 0;
+
+    float *rms_vals = (float *)malloc((size_t)n_win * 2 * sizeof(float));
+    if (!rms_vals) return 0;
+    float *sorted = rms_vals + n_win;
+    const float *base = samples + (n_samples - n_win * win);
+    for (int w = 0; w < n_win; w++) {
+        float energy = 0.0f;
+        for (int i = 0; i < win; i++) {
+            float v = base[w * win + i];
+            energy += v * v;
+        }
+        rms_vals[w] = sqrtf(energy / (float)win);
+    }
+    memcpy(sorted, rms_vals, (size_t)n_win * sizeof(float));
+    qsort(sorted, (size_t)n_win, sizeof(float), cmp_float_asc);
+    float thresh = sorted[(int)((n_win - 1) * 0.25f)] * 1.8f;
+    if (thresh < base_thresh) thresh = base_thresh;
+    if (thresh > max_thresh) thresh = max_thresh;
+
+    int n_silent = 0;
+    for (int w = n_win - 1; w >= 0 && rms_vals[w] <= thresh; w--) n_silent++;
+    free(rms_vals);
+    return n_silent * win;
+}
+
 /* Drop long silent spans while preserving short pauses for readability.
  * Uses adaptive RMS gating with spike rejection for noisy backgrounds. */
 static float *compact_silence(const float *samples, int n_samples, int *out_samples) {
@@ -627,22 +890,27 @@ static char *transcribe_segment(qwen_ctx_t *ctx, const float *samples,
     int n_text_tokens = 0;
 
     /* ---- Mel spectrogram ---- */
+    qwen_perf_sample_t ps;
+    qwen_phase_begin(&ps);
     double t0 = get_time_ms();
     int mel_frames = 0;
     float *mel = qwen_mel_spectrogram(samples, n_samples, &mel_frames);
     if (!mel) return NULL;
     double mel_ms = get_time_ms() - t0;
+    qwen_phase_end(&ctx->perf_phase[QWEN_PHASE_MEL], &ps);
 
     if (qwen_verbose >= 2)
         fprintf(stderr, "  Mel: %d frames (%.0f ms)\n", mel_frames, mel_ms);
 
     /* ---- Encoder ---- */
+    qwen_phase_begin(&ps);
     t0 = get_time_ms();
     int enc_seq_len = 0;
     float *enc_output = qwen_encoder_forward(ctx, mel, mel_frames, &enc_seq_len);
     free(mel);
     if (!enc_output) return NULL;
     double enc_ms = get_time_ms() - t0;
+    qwen_phase_end(&ctx->perf_phase[QWEN_PHASE_ENCODER], &ps);
 
     if (qwen_verbose >= 2)
         fprintf(stderr, "  Encoder: %d tokens (%.0f ms)\n", enc_seq_len, enc_ms);
@@ -669,25 +937,25 @@ static char *transcribe_segment(qwen_ctx_t *ctx, const float *samples,
     /* Embed prefix head: <|im_start|>system\n */
     int off = 0;
     for (int i = 0; i < PREFIX_HEAD_LEN; i++) {
-        tok_embed_bf16_to_f32(input_embeds + off * dim,
-                              ctx->decoder.tok_embeddings_bf16,
-                              PROMPT_PREFIX_HEAD[i], dim);
+        tok_embed_to_f32(input_embeds + off * dim,
+                         &ctx->decoder,
+                         PROMPT_PREFIX_HEAD[i], dim);
         off++;
     }
 
     /* Embed optional prompt text (system content) */
     for (int i = 0; i < ctx->n_prompt_tokens; i++) {
-        tok_embed_bf16_to_f32(input_embeds + off * dim,
-                              ctx->decoder.tok_embeddings_bf16,
-                              ctx->prompt_tokens[i], dim);
+        tok_embed_to_f32(input_embeds + off * dim,
+                         &ctx->decoder,
+                         ctx->prompt_tokens[i], dim);
         off++;
     }
 
     /* Embed prefix tail: <|im_end|>\n<|im_start|>user\n<|audio_start|> */
     for (int i = 0; i < PREFIX_TAIL_LEN; i++) {
-        tok_embed_bf16_to_f32(input_embeds + off * dim,
-                              ctx->decoder.tok_embeddings_bf16,
-                              PROMPT_PREFIX_TAIL[i], dim);
+        tok_embed_to_f32(input_embeds + off * dim,
+                         &ctx->decoder,
+                         PROMPT_PREFIX_TAIL[i], dim);
         off++;
     }
 
@@ -702,16 +970,16 @@ static char *transcribe_segment(qwen_ctx_t *ctx, const float *samples,
     /* Embed suffix base: <|audio_end|><|im_end|>\n<|im_start|>assistant\n */
     int suffix_off = prefix_len + enc_seq_len;
     for (int i = 0; i < SUFFIX_BASE_LEN; i++) {
-        tok_embed_bf16_to_f32(input_embeds + (suffix_off + i) * dim,
-                              ctx->decoder.tok_embeddings_bf16,
-                              PROMPT_SUFFIX_BASE[i], dim);
+        tok_embed_to_f32(input_embeds + (suffix_off + i) * dim,
+                         &ctx->decoder,
+                         PROMPT_SUFFIX_BASE[i], dim);
     }
 
     /* Optional forced-language suffix: "language X" + <asr_text> */
     for (int i = 0; i < ctx->n_force_prompt_tokens; i++) {
-        tok_embed_bf16_to_f32(input_embeds + (suffix_off + SUFFIX_BASE_LEN + i) * dim,
-                              ctx->decoder.tok_embeddings_bf16,
-                              ctx->force_prompt_tokens[i], dim);
+        tok_embed_to_f32(input_embeds + (suffix_off + SUFFIX_BASE_LEN + i) * dim,
+                         &ctx->decoder,
+                         ctx->force_prompt_tokens[i], dim);
     }
 
     /* Optional past-text conditioning tokens (for segmented mode).
@@ -719,17 +987,18 @@ static char *transcribe_segment(qwen_ctx_t *ctx, const float *samples,
      * restarts from a new ASR span instead of terminating immediately. */
     int past_off = suffix_off + suffix_len;
     for (int i = 0; i < n_past_tokens; i++) {
-        tok_embed_bf16_to_f32(input_embeds + (past_off + i) * dim,
-                              ctx->decoder.tok_embeddings_bf16,
-                              past_tokens[i], dim);
+        tok_embed_to_f32(input_embeds + (past_off + i) * dim,
+                         &ctx->decoder,
+                         past_tokens[i], dim);
     }
     if (n_past_tokens > 0) {
-        tok_embed_bf16_to_f32(input_embeds + (past_off + n_past_tokens) * dim,
-                              ctx->decoder.tok_embeddings_bf16,
-                              QWEN_TOKEN_ASR_TEXT, dim);
+        tok_embed_to_f32(input_embeds + (past_off + n_past_tokens) * dim,
+                         &ctx->decoder,
+                         QWEN_TOKEN_ASR_TEXT, dim);
     }
 
     /* ---- Decoder prefill ---- */
+    qwen_phase_begin(&ps);
     t0 = get_time_ms();
     ctx->kv_cache_len = 0; /* Reset KV cache for this segment */
     int prefill_len = total_seq - 1; /* prefill all but last */
@@ -741,10 +1010,12 @@ static char *transcribe_segment(qwen_ctx_t *ctx, const float *samples,
     free(input_embeds);
 
     double prefill_ms = get_time_ms() - t0;
+    qwen_phase_end(&ctx->perf_phase[QWEN_PHASE_PREFILL], &ps);
     if (qwen_verbose >= 2)
         fprintf(stderr, "  Prefill: %d tokens (%.0f ms)\n", total_seq, prefill_ms);
 
     /* ---- Autoregressive decode ---- */
+    qwen_phase_begin(&ps);
     t0 = get_time_ms();
     int max_tokens = 2048;
     int n_generated = 0;
@@ -784,11 +1055,13 @@ static char *transcribe_segment(qwen_ctx_t *ctx, const float *samples,
         }
 
         /* Embed and generate next token */
-        tok_embed_bf16_to_f32(tmp_embed, ctx->decoder.tok_embeddings_bf16, token, dim);
+        tok_embed_to_f32(tmp_embed, &ctx->decoder, token, dim);
+        qwen_sched_yield();
         token = qwen_decoder_forward(ctx, tmp_embed);
     }
 
     double decode_ms = get_time_ms() - t0;
+    qwen_phase_end(&ctx->perf_phase[QWEN_PHASE_DECODE], &ps);
     if (qwen_verbose >= 2)
         fprintf(stderr, "  Decode: %d tokens (%.0f ms, %.1f ms/token)\n",
                 n_generated, decode_ms,
@@ -868,12 +1141,13 @@ static void segment_emit_cb(const char *piece, void *userdata) {
     st->downstream_cb(piece, st->downstream_userdata);
 }
 
-char *qwen_transcribe_audio(qwen_ctx_t *ctx, const float *samples, int n_samples) {
+static char *transcribe_audio_impl(qwen_ctx_t *ctx, const float *samples, int n_samples) {
     ctx->perf_total_ms = 0;
     ctx->perf_text_tokens = 0;
     ctx->perf_audio_ms = 1000.0 * (double)n_samples / (double)QWEN_SAMPLE_RATE;
     ctx->perf_encode_ms = 0;
     ctx->perf_decode_ms = 0;
+    memset(ctx->perf_phase, 0, sizeof(ctx->perf_phase));
 
     const float *audio_samples = samples;
     int audio_n_samples = n_samples;
@@ -1160,6 +1434,483 @@ static void stream_clear_enc_cache(stream_enc_window_t *enc_cache,
     *next_window_start = new_start_sample;
 }
 
+/* Drop evicted slots in front of the live windows and shrink the array. */
+static void stream_compact_enc_cache(stream_enc_window_t **enc_cache,
+                                     int *n_enc_cache,
+                                     int *enc_cache_start,
+                                     int *enc_cache_cap) {
+    int n_live = *n_enc_cache - *enc_cache_start;
+    if (*enc_cache_start > 0 && n_live > 0) {
+        memmove(*enc_cache, *enc_cache + *enc_cache_start,
+                (size_t)n_live * sizeof(stream_enc_window_t));
+    }
+    *n_enc_cache = n_live;
+    *enc_cache_start = 0;
+
+    int new_cap = n_live > 8 ? n_live : 8;
+    if (*enc_cache_cap > new_cap) {
+        stream_enc_window_t *tmp = (stream_enc_window_t *)realloc(
+            *enc_cache, (size_t)new_cap * sizeof(stream_enc_window_t));
+        if (tmp) {
+            *enc_cache = tmp;
+            *enc_cache_cap = new_cap;
+        }
+    }
+}
+
+/* Live stream checkpoint blob: a versioned header with the model shape,
+ * then counters, token arrays, the current utterance text, encoder windows,
+ * the unprocessed audio tail and (optionally) prefill embeddings + KV.
+ * Native byte order; float arrays may be stored as bf16. */
+#define QWEN_CKPT_MAGIC   "QASRCKPT"
+#define QWEN_CKPT_VERSION 1
+
+typedef struct {
+    unsigned char *data;
+    size_t len, cap;
+    int failed;
+} ckpt_writer_t;
+
+typedef struct {
+    const unsigned char *data;
+    size_t len, pos;
+    int failed;
+} ckpt_reader_t;
+
+static void ckpt_put(ckpt_writer_t *w, const void *p, size_t n) {
+    if (w->failed) return;
+    if (w->len + n > w->cap) {
+        size_t new_cap = w->cap > 0 ? w->cap : 65536;
+        while (new_cap < w->len + n) new_cap *= 2;
+        unsigned char *tmp = (unsigned char *)realloc(w->data, new_cap);
+        if (!tmp) { w->failed = 1; return; }
+        w->data = tmp;
+        w->cap = new_cap;
+    }
+    if (n > 0) memcpy(w->data + w->len, p, n);
+    w->len += n;
+}
+
+static void ckpt_put_i64(ckpt_writer_t *w, int64_t v) { ckpt_put(w, &v, sizeof(v)); }
+
+static void ckpt_put_floats(ckpt_writer_t *w, const float *x, size_t n, int bf16) {
+    if (!bf16) {
+        ckpt_put(w, x, n * sizeof(float));
+        return;
+    }
+    uint16_t buf[1024];
+    for (size_t i = 0; i < n; i += 1024) {
+        size_t m = n - i < 1024 ? n - i : 1024;
+        for (size_t j = 0; j < m; j++) {
+            uint32_t u;
+            memcpy(&u, x + i + j, sizeof(u));
+            buf[j] = (uint16_t)((u + 0x7FFFu + ((u >> 16) & 1u)) >> 16);
+        }
+        ckpt_put(w, buf, m * sizeof(uint16_t));
+    }
+}
+
+static void ckpt_get(ckpt_reader_t *r, void *p, size_t n) {
+    if (r->failed || n > r->len - r->pos) {
+        r->failed = 1;
+        if (p && n > 0) memset(p, 0, n);
+        return;
+    }
+    if (p) memcpy(p, r->data + r->pos, n);
+    r->pos += n;
+}
+
+static int64_t ckpt_get_i64(ckpt_reader_t *r) {
+    int64_t v = 0;
+    ckpt_get(r, &v, sizeof(v));
+    return v;
+}
+
+static void ckpt_get_floats(ckpt_reader_t *r, float *x, size_t n, int bf16) {
+    if (!bf16) {
+        ckpt_get(r, x, n * sizeof(float));
+        return;
+    }
+    if (r->failed || n > (r->len - r->pos) / sizeof(uint16_t)) {
+        r->failed = 1;
+        return;
+    }
+    const unsigned char *src = r->data + r->pos;
+    for (size_t i = 0; i < n; i++) {
+        uint16_t h;
+        memcpy(&h, src + i * sizeof(uint16_t), sizeof(h));
+        uint32_t u = (uint32_t)h << 16;
+        memcpy(x + i, &u, sizeof(u));
+    }
+    r->pos += n * sizeof(uint16_t);
+}
+
+/* Read a token array of n entries into *arr, growing *cap as needed. */
+static void ckpt_get_tokens(ckpt_reader_t *r, int **arr, int *cap, int64_t n) {
+    if (n < 0 || n > INT_MAX / 2 || (size_t)n > (r->len - r->pos) / sizeof(int)) {
+        r->failed = 1;
+        return;
+    }
+    if (n > *cap) {
+        int new_cap = *cap;
+        while (new_cap < n) new_cap *= 2;
+        int *tmp = (int *)realloc(*arr, (size_t)new_cap * sizeof(int));
+        if (!tmp) { r->failed = 1; return; }
+        *arr = tmp;
+        *cap = new_cap;
+    }
+    ckpt_get(r, *arr, (size_t)n * sizeof(int));
+}
+
+/* Header: magic, version, flags, then the model shape the state depends on. */
+static void ckpt_put_header(ckpt_writer_t *w, const qwen_ctx_t *ctx, int flags,
+                            int enc_window_samples) {
+    const qwen_config_t *cfg = &ctx->config;
+    ckpt_put(w, QWEN_CKPT_MAGIC, 8);
+    ckpt_put_i64(w, QWEN_CKPT_VERSION);
+    ckpt_put_i64(w, flags);
+    ckpt_put_i64(w, cfg->dec_hidden);
+    ckpt_put_i64(w, cfg->dec_layers);
+    ckpt_put_i64(w, (int64_t)cfg->dec_kv_heads * cfg->dec_head_dim);
+    ckpt_put_i64(w, enc_window_samples);
+}
+
+static int ckpt_get_header(ckpt_reader_t *r, const qwen_ctx_t *ctx, int *flags,
+                           int *enc_window_samples) {
+    const qwen_config_t *cfg = &ctx->config;
+    char magic[8];
+    ckpt_get(r, magic, sizeof(magic));
+    int64_t version = ckpt_get_i64(r);
+    int64_t f = ckpt_get_i64(r);
+    int64_t hidden = ckpt_get_i64(r);
+    int64_t layers = ckpt_get_i64(r);
+    int64_t kv_dim = ckpt_get_i64(r);
+    int64_t window = ckpt_get_i64(r);
+    if (r->failed || memcmp(magic, QWEN_CKPT_MAGIC, 8) != 0 ||
+        version != QWEN_CKPT_VERSION) return -1;
+    if (hidden != cfg->dec_hidden || layers != cfg->dec_layers ||
+        kv_dim != (int64_t)cfg->dec_kv_heads * cfg->dec_head_dim ||
+        window < QWEN_HOP_LENGTH * 100 || window > QWEN_HOP_LENGTH * 800) return -1;
+    *flags = (int)f;
+    *enc_window_samples = (int)window;
+    return 0;
+}
+
+void qwen_stream_request_checkpoint(qwen_ctx_t *ctx, qwen_live_audio_t *live, int flags) {
+    if (!ctx) return;
+    ctx->checkpoint_flags = flags & (QWEN_CHECKPOINT_KV | QWEN_CHECKPOINT_COMPACT);
+    __atomic_store_n(&ctx->checkpoint_requested, 1, __ATOMIC_RELEASE);
+    if (live) qwen_live_audio_wake(live);
+}
+
+void *qwen_stream_take_checkpoint(qwen_ctx_t *ctx, size_t *out_size) {
+    if (!ctx || !ctx->checkpoint_blob) return NULL;
+    void *blob = ctx->checkpoint_blob;
+    if (out_size) *out_size = ctx->checkpoint_size;
+    ctx->checkpoint_blob = NULL;
+    ctx->checkpoint_size = 0;
+    return blob;
+}
+
+int qwen_stream_restore(qwen_ctx_t *ctx, const void *blob, size_t size) {
+    if (!ctx || !blob) return -1;
+    ckpt_reader_t r = { (const unsigned char *)blob, size, 0, 0 };
+    int flags = 0, window = 0;
+    if (ckpt_get_header(&r, ctx, &flags, &window) != 0) {
+        fprintf(stderr, "qwen_stream_restore: checkpoint does not match this model\n");
+        return -1;
+    }
+    void *copy = malloc(size);
+    if (!copy) return -1;
+    memcpy(copy, blob, size);
+    free(ctx->restore_blob);
+    ctx->restore_blob = copy;
+    ctx->restore_size = size;
+    return 0;
+}
+
+/* Pipelined live streaming: while chunk k decodes, a dedicated encoder
+ * stage computes mel + encoder output for chunk k+1 (its completed windows
+ * and its partial tail window) on its own share of the thread pool, which
+ * it acquires from the scheduler for each job.
+ * Results are keyed by sample range and only used when chunk k+1 asks for
+ * exactly that range; anything else falls back to inline encoding. */
+#define QWEN_STREAM_STAGE_MAX_WINDOWS 4
+
+typedef struct {
+    qwen_ctx_t *ctx;
+    qwen_live_audio_t *live;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int n_threads;             /* pool budget of the stage thread */
+    int verbose, monitor;      /* creator's per-thread flags */
+    int shutdown;
+    int pending;               /* job submitted, results not yet consumed */
+    int running;               /* job submitted, not yet finished */
+
+    /* Job: windows [start, start + n_windows*window), tail up to end.
+     * The first n_have samples are copied at submit time, the rest is
+     * read from the live buffer once it arrives. */
+    int64_t start_sample;
+    int64_t end_sample;
+    int window_samples;
+    int n_windows;
+    float *samples;
+    int64_t n_have;
+    int64_t samples_cap;
+
+    /* Results */
+    float *win_enc[QWEN_STREAM_STAGE_MAX_WINDOWS];
+    int win_seq[QWEN_STREAM_STAGE_MAX_WINDOWS];
+    float *tail_enc;
+    int tail_seq;
+    int failed;
+    double enc_ms;
+} stream_enc_stage_t;
+
+static void stream_stage_encode(stream_enc_stage_t *st, int64_t need) {
+    double t0 = get_time_ms();
+    for (int i = 0; i < st->n_windows; i++) {
+        if (stream_encode_span(st->ctx,
+                               st->samples + (size_t)i * st->window_samples,
+                               st->window_samples,
+                               &st->win_enc[i], &st->win_seq[i]) != 0 ||
+            !st->win_enc[i] || st->win_seq[i] <= 0) {
+            st->failed = 1;
+            return;
+        }
+    }
+    int64_t tail_off = (int64_t)st->n_windows * st->window_samples;
+    if (need > tail_off &&
+        stream_encode_span(st->ctx, st->samples + (size_t)tail_off,
+                           (int)(need - tail_off),
+                           &st->tail_enc, &st->tail_seq) != 0) {
+        st->failed = 1;
+        return;
+    }
+    st->enc_ms = get_time_ms() - t0;
+}
+
+static void stream_stage_run(stream_enc_stage_t *st) {
+    int64_t need = st->end_sample - st->start_sample;
+    st->failed = 0;
+
+    if (st->n_have < need) {
+        qwen_live_audio_t *live = st->live;
+        pthread_mutex_lock(&live->mutex);
+        qwen_live_audio_sync(live);
+        while (live->sample_offset + live->n_samples < st->end_sample && !live->eof &&
+               !__atomic_load_n(&st->shutdown, __ATOMIC_ACQUIRE) &&
+               !__atomic_load_n(&st->ctx->checkpoint_requested, __ATOMIC_ACQUIRE))
+            qwen_live_audio_wait(live, NULL);
+        int64_t from = st->start_sample + st->n_have;
+        int64_t src_off = from - live->sample_offset;
+        if (live->sample_offset + live->n_samples < st->end_sample || src_off < 0) {
+            st->failed = 1;
+        } else {
+            qwen_live_audio_read(live, st->samples + (size_t)st->n_have, from,
+                                 need - st->n_have);
+            st->n_have = need;
+        }
+        pthread_mutex_unlock(&live->mutex);
+        if (st->failed) return;
+    }
+
+    qwen_sched_acquire(st->ctx->priority, st->n_threads);
+    stream_stage_encode(st, need);
+    qwen_sched_release();
+}
+
+static void *stream_stage_main(void *arg) {
+    stream_enc_stage_t *st = (stream_enc_stage_t *)arg;
+    qwen_set_thread_budget(st->n_threads);
+    qwen_verbose = st->verbose;
+    qwen_monitor = st->monitor;
+
+    pthread_mutex_lock(&st->mutex);
+    for (;;) {
+        while (!st->running && !st->shutdown)
+            pthread_cond_wait(&st->cond, &st->mutex);
+        if (st->shutdown) break;
+        pthread_mutex_unlock(&st->mutex);
+
+        stream_stage_run(st);
+
+        pthread_mutex_lock(&st->mutex);
+        st->running = 0;
+        pthread_cond_broadcast(&st->cond);
+    }
+    pthread_mutex_unlock(&st->mutex);
+    return NULL;
+}
+
+static void stream_stage_discard(stream_enc_stage_t *st) {
+    for (int i = 0; i < QWEN_STREAM_STAGE_MAX_WINDOWS; i++) {
+        free(st->win_enc[i]);
+        st->win_enc[i] = NULL;
+        st->win_seq[i] = 0;
+    }
+    free(st->tail_enc);
+    st->tail_enc = NULL;
+    st->tail_seq = 0;
+    st->pending = 0;
+}
+
+static stream_enc_stage_t *stream_stage_start(qwen_ctx_t *ctx, qwen_live_audio_t *live,
+                                              int n_threads) {
+    stream_enc_stage_t *st = (stream_enc_stage_t *)calloc(1, sizeof(stream_enc_stage_t));
+    if (!st) return NULL;
+    st->ctx = ctx;
+    st->live = live;
+    st->n_threads = n_threads;
+    st->verbose = qwen_verbose;
+    st->monitor = qwen_monitor;
+    pthread_mutex_init(&st->mutex, NULL);
+    pthread_cond_init(&st->cond, NULL);
+    if (pthread_create(&st->thread, NULL, stream_stage_main, st) != 0) {
+        pthread_mutex_destroy(&st->mutex);
+        pthread_cond_destroy(&st->cond);
+        free(st);
+        return NULL;
+    }
+    return st;
+}
+
+/* Wait for the in-flight job. The compute pool is released meanwhile: the
+ * stage may be blocked on audio, and other jobs can use the idle workers. */
+static void stream_stage_wait(stream_enc_stage_t *st) {
+    pthread_mutex_lock(&st->mutex);
+    if (st->running) {
+        pthread_mutex_unlock(&st->mutex);
+        int depth = qwen_sched_suspend();
+        pthread_mutex_lock(&st->mutex);
+        while (st->running)
+            pthread_cond_wait(&st->cond, &st->mutex);
+        pthread_mutex_unlock(&st->mutex);
+        qwen_sched_resume(depth);
+        return;
+    }
+    pthread_mutex_unlock(&st->mutex);
+}
+
+/* Submit [start, end) for encoding. local/local_base/local_n describe the
+ * samples already mirrored by the streaming loop. Returns 0 if submitted. */
+static int stream_stage_submit(stream_enc_stage_t *st, int64_t start, int64_t end,
+                               int window_samples,
+                               const float *local, int64_t local_base, int64_t local_n) {
+    if (st->pending || end <= start || start < local_base) return -1;
+    int n_windows = (int)((end - start) / window_samples);
+    if (n_windows > QWEN_STREAM_STAGE_MAX_WINDOWS) return -1;
+
+    int64_t need = end - start;
+    if (need > st->samples_cap) {
+        float *tmp = (float *)realloc(st->samples, (size_t)need * sizeof(float));
+        if (!tmp) return -1;
+        st->samples = tmp;
+        st->samples_cap = need;
+    }
+    int64_t have = local_base + local_n - start;
+    if (have > need) have = need;
+    if (have < 0) have = 0;
+    if (have > 0)
+        memcpy(st->samples, local + (size_t)(start - local_base), (size_t)have * sizeof(float));
+
+    pthread_mutex_lock(&st->mutex);
+    st->start_sample = start;
+    st->end_sample = end;
+    st->window_samples = window_samples;
+    st->n_windows = n_windows;
+    st->n_have = have;
+    st->enc_ms = 0;
+    st->pending = 1;
+    st->running = 1;
+    pthread_cond_broadcast(&st->cond);
+    pthread_mutex_unlock(&st->mutex);
+    return 0;
+}
+
+static void stream_stage_stop(stream_enc_stage_t *st) {
+    if (!st) return;
+    pthread_mutex_lock(&st->mutex);
+    __atomic_store_n(&st->shutdown, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&st->cond);
+    pthread_mutex_unlock(&st->mutex);
+    /* Wake a job that is still waiting for audio. */
+    qwen_live_audio_wake(st->live);
+    pthread_join(st->thread, NULL);
+    stream_stage_discard(st);
+    free(st->samples);
+    pthread_mutex_destroy(&st->mutex);
+    pthread_cond_destroy(&st->cond);
+    free(st);
+}
+
+/* True if a decoded piece ends with sentence-final punctuation. */
+static int piece_ends_sentence(const char *piece) {
+    size_t n = strlen(piece);
+    while (n > 0 && isspace((unsigned char)piece[n - 1])) n--;
+    if (n == 0) return 0;
+    char c = piece[n - 1];
+    if (c == '.' || c == '?' || c == '!') return 1;
+    if (n >= 3) {
+        const unsigned char *u = (const unsigned char *)piece + n - 3;
+        if (u[0] == 0xE3 && u[1] == 0x80 && u[2] == 0x82) return 1; /* 。 */
+        if (u[0] == 0xEF && u[1] == 0xBC && (u[2] == 0x9F || u[2] == 0x81)) return 1; /* ？！ */
+    }
+    return 0;
+}
+
+/* Decode tokens into a reusable NUL-terminated text buffer. */
+static int stream_format_tokens(const qwen_tokenizer_t *tokenizer,
+                                const int *tokens, int n_tokens,
+                                char **buf, size_t *cap) {
+    size_t len = 0;
+    for (int i = 0; i < n_tokens || !*buf; i++) {
+        const char *piece = (i < n_tokens) ? qwen_tokenizer_decode(tokenizer, tokens[i]) : "";
+        size_t plen = strlen(piece);
+        if (!*buf || len + plen + 1 > *cap) {
+            size_t new_cap = *cap > 0 ? *cap : 256;
+            while (len + plen + 1 > new_cap) new_cap *= 2;
+            char *tmp = (char *)realloc(*buf, new_cap);
+            if (!tmp) return -1;
+            *buf = tmp;
+            *cap = new_cap;
+        }
+        memcpy(*buf + len, piece, plen);
+        len += plen;
+    }
+    (*buf)[len] = '\0';
+    return 0;
+}
+
+/* Start of the text region in raw stream output:
+ * - default: language ... <asr_text> TEXT
+ * - forced language: prompt already anchors language, so generated stream is TEXT. */
+static int stream_text_start(const qwen_ctx_t *ctx, const int *tokens, int n_tokens) {
+    if (ctx->n_force_prompt_tokens > 0) return 0;
+    for (int i = 0; i < n_tokens; i++)
+        if (tokens[i] == QWEN_TOKEN_ASR_TEXT) return i + 1;
+    return 0;
+}
+
+/* Live mode: drop local audio before keep_from (already encoded into cached
+ * windows), shifting the rolling buffer's global base. */
+static void stream_drop_local_audio(int64_t keep_from, float *local_samples,
+                                    int64_t *local_n_samples, int64_t *local_base_sample) {
+    if (keep_from <= *local_base_sample) return;
+    int64_t drop64 = keep_from - *local_base_sample;
+    if (drop64 > *local_n_samples) drop64 = *local_n_samples;
+    if (drop64 <= 0) return;
+    int64_t remain = *local_n_samples - drop64;
+    if (remain > 0) {
+        memmove(local_samples, local_samples + (size_t)drop64,
+                (size_t)remain * sizeof(float));
+    }
+    *local_n_samples = remain;
+    *local_base_sample += drop64;
+}
+
 /* Re-anchor stream text state to a short committed tail so decoding can
  * continue after a hard reset without replaying the full text history. */
 static int stream_reanchor_text_state(qwen_ctx_t *ctx,
@@ -1218,6 +1969,129 @@ static int stream_reanchor_text_state(qwen_ctx_t *ctx,
     return 0;
 }
 
+/* ========================================================================
+ * Flight Recorder
+ *
+ * Single writer (the stream thread), any number of readers. Slot i holds
+ * entries i, i + QWEN_FLIGHT_SLOTS, ...; its sequence number is odd while
+ * being written and 2k after the k-th write, so a reader knows both
+ * whether its copy was torn and whether it is the entry it wanted.
+ * ======================================================================== */
+
+static qwen_flight_recorder_t *flight_begin_stream(qwen_ctx_t *ctx) {
+    qwen_flight_recorder_t *fr = ctx->flight;
+    if (!fr) {
+        fr = (qwen_flight_recorder_t *)calloc(1, sizeof(qwen_flight_recorder_t));
+        if (!fr) return NULL;
+        __atomic_store_n(&ctx->flight, fr, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&fr->n_streams, fr->n_streams + 1, __ATOMIC_RELAXED);
+    return fr;
+}
+
+static void flight_record(qwen_flight_recorder_t *fr, const qwen_flight_entry_t *e) {
+    if (!fr) return;
+    uint64_t h = fr->head;
+    int i = (int)(h % QWEN_FLIGHT_SLOTS);
+    uint32_t seq = fr->seq[i];
+    __atomic_store_n(&fr->seq[i], seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    fr->slot[i] = *e;
+    __atomic_store_n(&fr->seq[i], seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&fr->head, h + 1, __ATOMIC_RELEASE);
+}
+
+/* Copy entry h out of the ring. Returns 0 if it was overwritten meanwhile. */
+static int flight_read(const qwen_flight_recorder_t *fr, uint64_t h, qwen_flight_entry_t *out) {
+    int i = (int)(h % QWEN_FLIGHT_SLOTS);
+    uint32_t want = (uint32_t)(2 * (h / QWEN_FLIGHT_SLOTS + 1));
+    for (int tries = 0; tries < 8; tries++) {
+        uint32_t s1 = __atomic_load_n(&fr->seq[i], __ATOMIC_ACQUIRE);
+        if (s1 != want) {
+            if (s1 == want - 1) continue;  /* being written */
+            return 0;
+        }
+        *out = fr->slot[i];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&fr->seq[i], __ATOMIC_RELAXED) == s1) return 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    char *buf;
+    size_t len, cap;
+    int failed;
+} json_buf_t;
+
+static void json_printf(json_buf_t *jb, const char *fmt, ...) {
+    if (jb->failed) return;
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(jb->buf + jb->len, jb->cap - jb->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            jb->failed = 1;
+            return;
+        }
+        if ((size_t)n < jb->cap - jb->len) {
+            jb->len += (size_t)n;
+            return;
+        }
+        size_t cap = jb->cap * 2 > jb->len + (size_t)n + 1 ? jb->cap * 2 : jb->len + (size_t)n + 1;
+        char *tmp = (char *)realloc(jb->buf, cap);
+        if (!tmp) {
+            jb->failed = 1;
+            return;
+        }
+        jb->buf = tmp;
+        jb->cap = cap;
+    }
+}
+
+char *qwen_flight_dump_json(const qwen_ctx_t *ctx) {
+    json_buf_t jb = { (char *)malloc(4096), 0, 4096, 0 };
+    if (!jb.buf) return NULL;
+    jb.buf[0] = '\0';
+
+    const qwen_flight_recorder_t *fr =
+        ctx ? __atomic_load_n(&ctx->flight, __ATOMIC_ACQUIRE) : NULL;
+    uint64_t head = fr ? __atomic_load_n(&fr->head, __ATOMIC_ACQUIRE) : 0;
+    json_printf(&jb, "{\"slots\":%d,\"streams\":%d,\"recorded\":%llu,\"chunks\":[",
+                QWEN_FLIGHT_SLOTS, fr ? __atomic_load_n(&fr->n_streams, __ATOMIC_RELAXED) : 0,
+                (unsigned long long)head);
+    uint64_t first = head > QWEN_FLIGHT_SLOTS ? head - QWEN_FLIGHT_SLOTS : 0;
+    int n_out = 0;
+    for (uint64_t h = first; h < head; h++) {
+        qwen_flight_entry_t e;
+        if (!flight_read(fr, h, &e)) continue;
+        json_printf(&jb,
+                    "%s\n{\"stream\":%d,\"chunk\":%d,\"unix_ms\":%.1f,\"stream_sec\":%.3f,"
+                    "\"audio_sec\":%.3f,\"lag_sec\":%.3f,\"encode_ms\":%.1f,\"prefill_ms\":%.1f,"
+                    "\"decode_ms\":%.1f,\"total_ms\":%.1f,\"prefill_tokens\":%d,"
+                    "\"prefill_reused\":%d,\"generated_tokens\":%d,\"emitted_tokens\":%d,"
+                    "\"evicted_windows\":%d,\"prefetched\":%s,\"recovery_reset\":%s,"
+                    "\"periodic_reset\":%s,\"endpoint\":%s,\"draft\":%s}",
+                    n_out ? "," : "", e.stream, e.chunk, e.unix_ms, e.stream_sec,
+                    e.audio_sec, e.stream_sec - e.audio_sec, e.encode_ms, e.prefill_ms,
+                    e.decode_ms, e.total_ms, e.prefill_tokens, e.prefill_reused,
+                    e.generated_tokens, e.emitted_tokens, e.evicted_windows,
+                    (e.flags & QWEN_FLIGHT_PREFETCHED) ? "true" : "false",
+                    (e.flags & QWEN_FLIGHT_RECOVERY_RESET) ? "true" : "false",
+                    (e.flags & QWEN_FLIGHT_PERIODIC_RESET) ? "true" : "false",
+                    (e.flags & QWEN_FLIGHT_ENDPOINT) ? "true" : "false",
+                    (e.flags & QWEN_FLIGHT_DRAFT) ? "true" : "false");
+        n_out++;
+    }
+    json_printf(&jb, "%s]}\n", n_out ? "\n" : "");
+    if (jb.failed) {
+        free(jb.buf);
+        return NULL;
+    }
+    return jb.buf;
+}
+
 /* ========================================================================
  * Streaming Transcription (chunked rollback + encoder window cache)
  *
@@ -1236,8 +2110,34 @@ static int stream_reanchor_text_state(qwen_ctx_t *ctx,
  *   partial tail window.
  * - Decoder prefill still consumes all encoder tokens
  *   ([cached windows] + [current partial window]).
+ *
+ * Two-pass mode (qwen_set_stream_draft):
+ * - Interim chunks are drafts: the same prompt decoded through the first
+ *   few decoder layers with a small token budget, shown as partial text
+ *   only. Raw history, commit frontier and resets are left untouched.
+ * - Every Nth chunk, and any final, endpoint or cold-start chunk, runs the
+ *   full decoder over all audio since the last full pass and commits.
+ * - Draft KV rows only hold the lower layers, so after a draft the KV
+ *   reuse prefix is cut back to the rows the draft did not rewrite.
  * ======================================================================== */
 
+/* Record a finished chunk in the flight recorder and the chunk callback. */
+static void stream_report_chunk(qwen_ctx_t *ctx, qwen_flight_recorder_t *flight,
+                                const qwen_flight_entry_t *fe,
+                                double encode_ms, double decode_ms, double total_ms) {
+    flight_record(flight, fe);
+    if (ctx->chunk_cb) {
+        qwen_chunk_stats_t cs = {
+            .chunk = fe->chunk,
+            .audio_sec = fe->audio_sec,
+            .encode_ms = encode_ms,
+            .decode_ms = decode_ms,
+            .total_ms = total_ms,
+        };
+        ctx->chunk_cb(&cs, ctx->chunk_cb_userdata);
+    }
+}
+
 /* Internal streaming implementation. When live!=NULL, audio is read
  * incrementally from the live buffer; when NULL, samples/n_samples
  * provide the complete audio upfront. */
@@ -1249,6 +2149,12 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
     int rollback = ctx->stream_rollback;
     int unfixed_chunks = ctx->stream_unfixed_chunks;
     int max_new_tokens = ctx->stream_max_new_tokens > 0 ? ctx->stream_max_new_tokens : 32;
+    int full_layers = cfg->dec_layers;
+    if (ctx->dec_layers_limit > 0 && ctx->dec_layers_limit < full_layers)
+        full_layers = ctx->dec_layers_limit;
+    int draft_layers = ctx->stream_draft_layers < full_layers ? ctx->stream_draft_layers : 0;
+    int draft_max_new = ctx->stream_draft_tokens > 0 ? ctx->stream_draft_tokens : max_new_tokens;
+    int final_every = ctx->stream_final_every > 0 ? ctx->stream_final_every : 1;
 
     const float *audio_samples = samples;
     int64_t audio_n_samples = n_samples;
@@ -1278,6 +2184,7 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
     if (live) {
         /* Seed local buffer with whatever is available now. */
         pthread_mutex_lock(&live->mutex);
+        qwen_live_audio_sync(live);
         int64_t live_start = live->sample_offset;
         int64_t live_count = live->n_samples;
         live_eof = live->eof;
@@ -1294,11 +2201,12 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                 pthread_mutex_unlock(&live->mutex);
                 return NULL;
             }
-            memcpy(local_samples, live->samples, (size_t)local_n_samples * sizeof(float));
+            qwen_live_audio_read(live, local_samples, live_start, local_n_samples);
         }
         /* Producer buffer is now mirrored locally: reset it to bound memory. */
         live->sample_offset = live_start + live_count;
         live->n_samples = 0;
+        qwen_live_audio_sync(live);
         pthread_mutex_unlock(&live->mutex);
         audio_samples = local_samples;
         audio_n_samples = local_base_sample + local_n_samples;
@@ -1316,6 +2224,10 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
     ctx->perf_audio_ms = live ? 0.0 : 1000.0 * (double)n_samples / (double)QWEN_SAMPLE_RATE;
     ctx->perf_encode_ms = 0;
     ctx->perf_decode_ms = 0;
+    memset(ctx->perf_phase, 0, sizeof(ctx->perf_phase));
+    qwen_flight_recorder_t *flight = flight_begin_stream(ctx);
+    int flight_stream = flight ? flight->n_streams - 1 : 0;
+    double stream_t0 = get_time_ms();
     int enc_window_frames = ctx->config.enc_n_window_infer;
     if (enc_window_frames < 100) enc_window_frames = 100;
     if (enc_window_frames > 800) enc_window_frames = 800;
@@ -1331,6 +2243,11 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
         }
         use_enc_cache = 1;
     }
+    int use_pipeline = (live && ctx->stream_pipeline && qwen_get_thread_budget() >= 2);
+    const char *no_pipe_env = getenv("QWEN_STREAM_NO_PIPELINE");
+    if (no_pipe_env && no_pipe_env[0] != '\0' && strcmp(no_pipe_env, "0") != 0) {
+        use_pipeline = 0;
+    }
 
     /* Sliding-window limits for long streams: bound encoder tokens and
      * prefix tokens fed to the decoder so memory/compute stay flat.
@@ -1349,17 +2266,25 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
     #define QWEN_STREAM_RESET_INTERVAL_CHUNKS 45
     #define QWEN_STREAM_RESET_CARRY_TOKENS 24
 
+    /* A full pass decodes all audio since the previous one, so that span
+     * must still be inside the retained encoder windows when it runs. */
+    int final_every_max = (int)((int64_t)QWEN_STREAM_MAX_ENC_WINDOWS * enc_window_samples /
+                                chunk_samples);
+    if (final_every_max < 1) final_every_max = 1;
+    if (final_every > final_every_max) final_every = final_every_max;
+
     if (qwen_verbose >= 2) {
         if (live)
             fprintf(stderr,
                     "Streaming (live): chunk=%.1f s, rollback=%d, "
                     "unfixed=%d, max_new=%d, enc_window=%.1fs, enc_cache=%s, prefix=%s, "
-                    "max_enc_win=%d, max_prefix=%d\n",
+                    "pipeline=%s, max_enc_win=%d, max_prefix=%d\n",
                     ctx->stream_chunk_sec, rollback,
                     unfixed_chunks, max_new_tokens,
                     (float)enc_window_frames / 100.0f,
                     use_enc_cache ? "on" : "off",
                     ctx->past_text_conditioning ? "on" : "off",
+                    use_pipeline ? "on" : "off",
                     QWEN_STREAM_MAX_ENC_WINDOWS, QWEN_STREAM_MAX_PREFIX_TOKENS);
         else
             fprintf(stderr,
@@ -1371,6 +2296,10 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                     (float)enc_window_frames / 100.0f,
                     use_enc_cache ? "on" : "off",
                     ctx->past_text_conditioning ? "on" : "off");
+        if (draft_layers > 0)
+            fprintf(stderr, "Streaming: two-pass, drafts use %d/%d decoder layers, "
+                    "max_new=%d, full pass every %d chunks\n",
+                    draft_layers, full_layers, draft_max_new, final_every);
     }
 
     /* Load tokenizer */
@@ -1391,7 +2320,7 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
      * streaming chunks are not externally consumed and the final answer is
      * already produced by a full refinement pass. Skip chunk-by-chunk
      * decoding entirely. (In live mode we must still use the chunked loop.) */
-    if (!ctx->token_cb && !live) {
+    if (!ctx->token_cb && !ctx->partial_cb && !live) {
         if (qwen_verbose >= 2) {
             fprintf(stderr, "Streaming: no token callback, using direct final refinement\n");
         }
@@ -1447,7 +2376,22 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
         return NULL;
     }
 
+    /* Interim hypothesis (unstable tail) text, rebuilt every chunk. */
+    char *partial_text = NULL;
+    size_t partial_cap = 0;
+
+    /* Utterance endpointing state */
+    int64_t enc_origin = 0;          /* window alignment base; moves at endpoints */
+    size_t utterance_start = 0;      /* result offset of the current utterance */
+    int endpoint_samples = ctx->stream_endpoint_ms > 0
+        ? (int)((int64_t)ctx->stream_endpoint_ms * QWEN_SAMPLE_RATE / 1000) : 0;
+    /* Trailing-silence lookback: the longest run that matters (twice the
+     * endpoint) plus 2 s of audio before it for the noise floor */
+    int64_t endpoint_span = 2 * (int64_t)endpoint_samples + 2 * QWEN_SAMPLE_RATE;
+    int endpoint_lookback = endpoint_span < INT_MAX ? (int)endpoint_span : INT_MAX;
+
     int chunk_idx = 0;
+    int drafts_since_full = 0;       /* two-pass: draft chunks since the last full pass */
     int64_t audio_cursor = 0;
     stream_enc_window_t *enc_cache = NULL;
     int n_enc_cache = 0;
@@ -1461,13 +2405,231 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
     int prefill_total_tokens = 0;
     int prefill_reused_tokens = 0;
 
+    /* Resume a checkpointed session. Its state stays in the old session's
+     * sample coordinates; the new live source is relabelled to continue
+     * right after the carried audio tail. */
+    char *utt_carry = NULL;   /* committed utterance text from before the handoff */
+    if (live && ctx->restore_blob) {
+        ckpt_reader_t rd = { (const unsigned char *)ctx->restore_blob,
+                             ctx->restore_size, 0, 0 };
+        int ck_flags = 0, ck_window = 0;
+        float *ck_tail = NULL;
+        int64_t ck_base = 0, ck_n = 0;
+        if (ckpt_get_header(&rd, ctx, &ck_flags, &ck_window) != 0 ||
+            ck_window != enc_window_samples) {
+            rd.failed = 1;
+        } else {
+            int ck_bf16 = (ck_flags & QWEN_CHECKPOINT_COMPACT) != 0;
+            chunk_idx = (int)ckpt_get_i64(&rd);
+            audio_cursor = ckpt_get_i64(&rd);
+            next_window_start = ckpt_get_i64(&rd);
+            enc_origin = ckpt_get_i64(&rd);
+            ck_base = ckpt_get_i64(&rd);
+            ck_n = ckpt_get_i64(&rd);
+            stagnant_chunks = (int)ckpt_get_i64(&rd);
+            int64_t n = ckpt_get_i64(&rd);
+            ckpt_get_tokens(&rd, &raw_tokens, &raw_tokens_cap, n);
+            n_raw_tokens = rd.failed ? 0 : (int)n;
+            n = ckpt_get_i64(&rd);
+            ckpt_get_tokens(&rd, &stable_text_tokens, &stable_text_cap, n);
+            n_stable_text_tokens = rd.failed ? 0 : (int)n;
+            n = ckpt_get_i64(&rd);
+            ckpt_get_tokens(&rd, &emitted_text_tokens, &emitted_text_cap, n);
+            n_emitted_text_tokens = rd.failed ? 0 : (int)n;
+
+            n = ckpt_get_i64(&rd);
+            if (n < 0 || (size_t)n > rd.len - rd.pos) {
+                rd.failed = 1;
+            } else if (n > 0 && (utt_carry = (char *)malloc((size_t)n + 1)) != NULL) {
+                ckpt_get(&rd, utt_carry, (size_t)n);
+                utt_carry[n] = '\0';
+            } else {
+                ckpt_get(&rd, NULL, (size_t)n);
+            }
+
+            int64_t n_win = ckpt_get_i64(&rd);
+            if (n_win < 0 || n_win > 64) rd.failed = 1;
+            for (int64_t i = 0; i < n_win && !rd.failed; i++) {
+                int64_t ws = ckpt_get_i64(&rd);
+                int64_t wn = ckpt_get_i64(&rd);
+                int64_t seq = ckpt_get_i64(&rd);
+                if (rd.failed || seq <= 0 || seq > 100000 || wn != enc_window_samples) {
+                    rd.failed = 1;
+                    break;
+                }
+                if (n_enc_cache == enc_cache_cap) {
+                    int new_cap = enc_cache_cap > 0 ? enc_cache_cap * 2 : 8;
+                    stream_enc_window_t *tmp = (stream_enc_window_t *)realloc(
+                        enc_cache, (size_t)new_cap * sizeof(stream_enc_window_t));
+                    if (!tmp) { rd.failed = 1; break; }
+                    enc_cache = tmp;
+                    enc_cache_cap = new_cap;
+                }
+                float *win = (float *)malloc((size_t)seq * dim * sizeof(float));
+                if (!win) { rd.failed = 1; break; }
+                ckpt_get_floats(&rd, win, (size_t)seq * dim, ck_bf16);
+                enc_cache[n_enc_cache].start_sample = ws;
+                enc_cache[n_enc_cache].n_samples = (int)wn;
+                enc_cache[n_enc_cache].seq_len = (int)seq;
+                enc_cache[n_enc_cache].enc_output = win;
+                n_enc_cache++;
+                enc_cached_seq_total += (int)seq;
+            }
+
+            if (ck_n < 0 || (size_t)ck_n > (rd.len - rd.pos) / sizeof(float) ||
+                ck_base < 0 || audio_cursor < ck_base || audio_cursor > ck_base + ck_n ||
+                next_window_start < ck_base || enc_origin > audio_cursor) {
+                rd.failed = 1;
+            } else {
+                ck_tail = (float *)malloc((size_t)(ck_n + local_n_samples + chunk_samples * 4) *
+                                          sizeof(float));
+                if (!ck_tail) rd.failed = 1;
+                else ckpt_get_floats(&rd, ck_tail, (size_t)ck_n, 0);
+            }
+
+            /* Prefill embeddings + KV (QWEN_CHECKPOINT_KV) */
+            int64_t pp_len = ckpt_get_i64(&rd);
+            if (!rd.failed && pp_len > 0 && pp_len < 1000000) {
+                prev_prefill_embeds = (float *)malloc((size_t)pp_len * dim * sizeof(float));
+                if (prev_prefill_embeds) {
+                    prev_prefill_cap = (int)pp_len;
+                    ckpt_get_floats(&rd, prev_prefill_embeds, (size_t)pp_len * dim, ck_bf16);
+                }
+                int kv_dim = cfg->dec_kv_heads * cfg->dec_head_dim;
+                if (!prev_prefill_embeds ||
+                    qwen_decoder_kv_reserve(ctx, (int)pp_len) != 0) {
+                    rd.failed = 1;
+                } else {
+                    for (int l = 0; l < cfg->dec_layers; l++)
+                        ckpt_get_floats(&rd, ctx->kv_cache_k +
+                                        (size_t)l * ctx->kv_cache_max * kv_dim,
+                                        (size_t)pp_len * kv_dim, ck_bf16);
+                    for (int l = 0; l < cfg->dec_layers; l++)
+                        ckpt_get_floats(&rd, ctx->kv_cache_v +
+                                        (size_t)l * ctx->kv_cache_max * kv_dim,
+                                        (size_t)pp_len * kv_dim, ck_bf16);
+                    prev_prefill_len = (int)pp_len;
+                    ctx->kv_cache_len = (int)pp_len;
+                }
+            } else if (pp_len != 0) {
+                rd.failed = 1;
+            }
+        }
+
+        if (!rd.failed) {
+            /* Carried tail first, then whatever the new source already has. */
+            if (local_n_samples > 0)
+                memcpy(ck_tail + (size_t)ck_n, local_samples,
+                       (size_t)local_n_samples * sizeof(float));
+            int64_t shift = ck_base + ck_n - local_base_sample;
+            free(local_samples);
+            local_samples = ck_tail;
+            local_capacity = ck_n + local_n_samples + chunk_samples * 4;
+            local_n_samples += ck_n;
+            local_base_sample = ck_base;
+            audio_samples = local_samples;
+            audio_n_samples = local_base_sample + local_n_samples;
+            pthread_mutex_lock(&live->mutex);
+            live->sample_offset += shift;
+            live->ring_base += shift;
+            pthread_mutex_unlock(&live->mutex);
+            if (qwen_verbose >= 2)
+                fprintf(stderr, "Streaming (live): resumed checkpoint at %.1f s "
+                        "(chunk %d, %d tokens, %d encoder windows, KV %d)\n",
+                        (float)audio_cursor / QWEN_SAMPLE_RATE, chunk_idx,
+                        n_raw_tokens, n_enc_cache, prev_prefill_len);
+        } else {
+            fprintf(stderr, "qwen_transcribe_stream_live: invalid checkpoint, starting cold\n");
+            free(ck_tail);
+            free(utt_carry);
+            utt_carry = NULL;
+            chunk_idx = 0;
+            audio_cursor = 0;
+            enc_origin = 0;
+            stagnant_chunks = 0;
+            n_raw_tokens = n_stable_text_tokens = n_emitted_text_tokens = 0;
+            prev_prefill_len = 0;
+            ctx->kv_cache_len = 0;
+            stream_clear_enc_cache(enc_cache, &n_enc_cache, &enc_cache_start,
+                                   &enc_cached_seq_total, &next_window_start, 0);
+        }
+        free(ctx->restore_blob);
+        ctx->restore_blob = NULL;
+        ctx->restore_size = 0;
+    }
+
+    /* Pipelined live path: split the job's share between the decoder (this
+     * thread) and an encoder stage that prepares the next chunk during
+     * decode. The decoder re-acquires only its part (the budget caps the
+     * request); the stage acquires the rest for each of its jobs. */
+    stream_enc_stage_t *stage = NULL;
+    int prev_budget = 0;
+    if (use_pipeline) {
+        int n_total = qwen_get_thread_budget();
+        int n_stage = n_total / 3;
+        if (n_stage < 1) n_stage = 1;
+        stage = stream_stage_start(ctx, live, n_stage);
+        if (stage) {
+            prev_budget = qwen_set_thread_budget(n_total - n_stage);
+            qwen_sched_resume(qwen_sched_suspend());
+        }
+    }
+
     while (audio_cursor < audio_n_samples || (live && !live_eof)) {
+        /* The next chunk's encoder job may still be reading the live buffer. */
+        if (stage) stream_stage_wait(stage);
+
         /* Live mode: wait until we have enough data for the next chunk. */
         if (live) {
             int64_t want = audio_cursor + chunk_samples;
             pthread_mutex_lock(&live->mutex);
-            while (live->sample_offset + live->n_samples < want && !live->eof)
-                pthread_cond_wait(&live->cond, &live->mutex);
+            qwen_live_audio_sync(live);
+            if (live->sample_offset + live->n_samples < want && !live->eof &&
+                !__atomic_load_n(&ctx->checkpoint_requested, __ATOMIC_ACQUIRE)) {
+                /* Idle until audio arrives: let other jobs use the pool. */
+                pthread_mutex_unlock(&live->mutex);
+                int sched_depth = qwen_sched_suspend();
+                struct timespec idle_deadline;
+                int idle_offload = ctx->trim_idle_sec > 0.0f;
+                if (idle_offload) {
+                    double idle_ns = (double)ctx->trim_idle_sec * 1e9;
+                    clock_gettime(CLOCK_REALTIME, &idle_deadline);
+                    idle_ns += (double)idle_deadline.tv_nsec;
+                    idle_deadline.tv_sec += (time_t)(idle_ns / 1e9);
+                    idle_deadline.tv_nsec = (long)fmod(idle_ns, 1e9);
+                }
+                pthread_mutex_lock(&live->mutex);
+                while (live->sample_offset + live->n_samples < want && !live->eof &&
+                       !__atomic_load_n(&ctx->checkpoint_requested, __ATOMIC_ACQUIRE)) {
+                    if (!idle_offload) {
+                        qwen_live_audio_wait(live, NULL);
+                        continue;
+                    }
+                    if (qwen_live_audio_wait(live, &idle_deadline) != ETIMEDOUT)
+                        continue;
+
+                    /* Paused stream: keep only the compact state (text
+                     * tokens and encoder windows). The next chunk rebuilds
+                     * the KV cache with one full prefill. */
+                    idle_offload = 0;
+                    pthread_mutex_unlock(&live->mutex);
+                    prev_prefill_len = 0;
+                    free(prev_prefill_embeds);
+                    prev_prefill_embeds = NULL;
+                    prev_prefill_cap = 0;
+                    stream_compact_enc_cache(&enc_cache, &n_enc_cache,
+                                             &enc_cache_start, &enc_cache_cap);
+                    qwen_trim(ctx);
+                    if (qwen_verbose >= 2)
+                        fprintf(stderr, "  Idle: offloaded session state after %.1fs\n",
+                                ctx->trim_idle_sec);
+                    pthread_mutex_lock(&live->mutex);
+                }
+                pthread_mutex_unlock(&live->mutex);
+                qwen_sched_resume(sched_depth);
+                pthread_mutex_lock(&live->mutex);
+                qwen_live_audio_sync(live);
+            }
 
             int64_t live_start = live->sample_offset;
             int64_t live_count = live->n_samples;
@@ -1511,15 +2673,16 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                     local_samples = tmp;
                     local_capacity = new_cap;
                 }
-                memcpy(local_samples + (size_t)local_n_samples,
-                       live->samples + (size_t)src_off64,
-                       (size_t)delta64 * sizeof(float));
+                qwen_live_audio_read(live, local_samples + (size_t)local_n_samples,
+                                     local_end, delta64);
                 local_n_samples += delta64;
             }
 
-            /* Producer buffer is mirrored locally: reset it to bound memory. */
+            /* Producer buffer is mirrored locally: reset it to bound memory
+             * (a shm ring gets the space back). */
             live->sample_offset = live_end;
             live->n_samples = 0;
+            qwen_live_audio_sync(live);
             live_eof = is_eof_now;
             pthread_mutex_unlock(&live->mutex);
 
@@ -1528,21 +2691,117 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
             ctx->perf_audio_ms = 1000.0 * (double)audio_n_samples / (double)QWEN_SAMPLE_RATE;
         }
 
+        /* Checkpoint at the chunk boundary: everything after audio_cursor is
+         * still in the local buffer, so the blob carries unprocessed audio. */
+        if (live && __atomic_load_n(&ctx->checkpoint_requested, __ATOMIC_ACQUIRE)) {
+            int ck_flags = ctx->checkpoint_flags;
+            int ck_bf16 = (ck_flags & QWEN_CHECKPOINT_COMPACT) != 0;
+            int kv_dim = cfg->dec_kv_heads * cfg->dec_head_dim;
+            ckpt_writer_t w = { NULL, 0, 0, 0 };
+            ckpt_put_header(&w, ctx, ck_flags, enc_window_samples);
+            ckpt_put_i64(&w, chunk_idx);
+            ckpt_put_i64(&w, audio_cursor);
+            ckpt_put_i64(&w, next_window_start);
+            ckpt_put_i64(&w, enc_origin);
+            ckpt_put_i64(&w, local_base_sample);
+            ckpt_put_i64(&w, local_n_samples);
+            ckpt_put_i64(&w, stagnant_chunks);
+            ckpt_put_i64(&w, n_raw_tokens);
+            ckpt_put(&w, raw_tokens, (size_t)n_raw_tokens * sizeof(int));
+            ckpt_put_i64(&w, n_stable_text_tokens);
+            ckpt_put(&w, stable_text_tokens, (size_t)n_stable_text_tokens * sizeof(int));
+            ckpt_put_i64(&w, n_emitted_text_tokens);
+            ckpt_put(&w, emitted_text_tokens, (size_t)n_emitted_text_tokens * sizeof(int));
+
+            size_t carry_len = utt_carry ? strlen(utt_carry) : 0;
+            ckpt_put_i64(&w, (int64_t)(carry_len + result_len - utterance_start));
+            ckpt_put(&w, utt_carry, carry_len);
+            ckpt_put(&w, result + utterance_start, result_len - utterance_start);
+
+            ckpt_put_i64(&w, n_enc_cache - enc_cache_start);
+            for (int i = enc_cache_start; i < n_enc_cache; i++) {
+                ckpt_put_i64(&w, enc_cache[i].start_sample);
+                ckpt_put_i64(&w, enc_cache[i].n_samples);
+                ckpt_put_i64(&w, enc_cache[i].seq_len);
+                ckpt_put_floats(&w, enc_cache[i].enc_output,
+                                (size_t)enc_cache[i].seq_len * dim, ck_bf16);
+            }
+            ckpt_put_floats(&w, local_samples, (size_t)local_n_samples, 0);
+
+            /* KV rows [0, prev_prefill_len) match prev_prefill_embeds, so the
+             * resumed session reuses them exactly like the next chunk would. */
+            int kv_len = 0;
+            if ((ck_flags & QWEN_CHECKPOINT_KV) && prev_prefill_embeds &&
+                ctx->kv_cache_k && ctx->kv_cache_len >= prev_prefill_len)
+                kv_len = prev_prefill_len;
+            ckpt_put_i64(&w, kv_len);
+            if (kv_len > 0) {
+                ckpt_put_floats(&w, prev_prefill_embeds, (size_t)kv_len * dim, ck_bf16);
+                for (int l = 0; l < cfg->dec_layers; l++)
+                    ckpt_put_floats(&w, ctx->kv_cache_k + (size_t)l * ctx->kv_cache_max * kv_dim,
+                                    (size_t)kv_len * kv_dim, ck_bf16);
+                for (int l = 0; l < cfg->dec_layers; l++)
+                    ckpt_put_floats(&w, ctx->kv_cache_v + (size_t)l * ctx->kv_cache_max * kv_dim,
+                                    (size_t)kv_len * kv_dim, ck_bf16);
+            }
+
+            free(ctx->checkpoint_blob);
+            ctx->checkpoint_blob = NULL;
+            ctx->checkpoint_size = 0;
+            if (w.failed) {
+                fprintf(stderr, "qwen_transcribe_stream_live: checkpoint allocation failed\n");
+                free(w.data);
+            } else {
+                ctx->checkpoint_blob = w.data;
+                ctx->checkpoint_size = w.len;
+                if (qwen_verbose >= 2)
+                    fprintf(stderr, "Streaming (live): checkpoint at %.1f s "
+                            "(%zu bytes, KV %d)\n",
+                            (float)audio_cursor / QWEN_SAMPLE_RATE, w.len, kv_len);
+            }
+            __atomic_store_n(&ctx->checkpoint_requested, 0, __ATOMIC_RELEASE);
+            break;
+        }
+
         double chunk_t0 = get_time_ms();
+        double chunk_enc0 = ctx->perf_encode_ms, chunk_dec0 = ctx->perf_decode_ms;
+        int chunk_text0 = ctx->perf_text_tokens;
+        int chunk_evicted = 0, chunk_prefetched = 0;
         audio_cursor += chunk_samples;
         if (audio_cursor > audio_n_samples) audio_cursor = audio_n_samples;
         int is_final = live ? (live_eof && audio_cursor >= audio_n_samples)
                             : (audio_cursor >= audio_n_samples);
 
+        /* Two-pass mode: this chunk is a draft unless a full pass is due.
+         * Cold-start chunks seed the text prefix and periodic reset chunks
+         * re-anchor it, so both stay full; so does a chunk whose trailing
+         * silence is already long enough to end the utterance. */
+        int is_draft = draft_layers > 0 && !is_final &&
+                       chunk_idx >= unfixed_chunks &&
+                       drafts_since_full + 1 < final_every &&
+                       (chunk_idx + 1) % QWEN_STREAM_RESET_INTERVAL_CHUNKS != 0;
+        if (is_draft && endpoint_samples > 0) {
+            int64_t span_start = enc_origin > local_base_sample ? enc_origin : local_base_sample;
+            int64_t span = audio_cursor - span_start;
+            if (span > 0 && span <= INT_MAX &&
+                trailing_silence_samples(audio_samples + (size_t)(span_start - local_base_sample),
+                                         (int)span, endpoint_lookback) >= endpoint_samples)
+                is_draft = 0;
+        }
+        int chunk_max_new = is_draft ? draft_max_new : max_new_tokens * (drafts_since_full + 1);
+
         /* Encoder path:
          * - default: cache completed local-attention windows and re-encode only
          *   the current partial tail window,
          * - debug fallback (`QWEN_STREAM_NO_ENC_CACHE=1`): re-encode full audio
          *   prefix every chunk. */
+        qwen_perf_sample_t ps;
+        qwen_phase_begin(&ps);
         double t0 = get_time_ms();
         int enc_seq_len = 0;
         float *enc_output = NULL;
-        int64_t full_end = (audio_cursor / enc_window_samples) * (int64_t)enc_window_samples;
+        int64_t full_end = enc_origin +
+            ((audio_cursor - enc_origin) / enc_window_samples) * (int64_t)enc_window_samples;
 
         if (!use_enc_cache) {
             if (audio_cursor > INT_MAX) {
@@ -1550,7 +2809,8 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                 chunk_idx++;
                 continue;
             }
-            if (stream_encode_span(ctx, audio_samples, (int)audio_cursor,
+            if (stream_encode_span(ctx, audio_samples + (size_t)enc_origin,
+                                   (int)(audio_cursor - enc_origin),
                                    &enc_output, &enc_seq_len) != 0 ||
                 !enc_output || enc_seq_len <= 0) {
                 free(enc_output);
@@ -1560,18 +2820,33 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
             }
             double enc_ms = get_time_ms() - t0;
             ctx->perf_encode_ms += enc_ms;
+            qwen_phase_end(&ctx->perf_phase[QWEN_PHASE_ENCODER], &ps);
             if (qwen_verbose >= 2) {
                 fprintf(stderr,
-                        "  Encoder: %d tokens from 0.0-%.1f s (full recompute, %.0f ms)\n",
+                        "  Encoder: %d tokens from %.1f-%.1f s (full recompute, %.0f ms)\n",
                         enc_seq_len,
+                        (float)enc_origin / QWEN_SAMPLE_RATE,
                         (float)audio_cursor / QWEN_SAMPLE_RATE,
                         enc_ms);
             }
         } else {
             int enc_failed = 0;
+            int use_stage = 0;
+            if (stage && stage->pending) {
+                if (!stage->failed &&
+                    stage->start_sample == next_window_start &&
+                    stage->start_sample +
+                        (int64_t)stage->n_windows * enc_window_samples == full_end &&
+                    stage->end_sample == audio_cursor) {
+                    use_stage = 1;
+                } else {
+                    stream_stage_discard(stage);
+                }
+            }
 
             while (next_window_start < full_end) {
                 int64_t ws = next_window_start;
+                qwen_sched_yield();
                 int64_t ws_local_off = ws - local_base_sample;
                 if (ws_local_off < 0 ||
                     ws_local_off + enc_window_samples > local_n_samples) {
@@ -1580,7 +2855,12 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                 }
                 float *win_enc = NULL;
                 int win_seq = 0;
-                if (stream_encode_span(ctx,
+                int si = use_stage ? (int)((ws - stage->start_sample) / enc_window_samples) : -1;
+                if (si >= 0 && si < stage->n_windows && stage->win_enc[si]) {
+                    win_enc = stage->win_enc[si];
+                    win_seq = stage->win_seq[si];
+                    stage->win_enc[si] = NULL;
+                } else if (stream_encode_span(ctx,
                                        audio_samples + (size_t)ws_local_off,
                                        enc_window_samples,
                                        &win_enc, &win_seq) != 0 ||
@@ -1614,7 +2894,11 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
 
             float *partial_enc = NULL;
             int partial_seq = 0;
-            if (!enc_failed && full_end < audio_cursor) {
+            if (!enc_failed && full_end < audio_cursor && use_stage) {
+                partial_enc = stage->tail_enc;
+                partial_seq = stage->tail_seq;
+                stage->tail_enc = NULL;
+            } else if (!enc_failed && full_end < audio_cursor) {
                 int64_t partial_samples64 = audio_cursor - full_end;
                 int64_t partial_off64 = full_end - local_base_sample;
                 if (partial_samples64 > INT_MAX || partial_off64 < 0 ||
@@ -1630,6 +2914,11 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                 }
             }
 
+            if (use_stage) {
+                ctx->perf_encode_ms += stage->enc_ms;
+                stream_stage_discard(stage);
+                chunk_prefetched = 1;
+            }
             if (enc_failed) {
                 free(partial_enc);
                 ctx->perf_total_ms += get_time_ms() - chunk_t0;
@@ -1648,6 +2937,7 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                     enc_cache_start++;
                     evicted++;
                 }
+                chunk_evicted = evicted;
                 if (evicted && qwen_monitor) {
                     fprintf(stderr, "\xe2\x9f\xb3");  /* ⟳ = window eviction */
                     fflush(stderr);
@@ -1687,23 +2977,58 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                 double enc_ms = get_time_ms() - t0;
                 ctx->perf_encode_ms += enc_ms;
                 fprintf(stderr,
-                        "  Encoder: %d tokens from 0.0-%.1f s (cached windows=%d, partial=%.1f s, %.0f ms)\n",
+                        "  Encoder: %d tokens from 0.0-%.1f s (cached windows=%d, partial=%.1f s, %.0f ms%s)\n",
                         enc_seq_len,
                         (float)audio_cursor / QWEN_SAMPLE_RATE,
                         n_enc_cache - enc_cache_start,
                         (float)(audio_cursor - full_end) / QWEN_SAMPLE_RATE,
-                        enc_ms);
+                        enc_ms, use_stage ? ", prefetched" : "");
             }
             if (qwen_verbose < 2) {
                 double enc_ms = get_time_ms() - t0;
                 ctx->perf_encode_ms += enc_ms;
             }
+            qwen_phase_end(&ctx->perf_phase[QWEN_PHASE_ENCODER], &ps);
             if (qwen_monitor) {
                 fprintf(stderr, "\xe2\x96\xb6");  /* ▶ = encoder */
                 fflush(stderr);
             }
         }
 
+        /* A draft nobody reads (no partial callback) only keeps the encoder
+         * cache current; its audio is decoded by the next full pass. */
+        if (is_draft && !ctx->partial_cb) {
+            free(enc_output);
+            if (stage) {
+                stream_stage_submit(stage, full_end, audio_cursor + chunk_samples,
+                                    enc_window_samples,
+                                    local_samples, local_base_sample, local_n_samples);
+            }
+            if (live && use_enc_cache) {
+                stream_drop_local_audio(full_end, local_samples,
+                                        &local_n_samples, &local_base_sample);
+                audio_n_samples = local_base_sample + local_n_samples;
+            }
+            double chunk_ms = get_time_ms() - chunk_t0;
+            ctx->perf_total_ms += chunk_ms;
+            qwen_flight_entry_t fe = {
+                .stream = flight_stream,
+                .chunk = chunk_idx,
+                .flags = QWEN_FLIGHT_DRAFT | (chunk_prefetched ? QWEN_FLIGHT_PREFETCHED : 0),
+                .unix_ms = chunk_t0 + chunk_ms,
+                .stream_sec = (chunk_t0 + chunk_ms - stream_t0) / 1000.0,
+                .audio_sec = (double)audio_cursor / QWEN_SAMPLE_RATE,
+                .encode_ms = (float)(ctx->perf_encode_ms - chunk_enc0),
+                .total_ms = (float)chunk_ms,
+                .evicted_windows = chunk_evicted,
+            };
+            stream_report_chunk(ctx, flight, &fe, ctx->perf_encode_ms - chunk_enc0,
+                                ctx->perf_decode_ms - chunk_dec0, chunk_ms);
+            drafts_since_full++;
+            chunk_idx++;
+            continue;
+        }
+
         /* Prefix rollback state:
          * we feed previously decoded raw tokens minus last `rollback` tokens.
          * This mirrors official streaming and keeps boundary text stable. */
@@ -1735,21 +3060,21 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
 
         int off = 0;
         for (int i = 0; i < PREFIX_HEAD_LEN; i++) {
-            tok_embed_bf16_to_f32(input_embeds + off * dim,
-                                  ctx->decoder.tok_embeddings_bf16,
-                                  PROMPT_PREFIX_HEAD[i], dim);
+            tok_embed_to_f32(input_embeds + off * dim,
+                             &ctx->decoder,
+                             PROMPT_PREFIX_HEAD[i], dim);
             off++;
         }
         for (int i = 0; i < ctx->n_prompt_tokens; i++) {
-            tok_embed_bf16_to_f32(input_embeds + off * dim,
-                                  ctx->decoder.tok_embeddings_bf16,
-                                  ctx->prompt_tokens[i], dim);
+            tok_embed_to_f32(input_embeds + off * dim,
+                             &ctx->decoder,
+                             ctx->prompt_tokens[i], dim);
             off++;
         }
         for (int i = 0; i < PREFIX_TAIL_LEN; i++) {
-            tok_embed_bf16_to_f32(input_embeds + off * dim,
-                                  ctx->decoder.tok_embeddings_bf16,
-                                  PROMPT_PREFIX_TAIL[i], dim);
+            tok_embed_to_f32(input_embeds + off * dim,
+                             &ctx->decoder,
+                             PROMPT_PREFIX_TAIL[i], dim);
             off++;
         }
 
@@ -1761,23 +3086,26 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
 
         int suffix_off = prefix_len + enc_seq_len;
         for (int i = 0; i < SUFFIX_BASE_LEN; i++)
-            tok_embed_bf16_to_f32(input_embeds + (suffix_off + i) * dim,
-                                  ctx->decoder.tok_embeddings_bf16,
-                                  PROMPT_SUFFIX_BASE[i], dim);
+            tok_embed_to_f32(input_embeds + (suffix_off + i) * dim,
+                             &ctx->decoder,
+                             PROMPT_SUFFIX_BASE[i], dim);
 
         for (int i = 0; i < ctx->n_force_prompt_tokens; i++)
-            tok_embed_bf16_to_f32(input_embeds + (suffix_off + SUFFIX_BASE_LEN + i) * dim,
-                                  ctx->decoder.tok_embeddings_bf16,
-                                  ctx->force_prompt_tokens[i], dim);
+            tok_embed_to_f32(input_embeds + (suffix_off + SUFFIX_BASE_LEN + i) * dim,
+                             &ctx->decoder,
+                             ctx->force_prompt_tokens[i], dim);
 
         int text_off = suffix_off + suffix_len;
         for (int i = 0; i < n_prefix_tokens; i++)
-            tok_embed_bf16_to_f32(input_embeds + (text_off + i) * dim,
-                                  ctx->decoder.tok_embeddings_bf16,
-                                  raw_tokens[prefix_offset + i], dim);
+            tok_embed_to_f32(input_embeds + (text_off + i) * dim,
+                             &ctx->decoder,
+                             raw_tokens[prefix_offset + i], dim);
 
         /* ---- Decoder prefill + first token ---- */
+        qwen_phase_begin(&ps);
         t0 = get_time_ms();
+        int saved_layers_limit = ctx->dec_layers_limit;
+        if (is_draft) ctx->dec_layers_limit = draft_layers;
         int prefill_len = total_seq - 1;
         int reused_prefill = 0;
         if (prev_prefill_embeds && prev_prefill_len > 0) {
@@ -1805,29 +3133,36 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
         float *last_embed = input_embeds + (size_t)prefill_len * dim;
         int token = qwen_decoder_forward(ctx, last_embed);
 
-        if (prefill_len > prev_prefill_cap) {
-            int new_cap = prev_prefill_cap > 0 ? prev_prefill_cap : 64;
-            while (new_cap < prefill_len) new_cap *= 2;
-            float *tmp_prev = (float *)realloc(prev_prefill_embeds,
-                                               (size_t)new_cap * dim * sizeof(float));
-            if (tmp_prev) {
-                prev_prefill_embeds = tmp_prev;
-                prev_prefill_cap = new_cap;
+        if (is_draft) {
+            /* Rows past the reused prefix now hold draft KV in the lower
+             * layers only: the next full pass must prefill them again. */
+            if (prev_prefill_len > reused_prefill) prev_prefill_len = reused_prefill;
+        } else {
+            if (prefill_len > prev_prefill_cap) {
+                int new_cap = prev_prefill_cap > 0 ? prev_prefill_cap : 64;
+                while (new_cap < prefill_len) new_cap *= 2;
+                float *tmp_prev = (float *)realloc(prev_prefill_embeds,
+                                                   (size_t)new_cap * dim * sizeof(float));
+                if (tmp_prev) {
+                    prev_prefill_embeds = tmp_prev;
+                    prev_prefill_cap = new_cap;
+                } else {
+                    prev_prefill_len = 0;
+                }
+            }
+            if (prev_prefill_embeds && prev_prefill_cap >= prefill_len) {
+                memcpy(prev_prefill_embeds, input_embeds,
+                       (size_t)prefill_len * dim * sizeof(float));
+                prev_prefill_len = prefill_len;
             } else {
                 prev_prefill_len = 0;
             }
         }
-        if (prev_prefill_embeds && prev_prefill_cap >= prefill_len) {
-            memcpy(prev_prefill_embeds, input_embeds,
-                   (size_t)prefill_len * dim * sizeof(float));
-            prev_prefill_len = prefill_len;
-        } else {
-            prev_prefill_len = 0;
-        }
         free(input_embeds);
 
         double prefill_ms = get_time_ms() - t0;
         ctx->perf_decode_ms += prefill_ms;
+        qwen_phase_end(&ctx->perf_phase[QWEN_PHASE_PREFILL], &ps);
         if (qwen_verbose >= 2)
             fprintf(stderr, "  Prefill: %d tokens (%d prefix, reused %d) (%.0f ms)\n",
                     total_seq, n_prefix_tokens, reused_prefill, prefill_ms);
@@ -1836,36 +3171,50 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
             fflush(stderr);
         }
 
+        /* Pipelined live path: encode the next chunk while this one decodes.
+         * Next chunk starts its windows at full_end (also after resets). */
+        if (stage && !is_final) {
+            stream_stage_submit(stage, full_end, audio_cursor + chunk_samples,
+                                enc_window_samples,
+                                local_samples, local_base_sample, local_n_samples);
+        }
+
         /* ---- Autoregressive decode ---- */
+        qwen_phase_begin(&ps);
         t0 = get_time_ms();
         int n_generated = 0;
 
         /* Collect ALL generated tokens (including language, <asr_text>, etc.) */
-        int *chunk_tokens = (int *)malloc((size_t)max_new_tokens * sizeof(int));
+        int *chunk_tokens = (int *)malloc((size_t)chunk_max_new * sizeof(int));
         if (!chunk_tokens) {
+            ctx->dec_layers_limit = saved_layers_limit;
             ctx->perf_total_ms += get_time_ms() - chunk_t0;
             chunk_idx++;
             continue;
         }
         int n_chunk_tokens = 0;
 
-        while (n_generated < max_new_tokens) {
+        while (n_generated < chunk_max_new) {
             n_generated++;
             if (token == QWEN_TOKEN_ENDOFTEXT || token == QWEN_TOKEN_IM_END) break;
 
             chunk_tokens[n_chunk_tokens++] = token;
 
-            tok_embed_bf16_to_f32(tmp_embed, ctx->decoder.tok_embeddings_bf16, token, dim);
+            tok_embed_to_f32(tmp_embed, &ctx->decoder, token, dim);
+            qwen_sched_yield();
             token = qwen_decoder_forward(ctx, tmp_embed);
         }
 
+        ctx->dec_layers_limit = saved_layers_limit;
         double decode_ms = get_time_ms() - t0;
         ctx->perf_decode_ms += decode_ms;
+        qwen_phase_end(&ctx->perf_phase[QWEN_PHASE_DECODE], &ps);
         if (qwen_verbose >= 2)
-            fprintf(stderr, "  Decode: %d tokens (%.0f ms, %.1f ms/token%s)\n",
+            fprintf(stderr, "  Decode%s: %d tokens (%.0f ms, %.1f ms/token%s)\n",
+                    is_draft ? " (draft)" : "",
                     n_generated, decode_ms,
                     n_generated > 0 ? decode_ms / n_generated : 0,
-                    (n_generated >= max_new_tokens &&
+                    (n_generated >= chunk_max_new &&
                      token != QWEN_TOKEN_ENDOFTEXT &&
                      token != QWEN_TOKEN_IM_END) ? ", hit max_new" : "");
         if (qwen_monitor) {
@@ -1875,6 +3224,56 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
             fflush(stderr);
         }
 
+        if (is_draft) {
+            /* Draft text beyond the committed frontier becomes the partial;
+             * raw history and commit state stay as the last full pass left
+             * them. */
+            int n_draft = n_prefix_tokens_full + n_chunk_tokens;
+            int *draft_tokens = (int *)malloc((size_t)(n_draft > 0 ? n_draft : 1) * sizeof(int));
+            if (partial_text) partial_text[0] = '\0';
+            if (draft_tokens) {
+                memcpy(draft_tokens, raw_tokens, (size_t)n_prefix_tokens_full * sizeof(int));
+                memcpy(draft_tokens + n_prefix_tokens_full, chunk_tokens,
+                       (size_t)n_chunk_tokens * sizeof(int));
+                int tail = stream_text_start(ctx, draft_tokens, n_draft) + n_stable_text_tokens;
+                if (tail < n_draft)
+                    stream_format_tokens(tokenizer, draft_tokens + tail, n_draft - tail,
+                                         &partial_text, &partial_cap);
+                free(draft_tokens);
+            }
+            free(chunk_tokens);
+            ctx->partial_cb(partial_text ? partial_text : "", ctx->partial_cb_userdata);
+
+            if (live && use_enc_cache) {
+                stream_drop_local_audio(full_end, local_samples,
+                                        &local_n_samples, &local_base_sample);
+                audio_n_samples = local_base_sample + local_n_samples;
+            }
+            double chunk_ms = get_time_ms() - chunk_t0;
+            ctx->perf_total_ms += chunk_ms;
+            qwen_flight_entry_t fe = {
+                .stream = flight_stream,
+                .chunk = chunk_idx,
+                .flags = QWEN_FLIGHT_DRAFT | (chunk_prefetched ? QWEN_FLIGHT_PREFETCHED : 0),
+                .unix_ms = chunk_t0 + chunk_ms,
+                .stream_sec = (chunk_t0 + chunk_ms - stream_t0) / 1000.0,
+                .audio_sec = (double)audio_cursor / QWEN_SAMPLE_RATE,
+                .encode_ms = (float)(ctx->perf_encode_ms - chunk_enc0),
+                .prefill_ms = (float)prefill_ms,
+                .decode_ms = (float)decode_ms,
+                .total_ms = (float)chunk_ms,
+                .prefill_tokens = prefill_len,
+                .prefill_reused = reused_prefill,
+                .generated_tokens = n_generated,
+                .evicted_windows = chunk_evicted,
+            };
+            stream_report_chunk(ctx, flight, &fe, ctx->perf_encode_ms - chunk_enc0,
+                                ctx->perf_decode_ms - chunk_dec0, chunk_ms);
+            drafts_since_full++;
+            chunk_idx++;
+            continue;
+        }
+
         /* Update raw token history = full prefix + newly generated continuation.
          * Uses n_prefix_tokens_full (uncapped) so raw_tokens keeps the complete
          * token sequence for correct text-level matching in the commit phase. */
@@ -1936,24 +3335,33 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
             fprintf(stderr, "  Decode: dropped %d repeated tokens\n", dropped_repeat_tokens);
         }
 
-        /* Parse text region from raw stream output:
-         * - default: language ... <asr_text> TEXT
-         * - forced language: prompt already anchors language, so generated stream is TEXT. */
-        int text_start = 0;
-        if (ctx->n_force_prompt_tokens <= 0) {
-            int asr_text_pos = -1;
-            for (int i = 0; i < n_raw_tokens; i++) {
-                if (raw_tokens[i] == QWEN_TOKEN_ASR_TEXT) {
-                    asr_text_pos = i;
-                    break;
-                }
-            }
-            text_start = (asr_text_pos >= 0) ? asr_text_pos + 1 : 0;
-        }
+        /* Parse text region from raw stream output. */
+        int text_start = stream_text_start(ctx, raw_tokens, n_raw_tokens);
         if (text_start < 0) text_start = 0;
         if (text_start > n_raw_tokens) text_start = n_raw_tokens;
         int n_text_tokens = n_raw_tokens - text_start;
 
+        /* Endpointing: enough trailing silence after sentence-final text (or
+         * twice as much after any text) closes the utterance now instead of
+         * waiting for more audio. */
+        int is_endpoint = 0;
+        int endpoint_sil = 0;
+        if (!is_final && endpoint_samples > 0 && n_text_tokens > 0) {
+            int64_t span_start = enc_origin > local_base_sample ? enc_origin : local_base_sample;
+            int64_t span = audio_cursor - span_start;
+            if (span > 0 && span <= INT_MAX) {
+                endpoint_sil = trailing_silence_samples(
+                    audio_samples + (size_t)(span_start - local_base_sample), (int)span,
+                    endpoint_lookback);
+                if (endpoint_sil >= endpoint_samples && endpoint_sil < span) {
+                    const char *last = qwen_tokenizer_decode(tokenizer,
+                                                             raw_tokens[n_raw_tokens - 1]);
+                    if (endpoint_sil >= 2 * endpoint_samples || piece_ends_sentence(last))
+                        is_endpoint = 1;
+                }
+            }
+        }
+
         /* "Fixed" frontier for this chunk:
          * - cold-start chunks: emit nothing,
          * - intermediate chunks: keep last `rollback` text tokens unfixed,
@@ -1961,7 +3369,7 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
          *   streaming still advances,
          * - final chunk: emit everything. */
         int candidate_len = 0;
-        if (is_final) {
+        if (is_final || is_endpoint) {
             candidate_len = n_text_tokens;
         } else if (chunk_idx >= unfixed_chunks) {
             candidate_len = n_text_tokens - rollback;
@@ -1974,13 +3382,15 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
         int *candidate_tokens = raw_tokens + text_start;
         int did_recovery_reset = 0;
         int did_periodic_reset = 0;
+        int did_endpoint = 0;
+        if (partial_text) partial_text[0] = '\0';
         {
             int tail_period = 0;
             int tail_reps = stream_tail_repeat_blocks(candidate_tokens, candidate_len,
                                                       QWEN_STREAM_DEGEN_MAX_PERIOD,
                                                       &tail_period);
             int candidate_advance = candidate_len - n_stable_text_tokens;
-            if (!is_final && n_generated >= max_new_tokens && candidate_advance <= 1) {
+            if (!is_final && n_generated >= chunk_max_new && candidate_advance <= 1) {
                 stagnant_chunks++;
             } else {
                 stagnant_chunks = 0;
@@ -2089,8 +3499,37 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
 
                 n_stable_text_tokens = candidate_len;
 
+                /* Unstable tail = decoded text beyond the commit frontier
+                 * (captured before a periodic reset re-anchors raw_tokens). */
+                if (ctx->partial_cb && n_text_tokens > candidate_len) {
+                    stream_format_tokens(tokenizer, candidate_tokens + candidate_len,
+                                         n_text_tokens - candidate_len,
+                                         &partial_text, &partial_cap);
+                }
+
+                if (is_endpoint) {
+                    /* Utterance is fully committed: restart from an empty
+                     * text state with encoder windows aligned to the cursor,
+                     * so the finished utterance's audio and KV are dropped. */
+                    n_raw_tokens = 0;
+                    n_stable_text_tokens = 0;
+                    n_emitted_text_tokens = 0;
+                    prev_prefill_len = 0;
+                    ctx->kv_cache_len = 0;
+                    stream_clear_enc_cache(enc_cache,
+                                           &n_enc_cache,
+                                           &enc_cache_start,
+                                           &enc_cached_seq_total,
+                                           &next_window_start,
+                                           audio_cursor);
+                    enc_origin = audio_cursor;
+                    full_end = audio_cursor;
+                    stagnant_chunks = 0;
+                    did_endpoint = 1;
+                }
+
                 int periodic_reset =
-                    (!is_final &&
+                    (!is_final && !did_endpoint &&
                      ctx->past_text_conditioning &&
                      chunk_idx >= unfixed_chunks &&
                      ((chunk_idx + 1) % QWEN_STREAM_RESET_INTERVAL_CHUNKS == 0));
@@ -2123,37 +3562,86 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                         n_prefix_tokens, n_prefix_tokens_full, prefix_offset);
             if (did_recovery_reset) {
                 fprintf(stderr, "  Recovery reset applied\n");
+            } else if (did_endpoint) {
+                fprintf(stderr, "  Endpoint: utterance finalized after %.0f ms of silence\n",
+                        1000.0 * endpoint_sil / QWEN_SAMPLE_RATE);
             } else if (did_periodic_reset) {
                 fprintf(stderr, "  Periodic reset applied\n");
             }
             fprintf(stderr, "  Commit: candidate=%d tokens, emitted_total=%d\n",
                     candidate_len, n_stable_text_tokens);
         }
+        if (ctx->partial_cb)
+            ctx->partial_cb(partial_text ? partial_text : "", ctx->partial_cb_userdata);
+        if (did_endpoint || is_final) {
+            /* A resumed utterance starts with the text committed before the
+             * handoff. */
+            char *joined = NULL;
+            if (utt_carry) {
+                size_t carry_len = strlen(utt_carry);
+                size_t tail_len = result_len - utterance_start;
+                joined = (char *)malloc(carry_len + tail_len + 1);
+                if (joined) {
+                    memcpy(joined, utt_carry, carry_len);
+                    memcpy(joined + carry_len, result + utterance_start, tail_len + 1);
+                }
+                free(utt_carry);
+                utt_carry = NULL;
+            }
+            const char *utt = joined ? joined : result + utterance_start;
+            while (*utt && isspace((unsigned char)*utt)) utt++;
+            if (ctx->endpoint_cb && (*utt || did_endpoint))
+                ctx->endpoint_cb(utt, ctx->endpoint_cb_userdata);
+            free(joined);
+            utterance_start = result_len;
+            if (did_endpoint && qwen_monitor) {
+                fprintf(stderr, "\xe2\x8f\x8e");  /* ⏎ = endpoint */
+                fflush(stderr);
+            }
+        }
 
         if (live && use_enc_cache) {
             /* Keep only the current partial tail [full_end, audio_n_samples). */
-            int64_t keep_from = full_end;
-            if (keep_from > local_base_sample) {
-                int64_t drop64 = keep_from - local_base_sample;
-                if (drop64 > local_n_samples) drop64 = local_n_samples;
-                if (drop64 > 0) {
-                    int64_t remain = local_n_samples - drop64;
-                    if (remain > 0) {
-                        memmove(local_samples, local_samples + (size_t)drop64,
-                                (size_t)remain * sizeof(float));
-                    }
-                    local_n_samples = remain;
-                    local_base_sample += drop64;
-                    audio_samples = local_samples;
-                    audio_n_samples = local_base_sample + local_n_samples;
-                }
-            }
+            stream_drop_local_audio(full_end, local_samples,
+                                    &local_n_samples, &local_base_sample);
+            audio_n_samples = local_base_sample + local_n_samples;
         }
 
-        ctx->perf_total_ms += get_time_ms() - chunk_t0;
+        double chunk_ms = get_time_ms() - chunk_t0;
+        ctx->perf_total_ms += chunk_ms;
+        qwen_flight_entry_t fe = {
+            .stream = flight_stream,
+            .chunk = chunk_idx,
+            .flags = (chunk_prefetched ? QWEN_FLIGHT_PREFETCHED : 0) |
+                     (did_recovery_reset ? QWEN_FLIGHT_RECOVERY_RESET : 0) |
+                     (did_periodic_reset ? QWEN_FLIGHT_PERIODIC_RESET : 0) |
+                     (did_endpoint ? QWEN_FLIGHT_ENDPOINT : 0),
+            .unix_ms = chunk_t0 + chunk_ms,
+            .stream_sec = (chunk_t0 + chunk_ms - stream_t0) / 1000.0,
+            .audio_sec = (double)audio_cursor / QWEN_SAMPLE_RATE,
+            .encode_ms = (float)(ctx->perf_encode_ms - chunk_enc0),
+            .prefill_ms = (float)prefill_ms,
+            .decode_ms = (float)decode_ms,
+            .total_ms = (float)chunk_ms,
+            .prefill_tokens = prefill_len,
+            .prefill_reused = reused_prefill,
+            .generated_tokens = n_generated,
+            .emitted_tokens = ctx->perf_text_tokens - chunk_text0,
+            .evicted_windows = chunk_evicted,
+        };
+        stream_report_chunk(ctx, flight, &fe, ctx->perf_encode_ms - chunk_enc0,
+                            ctx->perf_decode_ms - chunk_dec0, chunk_ms);
+        drafts_since_full = 0;
         chunk_idx++;
     }
 
+    if (stage) {
+        /* The stage may be waiting for its share: don't hold ours */
+        int depth = qwen_sched_suspend();
+        stream_stage_stop(stage);
+        qwen_set_thread_budget(prev_budget);
+        qwen_sched_resume(depth);
+    }
     free(tmp_embed);
     for (int i = enc_cache_start; i < n_enc_cache; i++) {
         free(enc_cache[i].enc_output);
@@ -2165,6 +3653,8 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
                 prefill_reused_tokens, prefill_total_tokens, reuse_pct);
     }
     free(prev_prefill_embeds);
+    free(utt_carry);
+    free(partial_text);
     free(raw_tokens);
     free(stable_text_tokens);
     free(emitted_text_tokens);
@@ -2182,12 +3672,31 @@ static char *stream_impl(qwen_ctx_t *ctx, const float *samples, int n_samples,
     return result;
 }
 
+/* Public entry points own their share of the compute pool (ctx->job_threads,
+ * whole pool by default) for the whole job; batch jobs hand it over at
+ * yield points inside the encoder/decoder loops. */
+char *qwen_transcribe_audio(qwen_ctx_t *ctx, const float *samples, int n_samples) {
+    qwen_sched_acquire(ctx->priority, ctx->job_threads);
+    char *text = transcribe_audio_impl(ctx, samples, n_samples);
+    if (ctx->trim_policy == QWEN_TRIM_AFTER_JOB) qwen_trim(ctx);
+    qwen_sched_release();
+    return text;
+}
+
 char *qwen_transcribe_stream(qwen_ctx_t *ctx, const float *samples, int n_samples) {
-    return stream_impl(ctx, samples, n_samples, NULL);
+    qwen_sched_acquire(ctx->priority, ctx->job_threads);
+    char *text = stream_impl(ctx, samples, n_samples, NULL);
+    if (ctx->trim_policy == QWEN_TRIM_AFTER_JOB) qwen_trim(ctx);
+    qwen_sched_release();
+    return text;
 }
 
 char *qwen_transcribe_stream_live(qwen_ctx_t *ctx, qwen_live_audio_t *live) {
-    return stream_impl(ctx, NULL, 0, live);
+    qwen_sched_acquire(ctx->priority, ctx->job_threads);
+    char *text = stream_impl(ctx, NULL, 0, live);
+    if (ctx->trim_policy == QWEN_TRIM_AFTER_JOB) qwen_trim(ctx);
+    qwen_sched_release();
+    return text;
 }
 
 char *qwen_transcribe(qwen_ctx_t *ctx, const char *wav_path) {
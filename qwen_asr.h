@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <pthread.h>
+#include "qwen_asr_perfctr.h"
 
 /* ========================================================================
  * Constants
@@ -35,6 +36,18 @@
 #define QWEN_TOKEN_AUDIO_PAD    151676
 #define QWEN_TOKEN_ASR_TEXT     151704
 
+/* Job priority classes (see qwen_set_priority) */
+#define QWEN_PRIORITY_INTERACTIVE 0
+#define QWEN_PRIORITY_BATCH       1
+
+/* Memory trim policies (see qwen_set_trim_policy) */
+#define QWEN_TRIM_NONE            0
+#define QWEN_TRIM_AFTER_JOB       1
+
+/* Live stream checkpoint flags (see qwen_stream_request_checkpoint) */
+#define QWEN_CHECKPOINT_KV        1   /* include decoder KV: resume without prefill */
+#define QWEN_CHECKPOINT_COMPACT   2   /* store encoder/KV/embedding floats as bf16 */
+
 /* Conv2D stem constants */
 #define QWEN_CONV_HIDDEN      480
 #define QWEN_CONV_KERNEL      3
@@ -122,6 +135,9 @@ typedef struct {
     float *proj1_bias;         /* [d_model] */
     float *proj2_weight;       /* [output_dim, d_model] */
     float *proj2_bias;         /* [output_dim] */
+
+    /* int8 copies of the linear weights (qwen_set_encoder_int8), or NULL */
+    void *q8;
 } qwen_encoder_t;
 
 /* ========================================================================
@@ -150,6 +166,13 @@ typedef struct {
 
     /* Fused gate+up weight for single-token matvec [2*intermediate, hidden] */
     uint16_t *gate_up_fused_bf16;
+
+    /* 2:4 sparse MLP from a sidecar file (qwen_load_sparse_mlp), or NULL;
+     * replaces gate_up_fused_bf16 and down_weight_bf16 when set */
+    uint16_t *gate_up_sp24_vals; /* [2*intermediate, hidden/2] */
+    uint8_t *gate_up_sp24_idx;   /* [2*intermediate, hidden/8] */
+    uint16_t *down_sp24_vals;    /* [hidden, intermediate/2] */
+    uint8_t *down_sp24_idx;      /* [hidden, intermediate/8] */
 } qwen_dec_layer_t;
 
 typedef struct {
@@ -161,6 +184,9 @@ typedef struct {
 
     /* Final RMSNorm */
     float *norm;               /* [hidden] */
+
+    /* The 16-bit weights (*_bf16 fields) hold IEEE fp16: fp16 checkpoint */
+    int f16;
 } qwen_decoder_t;
 
 /* ========================================================================
@@ -171,6 +197,65 @@ typedef struct {
  * 'piece' is the decoded token string (UTF-8). */
 typedef void (*qwen_token_cb)(const char *piece, void *userdata);
 
+/* Called after each streaming chunk with the current unstable tail: text
+ * already decoded but not yet committed through qwen_token_cb. Each call
+ * replaces the previous partial; "" means no pending tail. */
+typedef void (*qwen_partial_cb)(const char *text, void *userdata);
+
+/* Called when a streaming utterance is finalized (endpoint detected, or end
+ * of stream) with the utterance's full committed text. */
+typedef void (*qwen_endpoint_cb)(const char *utterance, void *userdata);
+
+/* Per-chunk streaming stats, passed to qwen_chunk_cb after each chunk is
+ * committed. audio_sec is the stream time of the chunk's last sample, so a
+ * caller that knows when that audio arrived can derive caption lag. */
+typedef struct {
+    int chunk;                 /* chunk index within the stream */
+    double audio_sec;          /* audio covered once this chunk is done */
+    double encode_ms;          /* mel + encoder time (incl. prefetched stage) */
+    double decode_ms;          /* prefill + decode time */
+    double total_ms;           /* wall time from chunk start to commit */
+} qwen_chunk_stats_t;
+
+typedef void (*qwen_chunk_cb)(const qwen_chunk_stats_t *stats, void *userdata);
+
+/* Flight recorder: the last QWEN_FLIGHT_SLOTS chunks of a context's
+ * streaming sessions in a fixed ring. The stream thread writes each slot
+ * under a per-slot seqlock, so recording is a copy and two stores, and a
+ * dump from any thread (qwen_flight_dump_json) never blocks it. */
+#define QWEN_FLIGHT_SLOTS 256
+
+#define QWEN_FLIGHT_PREFETCHED     1   /* encoder output came from the pipelined stage */
+#define QWEN_FLIGHT_RECOVERY_RESET 2   /* degenerate output, decoder state reset */
+#define QWEN_FLIGHT_PERIODIC_RESET 4   /* text history re-anchored */
+#define QWEN_FLIGHT_ENDPOINT       8   /* utterance finalized after silence */
+#define QWEN_FLIGHT_DRAFT         16   /* interim draft chunk, nothing committed */
+
+typedef struct {
+    int stream;                /* stream index within the context */
+    int chunk;                 /* chunk index within the stream */
+    int flags;                 /* QWEN_FLIGHT_* */
+    double unix_ms;            /* wall clock at commit */
+    double stream_sec;         /* wall time since the stream started */
+    double audio_sec;          /* audio covered once this chunk is done */
+    float encode_ms;
+    float prefill_ms;
+    float decode_ms;
+    float total_ms;
+    int prefill_tokens;        /* decoder prefill length */
+    int prefill_reused;        /* of which reused from the previous chunk */
+    int generated_tokens;
+    int emitted_tokens;        /* text tokens committed by this chunk */
+    int evicted_windows;       /* encoder windows dropped from the cache */
+} qwen_flight_entry_t;
+
+typedef struct {
+    uint64_t head;                              /* entries ever recorded */
+    int n_streams;
+    uint32_t seq[QWEN_FLIGHT_SLOTS];            /* 2 x writes to the slot, odd while writing */
+    qwen_flight_entry_t slot[QWEN_FLIGHT_SLOTS];
+} qwen_flight_recorder_t;
+
 /* ========================================================================
  * Main Context
  * ======================================================================== */
@@ -182,7 +267,9 @@ typedef struct {
 
     /* Model files (kept open for mmap) */
     void *safetensors;         /* multi_safetensors_t* */
+    void *sparse_mlp;          /* safetensors_file_t* of the 2:4 MLP sidecar, or NULL */
     char model_dir[512];
+    int owns_weights;          /* 0 for qwen_clone() contexts */
 
     /* KV cache for decoder */
     float *kv_cache_k;         /* [layers, max_seq, kv_heads * head_dim] */
@@ -212,6 +299,18 @@ typedef struct {
     qwen_token_cb token_cb;
     void *token_cb_userdata;
 
+    /* Streaming interim hypothesis callback (optional) */
+    qwen_partial_cb partial_cb;
+    void *partial_cb_userdata;
+
+    /* Streaming utterance-final callback (optional) */
+    qwen_endpoint_cb endpoint_cb;
+    void *endpoint_cb_userdata;
+
+    /* Streaming per-chunk stats callback (optional) */
+    qwen_chunk_cb chunk_cb;
+    void *chunk_cb_userdata;
+
     /* Segmentation settings */
     float segment_sec;             /* 0 = no splitting, default full-audio decode */
     float search_sec;              /* segment-cutting silence search window ± seconds (default 3) */
@@ -221,10 +320,31 @@ typedef struct {
     int stream_rollback;           /* tokens to roll back per chunk (default 5) */
     int stream_unfixed_chunks;     /* cold-start chunks without prefix (default 2) */
     int stream_max_new_tokens;     /* max generated tokens per streaming step (default 32) */
+    int stream_pipeline;           /* 1=live mode encodes next chunk during decode (default 1) */
+    int stream_endpoint_ms;        /* trailing silence that ends an utterance, 0=off (default 0) */
+    int stream_draft_layers;       /* decoder layers for interim chunks, 0=two-pass off (default 0) */
+    int stream_draft_tokens;       /* max generated tokens per draft, 0=stream_max_new_tokens */
+    int stream_final_every;        /* full-quality commit every Nth chunk in two-pass mode (default 3) */
     int past_text_conditioning;    /* 1=enable past text conditioning in -S/--stream (default: off).
                                     * In segmented mode, this also enables boundary cleanup/post-processing. */
     int skip_silence;              /* 1=drop long silent spans before transcription */
     int dec_layers_limit;          /* 0=use all layers, >0=use only first N layers (experimental) */
+    int enc_int8;                  /* 1=encoder linears use the int8 GEMM (default 0) */
+    int priority;                  /* QWEN_PRIORITY_INTERACTIVE (default) or QWEN_PRIORITY_BATCH */
+    int job_threads;               /* compute pool share per call, 0=whole pool (default) */
+
+    /* Memory trimming */
+    int trim_policy;               /* QWEN_TRIM_NONE (default) or QWEN_TRIM_AFTER_JOB */
+    int trim_baseline_tokens;      /* decoder buffers up to this many positions are kept */
+    float trim_idle_sec;           /* paused live stream offload delay, 0=off (default 0) */
+
+    /* Live stream checkpoint/restore */
+    int checkpoint_requested;      /* set atomically by qwen_stream_request_checkpoint */
+    int checkpoint_flags;          /* QWEN_CHECKPOINT_* for the pending request */
+    void *checkpoint_blob;         /* last saved session state (until taken) */
+    size_t checkpoint_size;
+    void *restore_blob;            /* state to resume in the next live stream */
+    size_t restore_size;
 
     /* Optional prompt/language controls */
     char *prompt;                  /* system prompt text (UTF-8) */
@@ -241,6 +361,10 @@ typedef struct {
     double perf_audio_ms;          /* input audio duration in milliseconds */
     double perf_encode_ms;         /* mel + encoder time in milliseconds */
     double perf_decode_ms;         /* decoder prefill + decode time in milliseconds */
+    qwen_phase_counts_t perf_phase[QWEN_N_PHASES]; /* hardware counters per phase
+                                                    * (after qwen_perf_counters_open) */
+
+    qwen_flight_recorder_t *flight; /* streaming flight recorder (first stream allocates) */
 } qwen_ctx_t;
 
 /* ========================================================================
@@ -257,6 +381,15 @@ typedef struct {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     pthread_t thread;
+
+    /* Shared-memory source (qwen_live_audio_attach_shm): samples stay in
+     * the ring, n_samples/eof are refreshed by qwen_live_audio_sync() */
+    struct qwen_shm_ring *ring;
+    int64_t ring_base;          /* global index of ring position 0 */
+    /* Fixed at attach from the validated header; the shared copies are not
+     * trusted afterwards (reads and the unmap use these) */
+    const float *ring_data;
+    uint32_t ring_capacity;
 } qwen_live_audio_t;
 
 /* ========================================================================
@@ -266,13 +399,48 @@ typedef struct {
 /* Load model from directory */
 qwen_ctx_t *qwen_load(const char *model_dir);
 
-/* Free all resources */
+/* Create a context that shares model's weights (read-only) but has its own
+ * settings copy, buffers and callbacks. model must outlive its clones. */
+qwen_ctx_t *qwen_clone(const qwen_ctx_t *model);
+
+/* Free all resources (weights only if ctx owns them) */
 void qwen_free(qwen_ctx_t *ctx);
 
 /* Set a callback to receive each decoded token as it's generated.
  * Set cb=NULL to disable. The callback is invoked during transcription. */
 void qwen_set_token_callback(qwen_ctx_t *ctx, qwen_token_cb cb, void *userdata);
 
+/* Set a callback to receive per-chunk timing of streaming modes
+ * (qwen_chunk_stats_t). Set cb=NULL to disable. */
+void qwen_set_chunk_callback(qwen_ctx_t *ctx, qwen_chunk_cb cb, void *userdata);
+
+/* Set a callback to receive the unstable tail (interim hypothesis) after
+ * each streaming chunk. Committed text still goes through the token
+ * callback; a UI can show committed + partial and redraw the partial on
+ * every call. Set cb=NULL to disable. Streaming modes only. */
+void qwen_set_partial_callback(qwen_ctx_t *ctx, qwen_partial_cb cb, void *userdata);
+
+/* Enable streaming endpoint detection. After silence_ms of trailing
+ * silence following sentence-final punctuation (or 2*silence_ms after any
+ * text), the remaining tail is committed immediately, the endpoint callback
+ * fires, and encoder cache, KV cache and text context restart empty.
+ * 0 disables (default). */
+void qwen_set_stream_endpoint_ms(qwen_ctx_t *ctx, int silence_ms);
+
+/* Two-pass streaming. With n_layers > 0 only every final_every-th chunk
+ * (and every final, endpoint or cold-start chunk) runs the full decoder and
+ * commits text; the chunks in between are drafts decoded through the first
+ * n_layers decoder layers with at most max_new_tokens tokens (0 = the
+ * stream_max_new_tokens limit), which only refresh the partial callback and
+ * leave the committed state alone. Without a partial callback drafts only
+ * encode. final_every is capped at run time so the audio since the last
+ * full pass fits the retained encoder windows. n_layers = 0 turns it off
+ * (default); invalid values are ignored. */
+void qwen_set_stream_draft(qwen_ctx_t *ctx, int n_layers, int max_new_tokens, int final_every);
+
+/* Set a callback for utterance-final events (see qwen_endpoint_cb). */
+void qwen_set_endpoint_callback(qwen_ctx_t *ctx, qwen_endpoint_cb cb, void *userdata);
+
 /* Set optional system prompt text (UTF-8). Pass NULL or "" to clear.
  * Returns 0 on success, -1 on allocation/encoding errors. */
 int qwen_set_prompt(qwen_ctx_t *ctx, const char *prompt);
@@ -292,6 +460,12 @@ void qwen_set_past_text_conditioning(qwen_ctx_t *ctx, int enable);
  * Valid range: 0.1 to 10.0 seconds. Default: 2.0. */
 void qwen_set_stream_chunk_sec(qwen_ctx_t *ctx, float chunk_sec);
 
+/* Enable/disable pipelined live streaming (default: 1).
+ * When enabled and the pool has >= 2 threads, a dedicated stage encodes the
+ * next chunk (completed windows + tail) while the current chunk decodes.
+ * About a third of the pool goes to the stage, the rest to the decoder. */
+void qwen_set_stream_pipeline(qwen_ctx_t *ctx, int enable);
+
 /* Set offline segmentation size in seconds.
  * 0 disables segmentation (full-audio decode). */
 void qwen_set_segment_sec(qwen_ctx_t *ctx, float segment_sec);
@@ -304,6 +478,100 @@ void qwen_set_search_sec(qwen_ctx_t *ctx, float search_sec);
  * Reduces compute time but may impact transcription quality. */
 void qwen_set_dec_layers_limit(qwen_ctx_t *ctx, int n_layers);
 
+/* Run the encoder linear layers (conv_out, q/k/v/o, fc1/fc2, proj1/proj2)
+ * through a dynamic int8 GEMM: weights quantized per output channel,
+ * activations per row at run time. Faster on long inputs, slightly less
+ * accurate. The first enable quantizes the weights, so call it on the
+ * loaded model before qwen_clone(); clones then share the int8 weights.
+ * Returns 0, or -1 if the weights cannot be quantized. Default: off. */
+int qwen_set_encoder_int8(qwen_ctx_t *ctx, int enable);
+
+/* 2:4 structured-sparse decoder MLP (experimental, lossy). In every group
+ * of 4 consecutive input columns of the gate/up/down matrices only the 2
+ * largest-magnitude bf16 weights are kept, with 2-bit positions: the MLP
+ * streams about 56% of its dense bytes per token.
+ * qwen_write_sparse_mlp() prunes the loaded dense weights and writes them
+ * to a sidecar safetensors file; qwen_load_sparse_mlp() maps such a file
+ * (any 2:4 pruning of the same model will do) and switches the MLP to the
+ * sparse kernels, dropping the dense fused gate/up copy. Load on the model
+ * before qwen_clone(). Both return 0, or -1 on error. */
+int qwen_write_sparse_mlp(qwen_ctx_t *ctx, const char *path);
+int qwen_load_sparse_mlp(qwen_ctx_t *ctx, const char *path);
+
+/* Set job priority class for transcription calls on this context.
+ * Batch jobs give the compute pool to waiting interactive jobs at every
+ * decode step and encoder layer/window boundary, and resume afterwards.
+ * Default: QWEN_PRIORITY_INTERACTIVE. */
+void qwen_set_priority(qwen_ctx_t *ctx, int priority);
+
+/* Set how many compute pool threads a transcription call on this context
+ * uses (0 = whole pool, the default). Calls on contexts whose shares fit
+ * in the pool together run concurrently on disjoint workers; a call waits
+ * until its share is free. A share larger than the pool uses the whole
+ * pool, also after qwen_set_threads() resizes it. */
+void qwen_set_job_threads(qwen_ctx_t *ctx, int n_threads);
+
+/* Set the memory trim policy. Per-context decoder buffers (KV cache,
+ * prefill activations, RoPE tables) and the per-thread bf16 scratch only grow;
+ * with QWEN_TRIM_AFTER_JOB every transcription call ends with qwen_trim().
+ * Buffers sized for at most baseline_tokens decoder positions are kept warm,
+ * larger ones are released and regrow on demand. Default: QWEN_TRIM_NONE. */
+void qwen_set_trim_policy(qwen_ctx_t *ctx, int policy, int baseline_tokens);
+
+/* Offload a paused live stream after idle_sec without new audio: the KV
+ * cache and the cached prefill embeddings are dropped (text tokens and f32
+ * encoder windows are kept, and the next chunk runs one full prefill),
+ * encoder cache bookkeeping is compacted and qwen_trim() runs.
+ * 0 disables (default). */
+void qwen_set_trim_idle_sec(qwen_ctx_t *ctx, float idle_sec);
+
+/* Release grown buffers now (see qwen_set_trim_policy) and return freed
+ * heap memory to the OS. Must not run concurrently with a transcription
+ * call on the same context; hosts can call it from their own idle timer. */
+void qwen_trim(qwen_ctx_t *ctx);
+
+/* Kernel tuning profiles. A profile file holds one entry per (CPU model,
+ * usable CPUs, model variant); qwen_load() applies the matching entry from
+ * qwen_tune_default_path(): $QWEN_TUNE_FILE, else
+ * $XDG_CACHE_HOME/qwen_asr/tuning.txt or ~/.cache/qwen_asr/tuning.txt
+ * (QWEN_TUNE_FILE="" disables profiles; NULL if there is no path). */
+const char *qwen_tune_default_path(void);
+
+/* Apply this host's entry for ctx's model from path (NULL = default path).
+ * Returns 1 if applied, 0 if there is no entry, -1 if the file is unreadable. */
+int qwen_tune_apply(const qwen_ctx_t *ctx, const char *path);
+
+/* Time candidate kernel settings (decode matvec threads, threaded attention
+ * threshold, prefill GEMM panel size) on ctx's weights, apply the fastest
+ * and save them to path (NULL = default path), replacing this host's entry.
+ * Takes up to a minute. Returns 0 on success, -1 on error. */
+int qwen_autotune(qwen_ctx_t *ctx, const char *path);
+
+/* Ask a running (or the next) live stream on ctx to stop at its next chunk
+ * boundary and save its session state: encoder window cache, unprocessed
+ * audio tail, raw/stable/emitted tokens, counters and the current
+ * utterance's committed text; plus the decoder KV cache with
+ * QWEN_CHECKPOINT_KV. qwen_transcribe_stream_live() then returns the text
+ * committed so far. Wakes the stream if it is waiting for audio. */
+void qwen_stream_request_checkpoint(qwen_ctx_t *ctx, qwen_live_audio_t *live, int flags);
+
+/* Take the state saved by the last checkpoint (caller must free), or NULL.
+ * The blob uses native byte order and is tied to the model it came from. */
+void *qwen_stream_take_checkpoint(qwen_ctx_t *ctx, size_t *out_size);
+
+/* Resume the next qwen_transcribe_stream_live() call on ctx from a
+ * checkpoint blob (copied). The new live source continues the old audio:
+ * its first sample follows the last sample the old session received.
+ * Without KV in the blob, the first chunk runs one full prefill.
+ * Returns 0 on success, -1 if the blob is invalid or from another model. */
+int qwen_stream_restore(qwen_ctx_t *ctx, const void *blob, size_t size);
+
+/* JSON snapshot of ctx's flight recorder: {"slots":N,"recorded":N,
+ * "chunks":[{...}, ...]} with the retained chunks oldest first. Safe to call
+ * from any thread while a stream runs. Caller must free; NULL on allocation
+ * failure. */
+char *qwen_flight_dump_json(const qwen_ctx_t *ctx);
+
 /* Comma-separated supported language names for --language. */
 const char *qwen_supported_languages_csv(void);
 
@@ -340,11 +608,21 @@ void qwen_decoder_prefill(qwen_ctx_t *ctx, const float *input_embeds, int seq_le
 /* Decoder forward (single token, uses KV cache, returns greedy token) */
 int qwen_decoder_forward(qwen_ctx_t *ctx, const float *input_embed);
 
-/* Global verbose flag */
-extern int qwen_verbose;
+/* Shrink KV cache, prefill buffers and RoPE tables whose capacity exceeds
+ * max_tokens positions back to max_tokens (0 frees them). Discards KV
+ * contents (kv_cache_len becomes 0). */
+void qwen_decoder_trim(qwen_ctx_t *ctx, int max_tokens);
+
+/* Make room for n_pos KV positions (allocating the cache if needed). */
+int qwen_decoder_kv_reserve(qwen_ctx_t *ctx, int n_pos);
+
+/* Verbose flag (per thread: embedders set it around each call) */
+extern __thread int qwen_verbose;
 
 /* Monitor mode: show inline Unicode symbols on stderr for streaming diagnostics.
- * Symbols: ▶ encoder  · prefill  ▪ decode  ▸ slow decode  ⟳ window eviction */
-extern int qwen_monitor;
+ * Symbols: ▶ encoder  · prefill  ▪ decode  ▸ slow decode  ⟳ window eviction
+ *          ⏎ endpoint
+ * Per thread, like qwen_verbose. */
+extern __thread int qwen_monitor;
 
 #endif /* QWEN_ASR_H */
@@ -13,11 +13,14 @@
 
 #include "qwen_asr_audio.h"
 #include "qwen_asr_kernels.h"
+#include "qwen_asr_shm.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <limits.h>
+#include <errno.h>
+#include <pthread.h>
 
 #if defined(USE_BLAS) && defined(__APPLE__)
 #include <Accelerate/Accelerate.h>
@@ -34,6 +37,667 @@
 #define N_FFT        400
 #define N_FREQ       (N_FFT / 2 + 1)    /* 201 bins */
 
+/* ========================================================================
+ * Resampling to 16 kHz
+ *
+ * Windowed-sinc interpolation with a Kaiser window for proper anti-aliasing
+ * when downsampling. Incremental: source blocks are pushed as they are
+ * decoded and every output sample whose taps are all available is emitted,
+ * keeping only the last few source samples. Samples outside the stream
+ * count as zero, so pushing in blocks gives the same result as one buffer.
+ *
+ * 8 kHz input (telephony) takes a half-band path: even outputs are the
+ * source samples, odd outputs a fixed 32-tap filter at the half-sample
+ * phase, with the same taps the general path would compute.
+ * ======================================================================== */
+
+#define SINC_HALF    16     /* zero-crossings per side */
+#define KAISER_BETA  6.0    /* sidelobe suppression */
+
+typedef struct {
+    double ratio;           /* SAMPLE_RATE / in_rate */
+    double cutoff;          /* lower Nyquist, relative to the source rate */
+    double inv_I0_beta;
+    int in_rate;
+    float *hist;            /* source samples from index hist_base on */
+    int hist_len, hist_cap;
+    int64_t hist_base;
+    int64_t n_in;           /* source samples pushed so far */
+    int64_t n_out;          /* output samples emitted so far */
+    int halfband;           /* in_rate * 2 == SAMPLE_RATE: hb[] taps */
+    float hb[2 * SINC_HALF];
+} resampler_t;
+
+/* I0 (modified Bessel, first kind, order 0) via power series
+ * (converges fast for beta <= 10) */
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0, xx = x * x;
+    for (int k = 1; k <= 20; k++) {
+        term *= xx / (4.0 * (double)k * (double)k);
+        sum += term;
+    }
+    return sum;
+}
+
+/* Filter coefficient for a source sample d samples from the output position */
+static double resampler_tap(const resampler_t *rs, double d) {
+    double x = d * rs->cutoff;             /* scale by cutoff */
+
+    /* Sinc value */
+    double s = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+
+    /* Kaiser window over the support [-SINC_HALF, SINC_HALF] */
+    double npos = d / SINC_HALF;  /* normalized to [-1, 1] */
+    double w = (npos <= -1.0 || npos >= 1.0) ? 0.0 :
+               bessel_i0(KAISER_BETA * sqrt(1.0 - npos * npos)) * rs->inv_I0_beta;
+    return s * w * rs->cutoff;
+}
+
+static float resampler_sample(const resampler_t *rs, int64_t i) {
+    double src_pos = (double)i / rs->ratio;
+    int64_t center = (int64_t)src_pos;
+    double acc = 0.0;
+    double wsum = 0.0;
+
+    for (int64_t j = center - SINC_HALF + 1; j <= center + SINC_HALF; j++) {
+        double coeff = resampler_tap(rs, (double)j - src_pos);
+        int64_t h = j - rs->hist_base;
+        if (j >= 0 && h >= 0 && h < rs->hist_len) acc += rs->hist[h] * coeff;
+        wsum += coeff;
+    }
+    /* Normalize to handle edge effects at boundaries */
+    return (wsum > 1e-9) ? (float)(acc / wsum) : 0.0f;
+}
+
+/* Half-band output i (2x upsampling) */
+static float resampler_sample_hb(const resampler_t *rs, int64_t i) {
+    int64_t k = i >> 1;
+    int64_t h0 = k - SINC_HALF + 1 - rs->hist_base;
+    if (!(i & 1)) return rs->hist[k - rs->hist_base];
+    if (h0 >= 0 && h0 + 2 * SINC_HALF <= rs->hist_len) {
+        const float *x = rs->hist + h0;
+        float acc = 0.0f;
+        for (int t = 0; t < 2 * SINC_HALF; t++) acc += x[t] * rs->hb[t];
+        return acc;
+    }
+    /* Stream edges: taps outside the pushed samples count as zero */
+    float acc = 0.0f;
+    for (int t = 0; t < 2 * SINC_HALF; t++) {
+        int64_t h = h0 + t;
+        if (h >= 0 && h < rs->hist_len) acc += rs->hist[h] * rs->hb[t];
+    }
+    return acc;
+}
+
+static void resampler_init(resampler_t *rs, int in_rate) {
+    memset(rs, 0, sizeof(*rs));
+    rs->in_rate = in_rate;
+    rs->ratio = (double)SAMPLE_RATE / (double)in_rate;
+    rs->cutoff = (rs->ratio < 1.0) ? rs->ratio : 1.0;
+    rs->inv_I0_beta = 1.0 / bessel_i0(KAISER_BETA);
+
+    if (in_rate * 2 == SAMPLE_RATE) {
+        double taps[2 * SINC_HALF], wsum = 0.0;
+        for (int t = 0; t < 2 * SINC_HALF; t++) {
+            taps[t] = resampler_tap(rs, (double)(t - SINC_HALF + 1) - 0.5);
+            wsum += taps[t];
+        }
+        for (int t = 0; t < 2 * SINC_HALF; t++) rs->hb[t] = (float)(taps[t] / wsum);
+        rs->halfband = 1;
+    }
+}
+
+static void resampler_free(resampler_t *rs) {
+    free(rs->hist);
+    rs->hist = NULL;
+}
+
+/* Make room for n more samples in a growable output buffer */
+static int sample_buf_reserve(float **out, int64_t *out_len, int64_t *out_cap, int64_t n) {
+    if (*out_len + n <= *out_cap) return 0;
+    int64_t cap = *out_cap > 0 ? *out_cap : 16000;
+    while (cap < *out_len + n) cap *= 2;
+    if ((uint64_t)cap > (uint64_t)(SIZE_MAX / sizeof(float))) return -1;
+    float *tmp = (float *)realloc(*out, (size_t)cap * sizeof(float));
+    if (!tmp) return -1;
+    *out = tmp;
+    *out_cap = cap;
+    return 0;
+}
+
+/* Push n source samples (flush=1 at end of stream) and append the output
+ * samples now available to *out (grown with realloc; *out_len / *out_cap
+ * track it). 16 kHz input passes through. Returns 0, or -1 on allocation
+ * failure. */
+static int resampler_push(resampler_t *rs, const float *in, int n, int flush,
+                          float **out, int64_t *out_len, int64_t *out_cap) {
+    if (rs->in_rate == SAMPLE_RATE) {
+        if (n <= 0) return 0;
+        if (sample_buf_reserve(out, out_len, out_cap, n) != 0) return -1;
+        memcpy(*out + *out_len, in, (size_t)n * sizeof(float));
+        *out_len += n;
+        return 0;
+    }
+    if (n > 0) {
+        if (rs->hist_len + n > rs->hist_cap) {
+            int cap = rs->hist_cap > 0 ? rs->hist_cap : 4096;
+            while (cap < rs->hist_len + n) cap *= 2;
+            float *tmp = (float *)realloc(rs->hist, (size_t)cap * sizeof(float));
+            if (!tmp) return -1;
+            rs->hist = tmp;
+            rs->hist_cap = cap;
+        }
+        memcpy(rs->hist + rs->hist_len, in, (size_t)n * sizeof(float));
+        rs->hist_len += n;
+        rs->n_in += n;
+    }
+
+    /* Emit while the last tap is inside the pushed data (or the stream ended) */
+    int64_t total = flush ? (int64_t)(rs->n_in * SAMPLE_RATE / rs->in_rate) : INT64_MAX;
+    int64_t start = rs->n_out;
+    while (rs->n_out < total) {
+        int64_t center = (int64_t)((double)rs->n_out / rs->ratio);
+        if (!flush && center + SINC_HALF >= rs->n_in) break;
+        rs->n_out++;
+    }
+    int64_t n_new = rs->n_out - start;
+
+    if (n_new > 0) {
+        if (sample_buf_reserve(out, out_len, out_cap, n_new) != 0) return -1;
+        float *dst = *out + *out_len;
+        if (rs->halfband) {
+            for (int64_t i = 0; i < n_new; i++) dst[i] = resampler_sample_hb(rs, start + i);
+        } else {
+            for (int64_t i = 0; i < n_new; i++) dst[i] = resampler_sample(rs, start + i);
+        }
+        *out_len += n_new;
+    }
+
+    /* Drop source samples no future output can reach */
+    int64_t keep_from = (int64_t)((double)rs->n_out / rs->ratio) - SINC_HALF;
+    int64_t drop = keep_from - rs->hist_base;
+    if (drop > rs->hist_len) drop = rs->hist_len;
+    if (drop > 0) {
+        memmove(rs->hist, rs->hist + drop, (size_t)(rs->hist_len - drop) * sizeof(float));
+        rs->hist_len -= (int)drop;
+        rs->hist_base += drop;
+    }
+    return 0;
+}
+
+/* Resample a whole buffer; returns a new buffer (caller frees) or NULL. */
+static float *resample_buffer(const float *in, int n, int in_rate, int *out_n) {
+    resampler_t rs;
+    resampler_init(&rs, in_rate);
+    float *out = NULL;
+    int64_t len = 0, cap = 0;
+    if (resampler_push(&rs, in, n, 1, &out, &len, &cap) != 0 || len > INT_MAX) {
+        resampler_free(&rs);
+        free(out);
+        return NULL;
+    }
+    resampler_free(&rs);
+    if (!out) out = (float *)malloc(sizeof(float));
+    *out_n = (int)len;
+    return out;
+}
+
+/* ========================================================================
+ * G.711 (ITU-T) u-law / A-law
+ *
+ * Each 8-bit code expands to a 14/13-bit linear value; both codecs are
+ * decoded through 256-entry float tables built once.
+ * ======================================================================== */
+
+static float g711_ulaw_lut[256];
+static float g711_alaw_lut[256];
+static pthread_once_t g711_once = PTHREAD_ONCE_INIT;
+
+static void g711_build_luts(void) {
+    for (int c = 0; c < 256; c++) {
+        int u = ~c & 0xFF;
+        int t = (((u & 0x0F) << 3) + 0x84) << ((u & 0x70) >> 4);
+        g711_ulaw_lut[c] = (float)((u & 0x80) ? 0x84 - t : t - 0x84) / 32768.0f;
+
+        int a = c ^ 0x55;
+        int seg = (a & 0x70) >> 4;
+        int v = (a & 0x0F) << 4;
+        if (seg == 0) v += 8;
+        else v = (v + 0x108) << (seg - 1);
+        g711_alaw_lut[c] = (float)((a & 0x80) ? v : -v) / 32768.0f;
+    }
+}
+
+/* WAV format code 7 (u-law) or 6 (A-law) -> decode table */
+static const float *g711_lut(int wav_format) {
+    pthread_once(&g711_once, g711_build_luts);
+    return wav_format == 7 ? g711_ulaw_lut : g711_alaw_lut;
+}
+
+static void g711_expand(float *dst, const uint8_t *src, int n, const float *lut) {
+    for (int i = 0; i < n; i++) dst[i] = lut[src[i]];
+}
+
+/* ========================================================================
+ * FLAC Decoding
+ *
+ * Complete decoder for the FLAC bitstream (RFC 9639): CONSTANT, VERBATIM,
+ * FIXED and LPC subframes, Rice-coded residuals with escape partitions,
+ * wasted bits and the three stereo decorrelation modes. Frames are decoded
+ * one at a time, mixed to mono and pushed into the resampler, so the same
+ * code serves whole buffers and the live stdin reader. Up to 8 channels and
+ * 24 bits per sample.
+ * ======================================================================== */
+
+#define FLAC_MAX_CHANNELS 8
+
+typedef struct {
+    const uint8_t *buf;
+    size_t size;
+    size_t bit;             /* read position in bits */
+    int eof;                /* a read ran past the end of buf */
+} flac_bits_t;
+
+static uint32_t flac_read(flac_bits_t *br, int n) {
+    if (n == 0) return 0;
+    if (br->bit + (size_t)n > br->size * 8) {
+        br->eof = 1;
+        return 0;
+    }
+    size_t byte = br->bit >> 3;
+    int off = (int)(br->bit & 7);
+    int nbytes = (off + n + 7) >> 3;
+    uint64_t v = 0;
+    for (int k = 0; k < nbytes; k++) v = (v << 8) | br->buf[byte + k];
+    v >>= nbytes * 8 - off - n;
+    br->bit += (size_t)n;
+    return (uint32_t)(v & ((1ULL << n) - 1));
+}
+
+static int32_t flac_read_signed(flac_bits_t *br, int n) {
+    if (n == 0) return 0;
+    uint32_t v = flac_read(br, n);
+    if (n < 32 && (v & (1U << (n - 1)))) v |= ~0U << n;
+    return (int32_t)v;
+}
+
+/* Count zero bits up to and including the terminating one */
+static uint32_t flac_read_unary(flac_bits_t *br) {
+    uint32_t count = 0;
+    size_t end = br->size * 8;
+    while (br->bit < end) {
+        unsigned byte = (unsigned)(br->buf[br->bit >> 3] << (br->bit & 7)) & 0xFF;
+        if (byte) {
+            int lz = __builtin_clz(byte) - 24;
+            count += (uint32_t)lz;
+            br->bit += (size_t)lz + 1;
+            return count;
+        }
+        count += 8 - (uint32_t)(br->bit & 7);
+        br->bit = (br->bit | 7) + 1;
+    }
+    br->eof = 1;
+    return 0;
+}
+
+static uint8_t flac_crc8(const uint8_t *p, size_t n) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) crc = (uint8_t)((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+    return crc;
+}
+
+static uint16_t flac_crc16(const uint8_t *p, size_t n) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= (uint16_t)(p[i] << 8);
+        for (int b = 0; b < 8; b++) crc = (uint16_t)((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+    }
+    return crc;
+}
+
+typedef struct {
+    int sample_rate, channels, bps;
+    int max_block;
+    uint64_t total_samples;     /* 0 = unknown */
+    int32_t *ch[FLAC_MAX_CHANNELS];
+    float *mono;                /* last decoded frame, mixed to mono */
+    int cap;                    /* per-channel capacity of ch[] / mono */
+    int crc_errors;
+    int param_skips;            /* headers with other rate/channels/bps */
+} flac_decoder_t;
+
+static void flac_free(flac_decoder_t *fd) {
+    for (int c = 0; c < FLAC_MAX_CHANNELS; c++) free(fd->ch[c]);
+    free(fd->mono);
+    memset(fd, 0, sizeof(*fd));
+}
+
+/* Does the buffer start like a FLAC stream ("fLaC", or an ID3v2 tag)? */
+static int flac_sniff(const uint8_t *data, size_t size) {
+    return (size >= 4 && memcmp(data, "fLaC", 4) == 0) ||
+           (size >= 3 && memcmp(data, "ID3", 3) == 0);
+}
+
+/* Parse the stream marker and metadata blocks (STREAMINFO is required).
+ * Returns 1 and sets *consumed when done, 0 if more data is needed, -1 on
+ * error. */
+static int flac_parse_header(flac_decoder_t *fd, const uint8_t *data, size_t size,
+                             size_t *consumed) {
+    size_t pos = 0;
+    if (size >= 3 && memcmp(data, "ID3", 3) == 0) {
+        if (size < 10) return 0;
+        size_t tag = ((size_t)(data[6] & 0x7F) << 21) | ((size_t)(data[7] & 0x7F) << 14) |
+                     ((size_t)(data[8] & 0x7F) << 7) | (size_t)(data[9] & 0x7F);
+        pos = 10 + tag + ((data[5] & 0x10) ? 10 : 0);
+    }
+    if (size < pos + 4) return 0;
+    if (memcmp(data + pos, "fLaC", 4) != 0) {
+        fprintf(stderr, "flac: missing fLaC stream marker\n");
+        return -1;
+    }
+    pos += 4;
+
+    int have_info = 0, last = 0;
+    while (!last) {
+        if (size < pos + 4) return 0;
+        last = data[pos] >> 7;
+        int type = data[pos] & 0x7F;
+        size_t len = ((size_t)data[pos + 1] << 16) | ((size_t)data[pos + 2] << 8) | data[pos + 3];
+        pos += 4;
+        if (size < pos + len) return 0;
+        if (type == 0 && len >= 34) {
+            const uint8_t *m = data + pos;
+            fd->max_block = (m[2] << 8) | m[3];
+            fd->sample_rate = (m[10] << 12) | (m[11] << 4) | (m[12] >> 4);
+            fd->channels = ((m[12] >> 1) & 7) + 1;
+            fd->bps = (((m[12] & 1) << 4) | (m[13] >> 4)) + 1;
+            fd->total_samples = ((uint64_t)(m[13] & 0x0F) << 32) | ((uint64_t)m[14] << 24) |
+                                ((uint64_t)m[15] << 16) | ((uint64_t)m[16] << 8) | m[17];
+            have_info = 1;
+        } else if (type == 127) {
+            fprintf(stderr, "flac: invalid metadata block\n");
+            return -1;
+        }
+        pos += len;
+    }
+    if (!have_info) {
+        fprintf(stderr, "flac: missing STREAMINFO block\n");
+        return -1;
+    }
+    if (fd->sample_rate <= 0 || fd->bps < 4 || fd->bps > 24) {
+        fprintf(stderr, "flac: unsupported stream (%d Hz, %d bits per sample)\n",
+                fd->sample_rate, fd->bps);
+        return -1;
+    }
+    *consumed = pos;
+    return 1;
+}
+
+static int flac_decode_residual(flac_bits_t *br, int32_t *res, int block, int order) {
+    int method = (int)flac_read(br, 2);
+    if (method > 1) return -1;
+    int param_bits = method == 0 ? 4 : 5;
+    uint32_t escape = method == 0 ? 15 : 31;
+    int porder = (int)flac_read(br, 4);
+    int parts = 1 << porder;
+    if ((block >> porder) < order || (block & (parts - 1))) return -1;
+
+    int i = 0;
+    for (int p = 0; p < parts; p++) {
+        int n = (block >> porder) - (p == 0 ? order : 0);
+        uint32_t param = flac_read(br, param_bits);
+        if (param == escape) {
+            int bits = (int)flac_read(br, 5);
+            for (int k = 0; k < n; k++) res[i++] = flac_read_signed(br, bits);
+        } else {
+            for (int k = 0; k < n; k++) {
+                uint32_t q = flac_read_unary(br);
+                uint32_t v = (q << param) | flac_read(br, (int)param);
+                res[i++] = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+            }
+        }
+        if (br->eof) return 0;
+    }
+    return 1;
+}
+
+/* Decode one subframe into out[block]. Returns 1, 0 if the data ran out,
+ * -1 if the subframe is invalid. */
+static int flac_decode_subframe(flac_bits_t *br, int32_t *out, int block, int bps) {
+    if (flac_read(br, 1) != 0) return -1;
+    int type = (int)flac_read(br, 6);
+    int wasted = 0;
+    if (flac_read(br, 1)) wasted = (int)flac_read_unary(br) + 1;
+    if (br->eof) return 0;
+    if (wasted >= bps) return -1;
+    bps -= wasted;
+
+    if (type == 0) {
+        int32_t v = flac_read_signed(br, bps);
+        for (int i = 0; i < block; i++) out[i] = v;
+    } else if (type == 1) {
+        for (int i = 0; i < block; i++) out[i] = flac_read_signed(br, bps);
+    } else if (type >= 8 && type <= 12) {
+        int order = type - 8;
+        if (order > block) return -1;
+        for (int i = 0; i < order; i++) out[i] = flac_read_signed(br, bps);
+        int r = flac_decode_residual(br, out + order, block, order);
+        if (r <= 0) return r;
+        for (int i = order; i < block; i++) {
+            int64_t pred;
+            switch (order) {
+            case 0: pred = 0; break;
+            case 1: pred = out[i - 1]; break;
+            case 2: pred = 2 * (int64_t)out[i - 1] - out[i - 2]; break;
+            case 3: pred = 3 * (int64_t)out[i - 1] - 3 * (int64_t)out[i - 2] + out[i - 3]; break;
+            default: pred = 4 * (int64_t)out[i - 1] - 6 * (int64_t)out[i - 2] +
+                            4 * (int64_t)out[i - 3] - out[i - 4]; break;
+            }
+            out[i] = (int32_t)(pred + out[i]);
+        }
+    } else if (type >= 32) {
+        int order = type - 31;
+        if (order > block) return -1;
+        for (int i = 0; i < order; i++) out[i] = flac_read_signed(br, bps);
+        int precision = (int)flac_read(br, 4) + 1;
+        int shift = flac_read_signed(br, 5);
+        if (precision == 16 || shift < 0) return -1;
+        int32_t coef[32];
+        for (int j = 0; j < order; j++) coef[j] = flac_read_signed(br, precision);
+        int r = flac_decode_residual(br, out + order, block, order);
+        if (r <= 0) return r;
+        for (int i = order; i < block; i++) {
+            int64_t sum = 0;
+            for (int j = 0; j < order; j++) sum += (int64_t)coef[j] * out[i - 1 - j];
+            out[i] = (int32_t)(out[i] + (sum >> shift));
+        }
+    } else {
+        return -1;
+    }
+    if (br->eof) return 0;
+
+    if (wasted)
+        for (int i = 0; i < block; i++) out[i] = (int32_t)((uint32_t)out[i] << wasted);
+    return 1;
+}
+
+/* Decode the frame at data[0] into fd->mono. Returns the number of samples
+ * and sets *consumed. *consumed == 0 means more data is needed; a return of
+ * 0 with *consumed > 0 skips bytes that are not a valid frame (resync). */
+static int flac_decode_frame(flac_decoder_t *fd, const uint8_t *data, size_t size,
+                             size_t *consumed) {
+    static const int rate_table[12] = {
+        0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000
+    };
+    static const int bps_table[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+
+    *consumed = 0;
+    if (size < 2) return 0;
+    if (data[0] != 0xFF || (data[1] & 0xFE) != 0xF8) {
+        /* Skip to the next sync code candidate */
+        size_t i = 1;
+        while (i + 1 < size && !(data[i] == 0xFF && (data[i + 1] & 0xFE) == 0xF8)) i++;
+        *consumed = i;
+        return 0;
+    }
+
+    flac_bits_t br = { data, size, 16, 0 };
+    int bs_code = (int)flac_read(&br, 4);
+    int sr_code = (int)flac_read(&br, 4);
+    int ch_code = (int)flac_read(&br, 4);
+    int ss_code = (int)flac_read(&br, 3);
+    int reserved = (int)flac_read(&br, 1);
+
+    /* UTF-8 style coded frame/sample number */
+    uint32_t lead = flac_read(&br, 8);
+    int extra = 0;
+    while (extra < 7 && (lead & (0x80u >> extra))) extra++;
+    if (extra == 1 || extra == 7) reserved = 1;
+    for (int k = 1; k < extra; k++)
+        if ((flac_read(&br, 8) & 0xC0) != 0x80) reserved = 1;
+
+    int block = 0;
+    if (bs_code == 1) block = 192;
+    else if (bs_code >= 2 && bs_code <= 5) block = 576 << (bs_code - 2);
+    else if (bs_code == 6) block = (int)flac_read(&br, 8) + 1;
+    else if (bs_code == 7) block = (int)flac_read(&br, 16) + 1;
+    else if (bs_code >= 8) block = 256 << (bs_code - 8);
+
+    int rate = fd->sample_rate;
+    if (sr_code >= 1 && sr_code <= 11) rate = rate_table[sr_code];
+    else if (sr_code == 12) rate = (int)flac_read(&br, 8) * 1000;
+    else if (sr_code == 13) rate = (int)flac_read(&br, 16);
+    else if (sr_code == 14) rate = (int)flac_read(&br, 16) * 10;
+    else if (sr_code == 15) reserved = 1;
+
+    int crc8 = (int)flac_read(&br, 8);
+    if (br.eof) return 0;
+
+    int channels = ch_code < 8 ? ch_code + 1 : 2;
+    int bps = ss_code == 0 ? fd->bps : bps_table[ss_code];
+    if (reserved || block == 0 || ch_code > 10 || bps == 0 ||
+        flac_crc8(data, (br.bit >> 3) - 1) != crc8) {
+        *consumed = 1;  /* false sync: resume the search after it */
+        return 0;
+    }
+    if (channels != fd->channels || rate != fd->sample_rate || bps != fd->bps) {
+        /* A false sync whose header passed CRC-8 by chance, or a real
+         * parameter change (unsupported): either way skip past it */
+        if (fd->param_skips++ == 0)
+            fprintf(stderr, "flac: skipping frame with different stream parameters\n");
+        *consumed = 1;
+        return 0;
+    }
+
+    if (block > fd->cap) {
+        for (int c = 0; c < channels; c++) {
+            int32_t *tmp = (int32_t *)realloc(fd->ch[c], (size_t)block * sizeof(int32_t));
+            if (!tmp) return -1;
+            fd->ch[c] = tmp;
+        }
+        float *tmp = (float *)realloc(fd->mono, (size_t)block * sizeof(float));
+        if (!tmp) return -1;
+        fd->mono = tmp;
+        fd->cap = block;
+    }
+
+    for (int c = 0; c < channels; c++) {
+        /* The side channel carries one extra bit */
+        int sbps = bps + ((ch_code == 8 && c == 1) || (ch_code == 9 && c == 0) ||
+                          (ch_code == 10 && c == 1));
+        int r = flac_decode_subframe(&br, fd->ch[c], block, sbps);
+        if (r == 0) return 0;
+        if (r < 0) {
+            *consumed = 1;
+            return 0;
+        }
+    }
+
+    br.bit = (br.bit + 7) & ~(size_t)7;
+    uint32_t crc16 = flac_read(&br, 16);
+    if (br.eof) return 0;
+    size_t frame_len = br.bit >> 3;
+    if (flac_crc16(data, frame_len - 2) != crc16) {
+        /* Corrupt frame: keep the timeline with silence of its length */
+        if (fd->crc_errors++ == 0)
+            fprintf(stderr, "flac: frame CRC mismatch (corrupt input?), using silence\n");
+        memset(fd->mono, 0, (size_t)block * sizeof(float));
+        *consumed = frame_len;
+        return block;
+    }
+
+    int32_t *a = fd->ch[0], *b = fd->ch[1];
+    if (ch_code == 8) {
+        for (int i = 0; i < block; i++) b[i] = (int32_t)((int64_t)a[i] - b[i]);
+    } else if (ch_code == 9) {
+        for (int i = 0; i < block; i++) a[i] = (int32_t)((int64_t)a[i] + b[i]);
+    } else if (ch_code == 10) {
+        for (int i = 0; i < block; i++) {
+            int64_t mid = ((int64_t)a[i] * 2) | (b[i] & 1);
+            int64_t side = b[i];
+            a[i] = (int32_t)((mid + side) >> 1);
+            b[i] = (int32_t)((mid - side) >> 1);
+        }
+    }
+
+    /* Mix like the WAV path: (sum / channels) / full scale */
+    float scale = 1.0f / (float)(1 << (bps - 1));
+    for (int i = 0; i < block; i++) {
+        int64_t sum = 0;
+        for (int c = 0; c < channels; c++) sum += fd->ch[c][i];
+        fd->mono[i] = ((float)sum / (float)channels) * scale;
+    }
+    *consumed = frame_len;
+    return block;
+}
+
+float *qwen_parse_flac_buffer(const uint8_t *data, size_t size, int *out_n_samples) {
+    flac_decoder_t fd;
+    memset(&fd, 0, sizeof(fd));
+    size_t pos = 0;
+    if (flac_parse_header(&fd, data, size, &pos) != 1) {
+        if (pos == 0) fprintf(stderr, "qwen_parse_flac_buffer: truncated or invalid header\n");
+        flac_free(&fd);
+        return NULL;
+    }
+
+    resampler_t rs;
+    resampler_init(&rs, fd.sample_rate);
+    float *out = NULL;
+    int64_t len = 0, cap = 0;
+    int ok = 1;
+    while (pos < size) {
+        size_t used = 0;
+        int n = flac_decode_frame(&fd, data + pos, size - pos, &used);
+        if (n < 0) { ok = 0; break; }
+        if (used == 0) break;   /* truncated final frame */
+        pos += used;
+        if (n == 0) continue;
+        if (resampler_push(&rs, fd.mono, n, 0, &out, &len, &cap) != 0) {
+            ok = 0;
+            break;
+        }
+    }
+    if (ok && resampler_push(&rs, NULL, 0, 1, &out, &len, &cap) != 0) ok = 0;
+    if (ok && len > INT_MAX) ok = 0;
+    if (qwen_verbose >= 2)
+        fprintf(stderr, "FLAC: %d Hz, %d-bit, %d ch -> %lld samples at 16 kHz\n",
+                fd.sample_rate, fd.bps, fd.channels, (long long)len);
+    resampler_free(&rs);
+    flac_free(&fd);
+    if (!ok) {
+        fprintf(stderr, "qwen_parse_flac_buffer: decode failed\n");
+        free(out);
+        return NULL;
+    }
+    if (!out) out = (float *)malloc(sizeof(float));
+    *out_n_samples = (int)len;
+    return out;
+}
+
 /* ========================================================================
  * WAV File Loading (adapted from voxtral)
  * ======================================================================== */
@@ -42,6 +706,8 @@ static uint16_t read_u16(const uint8_t *p) { return p[0] | (p[1] << 8); }
 static uint32_t read_u32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24); }
 
 float *qwen_parse_wav_buffer(const uint8_t *data, size_t file_size, int *out_n_samples) {
+    if (flac_sniff(data, file_size))
+        return qwen_parse_flac_buffer(data, file_size, out_n_samples);
     if (file_size < 44 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
         fprintf(stderr, "parse_wav_buffer: not a valid WAV file\n");
         return NULL;
@@ -72,19 +738,33 @@ float *qwen_parse_wav_buffer(const uint8_t *data, size_t file_size, int *out_n_s
         if (chunk_size & 1) p++;
     }
 
-    if (audio_format != 1 || bits_per_sample != 16 || pcm_data == NULL || channels < 1) {
-        fprintf(stderr, "parse_wav_buffer: unsupported format (need 16-bit PCM, got fmt=%d bits=%d)\n",
-                audio_format, bits_per_sample);
+    int is_g711 = (audio_format == 6 || audio_format == 7) && bits_per_sample == 8;
+    if (!(audio_format == 1 && bits_per_sample == 16) && !is_g711) {
+        fprintf(stderr, "parse_wav_buffer: unsupported format (need 16-bit PCM or G.711, "
+                "got fmt=%d bits=%d)\n", audio_format, bits_per_sample);
+        return NULL;
+    }
+    if (pcm_data == NULL || channels < 1 || sample_rate <= 0) {
+        fprintf(stderr, "parse_wav_buffer: missing data chunk or invalid fmt chunk\n");
         return NULL;
     }
 
-    int n_frames = pcm_size / (channels * 2);
+    int n_frames = pcm_size / (channels * (is_g711 ? 1 : 2));
     float *samples = (float *)malloc(n_frames * sizeof(float));
     if (!samples) return NULL;
 
     const int16_t *src = (const int16_t *)pcm_data;
+    const float *lut = is_g711 ? g711_lut(audio_format) : NULL;
     for (int i = 0; i < n_frames; i++) {
-        if (channels == 1) {
+        if (lut) {
+            if (channels == 1) {
+                samples[i] = lut[pcm_data[i]];
+            } else {
+                float sum = 0;
+                for (int c = 0; c < channels; c++) sum += lut[pcm_data[i * channels + c]];
+                samples[i] = sum / channels;
+            }
+        } else if (channels == 1) {
             samples[i] = src[i] / 32768.0f;
         } else {
             float sum = 0;
@@ -97,74 +777,12 @@ float *qwen_parse_wav_buffer(const uint8_t *data, size_t file_size, int *out_n_s
         }
     }
 
-    /* Resample to 16kHz if needed — windowed-sinc interpolation with
-     * Kaiser window for proper anti-aliasing when downsampling. */
+    /* Resample to 16kHz if needed */
     if (sample_rate != SAMPLE_RATE) {
-        int new_n = (int)((long long)n_frames * SAMPLE_RATE / sample_rate);
-        float *resampled = (float *)malloc(new_n * sizeof(float));
-        if (!resampled) { free(samples); return NULL; }
-
-        /* Sinc resampler parameters */
-        const int SINC_HALF = 16;          /* zero-crossings per side */
-        const double KAISER_BETA = 6.0;    /* sidelobe suppression */
-        /* Cutoff at the lower Nyquist to prevent aliasing */
-        double ratio = (double)SAMPLE_RATE / (double)sample_rate;
-        double cutoff = (ratio < 1.0) ? ratio : 1.0;
-
-        /* Precompute Kaiser window: I0(beta * sqrt(1 - (n/N)^2)) / I0(beta)
-         * I0 approximation via power series (converges fast for beta <= 10). */
-        /* I0 (modified Bessel, first kind, order 0) */
-        #define BESSEL_I0(x) ({ \
-            double _sum = 1.0, _term = 1.0, _xx = (x)*(x); \
-            for (int _k = 1; _k <= 20; _k++) { \
-                _term *= _xx / (4.0 * (double)_k * (double)_k); \
-                _sum += _term; \
-            } \
-            _sum; })
-        double inv_I0_beta = 1.0 / BESSEL_I0(KAISER_BETA);
-
-        for (int i = 0; i < new_n; i++) {
-            double src_pos = (double)i / ratio;
-            int center = (int)src_pos;
-            double acc = 0.0;
-            double wsum = 0.0;
-
-            int j_lo = center - SINC_HALF + 1;
-            int j_hi = center + SINC_HALF;
-            for (int j = j_lo; j <= j_hi; j++) {
-                double d = (double)j - src_pos;        /* distance in source samples */
-                double x = d * cutoff;                  /* scale by cutoff */
-
-                /* Sinc value */
-                double s;
-                if (fabs(x) < 1e-9) {
-                    s = 1.0;
-                } else {
-                    s = sin(M_PI * x) / (M_PI * x);
-                }
-
-                /* Kaiser window over the support [-SINC_HALF, SINC_HALF] */
-                double npos = d / SINC_HALF;  /* normalized to [-1, 1] */
-                double w;
-                if (npos <= -1.0 || npos >= 1.0) {
-                    w = 0.0;
-                } else {
-                    w = BESSEL_I0(KAISER_BETA * sqrt(1.0 - npos * npos)) * inv_I0_beta;
-                }
-
-                double coeff = s * w * cutoff;
-                if (j >= 0 && j < n_frames) {
-                    acc += samples[j] * coeff;
-                }
-                wsum += coeff;
-            }
-            /* Normalize to handle edge effects at boundaries */
-            resampled[i] = (wsum > 1e-9) ? (float)(acc / wsum) : 0.0f;
-        }
-        #undef BESSEL_I0
+        float *resampled = resample_buffer(samples, n_frames, sample_rate, &n_frames);
         free(samples);
         samples = resampled;
-        n_frames = new_n;
+        if (!samples) return NULL;
     }
 
     *out_n_samples = n_frames;
@@ -191,6 +809,14 @@ float *qwen_load_wav(const char *path, int *out_n_samples) {
     return samples;
 }
 
+/* Format of headerless stdin data (process-wide, like stdin itself) */
+static int stdin_raw_format = QWEN_STDIN_S16LE;
+
+void qwen_set_stdin_raw_format(int format) {
+    if (format == QWEN_STDIN_S16LE || format == QWEN_STDIN_ULAW || format == QWEN_STDIN_ALAW)
+        stdin_raw_format = format;
+}
+
 float *qwen_read_pcm_stdin(int *out_n_samples) {
     size_t capacity = 1024 * 1024;
     size_t size = 0;
@@ -213,13 +839,27 @@ float *qwen_read_pcm_stdin(int *out_n_samples) {
     }
     if (qwen_verbose >= 2)
         fprintf(stderr, "Read %zu bytes from stdin\n", size);
-    if (memcmp(buf, "RIFF", 4) == 0) {
+    if (memcmp(buf, "RIFF", 4) == 0 || flac_sniff(buf, size)) {
         if (qwen_verbose >= 2)
-            fprintf(stderr, "Detected WAV format on stdin\n");
+            fprintf(stderr, "Detected %s format on stdin\n", memcmp(buf, "RIFF", 4) == 0 ? "WAV" : "FLAC");
         float *samples = qwen_parse_wav_buffer(buf, size, out_n_samples);
         free(buf);
         return samples;
     }
+    if (stdin_raw_format != QWEN_STDIN_S16LE) {
+        /* Raw G.711 8kHz mono */
+        int fmt = stdin_raw_format == QWEN_STDIN_ULAW ? 7 : 6;
+        if (qwen_verbose >= 2)
+            fprintf(stderr, "Treating stdin as raw G.711 %s 8kHz mono\n", fmt == 7 ? "u-law" : "A-law");
+        if (size > INT_MAX) { free(buf); return NULL; }
+        float *pcm8k = (float *)malloc(size * sizeof(float));
+        if (!pcm8k) { free(buf); return NULL; }
+        g711_expand(pcm8k, buf, (int)size, g711_lut(fmt));
+        free(buf);
+        float *samples = resample_buffer(pcm8k, (int)size, 8000, out_n_samples);
+        free(pcm8k);
+        return samples;
+    }
     /* Raw s16le 16kHz mono */
     if (qwen_verbose >= 2)
         fprintf(stderr, "Treating stdin as raw s16le 16kHz mono\n");
@@ -292,68 +932,56 @@ static float *build_mel_filters(void) {
 
 /* ========================================================================
  * Mel Spectrogram (dynamic max, returns [128, n_frames])
+ *
+ * Frames are independent, so both passes split the frame range across the
+ * thread pool: each worker computes its frames and a local maximum, and
+ * after the max reduction writes its frames' columns of the [128, n_frames]
+ * output. Per-frame arithmetic is unchanged, so the result does not depend
+ * on the thread count.
  * ======================================================================== */
 
-float *qwen_mel_spectrogram(const float *samples, int n_samples, int *out_frames) {
-    int n_fft = N_FFT;
-    int n_freqs = N_FREQ;
-    int pad_len = n_fft / 2; /* center=True padding (reflect) */
-
-    /* Reflect-pad the signal */
-    int padded_len = n_samples + 2 * pad_len;
-    float *padded = (float *)malloc(padded_len * sizeof(float));
-    for (int i = 0; i < pad_len; i++) {
-        int src = pad_len - i;
-        padded[i] = (src < n_samples) ? samples[src] : 0.0f;
-    }
-    memcpy(padded + pad_len, samples, n_samples * sizeof(float));
-    for (int i = 0; i < pad_len; i++) {
-        int src = n_samples - 2 - i;
-        padded[pad_len + n_samples + i] = (src >= 0) ? samples[src] : 0.0f;
-    }
-
-    int n_frames_total = (padded_len - n_fft) / HOP_LENGTH + 1;
-    int n_frames = n_frames_total - 1; /* drop last frame */
-    if (n_frames <= 0) {
-        fprintf(stderr, "qwen_mel_spectrogram: audio too short (%d samples)\n", n_samples);
-        free(padded);
-        return NULL;
-    }
+#define MEL_MIN_PARALLEL_FRAMES 64
 
-    float *mel_filters = build_mel_filters();
-    if (!mel_filters) { free(padded); return NULL; }
-
-    /* Periodic Hann window */
-    float window[WIN_LENGTH];
-    for (int i = 0; i < WIN_LENGTH; i++)
-        window[i] = 0.5f * (1.0f - cosf(2.0f * (float)M_PI * (float)i / (float)WIN_LENGTH));
-
-    /* Precompute DFT tables */
-    float *dft_cos = (float *)malloc((size_t)N_FREQ * N_FFT * sizeof(float));
-    float *dft_sin = (float *)malloc((size_t)N_FREQ * N_FFT * sizeof(float));
-    for (int k = 0; k < N_FREQ; k++) {
-        for (int n = 0; n < N_FFT; n++) {
-            float angle = 2.0f * (float)M_PI * (float)k * (float)n / (float)N_FFT;
-            dft_cos[k * N_FFT + n] = cosf(angle);
-            dft_sin[k * N_FFT + n] = sinf(angle);
-        }
-    }
+typedef struct {
+    const float *padded;
+    const float *window;
+    const float *dft_cos, *dft_sin;
+    const float *mel_filters;
+    float *mel_tmp;                     /* [n_frames, N_MEL] log10 values */
+    float *mel;                         /* [N_MEL, n_frames] output */
+    int n_frames;
+    float min_val;                      /* second pass: global max - 8 */
+    float local_max[QWEN_MAX_THREADS];
+} mel_task_t;
+
+static void mel_frame_range(int tid, int n_threads, int n_frames, int *t0, int *t1) {
+    int per = (n_frames + n_threads - 1) / n_threads;
+    *t0 = tid * per < n_frames ? tid * per : n_frames;
+    *t1 = *t0 + per < n_frames ? *t0 + per : n_frames;
+}
 
-    /* First pass: compute mel values and find global max.
-     * Store as [n_frames, N_MEL] temporarily for convenient max search. */
-    float *mel_tmp = (float *)calloc(n_frames * N_MEL, sizeof(float));
+/* First pass: mel values of a frame range and their maximum */
+static void mel_frames_worker(int tid, int n_threads, void *arg) {
+    mel_task_t *task = (mel_task_t *)arg;
+    const int n_freqs = N_FREQ;
+    const float *window = task->window;
+    const float *dft_cos = task->dft_cos, *dft_sin = task->dft_sin;
+    const float *mel_filters = task->mel_filters;
+    float *mel_tmp = task->mel_tmp;
     float windowed[N_FFT];
     float power[N_FREQ];
-    float global_max = -1e30f;
+    float local_max = -1e30f;
+    int t0, t1;
+    mel_frame_range(tid, n_threads, task->n_frames, &t0, &t1);
 
-    for (int t = 0; t < n_frames; t++) {
-        int start = t * HOP_LENGTH;
+    for (int t = t0; t < t1; t++) {
+        const float *frame = task->padded + (size_t)t * HOP_LENGTH;
 #if defined(USE_BLAS) && defined(__APPLE__)
         /* Use vDSP for windowing: windowed = padded[start:] * window */
-        vDSP_vmul(padded + start, 1, window, 1, windowed, 1, N_FFT);
+        vDSP_vmul(frame, 1, window, 1, windowed, 1, N_FFT);
 #else
         for (int i = 0; i < N_FFT; i++)
-            windowed[i] = padded[start + i] * window[i];
+            windowed[i] = frame[i] * window[i];
 #endif
 
 #if defined(USE_BLAS) && defined(__APPLE__)
@@ -384,8 +1012,8 @@ float *qwen_mel_spectrogram(const float *samples, int n_samples, int *out_frames
             vDSP_dotpr(power, 1, mel_filters + (size_t)m * n_freqs, 1, &sum, n_freqs);
             if (sum < 1e-10f) sum = 1e-10f;
             float val = log10f(sum);
-            mel_tmp[t * N_MEL + m] = val;
-            if (val > global_max) global_max = val;
+            mel_tmp[(size_t)t * N_MEL + m] = val;
+            if (val > local_max) local_max = val;
         }
 #else
         for (int m = 0; m < N_MEL; m++) {
@@ -394,25 +1022,102 @@ float *qwen_mel_spectrogram(const float *samples, int n_samples, int *out_frames
             for (int k = 0; k < n_freqs; k++) sum += filt[k] * power[k];
             if (sum < 1e-10f) sum = 1e-10f;
             float val = log10f(sum);
-            mel_tmp[t * N_MEL + m] = val;
-            if (val > global_max) global_max = val;
+            mel_tmp[(size_t)t * N_MEL + m] = val;
+            if (val > local_max) local_max = val;
         }
 #endif
     }
+    task->local_max[tid] = local_max;
+}
 
-    /* Second pass: clamp with dynamic max and normalize.
-     * Output layout: [N_MEL, n_frames] for Conv2D compatibility. */
-    float *mel = (float *)malloc((size_t)N_MEL * n_frames * sizeof(float));
-    float min_val = global_max - 8.0f;
+/* Second pass: clamp with the dynamic max, normalize and write the frame
+ * range's columns of the [N_MEL, n_frames] output (Conv2D layout). */
+static void mel_store_worker(int tid, int n_threads, void *arg) {
+    mel_task_t *task = (mel_task_t *)arg;
+    int n_frames = task->n_frames;
+    int t0, t1;
+    mel_frame_range(tid, n_threads, n_frames, &t0, &t1);
 
-    for (int t = 0; t < n_frames; t++) {
-        for (int m = 0; m < N_MEL; m++) {
-            float val = mel_tmp[t * N_MEL + m];
-            if (val < min_val) val = min_val;
-            /* Store as [mel_bin, frame] for Conv2D input */
-            mel[m * n_frames + t] = (val + 4.0f) / 4.0f;
+    for (int m = 0; m < N_MEL; m++) {
+        float *dst = task->mel + (size_t)m * n_frames;
+        for (int t = t0; t < t1; t++) {
+            float val = task->mel_tmp[(size_t)t * N_MEL + m];
+            if (val < task->min_val) val = task->min_val;
+            dst[t] = (val + 4.0f) / 4.0f;
         }
     }
+}
+
+float *qwen_mel_spectrogram(const float *samples, int n_samples, int *out_frames) {
+    int n_fft = N_FFT;
+    int pad_len = n_fft / 2; /* center=True padding (reflect) */
+
+    /* Reflect-pad the signal */
+    int padded_len = n_samples + 2 * pad_len;
+    float *padded = (float *)malloc(padded_len * sizeof(float));
+    if (!padded) return NULL;
+    for (int i = 0; i < pad_len; i++) {
+        int src = pad_len - i;
+        padded[i] = (src < n_samples) ? samples[src] : 0.0f;
+    }
+    memcpy(padded + pad_len, samples, n_samples * sizeof(float));
+    for (int i = 0; i < pad_len; i++) {
+        int src = n_samples - 2 - i;
+        padded[pad_len + n_samples + i] = (src >= 0) ? samples[src] : 0.0f;
+    }
+
+    int n_frames_total = (padded_len - n_fft) / HOP_LENGTH + 1;
+    int n_frames = n_frames_total - 1; /* drop last frame */
+    if (n_frames <= 0) {
+        fprintf(stderr, "qwen_mel_spectrogram: audio too short (%d samples)\n", n_samples);
+        free(padded);
+        return NULL;
+    }
+
+    float *mel_filters = build_mel_filters();
+    if (!mel_filters) { free(padded); return NULL; }
+
+    /* Periodic Hann window */
+    float window[WIN_LENGTH];
+    for (int i = 0; i < WIN_LENGTH; i++)
+        window[i] = 0.5f * (1.0f - cosf(2.0f * (float)M_PI * (float)i / (float)WIN_LENGTH));
+
+    /* Precompute DFT tables */
+    float *dft_cos = (float *)malloc((size_t)N_FREQ * N_FFT * sizeof(float));
+    float *dft_sin = (float *)malloc((size_t)N_FREQ * N_FFT * sizeof(float));
+    /* [n_frames, N_MEL] temporary for the max search */
+    float *mel_tmp = (float *)malloc((size_t)n_frames * N_MEL * sizeof(float));
+    float *mel = (float *)malloc((size_t)N_MEL * n_frames * sizeof(float));
+    if (!dft_cos || !dft_sin || !mel_tmp || !mel) {
+        free(dft_cos); free(dft_sin); free(mel_tmp); free(mel);
+        free(padded); free(mel_filters);
+        return NULL;
+    }
+    for (int k = 0; k < N_FREQ; k++) {
+        for (int n = 0; n < N_FFT; n++) {
+            float angle = 2.0f * (float)M_PI * (float)k * (float)n / (float)N_FFT;
+            dft_cos[k * N_FFT + n] = cosf(angle);
+            dft_sin[k * N_FFT + n] = sinf(angle);
+        }
+    }
+
+    mel_task_t task = {
+        .padded = padded, .window = window, .dft_cos = dft_cos, .dft_sin = dft_sin,
+        .mel_filters = mel_filters, .mel_tmp = mel_tmp, .mel = mel, .n_frames = n_frames,
+    };
+    int parallel = n_frames >= MEL_MIN_PARALLEL_FRAMES;
+
+    /* First pass: mel values and per-thread maxima */
+    int nt = parallel ? qwen_parallel_for(mel_frames_worker, &task) : 1;
+    if (!parallel) mel_frames_worker(0, 1, &task);
+    float global_max = -1e30f;
+    for (int i = 0; i < nt; i++)
+        if (task.local_max[i] > global_max) global_max = task.local_max[i];
+
+    /* Second pass: clamp with dynamic max and normalize */
+    task.min_val = global_max - 8.0f;
+    if (parallel) qwen_parallel_for(mel_store_worker, &task);
+    else mel_store_worker(0, 1, &task);
 
     free(mel_tmp);
     free(dft_cos);
@@ -428,8 +1133,6 @@ float *qwen_mel_spectrogram(const float *samples, int n_samples, int *out_frames
  * Live Audio: stdin reader thread for incremental streaming
  * ======================================================================== */
 
-#include <pthread.h>
-
 /* Append n_new float samples to la->samples under mutex + signal condvar. */
 static void live_audio_append(qwen_live_audio_t *la, const float *data, int n_new) {
     if (!la || !data || n_new <= 0) return;
@@ -453,67 +1156,369 @@ static void live_audio_append(qwen_live_audio_t *la, const float *data, int n_ne
     }
     memcpy(la->samples + (size_t)la->n_samples, data, (size_t)n_new * sizeof(float));
     la->n_samples += n_new;
-    pthread_cond_signal(&la->cond);
+    pthread_cond_broadcast(&la->cond);
     pthread_mutex_unlock(&la->mutex);
 }
 
-/* Convert a chunk of s16le bytes to float samples and append. */
-static void live_audio_convert_and_append(qwen_live_audio_t *la,
-                                          const uint8_t *buf, size_t n_bytes) {
-    int n_frames = (int)(n_bytes / 2);
-    if (n_frames <= 0) return;
-    float *tmp = (float *)malloc((size_t)n_frames * sizeof(float));
-    if (!tmp) return;
-    const int16_t *src = (const int16_t *)buf;
-    for (int i = 0; i < n_frames; i++) tmp[i] = src[i] / 32768.0f;
-    live_audio_append(la, tmp, n_frames);
-    free(tmp);
+qwen_live_audio_t *qwen_live_audio_create(void) {
+    qwen_live_audio_t *la = (qwen_live_audio_t *)calloc(1, sizeof(qwen_live_audio_t));
+    if (!la) return NULL;
+    pthread_mutex_init(&la->mutex, NULL);
+    pthread_cond_init(&la->cond, NULL);
+    return la;
 }
 
-typedef struct {
-    qwen_live_audio_t *la;
-    int is_wav;
-    int data_remaining;  /* bytes remaining in WAV data chunk, -1 if raw */
-} live_reader_ctx_t;
+void qwen_live_audio_push(qwen_live_audio_t *la, const float *samples, int n_samples) {
+    live_audio_append(la, samples, n_samples);
+}
 
-static void *live_reader_thread(void *arg) {
-    live_reader_ctx_t *rctx = (live_reader_ctx_t *)arg;
-    qwen_live_audio_t *la = rctx->la;
-    int is_wav = rctx->is_wav;
-    int data_remaining = rctx->data_remaining;
-    free(rctx);
+void qwen_live_audio_close(qwen_live_audio_t *la) {
+    if (!la) return;
+    pthread_mutex_lock(&la->mutex);
+    la->eof = 1;
+    pthread_cond_broadcast(&la->cond);
+    if (la->ring) qwen_shm_wake(la->ring);
+    pthread_mutex_unlock(&la->mutex);
+}
 
-    /* Read stdin in ~2s chunks: 32000 samples * 2 bytes = 64000 bytes */
-    const size_t READ_SIZE = 64000;
-    uint8_t *buf = (uint8_t *)malloc(READ_SIZE);
-    if (!buf) {
-        pthread_mutex_lock(&la->mutex);
+qwen_live_audio_t *qwen_live_audio_attach_shm(const char *path) {
+    uint32_t capacity = 0;
+    qwen_shm_ring_t *ring = qwen_shm_attach(path, &capacity);
+    if (!ring) return NULL;
+    qwen_live_audio_t *la = qwen_live_audio_create();
+    if (!la) {
+        qwen_shm_detach(ring, capacity);
+        return NULL;
+    }
+    la->ring = ring;
+    la->ring_data = qwen_shm_data(ring);
+    la->ring_capacity = capacity;
+    la->ring_base = -(int64_t)__atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE);
+    qwen_live_audio_sync(la);
+    if (qwen_verbose >= 2)
+        fprintf(stderr, "Live shm: attached %s (%u samples, %lld buffered)\n",
+                path, capacity, (long long)la->n_samples);
+    return la;
+}
+
+void qwen_live_audio_sync(qwen_live_audio_t *la) {
+    qwen_shm_ring_t *r = la->ring;
+    if (!r) return;
+    uint64_t rd = (uint64_t)(la->sample_offset - la->ring_base);
+    if (__atomic_load_n(&r->read_pos, __ATOMIC_RELAXED) != rd)
+        __atomic_store_n(&r->read_pos, rd, __ATOMIC_RELEASE);
+    /* eof before write_pos: the final write is visible once eof is */
+    if (__atomic_load_n(&r->eof, __ATOMIC_ACQUIRE)) la->eof = 1;
+    uint64_t wr = __atomic_load_n(&r->write_pos, __ATOMIC_ACQUIRE);
+
+    /* The producer can write the whole header: reads use the capacity and
+     * data pointer cached at attach, and a ring claiming more than a full
+     * buffer would still make them run off the mapping. End the stream on
+     * what was already validated. */
+    if (wr - rd > la->ring_capacity) {
+        if (!la->eof)
+            fprintf(stderr, "qwen_live_audio_sync: corrupt shm ring (write_pos %llu, "
+                    "read_pos %llu, capacity %u), ending stream\n",
+                    (unsigned long long)wr, (unsigned long long)rd, la->ring_capacity);
         la->eof = 1;
-        pthread_cond_signal(&la->cond);
+        return;
+    }
+    la->n_samples = (int64_t)(wr - rd);
+}
+
+void qwen_live_audio_read(const qwen_live_audio_t *la, float *dst, int64_t from, int64_t n) {
+    if (n <= 0) return;
+    if (la->ring)
+        qwen_shm_read(la->ring_data, la->ring_capacity, (uint64_t)(from - la->ring_base),
+                      dst, (size_t)n);
+    else
+        memcpy(dst, la->samples + (size_t)(from - la->sample_offset), (size_t)n * sizeof(float));
+}
+
+int qwen_live_audio_wait(qwen_live_audio_t *la, const struct timespec *deadline) {
+    qwen_shm_ring_t *r = la->ring;
+    if (!r)
+        return deadline ? pthread_cond_timedwait(&la->cond, &la->mutex, deadline)
+                        : pthread_cond_wait(&la->cond, &la->mutex);
+
+    /* Register, then re-check: a write or wake after the seq load makes
+     * the futex wait return at once. Local wakers bump seq under the
+     * mutex, so they cannot slip in before the load either. */
+    int64_t end0 = la->sample_offset + la->n_samples;
+    int eof0 = la->eof;
+    int rc = 0;
+    __atomic_add_fetch(&r->waiters, 1, __ATOMIC_SEQ_CST);
+    uint32_t seq = __atomic_load_n(&r->seq, __ATOMIC_SEQ_CST);
+    qwen_live_audio_sync(la);
+    if (la->sample_offset + la->n_samples == end0 && la->eof == eof0) {
         pthread_mutex_unlock(&la->mutex);
-        return NULL;
+        rc = qwen_shm_wait(r, seq, deadline);
+        pthread_mutex_lock(&la->mutex);
+        qwen_live_audio_sync(la);
     }
+    __atomic_sub_fetch(&r->waiters, 1, __ATOMIC_SEQ_CST);
+    return rc;
+}
 
-    while (1) {
-        size_t want = READ_SIZE;
-        if (is_wav && data_remaining >= 0) {
+void qwen_live_audio_wake(qwen_live_audio_t *la) {
+    pthread_mutex_lock(&la->mutex);
+    pthread_cond_broadcast(&la->cond);
+    if (la->ring) qwen_shm_wake(la->ring);
+    pthread_mutex_unlock(&la->mutex);
+}
+
+/* Byte-stream decoder for the live reader: PCM16 or G.711 frames with any
+ * channel count and rate, mixed to mono and resampled to 16 kHz. */
+typedef struct {
+    qwen_live_audio_t *la;
+    int wav_format;         /* 1 = PCM16, 6 = A-law, 7 = u-law */
+    int channels;
+    int frame_bytes;
+    resampler_t rs;
+    uint8_t carry[16];      /* partial frame left over from the last read */
+    int n_carry;
+    float *mono;
+    int mono_cap;
+    float *out;
+    int64_t out_len, out_cap;
+} live_pcm_t;
+
+static int live_pcm_init(live_pcm_t *pc, qwen_live_audio_t *la, int wav_format,
+                         int channels, int sample_rate) {
+    memset(pc, 0, sizeof(*pc));
+    if (channels < 1 || channels > 8 || sample_rate <= 0) return -1;
+    pc->la = la;
+    pc->wav_format = wav_format;
+    pc->channels = channels;
+    pc->frame_bytes = channels * (wav_format == 1 ? 2 : 1);
+    resampler_init(&pc->rs, sample_rate);
+    return 0;
+}
+
+static void live_pcm_free(live_pcm_t *pc) {
+    resampler_free(&pc->rs);
+    free(pc->mono);
+    free(pc->out);
+}
+
+/* Decode whole frames from carry + buf (flush=1 at end of stream) and
+ * append the 16 kHz result to the live buffer. */
+static void live_pcm_feed(live_pcm_t *pc, const uint8_t *buf, size_t n_bytes, int flush) {
+    /* Complete a frame split across reads */
+    if (pc->n_carry > 0 && n_bytes > 0) {
+        size_t need = (size_t)(pc->frame_bytes - pc->n_carry);
+        size_t take = n_bytes < need ? n_bytes : need;
+        memcpy(pc->carry + pc->n_carry, buf, take);
+        pc->n_carry += (int)take;
+        buf += take;
+        n_bytes -= take;
+        if (pc->n_carry == pc->frame_bytes) {
+            pc->n_carry = 0;
+            live_pcm_feed(pc, pc->carry, (size_t)pc->frame_bytes, 0);
+        }
+    }
+
+    int n_frames = (int)(n_bytes / (size_t)pc->frame_bytes);
+    size_t rest = n_bytes - (size_t)n_frames * pc->frame_bytes;
+    if (rest > 0) {
+        memcpy(pc->carry, buf + (size_t)n_frames * pc->frame_bytes, rest);
+        pc->n_carry = (int)rest;
+    }
+
+    if (n_frames > pc->mono_cap) {
+        float *tmp = (float *)realloc(pc->mono, (size_t)n_frames * sizeof(float));
+        if (!tmp) return;
+        pc->mono = tmp;
+        pc->mono_cap = n_frames;
+    }
+    if (pc->wav_format != 1) {
+        const float *lut = g711_lut(pc->wav_format);
+        if (pc->channels == 1) {
+            g711_expand(pc->mono, buf, n_frames, lut);
+        } else {
+            for (int i = 0; i < n_frames; i++) {
+                float sum = 0;
+                for (int c = 0; c < pc->channels; c++) sum += lut[buf[i * pc->channels + c]];
+                pc->mono[i] = sum / pc->channels;
+            }
+        }
+    } else {
+        for (int i = 0; i < n_frames; i++) {
+            float sum = 0;
+            for (int c = 0; c < pc->channels; c++) {
+                int16_t val;
+                memcpy(&val, buf + ((size_t)i * pc->channels + c) * 2, sizeof(int16_t));
+                sum += val;
+            }
+            pc->mono[i] = (pc->channels == 1 ? sum : sum / pc->channels) / 32768.0f;
+        }
+    }
+
+    pc->out_len = 0;
+    if (resampler_push(&pc->rs, pc->mono, n_frames, flush,
+                       &pc->out, &pc->out_len, &pc->out_cap) == 0 && pc->out_len > 0)
+        live_audio_append(pc->la, pc->out, (int)pc->out_len);
+}
+
+/* Audio per blocking stdin read: fread() returns only when the request is
+ * full, so this bounds how late samples reach the live buffer. */
+#define LIVE_READ_MS 100
+
+typedef struct {
+    live_pcm_t pcm;
+    int64_t data_remaining;  /* bytes remaining in WAV data chunk, -1 if unbounded */
+    size_t read_bytes;       /* LIVE_READ_MS of input in the stream's own format */
+} live_reader_ctx_t;
+
+static void *live_reader_thread(void *arg) {
+    live_reader_ctx_t *rctx = (live_reader_ctx_t *)arg;
+    qwen_live_audio_t *la = rctx->pcm.la;
+    int64_t data_remaining = rctx->data_remaining;
+
+    /* Read stdin in LIVE_READ_MS chunks at the input's byte rate */
+    const size_t read_size = rctx->read_bytes;
+    uint8_t *buf = (uint8_t *)malloc(read_size);
+    while (buf) {
+        size_t want = read_size;
+        if (data_remaining >= 0) {
             if (data_remaining == 0) break;
             if (want > (size_t)data_remaining) want = (size_t)data_remaining;
         }
         size_t n = fread(buf, 1, want, stdin);
         if (n == 0) break;
-        if (is_wav && data_remaining >= 0) data_remaining -= (int)n;
-        live_audio_convert_and_append(la, buf, n);
+        if (data_remaining >= 0) data_remaining -= (int64_t)n;
+        live_pcm_feed(&rctx->pcm, buf, n, 0);
     }
+    live_pcm_feed(&rctx->pcm, NULL, 0, 1);
 
     free(buf);
+    live_pcm_free(&rctx->pcm);
+    free(rctx);
+    pthread_mutex_lock(&la->mutex);
+    la->eof = 1;
+    pthread_cond_broadcast(&la->cond);
+    pthread_mutex_unlock(&la->mutex);
+    return NULL;
+}
+
+/* FLAC on stdin: undecoded bytes are kept in buf until a full frame is
+ * available; decoded frames go through the resampler into the live buffer. */
+typedef struct {
+    qwen_live_audio_t *la;
+    flac_decoder_t fd;
+    resampler_t rs;
+    uint8_t *buf;
+    size_t len, cap;
+} live_flac_ctx_t;
+
+/* Append up to want bytes from stdin to fctx->buf; returns bytes read
+ * (0 at EOF or on allocation failure). */
+static size_t live_flac_fill(live_flac_ctx_t *fctx, size_t want) {
+    if (fctx->len + want > fctx->cap) {
+        size_t cap = fctx->cap > 0 ? fctx->cap : 65536;
+        while (cap < fctx->len + want) cap *= 2;
+        uint8_t *tmp = (uint8_t *)realloc(fctx->buf, cap);
+        if (!tmp) return 0;
+        fctx->buf = tmp;
+        fctx->cap = cap;
+    }
+    size_t n = fread(fctx->buf + fctx->len, 1, want, stdin);
+    fctx->len += n;
+    return n;
+}
+
+static void live_flac_free(live_flac_ctx_t *fctx) {
+    flac_free(&fctx->fd);
+    resampler_free(&fctx->rs);
+    free(fctx->buf);
+    free(fctx);
+}
+
+static void *live_flac_reader_thread(void *arg) {
+    live_flac_ctx_t *fctx = (live_flac_ctx_t *)arg;
+    qwen_live_audio_t *la = fctx->la;
+    float *out = NULL;
+    int64_t out_len = 0, out_cap = 0;
+    int at_eof = 0;
+
+    while (!at_eof) {
+        /* Decode every complete frame in the buffer */
+        size_t pos = 0;
+        for (;;) {
+            size_t used = 0;
+            int n = flac_decode_frame(&fctx->fd, fctx->buf + pos, fctx->len - pos, &used);
+            if (n < 0) { at_eof = 1; break; }
+            if (used == 0) break;
+            pos += used;
+            if (n > 0 && resampler_push(&fctx->rs, fctx->fd.mono, n, 0,
+                                        &out, &out_len, &out_cap) != 0) {
+                at_eof = 1;
+                break;
+            }
+        }
+        if (out_len > 0) {
+            live_audio_append(la, out, (int)out_len);
+            out_len = 0;
+        }
+        memmove(fctx->buf, fctx->buf + pos, fctx->len - pos);
+        fctx->len -= pos;
+        if (!at_eof && live_flac_fill(fctx, 16384) == 0) at_eof = 1;
+    }
+
+    if (resampler_push(&fctx->rs, NULL, 0, 1, &out, &out_len, &out_cap) == 0 && out_len > 0)
+        live_audio_append(la, out, (int)out_len);
+    free(out);
+    live_flac_free(fctx);
+
     pthread_mutex_lock(&la->mutex);
     la->eof = 1;
-    pthread_cond_signal(&la->cond);
+    pthread_cond_broadcast(&la->cond);
     pthread_mutex_unlock(&la->mutex);
     return NULL;
 }
 
+/* Parse the FLAC header (reading more of stdin if the metadata is larger
+ * than the sniffed bytes) and start the decoding reader thread. */
+static qwen_live_audio_t *live_audio_start_flac(const uint8_t *header, size_t hdr_read) {
+    live_flac_ctx_t *fctx = (live_flac_ctx_t *)calloc(1, sizeof(live_flac_ctx_t));
+    if (!fctx) return NULL;
+    fctx->buf = (uint8_t *)malloc(hdr_read);
+    if (!fctx->buf) { free(fctx); return NULL; }
+    memcpy(fctx->buf, header, hdr_read);
+    fctx->len = fctx->cap = hdr_read;
+
+    size_t pos = 0;
+    int r;
+    while ((r = flac_parse_header(&fctx->fd, fctx->buf, fctx->len, &pos)) == 0) {
+        if (live_flac_fill(fctx, 65536) == 0) break;
+    }
+    if (r != 1) {
+        if (r == 0) fprintf(stderr, "qwen_live_audio_start_stdin: truncated FLAC header\n");
+        live_flac_free(fctx);
+        return NULL;
+    }
+    memmove(fctx->buf, fctx->buf + pos, fctx->len - pos);
+    fctx->len -= pos;
+    resampler_init(&fctx->rs, fctx->fd.sample_rate);
+    if (qwen_verbose >= 2)
+        fprintf(stderr, "Live stdin: FLAC detected (%d Hz, %d-bit, %d ch)\n",
+                fctx->fd.sample_rate, fctx->fd.bps, fctx->fd.channels);
+
+    qwen_live_audio_t *la = qwen_live_audio_create();
+    if (!la) {
+        live_flac_free(fctx);
+        return NULL;
+    }
+    fctx->la = la;
+    if (pthread_create(&la->thread, NULL, live_flac_reader_thread, fctx) != 0) {
+        fprintf(stderr, "qwen_live_audio_start_stdin: failed to create reader thread\n");
+        live_flac_free(fctx);
+        qwen_live_audio_free(la);
+        return NULL;
+    }
+    return la;
+}
+
 qwen_live_audio_t *qwen_live_audio_start_stdin(void) {
     /* Read enough to detect WAV vs raw: we need at least 12 bytes for RIFF+WAVE,
      * but a full WAV header is typically 44 bytes. Read up to 4096 to cover
@@ -524,18 +1529,21 @@ qwen_live_audio_t *qwen_live_audio_start_stdin(void) {
         fprintf(stderr, "qwen_live_audio_start_stdin: no data on stdin\n");
         return NULL;
     }
+    if (flac_sniff(header, hdr_read))
+        return live_audio_start_flac(header, hdr_read);
 
     int is_wav = 0;
-    int wav_sample_rate = 0;
-    int wav_channels = 0;
-    int wav_bits = 0;
-    int wav_format = 0;
-    int data_chunk_size = -1;
+    int wav_sample_rate = SAMPLE_RATE;
+    int wav_channels = 1;
+    int wav_bits = 16;
+    int wav_format = 1;
+    int64_t data_chunk_size = -1;
     size_t data_chunk_offset = 0; /* offset into header[] where PCM data starts */
     size_t pcm_in_header = 0;     /* how many PCM bytes are in the header buffer */
 
     if (hdr_read >= 44 && memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0) {
         is_wav = 1;
+        wav_format = 0;
         /* Parse WAV chunks */
         const uint8_t *p = header + 12;
         const uint8_t *end = header + hdr_read;
@@ -547,10 +1555,11 @@ qwen_live_audio_t *qwen_live_audio_start_stdin(void) {
                 wav_sample_rate = read_u32(p + 12);
                 wav_bits = read_u16(p + 22);
             } else if (memcmp(p, "data", 4) == 0) {
-                data_chunk_size = (int)chunk_size;
+                /* Streaming writers leave the size at 0xFFFFFFFF: read to EOF */
+                data_chunk_size = chunk_size == 0xFFFFFFFFu ? -1 : (int64_t)chunk_size;
                 data_chunk_offset = (size_t)(p + 8 - header);
                 pcm_in_header = hdr_read - data_chunk_offset;
-                if (pcm_in_header > (size_t)data_chunk_size)
+                if (data_chunk_size >= 0 && pcm_in_header > (size_t)data_chunk_size)
                     pcm_in_header = (size_t)data_chunk_size;
                 break; /* data chunk found, start streaming */
             }
@@ -558,25 +1567,15 @@ qwen_live_audio_t *qwen_live_audio_start_stdin(void) {
             if (chunk_size & 1) p++;
         }
 
-        if (wav_format != 1 || wav_bits != 16 || wav_channels < 1) {
+        int is_g711 = (wav_format == 6 || wav_format == 7) && wav_bits == 8;
+        if (!(wav_format == 1 && wav_bits == 16) && !is_g711) {
             fprintf(stderr, "qwen_live_audio_start_stdin: unsupported WAV format "
-                    "(need 16-bit PCM, got fmt=%d bits=%d)\n", wav_format, wav_bits);
-            return NULL;
-        }
-        if (wav_sample_rate != SAMPLE_RATE) {
-            fprintf(stderr, "qwen_live_audio_start_stdin: WAV sample rate is %d Hz, "
-                    "but live streaming requires 16000 Hz.\n"
-                    "  Hint: pipe through ffmpeg first:\n"
-                    "    ... | ffmpeg -i pipe:0 -ar 16000 -ac 1 -f s16le pipe:1 | "
-                    "./qwen_asr --stdin --stream\n", wav_sample_rate);
+                    "(need 16-bit PCM or G.711, got fmt=%d bits=%d)\n", wav_format, wav_bits);
             return NULL;
         }
-        if (wav_channels != 1) {
-            fprintf(stderr, "qwen_live_audio_start_stdin: WAV has %d channels, "
-                    "but live streaming requires mono.\n"
-                    "  Hint: pipe through ffmpeg first:\n"
-                    "    ... | ffmpeg -i pipe:0 -ar 16000 -ac 1 -f s16le pipe:1 | "
-                    "./qwen_asr --stdin --stream\n", wav_channels);
+        if (wav_channels < 1 || wav_channels > 8 || wav_sample_rate <= 0) {
+            fprintf(stderr, "qwen_live_audio_start_stdin: unsupported WAV layout "
+                    "(%d channels, %d Hz)\n", wav_channels, wav_sample_rate);
             return NULL;
         }
         if (data_chunk_offset == 0) {
@@ -584,39 +1583,47 @@ qwen_live_audio_t *qwen_live_audio_start_stdin(void) {
             return NULL;
         }
         if (qwen_verbose >= 2)
-            fprintf(stderr, "Live stdin: WAV detected (%d Hz, %d-bit, %d ch, data=%d bytes)\n",
-                    wav_sample_rate, wav_bits, wav_channels, data_chunk_size);
+            fprintf(stderr, "Live stdin: WAV detected (%s, %d Hz, %d-bit, %d ch, data=%lld bytes)\n",
+                    wav_format == 1 ? "PCM" : wav_format == 7 ? "u-law" : "A-law",
+                    wav_sample_rate, wav_bits, wav_channels, (long long)data_chunk_size);
+    } else if (stdin_raw_format != QWEN_STDIN_S16LE) {
+        wav_format = stdin_raw_format == QWEN_STDIN_ULAW ? 7 : 6;
+        wav_sample_rate = 8000;
+        wav_bits = 8;
+        if (qwen_verbose >= 2)
+            fprintf(stderr, "Live stdin: treating as raw G.711 %s 8kHz mono\n",
+                    wav_format == 7 ? "u-law" : "A-law");
     } else {
         if (qwen_verbose >= 2)
             fprintf(stderr, "Live stdin: treating as raw s16le 16kHz mono\n");
     }
 
-    /* Allocate live audio context */
-    qwen_live_audio_t *la = (qwen_live_audio_t *)calloc(1, sizeof(qwen_live_audio_t));
+    /* Allocate live audio context and reader state */
+    qwen_live_audio_t *la = qwen_live_audio_create();
     if (!la) return NULL;
-    pthread_mutex_init(&la->mutex, NULL);
-    pthread_cond_init(&la->cond, NULL);
+    live_reader_ctx_t *rctx = (live_reader_ctx_t *)malloc(sizeof(live_reader_ctx_t));
+    if (!rctx || live_pcm_init(&rctx->pcm, la, wav_format, wav_channels, wav_sample_rate) != 0) {
+        free(rctx);
+        qwen_live_audio_free(la);
+        return NULL;
+    }
+    rctx->data_remaining = is_wav && data_chunk_size >= 0 ?
+                           data_chunk_size - (int64_t)pcm_in_header : -1;
+    int64_t frames = (int64_t)wav_sample_rate * LIVE_READ_MS / 1000;
+    rctx->read_bytes = (size_t)(frames > 0 ? frames : 1) * (size_t)rctx->pcm.frame_bytes;
 
     /* Convert and append any PCM data already read in the header buffer */
     if (is_wav && pcm_in_header > 0) {
-        live_audio_convert_and_append(la, header + data_chunk_offset, pcm_in_header);
+        live_pcm_feed(&rctx->pcm, header + data_chunk_offset, pcm_in_header, 0);
     } else if (!is_wav) {
         /* Raw: everything we read is PCM data */
-        live_audio_convert_and_append(la, header, hdr_read);
+        live_pcm_feed(&rctx->pcm, header, hdr_read, 0);
     }
 
     /* Spawn reader thread */
-    live_reader_ctx_t *rctx = (live_reader_ctx_t *)malloc(sizeof(live_reader_ctx_t));
-    if (!rctx) {
-        qwen_live_audio_free(la);
-        return NULL;
-    }
-    rctx->la = la;
-    rctx->is_wav = is_wav;
-    rctx->data_remaining = is_wav ? (data_chunk_size - (int)pcm_in_header) : -1;
-
     if (pthread_create(&la->thread, NULL, live_reader_thread, rctx) != 0) {
         fprintf(stderr, "qwen_live_audio_start_stdin: failed to create reader thread\n");
+        live_pcm_free(&rctx->pcm);
         free(rctx);
         qwen_live_audio_free(la);
         return NULL;
@@ -633,6 +1640,7 @@ void qwen_live_audio_free(qwen_live_audio_t *la) {
     }
     pthread_mutex_destroy(&la->mutex);
     pthread_cond_destroy(&la->cond);
+    qwen_shm_detach(la->ring, la->ring_capacity);
     free(la->samples);
     free(la);
 }
@@ -7,18 +7,34 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 #include "qwen_asr.h"
 
-/* Load a WAV file, returns mono float32 samples in [-1,1] at 16kHz.
- * Handles: 16-bit PCM, mono or stereo (mixed to mono).
- * Resamples to 16kHz if needed.
+/* Load a WAV or FLAC file, returns mono float32 samples in [-1,1] at 16kHz.
+ * Handles: 16-bit PCM or G.711 u-law/A-law WAV, FLAC (4-24 bit, up to 8 channels); multiple
+ * channels are mixed to mono. Resamples to 16kHz if needed.
  * Returns NULL on error. Caller must free returned buffer. */
 float *qwen_load_wav(const char *path, int *out_n_samples);
 
-/* Parse a WAV file from a memory buffer. Caller must free returned buffer. */
+/* Parse a WAV file from a memory buffer (FLAC data is detected and passed
+ * to qwen_parse_flac_buffer). Caller must free returned buffer. */
 float *qwen_parse_wav_buffer(const uint8_t *data, size_t size, int *out_n_samples);
 
-/* Read audio from stdin (auto-detect WAV or raw s16le 16kHz mono).
+/* Decode a FLAC stream from a memory buffer (optionally behind an ID3v2
+ * tag). Caller must free returned buffer. */
+float *qwen_parse_flac_buffer(const uint8_t *data, size_t size, int *out_n_samples);
+
+/* Format of headerless audio on stdin. WAV and FLAC are always detected
+ * from their headers; this only applies when there is none. */
+#define QWEN_STDIN_S16LE 0   /* raw signed 16-bit little-endian, 16 kHz mono (default) */
+#define QWEN_STDIN_ULAW  1   /* raw G.711 u-law, 8 kHz mono */
+#define QWEN_STDIN_ALAW  2   /* raw G.711 A-law, 8 kHz mono */
+
+/* Set the raw stdin format for qwen_read_pcm_stdin() and
+ * qwen_live_audio_start_stdin() (process-wide; invalid values are ignored). */
+void qwen_set_stdin_raw_format(int format);
+
+/* Read audio from stdin (auto-detect WAV, FLAC or raw per qwen_set_stdin_raw_format).
  * Returns NULL on error. Caller must free returned buffer. */
 float *qwen_read_pcm_stdin(int *out_n_samples);
 
@@ -32,10 +48,38 @@ float *qwen_read_pcm_stdin(int *out_n_samples);
 float *qwen_mel_spectrogram(const float *samples, int n_samples, int *out_frames);
 
 /* Start a reader thread that incrementally fills a live audio buffer from stdin.
- * Detects WAV vs raw s16le. For WAV, requires 16kHz sample rate.
+ * Detects WAV (16-bit PCM or G.711), FLAC or raw audio (see
+ * qwen_set_stdin_raw_format). Input is decoded, mixed to mono and resampled
+ * to 16kHz as it arrives.
  * Returns NULL on error. Caller must call qwen_live_audio_free() when done. */
 qwen_live_audio_t *qwen_live_audio_start_stdin(void);
 
+/* Live buffer fed by the caller instead of a reader thread: push mono
+ * float32 16 kHz samples (copied) from any thread, then close to signal
+ * end of stream. */
+qwen_live_audio_t *qwen_live_audio_create(void);
+void qwen_live_audio_push(qwen_live_audio_t *la, const float *samples, int n_samples);
+void qwen_live_audio_close(qwen_live_audio_t *la);
+
+/* Live buffer reading a shared-memory ring written by another process
+ * (qwen_asr_shm.h), starting at the ring's read position. There is no
+ * reader thread: the stream copies samples straight from the ring into its
+ * window and hands consumed space back to the producer. Linux only.
+ * Returns NULL on error. */
+qwen_live_audio_t *qwen_live_audio_attach_shm(const char *path);
+
+/* Stream-side access to a live buffer, with la->mutex held. sync refreshes
+ * n_samples/eof from a ring (and publishes consumption up to sample_offset);
+ * read copies samples [from, from + n) of the buffered span; wait blocks
+ * like pthread_cond_(timed)wait on la->cond (deadline = absolute
+ * CLOCK_REALTIME, NULL = none) and returns 0 or ETIMEDOUT. */
+void qwen_live_audio_sync(qwen_live_audio_t *la);
+void qwen_live_audio_read(const qwen_live_audio_t *la, float *dst, int64_t from, int64_t n);
+int qwen_live_audio_wait(qwen_live_audio_t *la, const struct timespec *deadline);
+
+/* Wake threads blocked in qwen_live_audio_wait() (mutex not held). */
+void qwen_live_audio_wake(qwen_live_audio_t *la);
+
 /* Join reader thread and free all resources. */
 void qwen_live_audio_free(qwen_live_audio_t *la);
 
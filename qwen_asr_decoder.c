@@ -17,11 +17,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 /* ========================================================================
  * Weight Loading
  * ======================================================================== */
 
+/* Fault an mmapped weight into memory ahead of the first decode step. */
+static void prefault(const void *p, size_t bytes) {
+    if (!p || bytes == 0) return;
+#if !defined(_WIN32) && !defined(_WIN64)
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0) {
+        uintptr_t base = (uintptr_t)p & ~((uintptr_t)page - 1);
+        madvise((void *)base, bytes + ((uintptr_t)p - base), MADV_WILLNEED);
+    }
+#endif
+    const volatile unsigned char *c = (const volatile unsigned char *)p;
+    unsigned char acc = 0;
+    for (size_t off = 0; off < bytes; off += 4096) acc ^= c[off];
+    acc ^= c[bytes - 1];
+    (void)acc;
+}
+
 static float *load_f32(multi_safetensors_t *ms, const char *name) {
     safetensors_file_t *sf = NULL;
     const safetensor_t *t = multi_safetensors_find(ms, name, &sf);
@@ -32,22 +53,35 @@ static float *load_f32(multi_safetensors_t *ms, const char *name) {
     return safetensors_get_f32(sf, t);
 }
 
-static uint16_t *load_bf16_direct(multi_safetensors_t *ms, const char *name) {
+/* Large weights stay in the mmap as bf16 or, for fp16 checkpoints, IEEE
+ * fp16 (dec->f16); the kernels are picked per format, so all of them must
+ * share it. */
+static uint16_t *load_w16_direct(const qwen_decoder_t *dec, multi_safetensors_t *ms,
+                                 const char *name) {
     safetensors_file_t *sf = NULL;
     const safetensor_t *t = multi_safetensors_find(ms, name, &sf);
     if (!t) {
         fprintf(stderr, "decoder: weight not found: %s\n", name);
         return NULL;
     }
-    return safetensors_get_bf16_direct(sf, t);
+    uint16_t *w = dec->f16 ? safetensors_get_f16_direct(sf, t)
+                           : safetensors_get_bf16_direct(sf, t);
+    if (!w) {
+        fprintf(stderr, "decoder: %s is not %s like the token embeddings\n",
+                name, dec->f16 ? "F16" : "BF16");
+    }
+    return w;
 }
 
 int qwen_decoder_load(qwen_decoder_t *dec, multi_safetensors_t *ms,
                        const qwen_config_t *cfg) {
     char name[512];
 
-    /* Token embeddings (large, bf16 mmap direct) */
-    dec->tok_embeddings_bf16 = load_bf16_direct(ms,
+    /* Token embeddings (large, bf16 or fp16 mmap direct); their dtype sets
+     * the format of all large decoder weights */
+    const safetensor_t *emb = multi_safetensors_find(ms, "thinker.model.embed_tokens.weight", NULL);
+    dec->f16 = emb && emb->dtype == DTYPE_F16;
+    dec->tok_embeddings_bf16 = load_w16_direct(dec, ms,
         "thinker.model.embed_tokens.weight");
     if (!dec->tok_embeddings_bf16) return -1;
 
@@ -57,13 +91,13 @@ int qwen_decoder_load(qwen_decoder_t *dec, multi_safetensors_t *ms,
 
         /* Attention weights (bf16, no bias) */
         snprintf(name, sizeof(name), "thinker.model.layers.%d.self_attn.q_proj.weight", i);
-        l->wq_weight_bf16 = load_bf16_direct(ms, name);
+        l->wq_weight_bf16 = load_w16_direct(dec, ms, name);
         snprintf(name, sizeof(name), "thinker.model.layers.%d.self_attn.k_proj.weight", i);
-        l->wk_weight_bf16 = load_bf16_direct(ms, name);
+        l->wk_weight_bf16 = load_w16_direct(dec, ms, name);
         snprintf(name, sizeof(name), "thinker.model.layers.%d.self_attn.v_proj.weight", i);
-        l->wv_weight_bf16 = load_bf16_direct(ms, name);
+        l->wv_weight_bf16 = load_w16_direct(dec, ms, name);
         snprintf(name, sizeof(name), "thinker.model.layers.%d.self_attn.o_proj.weight", i);
-        l->wo_weight_bf16 = load_bf16_direct(ms, name);
+        l->wo_weight_bf16 = load_w16_direct(dec, ms, name);
 
         /* Per-head Q/K RMSNorm weights */
         snprintf(name, sizeof(name), "thinker.model.layers.%d.self_attn.q_norm.weight", i);
@@ -79,11 +113,11 @@ int qwen_decoder_load(qwen_decoder_t *dec, multi_safetensors_t *ms,
 
         /* SwiGLU MLP weights (bf16, no bias) */
         snprintf(name, sizeof(name), "thinker.model.layers.%d.mlp.gate_proj.weight", i);
-        l->gate_weight_bf16 = load_bf16_direct(ms, name);
+        l->gate_weight_bf16 = load_w16_direct(dec, ms, name);
         snprintf(name, sizeof(name), "thinker.model.layers.%d.mlp.up_proj.weight", i);
-        l->up_weight_bf16 = load_bf16_direct(ms, name);
+        l->up_weight_bf16 = load_w16_direct(dec, ms, name);
         snprintf(name, sizeof(name), "thinker.model.layers.%d.mlp.down_proj.weight", i);
-        l->down_weight_bf16 = load_bf16_direct(ms, name);
+        l->down_weight_bf16 = load_w16_direct(dec, ms, name);
 
         if (!l->wq_weight_bf16 || !l->wk_weight_bf16 ||
             !l->wv_weight_bf16 || !l->wo_weight_bf16 ||
@@ -98,6 +132,7 @@ int qwen_decoder_load(qwen_decoder_t *dec, multi_safetensors_t *ms,
             int hidden = cfg->dec_hidden;
             size_t row_bytes = (size_t)hidden * sizeof(uint16_t);
             l->gate_up_fused_bf16 = (uint16_t *)malloc(2 * (size_t)inter * row_bytes);
+            if (!l->gate_up_fused_bf16) return -1;
             for (int r = 0; r < inter; r++) {
                 memcpy(l->gate_up_fused_bf16 + (size_t)(2 * r) * hidden,
                        l->gate_weight_bf16 + (size_t)r * hidden, row_bytes);
@@ -112,9 +147,180 @@ int qwen_decoder_load(qwen_decoder_t *dec, multi_safetensors_t *ms,
     dec->norm = load_f32(ms, "thinker.model.norm.weight");
     if (!dec->norm) return -1;
 
+    /* The remaining bf16 weights stay mmapped; read them in now rather than
+     * page by page during the first decode step. qwen_load() runs this
+     * function on a helper thread while the encoder weights convert. */
+    size_t hidden = (size_t)cfg->dec_hidden;
+    size_t q_dim = (size_t)cfg->dec_heads * cfg->dec_head_dim;
+    size_t kv_dim = (size_t)cfg->dec_kv_heads * cfg->dec_head_dim;
+    size_t inter = (size_t)cfg->dec_intermediate;
+    for (int i = 0; i < cfg->dec_layers; i++) {
+        qwen_dec_layer_t *l = &dec->layers[i];
+        prefault(l->wq_weight_bf16, q_dim * hidden * sizeof(uint16_t));
+        prefault(l->wk_weight_bf16, kv_dim * hidden * sizeof(uint16_t));
+        prefault(l->wv_weight_bf16, kv_dim * hidden * sizeof(uint16_t));
+        prefault(l->wo_weight_bf16, hidden * q_dim * sizeof(uint16_t));
+        prefault(l->down_weight_bf16, hidden * inter * sizeof(uint16_t));
+    }
+    prefault(dec->tok_embeddings_bf16, emb->data_size);
+
+    return 0;
+}
+
+/* ========================================================================
+ * 2:4 Sparse MLP Sidecar
+ *
+ * Per layer: mlp.gate_up_proj.sp24_values / .sp24_index (rows interleaved
+ * gate/up like gate_up_fused_bf16) and mlp.down_proj.sp24_values /
+ * .sp24_index, in the qwen_sp24_prune_bf16() layout.
+ * ======================================================================== */
+
+static void sp24_name(char *out, size_t n, int layer, const char *proj, const char *kind) {
+    snprintf(out, n, "thinker.model.layers.%d.mlp.%s.sp24_%s", layer, proj, kind);
+}
+
+int qwen_decoder_write_sp24(const qwen_decoder_t *dec, const qwen_config_t *cfg,
+                            const char *path) {
+    int hidden = cfg->dec_hidden, inter = cfg->dec_intermediate;
+    int n_layers = cfg->dec_layers;
+    if (hidden % 8 || inter % 8) {
+        fprintf(stderr, "qwen_write_sparse_mlp: dimensions not a multiple of 8\n");
+        return -1;
+    }
+    if (dec->f16) {
+        fprintf(stderr, "qwen_write_sparse_mlp: fp16 checkpoints are not supported\n");
+        return -1;
+    }
+    for (int i = 0; i < n_layers; i++) {
+        if (!dec->layers[i].gate_up_fused_bf16) {
+            fprintf(stderr, "qwen_write_sparse_mlp: dense MLP weights not loaded\n");
+            return -1;
+        }
+    }
+
+    /* Per call: converters may run on several contexts at once */
+    char (*names)[96] = (char (*)[96])malloc((size_t)4 * n_layers * sizeof(*names));
+    if (!names) return -1;
+    safetensor_desc_t desc[4 * QWEN_MAX_DEC_LAYERS];
+    for (int i = 0; i < n_layers; i++) {
+        safetensor_desc_t *d = &desc[4 * i];
+        sp24_name(names[4 * i], sizeof(names[0]), i, "gate_up_proj", "values");
+        sp24_name(names[4 * i + 1], sizeof(names[0]), i, "gate_up_proj", "index");
+        sp24_name(names[4 * i + 2], sizeof(names[0]), i, "down_proj", "values");
+        sp24_name(names[4 * i + 3], sizeof(names[0]), i, "down_proj", "index");
+        d[0] = (safetensor_desc_t){ names[4 * i], DTYPE_BF16, 2, { 2 * inter, hidden / 2 } };
+        d[1] = (safetensor_desc_t){ names[4 * i + 1], DTYPE_U8, 2, { 2 * inter, hidden / 8 } };
+        d[2] = (safetensor_desc_t){ names[4 * i + 2], DTYPE_BF16, 2, { hidden, inter / 2 } };
+        d[3] = (safetensor_desc_t){ names[4 * i + 3], DTYPE_U8, 2, { hidden, inter / 8 } };
+    }
+
+    /* gate_up is the larger matrix: 2 * inter * hidden weights */
+    size_t n_weights = 2 * (size_t)inter * hidden;
+    uint16_t *vals = (uint16_t *)malloc(n_weights / 2 * sizeof(uint16_t));
+    uint8_t *idx = (uint8_t *)malloc(n_weights / 8);
+    FILE *f = fopen(path, "wb");
+    if (!vals || !idx || !f) {
+        if (!f) fprintf(stderr, "qwen_write_sparse_mlp: cannot create %s\n", path);
+        else fclose(f);
+        free(vals);
+        free(idx);
+        free(names);
+        return -1;
+    }
+
+    int rc = safetensors_write_header(f, desc, 4 * n_layers);
+    for (int i = 0; i < n_layers && rc == 0; i++) {
+        const qwen_dec_layer_t *l = &dec->layers[i];
+        qwen_sp24_prune_bf16(vals, idx, l->gate_up_fused_bf16, 2 * inter, hidden);
+        if (fwrite(vals, sizeof(uint16_t), n_weights / 2, f) != n_weights / 2 ||
+            fwrite(idx, 1, n_weights / 8, f) != n_weights / 8) rc = -1;
+        if (rc) break;
+        size_t nd = (size_t)hidden * inter;
+        qwen_sp24_prune_bf16(vals, idx, l->down_weight_bf16, hidden, inter);
+        if (fwrite(vals, sizeof(uint16_t), nd / 2, f) != nd / 2 ||
+            fwrite(idx, 1, nd / 8, f) != nd / 8) rc = -1;
+    }
+    if (fclose(f) != 0) rc = -1;
+    if (rc) fprintf(stderr, "qwen_write_sparse_mlp: write error on %s\n", path);
+    free(vals);
+    free(idx);
+    free(names);
+    return rc;
+}
+
+/* Tensor data of the given dtype and [rows, cols] shape, or NULL */
+static void *sp24_tensor(const safetensors_file_t *sf, int layer, const char *proj,
+                         const char *kind, safetensor_dtype_t dtype, int rows, int cols) {
+    char name[96];
+    sp24_name(name, sizeof(name), layer, proj, kind);
+    const safetensor_t *t = safetensors_find(sf, name);
+    size_t elem = dtype == DTYPE_BF16 ? 2 : 1;
+    if (!t || t->dtype != dtype || t->ndim != 2 || t->shape[0] != rows || t->shape[1] != cols ||
+        t->data_size != (size_t)rows * cols * elem ||
+        8 + sf->header_size + t->data_offset + t->data_size > sf->file_size) {
+        fprintf(stderr, "qwen_load_sparse_mlp: %s: missing or not %s [%d, %d]\n",
+                name, dtype == DTYPE_BF16 ? "BF16" : "U8", rows, cols);
+        return NULL;
+    }
+    return (void *)safetensors_data(sf, t);
+}
+
+int qwen_decoder_load_sp24(qwen_decoder_t *dec, const qwen_config_t *cfg,
+                           const safetensors_file_t *sf) {
+    int hidden = cfg->dec_hidden, inter = cfg->dec_intermediate;
+    void *p[QWEN_MAX_DEC_LAYERS][4];
+    for (int i = 0; i < cfg->dec_layers; i++) {
+        p[i][0] = sp24_tensor(sf, i, "gate_up_proj", "values", DTYPE_BF16, 2 * inter, hidden / 2);
+        p[i][1] = sp24_tensor(sf, i, "gate_up_proj", "index", DTYPE_U8, 2 * inter, hidden / 8);
+        p[i][2] = sp24_tensor(sf, i, "down_proj", "values", DTYPE_BF16, hidden, inter / 2);
+        p[i][3] = sp24_tensor(sf, i, "down_proj", "index", DTYPE_U8, hidden, inter / 8);
+        if (!p[i][0] || !p[i][1] || !p[i][2] || !p[i][3]) return -1;
+    }
+    for (int i = 0; i < cfg->dec_layers; i++) {
+        qwen_dec_layer_t *l = &dec->layers[i];
+        l->gate_up_sp24_vals = (uint16_t *)p[i][0];
+        l->gate_up_sp24_idx = (uint8_t *)p[i][1];
+        l->down_sp24_vals = (uint16_t *)p[i][2];
+        l->down_sp24_idx = (uint8_t *)p[i][3];
+        /* The dense fused copy is no longer read */
+        free(l->gate_up_fused_bf16);
+        l->gate_up_fused_bf16 = NULL;
+        prefault(l->gate_up_sp24_vals, (size_t)inter * hidden * sizeof(uint16_t));
+        prefault(l->gate_up_sp24_idx, (size_t)inter * hidden / 4);
+        prefault(l->down_sp24_vals, (size_t)hidden * inter / 2 * sizeof(uint16_t));
+        prefault(l->down_sp24_idx, (size_t)hidden * inter / 8);
+    }
     return 0;
 }
 
+/* Dense projection in the checkpoint's 16-bit weight format */
+static void linear_w16(const qwen_decoder_t *dec, float *y, const float *x,
+                       const uint16_t *W, int seq_len, int in_dim, int out_dim) {
+    if (dec->f16)
+        qwen_linear_nobias_f16(y, x, W, seq_len, in_dim, out_dim);
+    else
+        qwen_linear_nobias_bf16(y, x, W, seq_len, in_dim, out_dim);
+}
+
+/* MLP projections, through the 2:4 sparse weights when loaded */
+static void mlp_gate_up(const qwen_decoder_t *dec, float *y, const float *x,
+                        const qwen_dec_layer_t *l, int seq_len, int dim, int intermediate) {
+    if (l->gate_up_sp24_vals)
+        qwen_linear_nobias_sp24(y, x, l->gate_up_sp24_vals, l->gate_up_sp24_idx,
+                                seq_len, dim, 2 * intermediate);
+    else
+        linear_w16(dec, y, x, l->gate_up_fused_bf16, seq_len, dim, 2 * intermediate);
+}
+
+static void mlp_down(const qwen_decoder_t *dec, float *y, const float *x,
+                     const qwen_dec_layer_t *l, int seq_len, int dim, int intermediate) {
+    if (l->down_sp24_vals)
+        qwen_linear_nobias_sp24(y, x, l->down_sp24_vals, l->down_sp24_idx,
+                                seq_len, intermediate, dim);
+    else
+        linear_w16(dec, y, x, l->down_weight_bf16, seq_len, intermediate, dim);
+}
+
 /* ========================================================================
  * KV Cache Management
  * ======================================================================== */
@@ -255,6 +461,84 @@ static int ensure_rope_cache(qwen_ctx_t *ctx, int required_pos, int head_dim, fl
     return 0;
 }
 
+int qwen_decoder_kv_reserve(qwen_ctx_t *ctx, int n_pos) {
+    if (!ctx->kv_cache_k) return kv_cache_init(ctx, n_pos + 1024);
+    return kv_cache_grow(ctx, n_pos);
+}
+
+/* Shrink a buffer to count floats. A failed shrink keeps the larger block,
+ * which still covers the new capacity. */
+static float *shrink_buf(float *p, size_t count) {
+    float *tmp = (float *)realloc(p, count * sizeof(float));
+    return tmp ? tmp : p;
+}
+
+/* Buffers above max_tokens are shrunk in place to exactly max_tokens
+ * positions, so the next job starts from the baseline instead of
+ * regrowing from zero. max_tokens = 0 frees them. */
+void qwen_decoder_trim(qwen_ctx_t *ctx, int max_tokens) {
+    const qwen_config_t *cfg = &ctx->config;
+    int dim = cfg->dec_hidden;
+    int head_dim = cfg->dec_head_dim;
+    int q_dim = cfg->dec_heads * head_dim;
+    int kv_dim = cfg->dec_kv_heads * head_dim;
+    int intermediate = cfg->dec_intermediate;
+    size_t n = (size_t)(max_tokens > 0 ? max_tokens : 0);
+
+    ctx->kv_cache_len = 0;
+    if (ctx->kv_cache_max > max_tokens) {
+        if (n == 0) {
+            free(ctx->kv_cache_k); ctx->kv_cache_k = NULL;
+            free(ctx->kv_cache_v); ctx->kv_cache_v = NULL;
+        } else {
+            /* Contents are discarded, so the per-layer stride can change */
+            size_t total = (size_t)cfg->dec_layers * n * kv_dim;
+            ctx->kv_cache_k = shrink_buf(ctx->kv_cache_k, total);
+            ctx->kv_cache_v = shrink_buf(ctx->kv_cache_v, total);
+        }
+        ctx->kv_cache_max = (int)n;
+    }
+
+    if (ctx->pref_seq_cap > max_tokens) {
+        if (n == 0) {
+            free(ctx->pref_x); ctx->pref_x = NULL;
+            free(ctx->pref_x_norm); ctx->pref_x_norm = NULL;
+            free(ctx->pref_q); ctx->pref_q = NULL;
+            free(ctx->pref_k); ctx->pref_k = NULL;
+            free(ctx->pref_v); ctx->pref_v = NULL;
+            free(ctx->pref_attn_out); ctx->pref_attn_out = NULL;
+            free(ctx->pref_proj_out); ctx->pref_proj_out = NULL;
+            free(ctx->pref_ffn_out); ctx->pref_ffn_out = NULL;
+            free(ctx->pref_gate); ctx->pref_gate = NULL;
+            free(ctx->pref_gate_up); ctx->pref_gate_up = NULL;
+        } else {
+            ctx->pref_x = shrink_buf(ctx->pref_x, n * dim);
+            ctx->pref_x_norm = shrink_buf(ctx->pref_x_norm, n * dim);
+            ctx->pref_q = shrink_buf(ctx->pref_q, n * q_dim);
+            ctx->pref_k = shrink_buf(ctx->pref_k, n * kv_dim);
+            ctx->pref_v = shrink_buf(ctx->pref_v, n * kv_dim);
+            ctx->pref_attn_out = shrink_buf(ctx->pref_attn_out, n * q_dim);
+            ctx->pref_proj_out = shrink_buf(ctx->pref_proj_out, n * dim);
+            ctx->pref_ffn_out = shrink_buf(ctx->pref_ffn_out, n * dim);
+            ctx->pref_gate = shrink_buf(ctx->pref_gate, n * intermediate);
+            ctx->pref_gate_up = shrink_buf(ctx->pref_gate_up, n * 2 * intermediate);
+        }
+        ctx->pref_seq_cap = (int)n;
+    }
+
+    /* The first max_tokens rows are already filled in and stay valid */
+    if (ctx->rope_cache_cap > max_tokens) {
+        if (n == 0) {
+            free(ctx->rope_cache_cos); ctx->rope_cache_cos = NULL;
+            free(ctx->rope_cache_sin); ctx->rope_cache_sin = NULL;
+        } else {
+            ctx->rope_cache_cos = shrink_buf(ctx->rope_cache_cos, n * head_dim);
+            ctx->rope_cache_sin = shrink_buf(ctx->rope_cache_sin, n * head_dim);
+        }
+        ctx->rope_cache_cap = (int)n;
+    }
+}
+
 /* ========================================================================
  * Decoder Prefill (Multiple Tokens)
  * ======================================================================== */
@@ -309,14 +593,15 @@ void qwen_decoder_prefill(qwen_ctx_t *ctx, const float *input_embeds, int seq_le
 
     for (int layer = 0; layer < n_layers; layer++) {
         qwen_dec_layer_t *l = &dec->layers[layer];
+        qwen_sched_yield();
 
         /* Input RMSNorm */
         qwen_rms_norm(x_norm, x, l->input_norm, seq_len, dim, eps);
 
         /* QKV projections (no bias) */
-        qwen_linear_nobias_bf16(q, x_norm, l->wq_weight_bf16, seq_len, dim, q_dim);
-        qwen_linear_nobias_bf16(k, x_norm, l->wk_weight_bf16, seq_len, dim, kv_dim);
-        qwen_linear_nobias_bf16(v, x_norm, l->wv_weight_bf16, seq_len, dim, kv_dim);
+        linear_w16(dec, q, x_norm, l->wq_weight_bf16, seq_len, dim, q_dim);
+        linear_w16(dec, k, x_norm, l->wk_weight_bf16, seq_len, dim, kv_dim);
+        linear_w16(dec, v, x_norm, l->wv_weight_bf16, seq_len, dim, kv_dim);
 
         /* Per-head Q/K RMSNorm */
         qwen_rms_norm_per_head(q, l->q_norm_weight, seq_len, n_heads, head_dim, eps);
@@ -343,19 +628,16 @@ void qwen_decoder_prefill(qwen_ctx_t *ctx, const float *input_embeds, int seq_le
                                head_dim, scale, start_pos);
 
         /* Output projection + residual */
-        qwen_linear_nobias_bf16(proj_out, attn_out, l->wo_weight_bf16,
-                                 seq_len, q_dim, dim);
+        linear_w16(dec, proj_out, attn_out, l->wo_weight_bf16, seq_len, q_dim, dim);
         qwen_add_inplace(x, proj_out, seq_len * dim);
 
         /* Post-attention RMSNorm */
         qwen_rms_norm(x_norm, x, l->post_attn_norm, seq_len, dim, eps);
 
         /* SwiGLU MLP */
-        qwen_linear_nobias_bf16(gate_up, x_norm, l->gate_up_fused_bf16,
-                                 seq_len, dim, 2 * intermediate);
+        mlp_gate_up(dec, gate_up, x_norm, l, seq_len, dim, intermediate);
         qwen_swiglu_multiply(gate, gate_up, seq_len, intermediate);
-        qwen_linear_nobias_bf16(ffn_out, gate, l->down_weight_bf16,
-                                 seq_len, intermediate, dim);
+        mlp_down(dec, ffn_out, gate, l, seq_len, dim, intermediate);
 
         qwen_add_inplace(x, ffn_out, seq_len * dim);
 
@@ -441,11 +723,16 @@ int qwen_decoder_forward(qwen_ctx_t *ctx, const float *input_embed) {
         qwen_dec_layer_t *l = &dec->layers[layer];
 
         qwen_rms_norm(x_norm, x, l->input_norm, 1, dim, eps);
-        qwen_linear_nobias_bf16_qkv(q, k, v, x_norm,
-                                    l->wq_weight_bf16,
-                                    l->wk_weight_bf16,
-                                    l->wv_weight_bf16,
-                                    dim, q_dim, kv_dim);
+        if (dec->f16)
+            qwen_linear_nobias_f16_qkv(q, k, v, x_norm, l->wq_weight_bf16,
+                                       l->wk_weight_bf16, l->wv_weight_bf16,
+                                       dim, q_dim, kv_dim);
+        else
+            qwen_linear_nobias_bf16_qkv(q, k, v, x_norm,
+                                        l->wq_weight_bf16,
+                                        l->wk_weight_bf16,
+                                        l->wv_weight_bf16,
+                                        dim, q_dim, kv_dim);
 
         /* Per-head Q/K RMSNorm */
         qwen_rms_norm_per_head(q, l->q_norm_weight, 1, n_heads, head_dim, eps);
@@ -466,23 +753,28 @@ int qwen_decoder_forward(qwen_ctx_t *ctx, const float *input_embed) {
                                1, total_seq, n_heads, n_kv_heads,
                                head_dim, scale, pos);
 
-        qwen_linear_nobias_bf16(proj_out, attn_out, l->wo_weight_bf16, 1, q_dim, dim);
+        linear_w16(dec, proj_out, attn_out, l->wo_weight_bf16, 1, q_dim, dim);
         qwen_add_inplace(x, proj_out, dim);
 
         qwen_rms_norm(x_norm, x, l->post_attn_norm, 1, dim, eps);
 
         /* Fused gate+up matvec: one pass over x_norm, output interleaved [g0,u0,g1,u1,...] */
-        qwen_linear_nobias_bf16(gate_buf, x_norm, l->gate_up_fused_bf16,
-                                 1, dim, 2 * intermediate);
+        mlp_gate_up(dec, gate_buf, x_norm, l, 1, dim, intermediate);
         /* In-place for seq=1: gate_buf[0:inter] receives SwiGLU output. */
         qwen_swiglu_multiply(gate_buf, gate_buf, 1, intermediate);
-        qwen_linear_nobias_bf16(ffn_out, gate_buf, l->down_weight_bf16, 1, intermediate, dim);
+        mlp_down(dec, ffn_out, gate_buf, l, 1, dim, intermediate);
         qwen_add_inplace(x, ffn_out, dim);
     }
 
     ctx->kv_cache_len = pos + 1;
 
     /* Final norm + streaming argmax (no logits buffer needed) */
+    qwen_perf_sample_t ps;
+    qwen_phase_begin(&ps);
     qwen_rms_norm(x, x, dec->norm, 1, dim, eps);
-    return qwen_argmax_matvec_bf16(x, dec->tok_embeddings_bf16, dim, cfg->vocab_size);
+    int token = dec->f16
+        ? qwen_argmax_matvec_f16(x, dec->tok_embeddings_bf16, dim, cfg->vocab_size)
+        : qwen_argmax_matvec_bf16(x, dec->tok_embeddings_bf16, dim, cfg->vocab_size);
+    qwen_phase_end(&ctx->perf_phase[QWEN_PHASE_ARGMAX], &ps);
+    return token;
 }
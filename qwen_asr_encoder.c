@@ -39,7 +39,10 @@ static float *load_f32(multi_safetensors_t *ms, const char *name) {
 
 /* Load bf16 weight and convert to f32 at load time.
  * Encoder always processes batches, so pre-converting avoids
- * repeated scratch-buffer conversion during forward pass. */
+ * repeated scratch-buffer conversion during forward pass.
+ * The conversion runs on the thread pool, which also spreads the
+ * page faults on the mmapped source across cores. fp16 checkpoints
+ * take the same path. */
 static float *load_bf16_as_f32(multi_safetensors_t *ms, const char *name) {
     safetensors_file_t *sf = NULL;
     const safetensor_t *t = multi_safetensors_find(ms, name, &sf);
@@ -47,8 +50,9 @@ static float *load_bf16_as_f32(multi_safetensors_t *ms, const char *name) {
         fprintf(stderr, "encoder: weight not found: %s\n", name);
         return NULL;
     }
-    uint16_t *bf16 = safetensors_get_bf16_direct(sf, t);
-    if (!bf16) return NULL;
+    uint16_t *f16 = safetensors_get_f16_direct(sf, t);
+    uint16_t *bf16 = f16 ? NULL : safetensors_get_bf16_direct(sf, t);
+    if (!f16 && !bf16) return NULL;
 
     /* Compute number of elements from tensor shape */
     size_t n = 1;
@@ -57,10 +61,8 @@ static float *load_bf16_as_f32(multi_safetensors_t *ms, const char *name) {
     float *f32 = (float *)malloc(n * sizeof(float));
     if (!f32) return NULL;
 
-    uint32_t *d = (uint32_t *)(void *)f32;
-    for (size_t i = 0; i < n; i++)
-        d[i] = ((uint32_t)bf16[i]) << 16;
-
+    if (f16) qwen_f16_to_f32(f32, f16, n);
+    else qwen_bf16_to_f32(f32, bf16, n);
     return f32;
 }
 
@@ -164,6 +166,71 @@ int qwen_encoder_load(qwen_encoder_t *enc, multi_safetensors_t *ms,
     return 0;
 }
 
+/* ========================================================================
+ * Int8 Weights (optional, see qwen_set_encoder_int8)
+ * ======================================================================== */
+
+typedef struct {
+    qwen_q8_weight_t conv_out, proj1, proj2;
+    struct {
+        qwen_q8_weight_t wq, wk, wv, wo, fc1, fc2;
+    } layers[QWEN_MAX_ENC_LAYERS];
+} enc_q8_t;
+
+void qwen_encoder_free_int8(qwen_encoder_t *enc, const qwen_config_t *cfg) {
+    enc_q8_t *q8 = (enc_q8_t *)enc->q8;
+    if (!q8) return;
+    qwen_q8_free(&q8->conv_out);
+    qwen_q8_free(&q8->proj1);
+    qwen_q8_free(&q8->proj2);
+    for (int i = 0; i < cfg->enc_layers; i++) {
+        qwen_q8_free(&q8->layers[i].wq);
+        qwen_q8_free(&q8->layers[i].wk);
+        qwen_q8_free(&q8->layers[i].wv);
+        qwen_q8_free(&q8->layers[i].wo);
+        qwen_q8_free(&q8->layers[i].fc1);
+        qwen_q8_free(&q8->layers[i].fc2);
+    }
+    free(q8);
+    enc->q8 = NULL;
+}
+
+int qwen_encoder_quantize_int8(qwen_encoder_t *enc, const qwen_config_t *cfg) {
+    enc_q8_t *q8 = (enc_q8_t *)calloc(1, sizeof(enc_q8_t));
+    if (!q8) return -1;
+    enc->q8 = q8;
+
+    int d = cfg->enc_d_model;
+    int ffn = cfg->enc_ffn_dim;
+    int rc = 0;
+    rc |= qwen_q8_quantize(&q8->conv_out, enc->conv_out_weight, d, cfg->enc_conv_proj_dim);
+    for (int i = 0; i < cfg->enc_layers; i++) {
+        qwen_enc_layer_t *l = &enc->layers[i];
+        rc |= qwen_q8_quantize(&q8->layers[i].wq, l->wq_weight, d, d);
+        rc |= qwen_q8_quantize(&q8->layers[i].wk, l->wk_weight, d, d);
+        rc |= qwen_q8_quantize(&q8->layers[i].wv, l->wv_weight, d, d);
+        rc |= qwen_q8_quantize(&q8->layers[i].wo, l->wo_weight, d, d);
+        rc |= qwen_q8_quantize(&q8->layers[i].fc1, l->fc1_weight, ffn, d);
+        rc |= qwen_q8_quantize(&q8->layers[i].fc2, l->fc2_weight, d, ffn);
+        if (rc) break;
+    }
+    if (!rc) rc |= qwen_q8_quantize(&q8->proj1, enc->proj1_weight, d, d);
+    if (!rc) rc |= qwen_q8_quantize(&q8->proj2, enc->proj2_weight, cfg->enc_output_dim, d);
+    if (rc) {
+        qwen_encoder_free_int8(enc, cfg);
+        return -1;
+    }
+    return 0;
+}
+
+/* y = x @ W^T + b, through the int8 copy of W when it is in use */
+static void enc_linear(float *y, const float *x, const float *W,
+                       const qwen_q8_weight_t *Wq, const float *b,
+                       int seq_len, int in_dim, int out_dim) {
+    if (Wq) qwen_linear_q8(y, x, Wq, b, seq_len);
+    else qwen_linear(y, x, W, b, seq_len, in_dim, out_dim);
+}
+
 /* ========================================================================
  * Forward Pass
  * ======================================================================== */
@@ -180,6 +247,7 @@ float *qwen_encoder_forward(qwen_ctx_t *ctx, const float *mel, int mel_frames,
     int output_dim = cfg->enc_output_dim;
     int chunk_size = cfg->enc_chunk_size;          /* 100 */
     int n_window_infer = cfg->enc_n_window_infer;  /* 800 */
+    enc_q8_t *q8 = ctx->enc_int8 ? (enc_q8_t *)enc->q8 : NULL;
 
 
     /* ---- Per-chunk Conv2D stem ---- */
@@ -279,8 +347,8 @@ float *qwen_encoder_forward(qwen_ctx_t *ctx, const float *mel, int mel_frames,
 
         /* Project: [w3, 7680] -> [w3, d_model] (no bias) */
         float *projected = x + (size_t)token_offset * d_model;
-        qwen_linear_nobias(projected, reshaped, enc->conv_out_weight,
-                            w3, conv_proj_dim, d_model);
+        enc_linear(projected, reshaped, enc->conv_out_weight,
+                   q8 ? &q8->conv_out : NULL, NULL, w3, conv_proj_dim, d_model);
         free(reshaped);
 
         /* Add per-chunk sinusoidal position embeddings (starting from pos 0) */
@@ -317,25 +385,26 @@ float *qwen_encoder_forward(qwen_ctx_t *ctx, const float *mel, int mel_frames,
 
     for (int layer = 0; layer < cfg->enc_layers; layer++) {
         qwen_enc_layer_t *l = &enc->layers[layer];
+        qwen_sched_yield();
 
         /* ---- Self-attention ---- */
         qwen_layer_norm(x_norm, x, l->attn_norm_weight, l->attn_norm_bias,
                         total_tokens, d_model, 1e-5f);
 
-        qwen_linear(q, x_norm, l->wq_weight, l->wq_bias,
-                     total_tokens, d_model, d_model);
-        qwen_linear(k, x_norm, l->wk_weight, l->wk_bias,
-                     total_tokens, d_model, d_model);
-        qwen_linear(v, x_norm, l->wv_weight, l->wv_bias,
-                     total_tokens, d_model, d_model);
+        enc_linear(q, x_norm, l->wq_weight, q8 ? &q8->layers[layer].wq : NULL,
+                   l->wq_bias, total_tokens, d_model, d_model);
+        enc_linear(k, x_norm, l->wk_weight, q8 ? &q8->layers[layer].wk : NULL,
+                   l->wk_bias, total_tokens, d_model, d_model);
+        enc_linear(v, x_norm, l->wv_weight, q8 ? &q8->layers[layer].wv : NULL,
+                   l->wv_bias, total_tokens, d_model, d_model);
 
         qwen_bidirectional_attention(attn_out, q, k, v,
                                       total_tokens, n_heads, head_dim, scale,
                                       window_starts, n_windows);
 
         /* Output projection + residual */
-        qwen_linear(proj_out, attn_out, l->wo_weight, l->wo_bias,
-                     total_tokens, d_model, d_model);
+        enc_linear(proj_out, attn_out, l->wo_weight, q8 ? &q8->layers[layer].wo : NULL,
+                   l->wo_bias, total_tokens, d_model, d_model);
         qwen_add_inplace(x, proj_out, total_tokens * d_model);
 
         /* ---- FFN ---- */
@@ -343,11 +412,11 @@ float *qwen_encoder_forward(qwen_ctx_t *ctx, const float *mel, int mel_frames,
                         total_tokens, d_model, 1e-5f);
 
         /* GELU FFN: fc1 -> GELU -> fc2 */
-        qwen_linear(ffn_mid, x_norm, l->fc1_weight, l->fc1_bias,
-                     total_tokens, d_model, ffn_dim);
+        enc_linear(ffn_mid, x_norm, l->fc1_weight, q8 ? &q8->layers[layer].fc1 : NULL,
+                   l->fc1_bias, total_tokens, d_model, ffn_dim);
         qwen_gelu(ffn_mid, total_tokens * ffn_dim);
-        qwen_linear(ffn_out, ffn_mid, l->fc2_weight, l->fc2_bias,
-                     total_tokens, ffn_dim, d_model);
+        enc_linear(ffn_out, ffn_mid, l->fc2_weight, q8 ? &q8->layers[layer].fc2 : NULL,
+                   l->fc2_bias, total_tokens, ffn_dim, d_model);
         qwen_add_inplace(x, ffn_out, total_tokens * d_model);
 
     }
@@ -358,13 +427,13 @@ float *qwen_encoder_forward(qwen_ctx_t *ctx, const float *mel, int mel_frames,
 
     /* Projection: proj1 (GELU) -> proj2 */
     float *proj_mid = (float *)malloc(total_tokens * d_model * sizeof(float));
-    qwen_linear(proj_mid, x, enc->proj1_weight, enc->proj1_bias,
-                 total_tokens, d_model, d_model);
+    enc_linear(proj_mid, x, enc->proj1_weight, q8 ? &q8->proj1 : NULL,
+               enc->proj1_bias, total_tokens, d_model, d_model);
     qwen_gelu(proj_mid, total_tokens * d_model);
 
     float *enc_output = (float *)malloc(total_tokens * output_dim * sizeof(float));
-    qwen_linear(enc_output, proj_mid, enc->proj2_weight, enc->proj2_bias,
-                 total_tokens, d_model, output_dim);
+    enc_linear(enc_output, proj_mid, enc->proj2_weight, q8 ? &q8->proj2 : NULL,
+               enc->proj2_bias, total_tokens, d_model, output_dim);
     free(proj_mid);
 
     /* Clean up */
@@ -5,6 +5,7 @@
 
 #include "qwen_asr_kernels.h"
 #include "qwen_asr_kernels_impl.h"
+#include "qwen_asr_topology.h"
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
@@ -16,14 +17,6 @@
 #if defined(__ARM_NEON)
 #include <arm_neon.h>
 #endif
-#ifdef __APPLE__
-#include <sys/sysctl.h>
-#elif defined(_WIN32) || defined(_WIN64)
-#include <windows.h>
-#else
-#include <unistd.h>
-#endif
-
 #ifdef USE_BLAS
 #ifdef __APPLE__
 #include <Accelerate/Accelerate.h>
@@ -40,125 +33,327 @@
  * Thread Pool
  * ======================================================================== */
 
-#define QWEN_MAX_THREADS 16
+typedef qwen_parallel_fn_t parallel_fn_t;
 
-typedef void (*parallel_fn_t)(int tid, int n_threads, void *arg);
+/* One parallel_for() dispatch. Workers are claimed per dispatch, so
+ * independent callers (e.g. the streaming encoder stage and the decoder)
+ * can run concurrently on disjoint subsets of the pool. */
+typedef struct {
+    parallel_fn_t fn;
+    void *arg;
+    int n_threads;
+    int n_pending;
+} pool_job_t;
 
+/* Workers are created on demand and never joined: shrinking the pool only
+ * parks the workers past n_threads - 1 (dispatch skips them and they sleep
+ * on their own condition variable), growing it unparks them first. */
 static struct {
     pthread_t threads[QWEN_MAX_THREADS - 1];
     int tids[QWEN_MAX_THREADS - 1];
-    int n_threads;
-    int shutdown;
-
-    parallel_fn_t fn;
-    void *arg;
-    int generation;
+    pool_job_t *job[QWEN_MAX_THREADS - 1];   /* assigned dispatch, NULL = idle */
+    int job_tid[QWEN_MAX_THREADS - 1];
+    pthread_cond_t cond_work[QWEN_MAX_THREADS - 1];
+    int n_threads;                           /* active, including the caller */
+    int n_spawned;                           /* workers created so far */
 
     pthread_mutex_t mutex;
-    pthread_cond_t cond_work;
     pthread_cond_t cond_done;
-    int n_done;
 } tp = {
     .n_threads = 1,
-    .shutdown = 0,
-    .generation = 0,
     .mutex = PTHREAD_MUTEX_INITIALIZER,
-    .cond_work = PTHREAD_COND_INITIALIZER,
     .cond_done = PTHREAD_COND_INITIALIZER,
 };
 
+/* Per-thread cap on dispatch width (0 = whole pool) */
+static __thread int tp_budget = 0;
+/* Threads the scheduler granted the calling thread's job (0 = no job) */
+static __thread int tp_grant = 0;
+
+/* Runtime kernel tuning (0 = built-in default; see qwen_kernel_tuning_t) */
+static int tp_decode_threads = 0;
+static int tp_attn_min_seq_k = 0;
+static int tp_gemm_panel_kb = 0;
+
 static void *worker_loop(void *arg) {
-    int tid = *(int *)arg;
-    int my_gen = 0;
+    int w = *(int *)arg - 1;
 
+    pthread_mutex_lock(&tp.mutex);
     for (;;) {
-        pthread_mutex_lock(&tp.mutex);
-        while (tp.generation == my_gen && !tp.shutdown)
-            pthread_cond_wait(&tp.cond_work, &tp.mutex);
-        if (tp.shutdown) {
-            pthread_mutex_unlock(&tp.mutex);
-            return NULL;
-        }
-        my_gen = tp.generation;
-        parallel_fn_t fn = tp.fn;
-        void *a = tp.arg;
-        int nt = tp.n_threads;
+        while (!tp.job[w])
+            pthread_cond_wait(&tp.cond_work[w], &tp.mutex);
+        pool_job_t *job = tp.job[w];
+        int tid = tp.job_tid[w];
         pthread_mutex_unlock(&tp.mutex);
 
-        fn(tid, nt, a);
+        job->fn(tid, job->n_threads, job->arg);
 
         pthread_mutex_lock(&tp.mutex);
-        if (++tp.n_done >= tp.n_threads - 1)
-            pthread_cond_signal(&tp.cond_done);
-        pthread_mutex_unlock(&tp.mutex);
+        tp.job[w] = NULL;
+        if (--job->n_pending == 0)
+            pthread_cond_broadcast(&tp.cond_done);
     }
+    return NULL;
 }
 
+static void sched_pool_resized(void);
+static void pool_atfork_register(void);
+static pthread_once_t pool_atfork_once = PTHREAD_ONCE_INIT;
+
 void qwen_set_threads(int n) {
     if (n < 1) n = 1;
     if (n > QWEN_MAX_THREADS) n = QWEN_MAX_THREADS;
+    pthread_once(&pool_atfork_once, pool_atfork_register);
 
-    /* Shutdown existing workers */
-    if (tp.n_threads > 1) {
-        pthread_mutex_lock(&tp.mutex);
-        tp.shutdown = 1;
-        pthread_cond_broadcast(&tp.cond_work);
-        pthread_mutex_unlock(&tp.mutex);
-        for (int i = 0; i < tp.n_threads - 1; i++)
-            pthread_join(tp.threads[i], NULL);
-        tp.shutdown = 0;
-        tp.generation = 0;
+    pthread_mutex_lock(&tp.mutex);
+    while (tp.n_spawned < n - 1) {
+        int i = tp.n_spawned;
+        tp.tids[i] = i + 1;
+        tp.job[i] = NULL;
+        pthread_cond_init(&tp.cond_work[i], NULL);
+        if (pthread_create(&tp.threads[i], NULL, worker_loop, &tp.tids[i]) != 0) {
+            pthread_cond_destroy(&tp.cond_work[i]);
+            break;
+        }
+        tp.n_spawned++;
     }
+    if (n > tp.n_spawned + 1) n = tp.n_spawned + 1;
+    int prev = tp.n_threads;
+    __atomic_store_n(&tp.n_threads, n, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&tp.mutex);
 
-    tp.n_threads = n;
-    if (n <= 1) return;
+    /* Jobs waiting for threads may fit now */
+    sched_pool_resized();
 
-    for (int i = 0; i < n - 1; i++) {
-        tp.tids[i] = i + 1;
-        pthread_create(&tp.threads[i], NULL, worker_loop, &tp.tids[i]);
+    if (qwen_verbose >= 2 && n != prev) {
+        const qwen_topology_t *topo = qwen_get_topology();
+        fprintf(stderr, "Thread pool: %d threads\n", n);
+        fprintf(stderr, "CPU topology: %d online, %d in affinity mask, quota %.2f, "
+                "%d usable, %d cores; L1d %zuK L2 %zuK L3 %zuK\n",
+                topo->n_online, topo->n_affinity, topo->cpu_quota,
+                topo->n_usable, topo->n_cores,
+                topo->l1d_bytes >> 10, topo->l2_bytes >> 10, topo->l3_bytes >> 10);
     }
+}
 
-    if (qwen_verbose >= 2)
-        fprintf(stderr, "Thread pool: %d threads\n", n);
+int qwen_get_threads(void) {
+    return __atomic_load_n(&tp.n_threads, __ATOMIC_RELAXED);
+}
+
+int qwen_set_thread_budget(int n) {
+    int prev = tp_budget;
+    tp_budget = n > 0 ? n : 0;
+    return prev;
+}
+
+/* Dispatch width the calling thread may use */
+static int pool_width(void) {
+    int n = qwen_get_threads();
+    if (tp_budget > 0 && tp_budget < n) n = tp_budget;
+    if (tp_grant > 0 && tp_grant < n) n = tp_grant;
+    return n;
+}
+
+int qwen_get_thread_budget(void) {
+    return pool_width();
+}
+
+/* Dispatch width for single-token matvecs: SMT siblings share the load
+ * ports and memory path a bf16 matvec saturates, so they add nothing. */
+static int decode_width(void) {
+    int n = pool_width();
+    int cap = tp_decode_threads > 0 ? tp_decode_threads : qwen_get_num_cores();
+    return cap < n ? cap : n;
+}
+
+void qwen_set_decode_threads(int n) {
+    tp_decode_threads = n > 0 ? n : 0;
+}
+
+void qwen_get_kernel_tuning(qwen_kernel_tuning_t *t) {
+    t->decode_threads = tp_decode_threads;
+    t->attn_min_seq_k = tp_attn_min_seq_k;
+    t->gemm_panel_kb = tp_gemm_panel_kb;
+}
+
+void qwen_set_kernel_tuning(const qwen_kernel_tuning_t *t) {
+    tp_decode_threads = t->decode_threads > 0 ? t->decode_threads : 0;
+    tp_attn_min_seq_k = t->attn_min_seq_k > 0 ? t->attn_min_seq_k : 0;
+    tp_gemm_panel_kb = t->gemm_panel_kb > 0 ? t->gemm_panel_kb : 0;
 }
 
 int qwen_get_num_cpus(void) {
-#ifdef __APPLE__
-    int n = 0;
-    size_t len = sizeof(n);
-    sysctlbyname("hw.ncpu", &n, &len, NULL, 0);
-    return n > 0 ? n : 1;
-#elif defined(_WIN32) || defined(_WIN64)
-    SYSTEM_INFO sysinfo;
-    GetSystemInfo(&sysinfo);
-    return sysinfo.dwNumberOfProcessors > 0 ? sysinfo.dwNumberOfProcessors : 1;
-#else
-    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
-    return n > 0 ? n : 1;
-#endif
+    return qwen_get_topology()->n_usable;
 }
 
-/* Dispatch work to all threads; main thread is tid=0 */
-static void parallel_for(parallel_fn_t fn, void *arg) {
-    if (tp.n_threads <= 1) {
+int qwen_get_num_cores(void) {
+    return qwen_get_topology()->n_cores;
+}
+
+/* ========================================================================
+ * Job Scheduler
+ *
+ * Priority-aware shares of the thread pool. A job is granted the threads it
+ * asks for (the whole pool by default) once they are free, so jobs with
+ * small budgets run side by side while whole-pool jobs run one at a time.
+ * Interactive waiters are always served before batch waiters, and a batch
+ * owner gives its threads up at its next yield point when an interactive
+ * job is waiting, so interactive latency is bounded by one decode step /
+ * encoder layer.
+ * ======================================================================== */
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int in_use;                      /* threads granted to running jobs */
+    int n_interactive_waiting;
+} sched = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static __thread int sched_depth = 0;
+static __thread int sched_priority = 0;
+static __thread int sched_want = 0;      /* requested threads, 0 = whole pool */
+static __thread int sched_request = 0;   /* n_threads as passed to acquire */
+
+static void sched_lock_pool(int priority) {
+    pthread_mutex_lock(&sched.mutex);
+    int n;
+    if (priority == 0) sched.n_interactive_waiting++;
+    for (;;) {
+        int pool = qwen_get_threads();
+        n = sched_want > 0 && sched_want < pool ? sched_want : pool;
+        /* A pool shrunk under running jobs can leave in_use above it */
+        if (sched.in_use + n <= pool && (priority == 0 || sched.n_interactive_waiting == 0))
+            break;
+        pthread_cond_wait(&sched.cond, &sched.mutex);
+    }
+    if (priority == 0) sched.n_interactive_waiting--;
+    sched.in_use += n;
+    pthread_mutex_unlock(&sched.mutex);
+    tp_grant = n;
+}
+
+static void sched_unlock_pool(void) {
+    pthread_mutex_lock(&sched.mutex);
+    sched.in_use -= tp_grant;
+    pthread_cond_broadcast(&sched.cond);
+    pthread_mutex_unlock(&sched.mutex);
+    tp_grant = 0;
+}
+
+static void sched_pool_resized(void) {
+    pthread_mutex_lock(&sched.mutex);
+    pthread_cond_broadcast(&sched.cond);
+    pthread_mutex_unlock(&sched.mutex);
+}
+
+/* fork() copies the pool bookkeeping but only the forking thread: the child
+ * starts with an empty pool (its first qwen_set_threads() spawns workers)
+ * and a scheduler where only the forking thread's grant, if any, is held. */
+static void pool_atfork_child(void) {
+    for (int i = 0; i < tp.n_spawned; i++) {
+        tp.job[i] = NULL;
+        pthread_cond_init(&tp.cond_work[i], NULL);
+    }
+    tp.n_spawned = 0;
+    tp.n_threads = 1;
+    pthread_mutex_init(&tp.mutex, NULL);
+    pthread_cond_init(&tp.cond_done, NULL);
+
+    sched.in_use = tp_grant;
+    sched.n_interactive_waiting = 0;
+    pthread_mutex_init(&sched.mutex, NULL);
+    pthread_cond_init(&sched.cond, NULL);
+}
+
+static void pool_atfork_register(void) {
+    pthread_atfork(NULL, NULL, pool_atfork_child);
+}
+
+void qwen_sched_acquire(int priority, int n_threads) {
+    if (sched_depth++ > 0) return;
+    sched_priority = priority > 0 ? 1 : 0;
+    sched_request = n_threads;
+    /* The calling thread's budget also caps the request */
+    sched_want = n_threads > 0 ? n_threads : 0;
+    if (tp_budget > 0 && (sched_want == 0 || tp_budget < sched_want))
+        sched_want = tp_budget;
+    sched_lock_pool(sched_priority);
+}
+
+void qwen_sched_release(void) {
+    if (sched_depth <= 0) return;
+    if (--sched_depth > 0) return;
+    sched_unlock_pool();
+}
+
+int qwen_sched_suspend(void) {
+    int depth = sched_depth;
+    if (depth <= 0) return 0;
+    sched_depth = 0;
+    sched_unlock_pool();
+    return depth;
+}
+
+void qwen_sched_resume(int depth) {
+    if (depth <= 0) return;
+    qwen_sched_acquire(sched_priority, sched_request);
+    sched_depth = depth;
+}
+
+void qwen_sched_yield(void) {
+    if (sched_depth <= 0 || sched_priority == 0) return;
+    if (__atomic_load_n(&sched.n_interactive_waiting, __ATOMIC_RELAXED) == 0) return;
+    sched_unlock_pool();
+    sched_lock_pool(1);
+}
+
+/* Dispatch work to up to `want` idle pool threads; the calling thread is
+ * tid=0. Returns the number of threads used. */
+static int parallel_for_n(parallel_fn_t fn, void *arg, int want) {
+    if (want <= 1) {
         fn(0, 1, arg);
-        return;
+        return 1;
     }
 
+    pool_job_t job = { .fn = fn, .arg = arg };
+    int w_ids[QWEN_MAX_THREADS - 1];
+    int nt = 1;
+
     pthread_mutex_lock(&tp.mutex);
-    tp.fn = fn;
-    tp.arg = arg;
-    tp.n_done = 0;
-    tp.generation++;
-    pthread_cond_broadcast(&tp.cond_work);
+    for (int i = 0; i < tp.n_threads - 1 && nt < want; i++) {
+        if (tp.job[i]) continue;
+        tp.job[i] = &job;
+        tp.job_tid[i] = nt;
+        w_ids[nt - 1] = i;
+        nt++;
+    }
+    job.n_threads = nt;
+    job.n_pending = nt - 1;
+    for (int i = 0; i < nt - 1; i++)
+        pthread_cond_signal(&tp.cond_work[w_ids[i]]);
     pthread_mutex_unlock(&tp.mutex);
 
-    fn(0, tp.n_threads, arg);
+    fn(0, nt, arg);
 
-    pthread_mutex_lock(&tp.mutex);
-    while (tp.n_done < tp.n_threads - 1)
-        pthread_cond_wait(&tp.cond_done, &tp.mutex);
-    pthread_mutex_unlock(&tp.mutex);
+    if (nt > 1) {
+        pthread_mutex_lock(&tp.mutex);
+        while (job.n_pending > 0)
+            pthread_cond_wait(&tp.cond_done, &tp.mutex);
+        pthread_mutex_unlock(&tp.mutex);
+    }
+    return nt;
+}
+
+/* Dispatch up to the caller's budget */
+static int parallel_for(parallel_fn_t fn, void *arg) {
+    return parallel_for_n(fn, arg, pool_width());
+}
+
+int qwen_parallel_for(qwen_parallel_fn_t fn, void *arg) {
+    return parallel_for(fn, arg);
 }
 
 /* ========================================================================
@@ -339,6 +534,16 @@ static void bf16_to_f32_buf(float *dst, const uint16_t *src, size_t n) {
     uint32_t *d = (uint32_t *)(void *)dst;
     for (; i < n; i++)
         d[i] = ((uint32_t)src[i]) << 16;
+#elif defined(__ARM_NEON)
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t raw = vld1q_u16(src + i);
+        vst1q_f32(dst + i, vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(raw), 16)));
+        vst1q_f32(dst + i + 4, vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(raw), 16)));
+    }
+    uint32_t *d = (uint32_t *)(void *)dst;
+    for (; i < n; i++)
+        d[i] = ((uint32_t)src[i]) << 16;
 #else
     uint32_t *d = (uint32_t *)(void *)dst;
     for (size_t i = 0; i < n; i++)
@@ -346,17 +551,91 @@ static void bf16_to_f32_buf(float *dst, const uint16_t *src, size_t n) {
 #endif
 }
 
-/* Reusable scratch buffer for bf16->f32 conversion */
-static float *bf16_scratch = NULL;
-static size_t bf16_scratch_cap = 0;
+/* Convert a bf16 (f16 = 0) or IEEE fp16 (f16 = 1) buffer to f32 */
+static void w16_to_f32_buf(float *dst, const uint16_t *src, size_t n, int f16) {
+    if (f16) qwen_f16_to_f32_buf_impl(dst, src, n);
+    else bf16_to_f32_buf(dst, src, n);
+}
+
+typedef struct {
+    float *dst;
+    const uint16_t *src;
+    size_t n;
+    int f16;
+} bf16_convert_task_t;
+
+static void bf16_convert_worker(int tid, int n_threads, void *arg) {
+    bf16_convert_task_t *t = (bf16_convert_task_t *)arg;
+    /* 16-element aligned slices so every thread stays on the SIMD path */
+    size_t per = ((t->n + (size_t)n_threads - 1) / (size_t)n_threads + 15) & ~(size_t)15;
+    size_t start = (size_t)tid * per;
+    if (start >= t->n) return;
+    size_t end = start + per < t->n ? start + per : t->n;
+    w16_to_f32_buf(t->dst + start, t->src + start, end - start, t->f16);
+}
+
+static void w16_to_f32(float *dst, const uint16_t *src, size_t n, int f16) {
+    bf16_convert_task_t task = { dst, src, n, f16 };
+    /* Below ~256K elements the dispatch costs more than it saves */
+    if (n < ((size_t)1 << 18)) bf16_convert_worker(0, 1, &task);
+    else parallel_for(bf16_convert_worker, &task);
+}
+
+void qwen_bf16_to_f32(float *dst, const uint16_t *src, size_t n) {
+    w16_to_f32(dst, src, n, 0);
+}
+
+void qwen_f16_to_f32(float *dst, const uint16_t *src, size_t n) {
+    w16_to_f32(dst, src, n, 1);
+}
+
+/* Reusable scratch buffer for bf16->f32 conversion, one per calling thread
+ * so jobs sharing the pool never convert into the same panel. Freed when
+ * the thread exits. */
+typedef struct {
+    float *buf;
+    size_t cap;
+} bf16_scratch_t;
+
+static pthread_key_t bf16_scratch_key;
+static pthread_once_t bf16_scratch_once = PTHREAD_ONCE_INIT;
+
+static void bf16_scratch_free(void *p) {
+    bf16_scratch_t *s = (bf16_scratch_t *)p;
+    free(s->buf);
+    free(s);
+}
+
+static void bf16_scratch_key_init(void) {
+    pthread_key_create(&bf16_scratch_key, bf16_scratch_free);
+}
 
 static float *bf16_get_scratch(size_t n) {
-    if (n > bf16_scratch_cap) {
-        free(bf16_scratch);
-        bf16_scratch = (float *)malloc(n * sizeof(float));
-        bf16_scratch_cap = bf16_scratch ? n : 0;
+    pthread_once(&bf16_scratch_once, bf16_scratch_key_init);
+    bf16_scratch_t *s = (bf16_scratch_t *)pthread_getspecific(bf16_scratch_key);
+    if (!s) {
+        s = (bf16_scratch_t *)calloc(1, sizeof(bf16_scratch_t));
+        if (!s) return NULL;
+        if (pthread_setspecific(bf16_scratch_key, s) != 0) {
+            free(s);
+            return NULL;
+        }
+    }
+    if (n > s->cap) {
+        free(s->buf);
+        s->buf = (float *)malloc(n * sizeof(float));
+        s->cap = s->buf ? n : 0;
     }
-    return bf16_scratch;
+    return s->buf;
+}
+
+void qwen_release_scratch(void) {
+    pthread_once(&bf16_scratch_once, bf16_scratch_key_init);
+    bf16_scratch_t *s = (bf16_scratch_t *)pthread_getspecific(bf16_scratch_key);
+    if (!s) return;
+    free(s->buf);
+    s->buf = NULL;
+    s->cap = 0;
 }
 
 typedef struct {
@@ -365,6 +644,8 @@ typedef struct {
     float *dst_f32;
 } bf16_cache_entry_t;
 
+/* Shared by concurrent jobs: lookups and inserts hold bf16_cache_mutex */
+static pthread_mutex_t bf16_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
 static bf16_cache_entry_t *bf16_cache = NULL;
 static int bf16_cache_len = 0;
 static int bf16_cache_cap = 0;
@@ -391,7 +672,7 @@ static void bf16_cache_init_limit(void) {
     }
 }
 
-static const float *bf16_get_cached_f32(const uint16_t *src, size_t n) {
+static const float *bf16_cache_get_locked(const uint16_t *src, size_t n, int f16) {
     bf16_cache_init_limit();
 
     for (int i = 0; i < bf16_cache_len; i++) {
@@ -408,7 +689,7 @@ static const float *bf16_get_cached_f32(const uint16_t *src, size_t n) {
 
     float *dst = (float *)malloc(bytes);
     if (!dst) return NULL;
-    bf16_to_f32_buf(dst, src, n);
+    w16_to_f32_buf(dst, src, n, f16);
 
     if (bf16_cache_len == bf16_cache_cap) {
         int new_cap = bf16_cache_cap > 0 ? bf16_cache_cap * 2 : 256;
@@ -430,23 +711,89 @@ static const float *bf16_get_cached_f32(const uint16_t *src, size_t n) {
     return dst;
 }
 
-static const float *bf16_get_f32_view(const uint16_t *src, size_t n) {
-    const float *cached = bf16_get_cached_f32(src, n);
-    if (cached) return cached;
+static const float *bf16_get_cached_f32(const uint16_t *src, size_t n, int f16) {
+    pthread_mutex_lock(&bf16_cache_mutex);
+    const float *f32 = bf16_cache_get_locked(src, n, f16);
+    pthread_mutex_unlock(&bf16_cache_mutex);
+    return f32;
+}
+
+/* Rows of a bf16 weight converted per prefill GEMM panel: about half the
+ * last-level cache, so sgemm reads the panel while it is still resident
+ * instead of streaming a whole-matrix f32 copy back from DRAM. */
+static int bf16_panel_rows(int rows, int in_dim) {
+    const qwen_topology_t *topo = qwen_get_topology();
+    size_t budget;
+    if (tp_gemm_panel_kb > 0) {
+        budget = (size_t)tp_gemm_panel_kb << 10;
+    } else {
+        budget = topo->l3_bytes ? topo->l3_bytes / 2
+               : topo->l2_bytes ? topo->l2_bytes * 4 : (size_t)8 << 20;
+        if (budget < ((size_t)1 << 20)) budget = (size_t)1 << 20;
+    }
+    size_t r = budget / ((size_t)in_dim * sizeof(float));
+    if (r < 64) r = 64;
+    return r >= (size_t)rows ? rows : (int)r;
+}
+
+/* C[M, N] (row stride ldc) = A[M, K] @ B[N, K]^T (+ bias[N]) */
+static void gemm_nt_strided(float *C, int ldc, const float *A, const float *B,
+                            const float *bias, int M, int K, int N) {
+#ifdef USE_BLAS
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans,
+                M, N, K, 1.0f, A, K, B, K, 0.0f, C, ldc);
+    if (bias != NULL) {
+        for (int m = 0; m < M; m++)
+            for (int n = 0; n < N; n++)
+                C[(size_t)m * ldc + n] += bias[n];
+    }
+#else
+    for (int m = 0; m < M; m++) {
+        const float *a_row = A + (size_t)m * K;
+        float *c_row = C + (size_t)m * ldc;
+        for (int n = 0; n < N; n++) {
+            const float *b_row = B + (size_t)n * K;
+            float sum = (bias != NULL) ? bias[n] : 0.0f;
+            for (int k = 0; k < K; k++) sum += a_row[k] * b_row[k];
+            c_row[n] = sum;
+        }
+    }
+#endif
+}
 
-    float *scratch = bf16_get_scratch(n);
-    if (!scratch) return NULL;
-    bf16_to_f32_buf(scratch, src, n);
-    return scratch;
+/* y[M, N] = x[M, K] @ W_bf16[N, K]^T (+ bias), converting W one row panel
+ * at a time (whole, if it is in the f32 cache). f16: W holds IEEE fp16. */
+static void w16_gemm_panels(float *y, const float *x, const uint16_t *W_bf16,
+                            const float *bias, int M, int K, int N, int f16) {
+    const float *cached = bf16_get_cached_f32(W_bf16, (size_t)N * K, f16);
+    int panel = cached ? N : bf16_panel_rows(N, K);
+    float *scratch = NULL;
+    if (!cached) {
+        scratch = bf16_get_scratch((size_t)panel * K);
+        if (!scratch) return;
+    }
+    for (int r0 = 0; r0 < N; r0 += panel) {
+        int rows = N - r0 < panel ? N - r0 : panel;
+        const float *Wp;
+        if (cached) {
+            Wp = cached + (size_t)r0 * K;
+        } else {
+            w16_to_f32_buf(scratch, W_bf16 + (size_t)r0 * K, (size_t)rows * K, f16);
+            Wp = scratch;
+        }
+        gemm_nt_strided(y + r0, N, x, Wp, bias ? bias + r0 : NULL, M, K, rows);
+    }
 }
 
 /*
  * Fused BF16 matvec: y[out_dim] = W_bf16[out_dim, in_dim] @ x[in_dim] + bias
  * Processes 2 output rows at a time to amortize x vector loads.
+ * f16: W holds IEEE fp16 (F16C / NEON conversion in the same loop).
  */
-static void bf16_matvec_fused(float *y, const float *x, const uint16_t *W_bf16,
-                               const float *bias, int in_dim, int out_dim) {
-    qwen_bf16_matvec_fused_impl(y, x, W_bf16, bias, in_dim, out_dim);
+static void w16_matvec_fused(float *y, const float *x, const uint16_t *W_bf16,
+                             const float *bias, int in_dim, int out_dim, int f16) {
+    if (f16) qwen_f16_matvec_fused_impl(y, x, W_bf16, bias, in_dim, out_dim);
+    else qwen_bf16_matvec_fused_impl(y, x, W_bf16, bias, in_dim, out_dim);
 }
 
 /* Threaded matvec: split output rows across threads */
@@ -457,6 +804,7 @@ typedef struct {
     const float *bias;
     int in_dim;
     int out_dim;
+    int f16;
 } matvec_task_t;
 
 static void matvec_worker(int tid, int n_threads, void *arg) {
@@ -467,20 +815,21 @@ static void matvec_worker(int tid, int n_threads, void *arg) {
     if (end > t->out_dim) end = t->out_dim;
     if (start >= end) return;
 
-    bf16_matvec_fused(t->y + start, t->x,
-                      t->W_bf16 + (size_t)start * t->in_dim,
-                      t->bias ? t->bias + start : NULL,
-                      t->in_dim, end - start);
+    w16_matvec_fused(t->y + start, t->x,
+                     t->W_bf16 + (size_t)start * t->in_dim,
+                     t->bias ? t->bias + start : NULL,
+                     t->in_dim, end - start, t->f16);
 }
 
-static void bf16_matvec_threaded(float *y, const float *x, const uint16_t *W_bf16,
-                                  const float *bias, int in_dim, int out_dim) {
-    if (tp.n_threads <= 1) {
-        bf16_matvec_fused(y, x, W_bf16, bias, in_dim, out_dim);
+static void w16_matvec_threaded(float *y, const float *x, const uint16_t *W_bf16,
+                                const float *bias, int in_dim, int out_dim, int f16) {
+    int width = decode_width();
+    if (width <= 1) {
+        w16_matvec_fused(y, x, W_bf16, bias, in_dim, out_dim, f16);
         return;
     }
-    matvec_task_t task = { y, x, W_bf16, bias, in_dim, out_dim };
-    parallel_for(matvec_worker, &task);
+    matvec_task_t task = { y, x, W_bf16, bias, in_dim, out_dim, f16 };
+    parallel_for_n(matvec_worker, &task, width);
 }
 
 typedef struct {
@@ -495,6 +844,7 @@ typedef struct {
     int q_dim;
     int kv_dim;
     int total_dim;
+    int f16;
 } qkv_matvec_task_t;
 
 static void qkv_matvec_worker(int tid, int n_threads, void *arg) {
@@ -513,9 +863,9 @@ static void qkv_matvec_worker(int tid, int n_threads, void *arg) {
         int s = start;
         int e = end < q_end ? end : q_end;
         if (s < e) {
-            bf16_matvec_fused(t->q + s, t->x,
-                              t->Wq_bf16 + (size_t)s * t->in_dim,
-                              NULL, t->in_dim, e - s);
+            w16_matvec_fused(t->q + s, t->x,
+                             t->Wq_bf16 + (size_t)s * t->in_dim,
+                             NULL, t->in_dim, e - s, t->f16);
         }
     }
 
@@ -524,9 +874,9 @@ static void qkv_matvec_worker(int tid, int n_threads, void *arg) {
         int e_abs = end < k_end ? end : k_end;
         int e = e_abs - q_end;
         if (s < e) {
-            bf16_matvec_fused(t->k + s, t->x,
-                              t->Wk_bf16 + (size_t)s * t->in_dim,
-                              NULL, t->in_dim, e - s);
+            w16_matvec_fused(t->k + s, t->x,
+                             t->Wk_bf16 + (size_t)s * t->in_dim,
+                             NULL, t->in_dim, e - s, t->f16);
         }
     }
 
@@ -535,22 +885,23 @@ static void qkv_matvec_worker(int tid, int n_threads, void *arg) {
         int e_abs = end < v_end ? end : v_end;
         int e = e_abs - k_end;
         if (s < e) {
-            bf16_matvec_fused(t->v + s, t->x,
-                              t->Wv_bf16 + (size_t)s * t->in_dim,
-                              NULL, t->in_dim, e - s);
+            w16_matvec_fused(t->v + s, t->x,
+                             t->Wv_bf16 + (size_t)s * t->in_dim,
+                             NULL, t->in_dim, e - s, t->f16);
         }
     }
 }
 
-void qwen_linear_nobias_bf16_qkv(float *q, float *k, float *v, const float *x,
-                                 const uint16_t *Wq_bf16,
-                                 const uint16_t *Wk_bf16,
-                                 const uint16_t *Wv_bf16,
-                                 int in_dim, int q_dim, int kv_dim) {
-    if (tp.n_threads <= 1) {
-        bf16_matvec_fused(q, x, Wq_bf16, NULL, in_dim, q_dim);
-        bf16_matvec_fused(k, x, Wk_bf16, NULL, in_dim, kv_dim);
-        bf16_matvec_fused(v, x, Wv_bf16, NULL, in_dim, kv_dim);
+static void linear_nobias_w16_qkv(float *q, float *k, float *v, const float *x,
+                                  const uint16_t *Wq_bf16,
+                                  const uint16_t *Wk_bf16,
+                                  const uint16_t *Wv_bf16,
+                                  int in_dim, int q_dim, int kv_dim, int f16) {
+    int width = decode_width();
+    if (width <= 1) {
+        w16_matvec_fused(q, x, Wq_bf16, NULL, in_dim, q_dim, f16);
+        w16_matvec_fused(k, x, Wk_bf16, NULL, in_dim, kv_dim, f16);
+        w16_matvec_fused(v, x, Wv_bf16, NULL, in_dim, kv_dim, f16);
         return;
     }
 
@@ -566,40 +917,182 @@ void qwen_linear_nobias_bf16_qkv(float *q, float *k, float *v, const float *x,
         .q_dim = q_dim,
         .kv_dim = kv_dim,
         .total_dim = q_dim + 2 * kv_dim,
+        .f16 = f16,
     };
-    parallel_for(qkv_matvec_worker, &task);
+    parallel_for_n(qkv_matvec_worker, &task, width);
 }
 
-void qwen_linear_nobias_bf16(float *y, const float *x, const uint16_t *W_bf16,
-                              int seq_len, int in_dim, int out_dim) {
+void qwen_linear_nobias_bf16_qkv(float *q, float *k, float *v, const float *x,
+                                 const uint16_t *Wq_bf16,
+                                 const uint16_t *Wk_bf16,
+                                 const uint16_t *Wv_bf16,
+                                 int in_dim, int q_dim, int kv_dim) {
+    linear_nobias_w16_qkv(q, k, v, x, Wq_bf16, Wk_bf16, Wv_bf16, in_dim, q_dim, kv_dim, 0);
+}
+
+void qwen_linear_nobias_f16_qkv(float *q, float *k, float *v, const float *x,
+                                const uint16_t *Wq_f16,
+                                const uint16_t *Wk_f16,
+                                const uint16_t *Wv_f16,
+                                int in_dim, int q_dim, int kv_dim) {
+    linear_nobias_w16_qkv(q, k, v, x, Wq_f16, Wk_f16, Wv_f16, in_dim, q_dim, kv_dim, 1);
+}
+
+static void linear_w16(float *y, const float *x, const uint16_t *W_bf16, const float *b,
+                       int seq_len, int in_dim, int out_dim, int f16) {
     if (seq_len == 1) {
-        bf16_matvec_threaded(y, x, W_bf16, NULL, in_dim, out_dim);
+        w16_matvec_threaded(y, x, W_bf16, b, in_dim, out_dim, f16);
         return;
     }
-    size_t n = (size_t)out_dim * in_dim;
-    const float *W_f32 = bf16_get_f32_view(W_bf16, n);
-    if (!W_f32) return;
-    qwen_linear_nobias(y, x, W_f32, seq_len, in_dim, out_dim);
+    w16_gemm_panels(y, x, W_bf16, b, seq_len, in_dim, out_dim, f16);
+}
+
+void qwen_linear_nobias_bf16(float *y, const float *x, const uint16_t *W_bf16,
+                              int seq_len, int in_dim, int out_dim) {
+    linear_w16(y, x, W_bf16, NULL, seq_len, in_dim, out_dim, 0);
 }
 
 void qwen_linear_bf16(float *y, const float *x, const uint16_t *W_bf16,
                       const float *b, int seq_len, int in_dim, int out_dim) {
+    linear_w16(y, x, W_bf16, b, seq_len, in_dim, out_dim, 0);
+}
+
+void qwen_linear_nobias_f16(float *y, const float *x, const uint16_t *W_f16,
+                            int seq_len, int in_dim, int out_dim) {
+    linear_w16(y, x, W_f16, NULL, seq_len, in_dim, out_dim, 1);
+}
+
+/* ========================================================================
+ * 2:4 Structured-Sparse BF16 Weights
+ * ======================================================================== */
+
+static float bf16_abs(uint16_t v) {
+    uint32_t bits = ((uint32_t)(v & 0x7fff)) << 16;
+    float f;
+    memcpy(&f, &bits, sizeof(float));
+    return f;
+}
+
+void qwen_sp24_prune_bf16(uint16_t *vals, uint8_t *idx, const uint16_t *W_bf16,
+                          int out_dim, int in_dim) {
+    int n_groups = in_dim / 4;
+    for (int r = 0; r < out_dim; r++) {
+        const uint16_t *w = W_bf16 + (size_t)r * in_dim;
+        uint16_t *v = vals + (size_t)r * (in_dim / 2);
+        uint8_t *ix = idx + (size_t)r * (in_dim / 8);
+        for (int g = 0; g < n_groups; g++) {
+            const uint16_t *wg = w + 4 * g;
+            /* Keep the two largest magnitudes (earlier column on ties) */
+            int a = 0, b = 1;
+            if (bf16_abs(wg[1]) > bf16_abs(wg[0])) a = 1, b = 0;
+            for (int j = 2; j < 4; j++) {
+                float m = bf16_abs(wg[j]);
+                if (m > bf16_abs(wg[a])) b = a, a = j;
+                else if (m > bf16_abs(wg[b])) b = j;
+            }
+            int lo = a < b ? a : b, hi = a < b ? b : a;
+            v[2 * g] = wg[lo];
+            v[2 * g + 1] = wg[hi];
+            uint8_t nib = (uint8_t)(lo | (hi << 2));
+            if (g & 1) ix[g / 2] |= (uint8_t)(nib << 4);
+            else ix[g / 2] = nib;
+        }
+    }
+}
+
+/* Expand rows of a 2:4 sparse weight to dense f32 */
+static void sp24_to_f32_rows(float *dst, const uint16_t *vals, const uint8_t *idx,
+                             int rows, int in_dim) {
+    uint32_t *d = (uint32_t *)(void *)dst;
+    memset(dst, 0, (size_t)rows * in_dim * sizeof(float));
+    for (int r = 0; r < rows; r++) {
+        const uint16_t *v = vals + (size_t)r * (in_dim / 2);
+        const uint8_t *ix = idx + (size_t)r * (in_dim / 8);
+        uint32_t *dr = d + (size_t)r * in_dim;
+        for (int b = 0; b < in_dim / 8; b++) {
+            unsigned m = ix[b];
+            uint32_t *dg = dr + 8 * b;
+            dg[m & 3]              = (uint32_t)v[4 * b] << 16;
+            dg[(m >> 2) & 3]       = (uint32_t)v[4 * b + 1] << 16;
+            dg[4 + ((m >> 4) & 3)] = (uint32_t)v[4 * b + 2] << 16;
+            dg[4 + (m >> 6)]       = (uint32_t)v[4 * b + 3] << 16;
+        }
+    }
+}
+
+typedef struct {
+    float *y;
+    const float *x;
+    const uint16_t *vals;
+    const uint8_t *idx;
+    int in_dim;
+    int out_dim;
+} sp24_matvec_task_t;
+
+static void sp24_matvec_worker(int tid, int n_threads, void *arg) {
+    sp24_matvec_task_t *t = (sp24_matvec_task_t *)arg;
+    int chunk = (t->out_dim + n_threads - 1) / n_threads;
+    int start = tid * chunk;
+    int end = start + chunk;
+    if (end > t->out_dim) end = t->out_dim;
+    if (start >= end) return;
+
+    qwen_sp24_matvec_impl(t->y + start, t->x,
+                          t->vals + (size_t)start * (t->in_dim / 2),
+                          t->idx + (size_t)start * (t->in_dim / 8),
+                          t->in_dim, end - start);
+}
+
+void qwen_linear_nobias_sp24(float *y, const float *x, const uint16_t *vals,
+                             const uint8_t *idx, int seq_len, int in_dim, int out_dim) {
     if (seq_len == 1) {
-        bf16_matvec_threaded(y, x, W_bf16, b, in_dim, out_dim);
+        int width = decode_width();
+        if (width <= 1) {
+            qwen_sp24_matvec_impl(y, x, vals, idx, in_dim, out_dim);
+            return;
+        }
+        sp24_matvec_task_t task = { y, x, vals, idx, in_dim, out_dim };
+        parallel_for_n(sp24_matvec_worker, &task, width);
         return;
     }
-    size_t n = (size_t)out_dim * in_dim;
-    const float *W_f32 = bf16_get_f32_view(W_bf16, n);
-    if (!W_f32) return;
-    qwen_linear(y, x, W_f32, b, seq_len, in_dim, out_dim);
+
+    int panel = bf16_panel_rows(out_dim, in_dim);
+    float *scratch = bf16_get_scratch((size_t)panel * in_dim);
+    if (!scratch) return;
+    for (int r0 = 0; r0 < out_dim; r0 += panel) {
+        int rows = out_dim - r0 < panel ? out_dim - r0 : panel;
+        sp24_to_f32_rows(scratch, vals + (size_t)r0 * (in_dim / 2),
+                         idx + (size_t)r0 * (in_dim / 8), rows, in_dim);
+        gemm_nt_strided(y + r0, out_dim, x, scratch, NULL, seq_len, in_dim, rows);
+    }
 }
 
 /* Find argmax over a range of output rows [start, end).
- * Uses 2-row processing to amortize x vector loads (same as bf16_matvec_fused). */
-static void argmax_bf16_range(const float *x, const uint16_t *W_bf16,
-                               int in_dim, int start, int end,
-                               int *best_out, float *best_val_out) {
-    qwen_argmax_bf16_range_impl(x, W_bf16, in_dim, start, end, best_out, best_val_out);
+ * Uses 2-row processing to amortize x vector loads (same as w16_matvec_fused).
+ * fp16 rows go through the f16 matvec a block at a time; the scores stay in
+ * L1 and the scan over them is noise next to streaming the weights. */
+static void argmax_w16_range(const float *x, const uint16_t *W_bf16,
+                             int in_dim, int start, int end, int f16,
+                             int *best_out, float *best_val_out) {
+    if (!f16) {
+        qwen_argmax_bf16_range_impl(x, W_bf16, in_dim, start, end, best_out, best_val_out);
+        return;
+    }
+    float scores[64];
+    int best = start;
+    float best_val = -1e30f;
+    for (int r0 = start; r0 < end; r0 += 64) {
+        int rows = end - r0 < 64 ? end - r0 : 64;
+        qwen_f16_matvec_fused_impl(scores, x, W_bf16 + (size_t)r0 * in_dim, NULL, in_dim, rows);
+        for (int i = 0; i < rows; i++) {
+            if (scores[i] > best_val) {
+                best_val = scores[i];
+                best = r0 + i;
+            }
+        }
+    }
+    *best_out = best;
+    *best_val_out = best_val;
 }
 
 typedef struct {
@@ -607,6 +1100,7 @@ typedef struct {
     const uint16_t *W_bf16;
     int in_dim;
     int out_dim;
+    int f16;
     int best_idx[QWEN_MAX_THREADS];
     float best_val[QWEN_MAX_THREADS];
 } argmax_task_t;
@@ -622,16 +1116,17 @@ static void argmax_worker(int tid, int n_threads, void *arg) {
         t->best_idx[tid] = 0;
         return;
     }
-    argmax_bf16_range(t->x, t->W_bf16, t->in_dim, start, end,
-                      &t->best_idx[tid], &t->best_val[tid]);
+    argmax_w16_range(t->x, t->W_bf16, t->in_dim, start, end, t->f16,
+                     &t->best_idx[tid], &t->best_val[tid]);
 }
 
-int qwen_argmax_matvec_bf16(const float *x, const uint16_t *W_bf16,
-                             int in_dim, int out_dim) {
-    if (tp.n_threads <= 1) {
+static int argmax_matvec_w16(const float *x, const uint16_t *W_bf16,
+                             int in_dim, int out_dim, int f16) {
+    int width = decode_width();
+    if (width <= 1) {
         int best;
         float best_val;
-        argmax_bf16_range(x, W_bf16, in_dim, 0, out_dim, &best, &best_val);
+        argmax_w16_range(x, W_bf16, in_dim, 0, out_dim, f16, &best, &best_val);
         return best;
     }
 
@@ -640,11 +1135,12 @@ int qwen_argmax_matvec_bf16(const float *x, const uint16_t *W_bf16,
     task.W_bf16 = W_bf16;
     task.in_dim = in_dim;
     task.out_dim = out_dim;
-    parallel_for(argmax_worker, &task);
+    task.f16 = f16;
+    int nt = parallel_for_n(argmax_worker, &task, width);
 
     int best = task.best_idx[0];
     float best_val = task.best_val[0];
-    for (int i = 1; i < tp.n_threads; i++) {
+    for (int i = 1; i < nt; i++) {
         if (task.best_val[i] > best_val) {
             best_val = task.best_val[i];
             best = task.best_idx[i];
@@ -653,16 +1149,166 @@ int qwen_argmax_matvec_bf16(const float *x, const uint16_t *W_bf16,
     return best;
 }
 
+int qwen_argmax_matvec_bf16(const float *x, const uint16_t *W_bf16,
+                             int in_dim, int out_dim) {
+    return argmax_matvec_w16(x, W_bf16, in_dim, out_dim, 0);
+}
+
+int qwen_argmax_matvec_f16(const float *x, const uint16_t *W_f16,
+                           int in_dim, int out_dim) {
+    return argmax_matvec_w16(x, W_f16, in_dim, out_dim, 1);
+}
+
 void qwen_matmul_t_bf16(float *C, const float *A, const uint16_t *B_bf16,
                          int M, int K, int N) {
-    if (M == 1) {
-        bf16_matvec_threaded(C, A, B_bf16, NULL, K, N);
-    } else {
-        size_t n = (size_t)N * K;
-        const float *B_f32 = bf16_get_f32_view(B_bf16, n);
-        if (!B_f32) return;
-        qwen_matmul_t(C, A, B_f32, M, K, N);
+    linear_w16(C, A, B_bf16, NULL, M, K, N, 0);
+}
+
+/* ========================================================================
+ * Int8 GEMM (dynamic activation quantization)
+ *
+ * Weights: symmetric int8 per output channel, quantized once. Activations:
+ * symmetric int8 per row, quantized on every call. The int32 dot products
+ * are scaled back by scale_x[m] * scale_w[n] in the epilogue.
+ * ======================================================================== */
+
+#define Q8_BLOCK_N 16   /* weight rows per work item (16 x K int8 stays in L2) */
+
+/* Quantize one row to [-127, 127], zero the padding; returns the scale */
+static float q8_quantize_row(int8_t *dst, const float *src, int n, int n_pad) {
+    float amax = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float a = fabsf(src[i]);
+        if (a > amax) amax = a;
+    }
+    float scale = amax > 0.0f ? amax / 127.0f : 1.0f;
+    float inv = 1.0f / scale;
+    for (int i = 0; i < n; i++) dst[i] = (int8_t)lrintf(src[i] * inv);
+    if (n_pad > n) memset(dst + n, 0, (size_t)(n_pad - n));
+    return scale;
+}
+
+typedef struct {
+    int8_t *dst;
+    float *scale;
+    const float *src;
+    int rows, cols, cols_pad;
+} q8_quant_task_t;
+
+static void q8_quant_worker(int tid, int n_threads, void *arg) {
+    q8_quant_task_t *t = (q8_quant_task_t *)arg;
+    int per = (t->rows + n_threads - 1) / n_threads;
+    int r0 = tid * per;
+    int r1 = r0 + per < t->rows ? r0 + per : t->rows;
+    for (int r = r0; r < r1; r++)
+        t->scale[r] = q8_quantize_row(t->dst + (size_t)r * t->cols_pad,
+                                      t->src + (size_t)r * t->cols,
+                                      t->cols, t->cols_pad);
+}
+
+int qwen_q8_quantize(qwen_q8_weight_t *w, const float *W, int rows, int cols) {
+    memset(w, 0, sizeof(*w));
+    int cols_pad = (cols + 63) & ~63;
+    w->q = (int8_t *)malloc((size_t)rows * cols_pad);
+    w->scale = (float *)malloc((size_t)rows * sizeof(float));
+    w->sum = (int32_t *)malloc((size_t)rows * sizeof(int32_t));
+    if (!w->q || !w->scale || !w->sum) {
+        qwen_q8_free(w);
+        return -1;
+    }
+    w->rows = rows;
+    w->cols = cols;
+    w->cols_pad = cols_pad;
+    q8_quant_task_t task = { w->q, w->scale, W, rows, cols, cols_pad };
+    parallel_for(q8_quant_worker, &task);
+
+    for (int r = 0; r < rows; r++) {
+        const int8_t *q = w->q + (size_t)r * cols_pad;
+        int32_t sum = 0;
+        for (int c = 0; c < cols; c++) sum += q[c];
+        w->sum[r] = sum;
     }
+    return 0;
+}
+
+void qwen_q8_free(qwen_q8_weight_t *w) {
+    free(w->q);
+    free(w->scale);
+    free(w->sum);
+    memset(w, 0, sizeof(*w));
+}
+
+typedef struct {
+    float *y;
+    const int8_t *xq;
+    const float *xs;
+    const qwen_q8_weight_t *W;
+    const float *b;
+    int seq;
+} q8_gemm_task_t;
+
+static void q8_gemm_worker(int tid, int n_threads, void *arg) {
+    q8_gemm_task_t *t = (q8_gemm_task_t *)arg;
+    const qwen_q8_weight_t *W = t->W;
+    int M = t->seq;
+    int N = W->rows;
+    int kp = W->cols_pad;
+    int n_blocks = (N + Q8_BLOCK_N - 1) / Q8_BLOCK_N;
+    int per = (n_blocks + n_threads - 1) / n_threads;
+    int nb1 = (tid + 1) * per < n_blocks ? (tid + 1) * per : n_blocks;
+    const int8_t *a[4], *bw[4];
+    int32_t bsum[4], acc[16];
+
+    for (int nb = tid * per; nb < nb1; nb++) {
+        int n0 = nb * Q8_BLOCK_N;
+        int n1 = n0 + Q8_BLOCK_N < N ? n0 + Q8_BLOCK_N : N;
+        for (int m = 0; m < M; m += 4) {
+            /* Ragged edges repeat the last row/column; only valid outputs are stored */
+            int mh = M - m < 4 ? M - m : 4;
+            for (int i = 0; i < 4; i++)
+                a[i] = t->xq + (size_t)(i < mh ? m + i : M - 1) * kp;
+            for (int n = n0; n < n1; n += 4) {
+                int nw = n1 - n < 4 ? n1 - n : 4;
+                for (int j = 0; j < 4; j++) {
+                    int jj = j < nw ? n + j : n1 - 1;
+                    bw[j] = W->q + (size_t)jj * kp;
+                    bsum[j] = W->sum[jj];
+                }
+                qwen_q8_dot_4x4_impl(acc, a, bw, bsum, kp);
+                for (int i = 0; i < mh; i++) {
+                    float *yrow = t->y + (size_t)(m + i) * N;
+                    float sx = t->xs[m + i];
+                    for (int j = 0; j < nw; j++) {
+                        float v = (float)acc[i * 4 + j] * sx * W->scale[n + j];
+                        yrow[n + j] = t->b ? v + t->b[n + j] : v;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void qwen_linear_q8(float *y, const float *x, const qwen_q8_weight_t *W,
+                    const float *b, int seq_len) {
+    int8_t *xq = (int8_t *)malloc((size_t)seq_len * W->cols_pad);
+    float *xs = (float *)malloc((size_t)seq_len * sizeof(float));
+    if (!xq || !xs) {
+        fprintf(stderr, "qwen_linear_q8: out of memory\n");
+        memset(y, 0, (size_t)seq_len * W->rows * sizeof(float));
+        free(xq);
+        free(xs);
+        return;
+    }
+
+    q8_quant_task_t qt = { xq, xs, x, seq_len, W->cols, W->cols_pad };
+    if (seq_len >= 16) parallel_for(q8_quant_worker, &qt);
+    else q8_quant_worker(0, 1, &qt);
+
+    q8_gemm_task_t task = { y, xq, xs, W, b, seq_len };
+    parallel_for(q8_gemm_worker, &task);
+
+    free(xq);
+    free(xs);
 }
 
 /* ========================================================================
@@ -1069,7 +1715,7 @@ void qwen_swiglu_multiply(float *out, const float *gate_up, int seq_len, int int
         .intermediate = intermediate
     };
 
-    if (tp.n_threads > 1 && seq_len >= 2 && intermediate >= 256) {
+    if (pool_width() > 1 && seq_len >= 2 && intermediate >= 256) {
         parallel_for(swiglu_worker, &task);
     } else {
         swiglu_worker(0, 1, &task);
@@ -1194,7 +1840,7 @@ void qwen_bidirectional_attention(float *out, const float *Q, const float *K,
                                    const float *V, int seq __attribute__((unused)),
                                    int n_heads, int head_dim, float scale,
                                    const int *window_starts, int n_windows) {
-    if (tp.n_threads > 1 && n_heads >= 2) {
+    if (pool_width() > 1 && n_heads >= 2) {
         bidir_attn_task_t task = {
             .out = out, .Q = Q, .K = K, .V = V,
             .n_heads = n_heads, .head_dim = head_dim,
@@ -1285,7 +1931,8 @@ static void causal_attn_worker(int tid, int n_threads, void *arg) {
 void qwen_causal_attention(float *out, const float *Q, const float *K, const float *V,
                             int seq_q, int seq_k, int n_heads, int n_kv_heads,
                             int head_dim, float scale, int q_offset) {
-    if (tp.n_threads > 1 && n_heads >= 2 && (seq_q >= 2 || seq_k >= 128)) {
+    int min_seq_k = tp_attn_min_seq_k > 0 ? tp_attn_min_seq_k : 128;
+    if (pool_width() > 1 && n_heads >= 2 && (seq_q >= 2 || seq_k >= min_seq_k)) {
         causal_attn_task_t task = {
             .out = out, .Q = Q, .K = K, .V = V,
             .seq_q = seq_q, .seq_k = seq_k,
@@ -51,6 +51,54 @@ void qwen_linear_nobias_bf16_qkv(float *q, float *k, float *v, const float *x,
 void qwen_matmul_t_bf16(float *C, const float *A, const uint16_t *B_bf16,
                          int M, int K, int N);
 
+/* IEEE fp16 weight variants (fp16 checkpoints): same shapes and threading
+ * as the bf16 ones, widening with F16C vcvtph2ps / NEON fcvtl. */
+void qwen_linear_nobias_f16(float *y, const float *x, const uint16_t *W_f16,
+                            int seq_len, int in_dim, int out_dim);
+
+void qwen_linear_nobias_f16_qkv(float *q, float *k, float *v, const float *x,
+                                const uint16_t *Wq_f16,
+                                const uint16_t *Wk_f16,
+                                const uint16_t *Wv_f16,
+                                int in_dim, int q_dim, int kv_dim);
+
+/* 2:4 structured-sparse bf16 weight W[out_dim, in_dim]: every group of 4
+ * consecutive columns keeps at most 2 values. vals[out_dim, in_dim/2] holds
+ * the kept values in column order; idx[out_dim, in_dim/8] their offsets in
+ * the group, one nibble per group (low nibble = even group; bits 0-1 and
+ * 2-3 = first and second offset). in_dim must be a multiple of 8. */
+void qwen_sp24_prune_bf16(uint16_t *vals, uint8_t *idx, const uint16_t *W_bf16,
+                          int out_dim, int in_dim);
+
+/* y[seq, out_dim] = x[seq, in_dim] @ W^T for a 2:4 sparse W. seq_len == 1
+ * runs the sparse matvec kernels; longer inputs expand row panels to f32
+ * and reuse the prefill GEMM. */
+void qwen_linear_nobias_sp24(float *y, const float *x, const uint16_t *vals,
+                             const uint8_t *idx, int seq_len, int in_dim, int out_dim);
+
+/* ========================================================================
+ * Int8 Quantized GEMM
+ * ======================================================================== */
+
+/* Symmetric per-output-channel int8 weight: W[r, c] ~= q[r * cols_pad + c] * scale[r].
+ * Rows are zero-padded to cols_pad (a multiple of 64) for the SIMD tiles;
+ * sum[r] is the row sum of q (zero-point correction for u8 x s8 dot products). */
+typedef struct {
+    int8_t *q;
+    float *scale;
+    int32_t *sum;
+    int rows, cols, cols_pad;
+} qwen_q8_weight_t;
+
+/* Quantize W[rows, cols] (threaded). Returns 0, or -1 on allocation failure. */
+int qwen_q8_quantize(qwen_q8_weight_t *w, const float *W, int rows, int cols);
+void qwen_q8_free(qwen_q8_weight_t *w);
+
+/* y[seq, rows] = x[seq, cols] @ W^T + b, with x quantized per row to int8
+ * on the fly (VNNI / vpmaddubsw / SDOT tiles, f32 dequant epilogue). */
+void qwen_linear_q8(float *y, const float *x, const qwen_q8_weight_t *W,
+                    const float *b, int seq_len);
+
 /* ========================================================================
  * 2D Convolution (for audio encoder conv stem)
  * ======================================================================== */
@@ -155,19 +203,94 @@ void qwen_apply_rope_neox(float *x, const float *cos_vals, const float *sin_vals
  * Returns the index of the row with highest dot product. */
 int qwen_argmax_matvec_bf16(const float *x, const uint16_t *W_bf16,
                              int in_dim, int out_dim);
+int qwen_argmax_matvec_f16(const float *x, const uint16_t *W_f16,
+                           int in_dim, int out_dim);
+
+/* dst[i] = (float)src[i] for bf16 (or fp16) src, SIMD and spread over the
+ * thread pool (weight loading). */
+void qwen_bf16_to_f32(float *dst, const uint16_t *src, size_t n);
+void qwen_f16_to_f32(float *dst, const uint16_t *src, size_t n);
+
+/* One IEEE binary16 value -> binary32, exact (subnormals, inf and NaN
+ * included). Portable reference used by the generic kernels and loaders. */
+float qwen_f16_to_f32_scalar(uint16_t h);
+
+/* Free the calling thread's bf16->f32 conversion scratch (each thread
+ * has its own; it regrows on demand). */
+void qwen_release_scratch(void);
 
 /* ========================================================================
  * Threading
  * ======================================================================== */
 
 /* Set number of threads for parallel operations (default: 1).
- * Creates a persistent thread pool. Call before inference. */
+ * Resizes the persistent thread pool at any time, also while jobs run:
+ * missing workers are created, surplus ones are parked (never joined) and
+ * unparked again when the pool grows. */
 void qwen_set_threads(int n);
 
-/* Get number of available CPU cores */
+/* Current pool size (including the calling thread) */
+int qwen_get_threads(void);
+
+/* Run fn(tid, n_threads, arg) on idle pool threads up to the caller's budget,
+ * the calling thread being tid 0; returns when all have finished. Returns
+ * the number of threads used (at most QWEN_MAX_THREADS). */
+#define QWEN_MAX_THREADS 16
+typedef void (*qwen_parallel_fn_t)(int tid, int n_threads, void *arg);
+int qwen_parallel_for(qwen_parallel_fn_t fn, void *arg);
+
+/* Cap the number of pool threads used by parallel kernels called from the
+ * calling thread (0 = whole pool). Dispatches claim idle workers, so callers
+ * on different threads with budgets summing to the pool size run side by
+ * side on disjoint workers. Returns the previous budget. */
+int qwen_set_thread_budget(int n);
+
+/* Threads parallel kernels called from the calling thread may use: the
+ * pool size, capped by its budget and by its job's scheduler grant. */
+int qwen_get_thread_budget(void);
+
+/* CPUs this process can use: online CPUs limited by the affinity mask and
+ * any cgroup CPU quota (see qwen_asr_topology.h) */
 int qwen_get_num_cpus(void);
 
-/* Global verbose flag */
-extern int qwen_verbose;
+/* Physical cores among qwen_get_num_cpus() (SMT siblings counted once) */
+int qwen_get_num_cores(void);
+
+/* Cap the threads used by single-token (decode) matvecs, which are memory
+ * bandwidth bound (0 = default: physical cores). */
+void qwen_set_decode_threads(int n);
+
+/* Runtime kernel tuning, process-wide. 0 in a field = built-in default.
+ * Set from a tuning profile by qwen_load() (see qwen_autotune()). */
+typedef struct {
+    int decode_threads;     /* single-token matvec threads (default: physical cores) */
+    int attn_min_seq_k;     /* KV length from which 1-query attention is threaded (128) */
+    int gemm_panel_kb;      /* prefill bf16->f32 weight panel size (default: LLC / 2) */
+} qwen_kernel_tuning_t;
+
+void qwen_get_kernel_tuning(qwen_kernel_tuning_t *t);
+void qwen_set_kernel_tuning(const qwen_kernel_tuning_t *t);
+
+/* Job scheduler: jobs acquire a share of the thread pool with a priority
+ * class (0 = interactive, 1 = batch) and a thread count (0 = whole pool,
+ * also capped by the calling thread's budget). Shares are granted once
+ * that many threads are free, so jobs with budgets summing to the pool
+ * size run concurrently and whole-pool jobs run one at a time. Batch jobs
+ * hand their share over to waiting interactive jobs at every
+ * qwen_sched_yield() point (decode step, encoder layer/window).
+ * Acquire/release nest per thread; nested acquires keep the outer share. */
+void qwen_sched_acquire(int priority, int n_threads);
+void qwen_sched_release(void);
+void qwen_sched_yield(void);
+
+/* Give the calling thread's share back at every nesting level before it
+ * blocks (e.g. on live audio), so an idle job holds no threads. Returns
+ * the depth to pass to qwen_sched_resume(), which re-acquires with the
+ * same priority and thread count (capped by the budget at that time). */
+int qwen_sched_suspend(void);
+void qwen_sched_resume(int depth);
+
+/* Verbose flag (per thread) */
+extern __thread int qwen_verbose;
 
 #endif /* QWEN_ASR_KERNELS_H */
@@ -499,4 +499,339 @@ void qwen_vec_scale_add_avx(float *dst, const float *src, float correction, int
 #endif
 }
 
+/* =====================================================================
+ * int8 GEMM tile. x86 only multiplies u8 x s8 (vpdpbusd / vpmaddubsw).
+ * AVX-512 VNNI: activations are flipped to u8 (a + 128) and the extra
+ * 128 * sum(b) is subtracted at the end. AVX2: signed inputs via
+ * |a| * (b * sign(a)); with values in [-127, 127] the 16-bit pair sums of
+ * vpmaddubsw cannot saturate.
+ * ===================================================================== */
+
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+
+void qwen_q8_dot_4x4_avx(int32_t *out, const int8_t *const *a,
+                         const int8_t *const *b, const int32_t *bsum, int k) {
+    const __m512i flip = _mm512_set1_epi8((char)0x80);
+    __m512i c[16];
+    for (int i = 0; i < 16; i++) c[i] = _mm512_setzero_si512();
+
+    for (int t = 0; t < k; t += 64) {
+        __m512i w0 = _mm512_loadu_si512((const void *)(b[0] + t));
+        __m512i w1 = _mm512_loadu_si512((const void *)(b[1] + t));
+        __m512i w2 = _mm512_loadu_si512((const void *)(b[2] + t));
+        __m512i w3 = _mm512_loadu_si512((const void *)(b[3] + t));
+        for (int i = 0; i < 4; i++) {
+            __m512i x = _mm512_xor_si512(_mm512_loadu_si512((const void *)(a[i] + t)), flip);
+            c[i * 4 + 0] = _mm512_dpbusd_epi32(c[i * 4 + 0], x, w0);
+            c[i * 4 + 1] = _mm512_dpbusd_epi32(c[i * 4 + 1], x, w1);
+            c[i * 4 + 2] = _mm512_dpbusd_epi32(c[i * 4 + 2], x, w2);
+            c[i * 4 + 3] = _mm512_dpbusd_epi32(c[i * 4 + 3], x, w3);
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            out[i * 4 + j] = _mm512_reduce_add_epi32(c[i * 4 + j]) - 128 * bsum[j];
+}
+
+#else
+
+static inline __m256i q8_dot32(__m256i acc, __m256i a, __m256i b) {
+    __m256i ua = _mm256_sign_epi8(a, a);
+    __m256i sb = _mm256_sign_epi8(b, a);
+#if defined(__AVXVNNI__)
+    return _mm256_dpbusd_avx_epi32(acc, ua, sb);
+#else
+    __m256i p16 = _mm256_maddubs_epi16(ua, sb);
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(p16, _mm256_set1_epi16(1)));
+#endif
+}
+
+static inline int32_t hsum_epi32_avx(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+/* Two rows of a at a time keep the 8 accumulators in the 16 ymm registers */
+static void q8_dot_2x4_avx2(int32_t *out, const int8_t *a0, const int8_t *a1,
+                            const int8_t *const *b, int k) {
+    __m256i c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256();
+    __m256i c02 = _mm256_setzero_si256(), c03 = _mm256_setzero_si256();
+    __m256i c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256();
+    __m256i c12 = _mm256_setzero_si256(), c13 = _mm256_setzero_si256();
+
+    for (int t = 0; t < k; t += 32) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i *)(a0 + t));
+        __m256i x1 = _mm256_loadu_si256((const __m256i *)(a1 + t));
+        __m256i w0 = _mm256_loadu_si256((const __m256i *)(b[0] + t));
+        __m256i w1 = _mm256_loadu_si256((const __m256i *)(b[1] + t));
+        __m256i w2 = _mm256_loadu_si256((const __m256i *)(b[2] + t));
+        __m256i w3 = _mm256_loadu_si256((const __m256i *)(b[3] + t));
+        c00 = q8_dot32(c00, x0, w0); c01 = q8_dot32(c01, x0, w1);
+        c02 = q8_dot32(c02, x0, w2); c03 = q8_dot32(c03, x0, w3);
+        c10 = q8_dot32(c10, x1, w0); c11 = q8_dot32(c11, x1, w1);
+        c12 = q8_dot32(c12, x1, w2); c13 = q8_dot32(c13, x1, w3);
+    }
+
+    out[0] = hsum_epi32_avx(c00); out[1] = hsum_epi32_avx(c01);
+    out[2] = hsum_epi32_avx(c02); out[3] = hsum_epi32_avx(c03);
+    out[4] = hsum_epi32_avx(c10); out[5] = hsum_epi32_avx(c11);
+    out[6] = hsum_epi32_avx(c12); out[7] = hsum_epi32_avx(c13);
+}
+
+void qwen_q8_dot_4x4_avx(int32_t *out, const int8_t *const *a,
+                         const int8_t *const *b, const int32_t *bsum, int k) {
+    (void)bsum;
+    q8_dot_2x4_avx2(out, a[0], a[1], b, k);
+    q8_dot_2x4_avx2(out + 8, a[2], a[3], b, k);
+}
+
+#endif /* __AVX512VNNI__ && __AVX512BW__ */
+
+/* =====================================================================
+ * 2:4 sparse bf16 matvec
+ *
+ * Each idx byte holds the in-group offsets of two groups of 4 columns. The
+ * offsets are spread to one 32-bit lane per kept value with a variable
+ * shift, turned into column numbers and used to permute x in registers:
+ * one vpermt2ps per 16 values on AVX-512, two vpermps + blend per 8 on AVX2.
+ * ===================================================================== */
+
+static inline float sp24_tail(const float *x, const uint16_t *v, uint8_t m) {
+    uint32_t b0 = (uint32_t)v[0] << 16, b1 = (uint32_t)v[1] << 16;
+    uint32_t b2 = (uint32_t)v[2] << 16, b3 = (uint32_t)v[3] << 16;
+    float w0, w1, w2, w3;
+    memcpy(&w0, &b0, 4); memcpy(&w1, &b1, 4); memcpy(&w2, &b2, 4); memcpy(&w3, &b3, 4);
+    return w0 * x[m & 3] + w1 * x[(m >> 2) & 3] +
+           w2 * x[4 + ((m >> 4) & 3)] + w3 * x[4 + (m >> 6)];
+}
+
+#if defined(__AVX512F__)
+
+void qwen_sp24_matvec_avx(float *y, const float *x, const uint16_t *vals,
+                          const uint8_t *idx, int in_dim, int out_dim) {
+    const __m512i shifts = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14,
+                                             16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i base = _mm512_setr_epi32(0, 0, 4, 4, 8, 8, 12, 12,
+                                           16, 16, 20, 20, 24, 24, 28, 28);
+    const __m512i three = _mm512_set1_epi32(3);
+    int half = in_dim / 2, n_bytes = in_dim / 8;
+
+    for (int o = 0; o < out_dim; o++) {
+        const uint16_t *v = vals + (size_t)o * half;
+        const uint8_t *ix = idx + (size_t)o * n_bytes;
+        __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+        int k = 0;
+
+        for (; k + 64 <= in_dim; k += 64) {
+            uint32_t m0, m1;
+            memcpy(&m0, ix + k / 8, 4);
+            memcpy(&m1, ix + k / 8 + 4, 4);
+            __m512i i0 = _mm512_add_epi32(_mm512_and_si512(
+                _mm512_srlv_epi32(_mm512_set1_epi32((int)m0), shifts), three), base);
+            __m512i i1 = _mm512_add_epi32(_mm512_and_si512(
+                _mm512_srlv_epi32(_mm512_set1_epi32((int)m1), shifts), three), base);
+            __m512 g0 = _mm512_permutex2var_ps(_mm512_loadu_ps(x + k), i0,
+                                               _mm512_loadu_ps(x + k + 16));
+            __m512 g1 = _mm512_permutex2var_ps(_mm512_loadu_ps(x + k + 32), i1,
+                                               _mm512_loadu_ps(x + k + 48));
+            __m256i r0 = _mm256_loadu_si256((const __m256i *)(v + k / 2));
+            __m256i r1 = _mm256_loadu_si256((const __m256i *)(v + k / 2 + 16));
+            a0 = _mm512_fmadd_ps(_mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(r0), 16)), g0, a0);
+            a1 = _mm512_fmadd_ps(_mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(r1), 16)), g1, a1);
+        }
+        for (; k + 32 <= in_dim; k += 32) {
+            uint32_t m0;
+            memcpy(&m0, ix + k / 8, 4);
+            __m512i i0 = _mm512_add_epi32(_mm512_and_si512(
+                _mm512_srlv_epi32(_mm512_set1_epi32((int)m0), shifts), three), base);
+            __m512 g0 = _mm512_permutex2var_ps(_mm512_loadu_ps(x + k), i0,
+                                               _mm512_loadu_ps(x + k + 16));
+            __m256i r0 = _mm256_loadu_si256((const __m256i *)(v + k / 2));
+            a0 = _mm512_fmadd_ps(_mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(r0), 16)), g0, a0);
+        }
+
+        float sum = _mm512_reduce_add_ps(_mm512_add_ps(a0, a1));
+        for (; k < in_dim; k += 8) sum += sp24_tail(x + k, v + k / 2, ix[k / 8]);
+        y[o] = sum;
+    }
+}
+
+#else /* AVX2 */
+
+void qwen_sp24_matvec_avx(float *y, const float *x, const uint16_t *vals,
+                          const uint8_t *idx, int in_dim, int out_dim) {
+    const __m256i shift_lo = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256i shift_hi = _mm256_setr_epi32(16, 18, 20, 22, 24, 26, 28, 30);
+    const __m256i base = _mm256_setr_epi32(0, 0, 4, 4, 0, 0, 4, 4);
+    const __m256i three = _mm256_set1_epi32(3);
+    int half = in_dim / 2, n_bytes = in_dim / 8;
+
+    for (int o = 0; o < out_dim; o++) {
+        const uint16_t *v = vals + (size_t)o * half;
+        const uint8_t *ix = idx + (size_t)o * n_bytes;
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        int k = 0;
+
+        for (; k + 32 <= in_dim; k += 32) {
+            uint32_t m;
+            memcpy(&m, ix + k / 8, 4);
+            __m256i mv = _mm256_set1_epi32((int)m);
+            /* lanes 0-3 index x[k..k+8), lanes 4-7 x[k+8..k+16) (and +16 for hi) */
+            __m256i i_lo = _mm256_add_epi32(_mm256_and_si256(_mm256_srlv_epi32(mv, shift_lo), three), base);
+            __m256i i_hi = _mm256_add_epi32(_mm256_and_si256(_mm256_srlv_epi32(mv, shift_hi), three), base);
+            __m256 g0 = _mm256_blend_ps(_mm256_permutevar8x32_ps(_mm256_loadu_ps(x + k), i_lo),
+                                        _mm256_permutevar8x32_ps(_mm256_loadu_ps(x + k + 8), i_lo), 0xF0);
+            __m256 g1 = _mm256_blend_ps(_mm256_permutevar8x32_ps(_mm256_loadu_ps(x + k + 16), i_hi),
+                                        _mm256_permutevar8x32_ps(_mm256_loadu_ps(x + k + 24), i_hi), 0xF0);
+            __m256i raw = _mm256_loadu_si256((const __m256i *)(v + k / 2));
+            __m256 w0 = _mm256_castsi256_ps(_mm256_slli_epi32(
+                _mm256_cvtepu16_epi32(_mm256_castsi256_si128(raw)), 16));
+            __m256 w1 = _mm256_castsi256_ps(_mm256_slli_epi32(
+                _mm256_cvtepu16_epi32(_mm256_extracti128_si256(raw, 1)), 16));
+            a0 = _mm256_fmadd_ps(w0, g0, a0);
+            a1 = _mm256_fmadd_ps(w1, g1, a1);
+        }
+
+        a0 = _mm256_add_ps(a0, a1);
+        __m128 r = _mm_add_ps(_mm256_castps256_ps128(a0), _mm256_extractf128_ps(a0, 1));
+        r = _mm_hadd_ps(r, r);
+        r = _mm_hadd_ps(r, r);
+        float sum = _mm_cvtss_f32(r);
+        for (; k < in_dim; k += 8) sum += sp24_tail(x + k, v + k / 2, ix[k / 8]);
+        y[o] = sum;
+    }
+}
+
+#endif /* __AVX512F__ */
+
+/* =====================================================================
+ * FP16 matvec - F16C vcvtph2ps widens the IEEE halves in registers, so
+ * fp16 checkpoints stream from the mmap at the same 2 bytes per weight
+ * as bf16. 4 output rows at a time, as for bf16.
+ * ===================================================================== */
+
+#if defined(__F16C__)
+
+#if defined(__AVX512F__)
+
+void qwen_f16_matvec_fused_avx(float *y, const float *x, const uint16_t *W_f16,
+                               const float *bias, int in_dim, int out_dim) {
+    int o = 0;
+    for (; o + 3 < out_dim; o += 4) {
+        const uint16_t *w0 = W_f16 + (size_t)o * in_dim;
+        const uint16_t *w1 = w0 + in_dim;
+        const uint16_t *w2 = w1 + in_dim;
+        const uint16_t *w3 = w2 + in_dim;
+        __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+        __m512 a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+        int k = 0;
+
+        for (; k + 16 <= in_dim; k += 16) {
+            __m512 xv = _mm512_loadu_ps(x + k);
+            a0 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(w0 + k))), xv, a0);
+            a1 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(w1 + k))), xv, a1);
+            a2 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(w2 + k))), xv, a2);
+            a3 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(w3 + k))), xv, a3);
+        }
+
+        float s0 = _mm512_reduce_add_ps(a0) + (bias ? bias[o]   : 0.0f);
+        float s1 = _mm512_reduce_add_ps(a1) + (bias ? bias[o+1] : 0.0f);
+        float s2 = _mm512_reduce_add_ps(a2) + (bias ? bias[o+2] : 0.0f);
+        float s3 = _mm512_reduce_add_ps(a3) + (bias ? bias[o+3] : 0.0f);
+        for (; k < in_dim; k++) {
+            float xk = x[k];
+            s0 += _cvtsh_ss(w0[k]) * xk; s1 += _cvtsh_ss(w1[k]) * xk;
+            s2 += _cvtsh_ss(w2[k]) * xk; s3 += _cvtsh_ss(w3[k]) * xk;
+        }
+        y[o]=s0; y[o+1]=s1; y[o+2]=s2; y[o+3]=s3;
+    }
+
+    for (; o < out_dim; o++) {
+        const uint16_t *w = W_f16 + (size_t)o * in_dim;
+        __m512 a = _mm512_setzero_ps();
+        int k = 0;
+        for (; k + 16 <= in_dim; k += 16)
+            a = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(w + k))),
+                                _mm512_loadu_ps(x + k), a);
+        float s = _mm512_reduce_add_ps(a) + (bias ? bias[o] : 0.0f);
+        for (; k < in_dim; k++) s += _cvtsh_ss(w[k]) * x[k];
+        y[o] = s;
+    }
+}
+
+void qwen_f16_to_f32_buf_avx(float *dst, const uint16_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(src + i))));
+    for (; i < n; i++) dst[i] = _cvtsh_ss(src[i]);
+}
+
+#else /* AVX2 */
+
+static inline float hsum256_ps(__m256 v) {
+    __m128 r = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    r = _mm_hadd_ps(r, r);
+    r = _mm_hadd_ps(r, r);
+    return _mm_cvtss_f32(r);
+}
+
+void qwen_f16_matvec_fused_avx(float *y, const float *x, const uint16_t *W_f16,
+                               const float *bias, int in_dim, int out_dim) {
+    int o = 0;
+    for (; o + 3 < out_dim; o += 4) {
+        const uint16_t *w0 = W_f16 + (size_t)o * in_dim;
+        const uint16_t *w1 = w0 + in_dim;
+        const uint16_t *w2 = w1 + in_dim;
+        const uint16_t *w3 = w2 + in_dim;
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        int k = 0;
+
+        for (; k + 8 <= in_dim; k += 8) {
+            __m256 xv = _mm256_loadu_ps(x + k);
+            a0 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(w0 + k))), xv, a0);
+            a1 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(w1 + k))), xv, a1);
+            a2 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(w2 + k))), xv, a2);
+            a3 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(w3 + k))), xv, a3);
+        }
+
+        float s0 = hsum256_ps(a0) + (bias ? bias[o]   : 0.0f);
+        float s1 = hsum256_ps(a1) + (bias ? bias[o+1] : 0.0f);
+        float s2 = hsum256_ps(a2) + (bias ? bias[o+2] : 0.0f);
+        float s3 = hsum256_ps(a3) + (bias ? bias[o+3] : 0.0f);
+        for (; k < in_dim; k++) {
+            float xk = x[k];
+            s0 += _cvtsh_ss(w0[k]) * xk; s1 += _cvtsh_ss(w1[k]) * xk;
+            s2 += _cvtsh_ss(w2[k]) * xk; s3 += _cvtsh_ss(w3[k]) * xk;
+        }
+        y[o]=s0; y[o+1]=s1; y[o+2]=s2; y[o+3]=s3;
+    }
+
+    for (; o < out_dim; o++) {
+        const uint16_t *w = W_f16 + (size_t)o * in_dim;
+        __m256 a = _mm256_setzero_ps();
+        int k = 0;
+        for (; k + 8 <= in_dim; k += 8)
+            a = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(w + k))),
+                                _mm256_loadu_ps(x + k), a);
+        float s = hsum256_ps(a) + (bias ? bias[o] : 0.0f);
+        for (; k < in_dim; k++) s += _cvtsh_ss(w[k]) * x[k];
+        y[o] = s;
+    }
+}
+
+void qwen_f16_to_f32_buf_avx(float *dst, const uint16_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i))));
+    for (; i < n; i++) dst[i] = _cvtsh_ss(src[i]);
+}
+
+#endif /* __AVX512F__ */
+
+#endif /* __F16C__ */
+
 #endif /* __AVX2__ && __FMA__ */
@@ -2,6 +2,7 @@
  * qwen_asr_kernels_generic.c - architecture-generic hot kernels
  */
 
+#include "qwen_asr_kernels.h"
 #include "qwen_asr_kernels_impl.h"
 
 #include <string.h>
@@ -63,3 +64,77 @@ void qwen_vec_axpy_inplace_generic(float *dst, const float *src, float alpha, in
 void qwen_vec_scale_add_generic(float *dst, const float *src, float correction, int n) {
     for (int i = 0; i < n; i++) dst[i] = dst[i] * correction + src[i];
 }
+
+void qwen_q8_dot_4x4_generic(int32_t *out, const int8_t *const *a,
+                             const int8_t *const *b, const int32_t *bsum, int k) {
+    (void)bsum;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            int32_t sum = 0;
+            for (int t = 0; t < k; t++) sum += (int32_t)a[i][t] * b[j][t];
+            out[i * 4 + j] = sum;
+        }
+    }
+}
+
+static inline float sp24_bf16_to_f32(uint16_t v) {
+    uint32_t bits = ((uint32_t)v) << 16;
+    float f;
+    memcpy(&f, &bits, sizeof(float));
+    return f;
+}
+
+void qwen_sp24_matvec_generic(float *y, const float *x, const uint16_t *vals,
+                              const uint8_t *idx, int in_dim, int out_dim) {
+    int n_bytes = in_dim / 8;
+    for (int o = 0; o < out_dim; o++) {
+        const uint16_t *v = vals + (size_t)o * (in_dim / 2);
+        const uint8_t *ix = idx + (size_t)o * n_bytes;
+        float sum = 0.0f;
+        for (int b = 0; b < n_bytes; b++) {
+            const float *xg = x + 8 * b;
+            unsigned m = ix[b];
+            sum += sp24_bf16_to_f32(v[4 * b])     * xg[m & 3]
+                 + sp24_bf16_to_f32(v[4 * b + 1]) * xg[(m >> 2) & 3]
+                 + sp24_bf16_to_f32(v[4 * b + 2]) * xg[4 + ((m >> 4) & 3)]
+                 + sp24_bf16_to_f32(v[4 * b + 3]) * xg[4 + (m >> 6)];
+        }
+        y[o] = sum;
+    }
+}
+
+float qwen_f16_to_f32_scalar(uint16_t h) {
+    uint32_t sign = ((uint32_t)h & 0x8000u) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t man = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000u | (man << 13);
+    } else if (exp != 0) {
+        bits = sign | ((exp + 112) << 23) | (man << 13);
+    } else if (man == 0) {
+        bits = sign;
+    } else {
+        /* Subnormal: renormalize the mantissa */
+        exp = 113;
+        while (!(man & 0x400)) { man <<= 1; exp--; }
+        bits = sign | (exp << 23) | ((man & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(float));
+    return f;
+}
+
+void qwen_f16_matvec_fused_generic(float *y, const float *x, const uint16_t *W_f16,
+                                   const float *bias, int in_dim, int out_dim) {
+    for (int o = 0; o < out_dim; o++) {
+        const uint16_t *w_row = W_f16 + (size_t)o * in_dim;
+        float sum = bias ? bias[o] : 0.0f;
+        for (int k = 0; k < in_dim; k++) sum += qwen_f16_to_f32_scalar(w_row[k]) * x[k];
+        y[o] = sum;
+    }
+}
+
+void qwen_f16_to_f32_buf_generic(float *dst, const uint16_t *src, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = qwen_f16_to_f32_scalar(src[i]);
+}
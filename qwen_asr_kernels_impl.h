@@ -5,6 +5,7 @@
 #ifndef QWEN_ASR_KERNELS_IMPL_H
 #define QWEN_ASR_KERNELS_IMPL_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 void qwen_bf16_matvec_fused_generic(float *y, const float *x, const uint16_t *W_bf16,
@@ -16,6 +17,18 @@ float qwen_dot_f32_generic(const float *a, const float *b, int n);
 void qwen_vec_scale_inplace_generic(float *dst, float scale, int n);
 void qwen_vec_axpy_inplace_generic(float *dst, const float *src, float alpha, int n);
 void qwen_vec_scale_add_generic(float *dst, const float *src, float correction, int n);
+/* out[i*4+j] = dot(a[i], b[j]) over k int8 values (k % 64 == 0), i, j < 4.
+ * Values must lie in [-127, 127]; bsum[j] is the sum of b[j]. */
+void qwen_q8_dot_4x4_generic(int32_t *out, const int8_t *const *a,
+                             const int8_t *const *b, const int32_t *bsum, int k);
+/* y[out_dim] = W @ x for a 2:4 sparse W (see qwen_linear_nobias_sp24):
+ * vals [out_dim, in_dim/2] bf16, idx [out_dim, in_dim/8]; in_dim % 8 == 0. */
+void qwen_sp24_matvec_generic(float *y, const float *x, const uint16_t *vals,
+                              const uint8_t *idx, int in_dim, int out_dim);
+/* IEEE fp16 weights: matvec as for bf16, and a plain buffer conversion */
+void qwen_f16_matvec_fused_generic(float *y, const float *x, const uint16_t *W_f16,
+                                   const float *bias, int in_dim, int out_dim);
+void qwen_f16_to_f32_buf_generic(float *dst, const uint16_t *src, size_t n);
 
 #ifdef __ARM_NEON
 void qwen_bf16_matvec_fused_neon(float *y, const float *x, const uint16_t *W_bf16,
@@ -27,6 +40,13 @@ float qwen_dot_f32_neon(const float *a, const float *b, int n);
 void qwen_vec_scale_inplace_neon(float *dst, float scale, int n);
 void qwen_vec_axpy_inplace_neon(float *dst, const float *src, float alpha, int n);
 void qwen_vec_scale_add_neon(float *dst, const float *src, float correction, int n);
+void qwen_q8_dot_4x4_neon(int32_t *out, const int8_t *const *a,
+                          const int8_t *const *b, const int32_t *bsum, int k);
+void qwen_sp24_matvec_neon(float *y, const float *x, const uint16_t *vals,
+                           const uint8_t *idx, int in_dim, int out_dim);
+void qwen_f16_matvec_fused_neon(float *y, const float *x, const uint16_t *W_f16,
+                                const float *bias, int in_dim, int out_dim);
+void qwen_f16_to_f32_buf_neon(float *dst, const uint16_t *src, size_t n);
 
 #define qwen_bf16_matvec_fused_impl qwen_bf16_matvec_fused_neon
 #define qwen_argmax_bf16_range_impl qwen_argmax_bf16_range_neon
@@ -34,6 +54,10 @@ void qwen_vec_scale_add_neon(float *dst, const float *src, float correction, int
 #define qwen_vec_scale_inplace_impl qwen_vec_scale_inplace_neon
 #define qwen_vec_axpy_inplace_impl qwen_vec_axpy_inplace_neon
 #define qwen_vec_scale_add_impl qwen_vec_scale_add_neon
+#define qwen_q8_dot_4x4_impl qwen_q8_dot_4x4_neon
+#define qwen_sp24_matvec_impl qwen_sp24_matvec_neon
+#define qwen_f16_matvec_fused_impl qwen_f16_matvec_fused_neon
+#define qwen_f16_to_f32_buf_impl qwen_f16_to_f32_buf_neon
 
 #elif defined(__AVX2__) && defined(__FMA__)
 void qwen_bf16_matvec_fused_avx(float *y, const float *x, const uint16_t *W_bf16,
@@ -45,6 +69,13 @@ float qwen_dot_f32_avx(const float *a, const float *b, int n);
 void qwen_vec_scale_inplace_avx(float *dst, float scale, int n);
 void qwen_vec_axpy_inplace_avx(float *dst, const float *src, float alpha, int n);
 void qwen_vec_scale_add_avx(float *dst, const float *src, float correction, int n);
+void qwen_q8_dot_4x4_avx(int32_t *out, const int8_t *const *a,
+                         const int8_t *const *b, const int32_t *bsum, int k);
+void qwen_sp24_matvec_avx(float *y, const float *x, const uint16_t *vals,
+                          const uint8_t *idx, int in_dim, int out_dim);
+void qwen_f16_matvec_fused_avx(float *y, const float *x, const uint16_t *W_f16,
+                               const float *bias, int in_dim, int out_dim);
+void qwen_f16_to_f32_buf_avx(float *dst, const uint16_t *src, size_t n);
 
 #define qwen_bf16_matvec_fused_impl qwen_bf16_matvec_fused_avx
 #define qwen_argmax_bf16_range_impl qwen_argmax_bf16_range_avx
@@ -52,6 +83,16 @@ void qwen_vec_scale_add_avx(float *dst, const float *src, float correction, int
 #define qwen_vec_scale_inplace_impl qwen_vec_scale_inplace_avx
 #define qwen_vec_axpy_inplace_impl qwen_vec_axpy_inplace_avx
 #define qwen_vec_scale_add_impl qwen_vec_scale_add_avx
+#define qwen_q8_dot_4x4_impl qwen_q8_dot_4x4_avx
+#define qwen_sp24_matvec_impl qwen_sp24_matvec_avx
+/* fp16 conversion needs F16C (vcvtph2ps), which every AVX2 CPU has */
+#if defined(__F16C__)
+#define qwen_f16_matvec_fused_impl qwen_f16_matvec_fused_avx
+#define qwen_f16_to_f32_buf_impl qwen_f16_to_f32_buf_avx
+#else
+#define qwen_f16_matvec_fused_impl qwen_f16_matvec_fused_generic
+#define qwen_f16_to_f32_buf_impl qwen_f16_to_f32_buf_generic
+#endif
 
 #else
 #define qwen_bf16_matvec_fused_impl qwen_bf16_matvec_fused_generic
@@ -60,6 +101,10 @@ void qwen_vec_scale_add_avx(float *dst, const float *src, float correction, int
 #define qwen_vec_scale_inplace_impl qwen_vec_scale_inplace_generic
 #define qwen_vec_axpy_inplace_impl qwen_vec_axpy_inplace_generic
 #define qwen_vec_scale_add_impl qwen_vec_scale_add_generic
+#define qwen_q8_dot_4x4_impl qwen_q8_dot_4x4_generic
+#define qwen_sp24_matvec_impl qwen_sp24_matvec_generic
+#define qwen_f16_matvec_fused_impl qwen_f16_matvec_fused_generic
+#define qwen_f16_to_f32_buf_impl qwen_f16_to_f32_buf_generic
 #endif
 
 #endif /* QWEN_ASR_KERNELS_IMPL_H */
@@ -271,4 +271,149 @@ void qwen_vec_scale_add_neon(float *dst, const float *src, float correction, int
     for (; i < n; i++) dst[i] = dst[i] * correction + src[i];
 }
 
+/* =====================================================================
+ * int8 GEMM tile: SDOT when the core has it (ARMv8.2 dotprod),
+ * widening multiply + pairwise accumulate otherwise.
+ * ===================================================================== */
+
+static inline int32x4_t q8_dot16(int32x4_t acc, int8x16_t a, int8x16_t b) {
+#if defined(__ARM_FEATURE_DOTPROD)
+    return vdotq_s32(acc, a, b);
+#else
+    int16x8_t lo = vmull_s8(vget_low_s8(a), vget_low_s8(b));
+    int16x8_t hi = vmull_s8(vget_high_s8(a), vget_high_s8(b));
+    acc = vpadalq_s16(acc, lo);
+    return vpadalq_s16(acc, hi);
+#endif
+}
+
+void qwen_q8_dot_4x4_neon(int32_t *out, const int8_t *const *a,
+                          const int8_t *const *b, const int32_t *bsum, int k) {
+    (void)bsum;
+    int32x4_t c[16];
+    for (int i = 0; i < 16; i++) c[i] = vdupq_n_s32(0);
+
+    for (int t = 0; t < k; t += 16) {
+        int8x16_t w0 = vld1q_s8(b[0] + t), w1 = vld1q_s8(b[1] + t);
+        int8x16_t w2 = vld1q_s8(b[2] + t), w3 = vld1q_s8(b[3] + t);
+        for (int i = 0; i < 4; i++) {
+            int8x16_t x = vld1q_s8(a[i] + t);
+            c[i * 4 + 0] = q8_dot16(c[i * 4 + 0], x, w0);
+            c[i * 4 + 1] = q8_dot16(c[i * 4 + 1], x, w1);
+            c[i * 4 + 2] = q8_dot16(c[i * 4 + 2], x, w2);
+            c[i * 4 + 3] = q8_dot16(c[i * 4 + 3], x, w3);
+        }
+    }
+
+    for (int i = 0; i < 16; i++) out[i] = vaddvq_s32(c[i]);
+}
+
+/* 2:4 sparse bf16 matvec. Each idx byte holds the offsets of two groups
+ * of 4 columns; they become byte indices for a TBL over the 8 x values the
+ * two groups cover, gathering the 4 x values that meet the kept weights. */
+void qwen_sp24_matvec_neon(float *y, const float *x, const uint16_t *vals,
+                           const uint8_t *idx, int in_dim, int out_dim) {
+    const int32_t shift_v[4] = { 0, -2, -4, -6 };
+    const uint32_t base_v[4] = { 0, 0, 4, 4 };
+    const int32x4_t shifts = vld1q_s32(shift_v);
+    const uint32x4_t base = vld1q_u32(base_v);
+    const uint32x4_t three = vdupq_n_u32(3);
+    const uint32x4_t byte_off = vdupq_n_u32(0x03020100u);
+    int half = in_dim / 2, n_bytes = in_dim / 8;
+
+    for (int o = 0; o < out_dim; o++) {
+        const uint16_t *v = vals + (size_t)o * half;
+        const uint8_t *ix = idx + (size_t)o * n_bytes;
+        float32x4_t a0 = vdupq_n_f32(0.0f), a1 = vdupq_n_f32(0.0f);
+        int b = 0;
+
+        for (; b + 1 < n_bytes; b += 2) {
+            uint32x4_t l0 = vaddq_u32(vandq_u32(vshlq_u32(vdupq_n_u32(ix[b]), shifts), three), base);
+            uint32x4_t l1 = vaddq_u32(vandq_u32(vshlq_u32(vdupq_n_u32(ix[b + 1]), shifts), three), base);
+            uint8x16_t t0 = vreinterpretq_u8_u32(vmlaq_n_u32(byte_off, l0, 0x04040404u));
+            uint8x16_t t1 = vreinterpretq_u8_u32(vmlaq_n_u32(byte_off, l1, 0x04040404u));
+            uint8x16x2_t x0, x1;
+            x0.val[0] = vreinterpretq_u8_f32(vld1q_f32(x + 8 * b));
+            x0.val[1] = vreinterpretq_u8_f32(vld1q_f32(x + 8 * b + 4));
+            x1.val[0] = vreinterpretq_u8_f32(vld1q_f32(x + 8 * b + 8));
+            x1.val[1] = vreinterpretq_u8_f32(vld1q_f32(x + 8 * b + 12));
+            float32x4_t g0 = vreinterpretq_f32_u8(vqtbl2q_u8(x0, t0));
+            float32x4_t g1 = vreinterpretq_f32_u8(vqtbl2q_u8(x1, t1));
+            uint16x8_t raw = vld1q_u16(v + 4 * b);
+            a0 = vfmaq_f32(a0, vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(raw), 16)), g0);
+            a1 = vfmaq_f32(a1, vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(raw), 16)), g1);
+        }
+
+        float sum = vaddvq_f32(vaddq_f32(a0, a1));
+        for (; b < n_bytes; b++) {
+            const float *xg = x + 8 * b;
+            unsigned m = ix[b];
+            float w[4];
+            for (int j = 0; j < 4; j++) {
+                uint32_t bits = (uint32_t)v[4 * b + j] << 16;
+                memcpy(&w[j], &bits, 4);
+            }
+            sum += w[0] * xg[m & 3] + w[1] * xg[(m >> 2) & 3] +
+                   w[2] * xg[4 + ((m >> 4) & 3)] + w[3] * xg[4 + (m >> 6)];
+        }
+        y[o] = sum;
+    }
+}
+
+/* fp16 weights: vcvt_f32_f16 widens the IEEE halves (base ARMv8), the
+ * products accumulate in f32. 2 output rows at a time, 8 elements/iter. */
+static inline float f16_scalar(uint16_t v) {
+    __fp16 h;
+    memcpy(&h, &v, sizeof(h));
+    return (float)h;
+}
+
+static inline float32x4_t f16x4_load(const uint16_t *p) {
+    return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)));
+}
+
+void qwen_f16_matvec_fused_neon(float *y, const float *x, const uint16_t *W_f16,
+                                const float *bias, int in_dim, int out_dim) {
+    int o = 0;
+    for (; o + 1 < out_dim; o += 2) {
+        const uint16_t *w0 = W_f16 + (size_t)o * in_dim;
+        const uint16_t *w1 = w0 + in_dim;
+        float32x4_t a0 = vdupq_n_f32(0.0f), a1 = vdupq_n_f32(0.0f);
+        float32x4_t b0 = vdupq_n_f32(0.0f), b1 = vdupq_n_f32(0.0f);
+        int k = 0;
+        for (; k + 8 <= in_dim; k += 8) {
+            float32x4_t x0 = vld1q_f32(x + k);
+            float32x4_t x1 = vld1q_f32(x + k + 4);
+            a0 = vfmaq_f32(a0, f16x4_load(w0 + k), x0);
+            a1 = vfmaq_f32(a1, f16x4_load(w0 + k + 4), x1);
+            b0 = vfmaq_f32(b0, f16x4_load(w1 + k), x0);
+            b1 = vfmaq_f32(b1, f16x4_load(w1 + k + 4), x1);
+        }
+        float s0 = vaddvq_f32(vaddq_f32(a0, a1)) + (bias ? bias[o] : 0.0f);
+        float s1 = vaddvq_f32(vaddq_f32(b0, b1)) + (bias ? bias[o + 1] : 0.0f);
+        for (; k < in_dim; k++) {
+            s0 += f16_scalar(w0[k]) * x[k];
+            s1 += f16_scalar(w1[k]) * x[k];
+        }
+        y[o] = s0;
+        y[o + 1] = s1;
+    }
+
+    for (; o < out_dim; o++) {
+        const uint16_t *w = W_f16 + (size_t)o * in_dim;
+        float32x4_t a = vdupq_n_f32(0.0f);
+        int k = 0;
+        for (; k + 4 <= in_dim; k += 4) a = vfmaq_f32(a, f16x4_load(w + k), vld1q_f32(x + k));
+        float s = vaddvq_f32(a) + (bias ? bias[o] : 0.0f);
+        for (; k < in_dim; k++) s += f16_scalar(w[k]) * x[k];
+        y[o] = s;
+    }
+}
+
+void qwen_f16_to_f32_buf_neon(float *dst, const uint16_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, f16x4_load(src + i));
+    for (; i < n; i++) dst[i] = f16_scalar(src[i]);
+}
+
 #endif /* __ARM_NEON */
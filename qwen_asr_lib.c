@@ -0,0 +1,287 @@
+/*
+ * qwen_asr_lib.c - Embeddable C API (see qwen_asr_lib.h)
+ *
+ * Thin layer over qwen_asr.h: a model is a loaded qwen_ctx_t, sessions are
+ * qwen_clone() contexts sharing its weights, and streams run
+ * qwen_transcribe_stream_live() on a dedicated thread fed through a
+ * caller-pushed live buffer. Per-call diagnostics use the session's own
+ * verbosity (qwen_verbose is thread-local).
+ */
+
+#include "qwen_asr_lib.h"
+#include "qwen_asr.h"
+#include "qwen_asr_audio.h"
+#include "qwen_asr_kernels.h"
+#include "qwen_asr_topology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+
+struct qwen_asr_model {
+    qwen_ctx_t *ctx;
+};
+
+struct qwen_asr_session {
+    qwen_ctx_t *ctx;
+    int verbose;
+    qwen_asr_stream_t *stream;
+};
+
+struct qwen_asr_stream {
+    qwen_asr_session_t *session;
+    qwen_live_audio_t *live;
+    pthread_t thread;
+    char *text;
+};
+
+/* Run with the session's diagnostics on the calling thread. */
+#define SESSION_ENTER(s) \
+    int saved_verbose__ = qwen_verbose, saved_monitor__ = qwen_monitor; \
+    qwen_verbose = (s)->verbose; qwen_monitor = 0
+#define SESSION_LEAVE() \
+    qwen_verbose = saved_verbose__; qwen_monitor = saved_monitor__
+
+int qwen_asr_abi_version(void) {
+    return QWEN_ASR_ABI_VERSION;
+}
+
+qwen_asr_model_t *qwen_asr_model_load(const char *model_dir, int n_threads) {
+    if (!model_dir) return NULL;
+    if (n_threads > 0) {
+        if (n_threads != qwen_get_threads()) qwen_set_threads(n_threads);
+    } else if (qwen_get_threads() <= 1) {
+        qwen_set_threads(qwen_get_num_cpus());
+    }
+
+    qwen_asr_model_t *model = (qwen_asr_model_t *)calloc(1, sizeof(qwen_asr_model_t));
+    if (!model) return NULL;
+    int saved_verbose = qwen_verbose;
+    qwen_verbose = 0;
+    model->ctx = qwen_load(model_dir);
+    qwen_verbose = saved_verbose;
+    if (!model->ctx) {
+        free(model);
+        return NULL;
+    }
+    return model;
+}
+
+int qwen_asr_set_pool_threads(int n_threads) {
+    qwen_set_threads(n_threads > 0 ? n_threads : qwen_probe_usable_cpus());
+    return qwen_get_threads();
+}
+
+void qwen_asr_model_free(qwen_asr_model_t *model) {
+    if (!model) return;
+    qwen_free(model->ctx);
+    free(model);
+}
+
+qwen_asr_session_t *qwen_asr_session_create(qwen_asr_model_t *model) {
+    if (!model) return NULL;
+    qwen_asr_session_t *s = (qwen_asr_session_t *)calloc(1, sizeof(qwen_asr_session_t));
+    if (!s) return NULL;
+    s->ctx = qwen_clone(model->ctx);
+    if (!s->ctx) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void qwen_asr_session_free(qwen_asr_session_t *session) {
+    if (!session) return;
+    if (session->stream) qwen_asr_free_string(qwen_asr_stream_finish(session->stream));
+    qwen_free(session->ctx);
+    free(session);
+}
+
+int qwen_asr_session_set_option(qwen_asr_session_t *session, int option, double value) {
+    if (!session) return -1;
+    qwen_ctx_t *ctx = session->ctx;
+    int iv = (int)value;
+    switch (option) {
+        case QWEN_ASR_OPT_VERBOSE:
+            session->verbose = iv > 0 ? iv : 0;
+            break;
+        case QWEN_ASR_OPT_SEGMENT_SEC:
+            qwen_set_segment_sec(ctx, (float)value);
+            break;
+        case QWEN_ASR_OPT_SEARCH_SEC:
+            qwen_set_search_sec(ctx, (float)value);
+            break;
+        case QWEN_ASR_OPT_PAST_TEXT:
+            qwen_set_past_text_conditioning(ctx, iv);
+            break;
+        case QWEN_ASR_OPT_SKIP_SILENCE:
+            ctx->skip_silence = iv ? 1 : 0;
+            break;
+        case QWEN_ASR_OPT_STREAM_CHUNK_SEC:
+            qwen_set_stream_chunk_sec(ctx, (float)value);
+            break;
+        case QWEN_ASR_OPT_STREAM_MAX_NEW_TOKENS:
+            if (iv > 0) ctx->stream_max_new_tokens = iv;
+            break;
+        case QWEN_ASR_OPT_STREAM_ENDPOINT_MS:
+            qwen_set_stream_endpoint_ms(ctx, iv);
+            break;
+        case QWEN_ASR_OPT_STREAM_PIPELINE:
+            qwen_set_stream_pipeline(ctx, iv);
+            break;
+        case QWEN_ASR_OPT_PRIORITY:
+            qwen_set_priority(ctx, iv);
+            break;
+        case QWEN_ASR_OPT_TRIM_POLICY:
+            qwen_set_trim_policy(ctx, iv, ctx->trim_baseline_tokens);
+            break;
+        case QWEN_ASR_OPT_TRIM_BASELINE_TOKENS:
+            qwen_set_trim_policy(ctx, ctx->trim_policy, iv);
+            break;
+        case QWEN_ASR_OPT_TRIM_IDLE_SEC:
+            qwen_set_trim_idle_sec(ctx, (float)value);
+            break;
+        case QWEN_ASR_OPT_STREAM_DRAFT_LAYERS:
+            qwen_set_stream_draft(ctx, iv, -1, 0);
+            break;
+        case QWEN_ASR_OPT_STREAM_DRAFT_TOKENS:
+            qwen_set_stream_draft(ctx, -1, iv, 0);
+            break;
+        case QWEN_ASR_OPT_STREAM_FINAL_EVERY:
+            qwen_set_stream_draft(ctx, -1, -1, iv);
+            break;
+        case QWEN_ASR_OPT_THREADS:
+            qwen_set_job_threads(ctx, iv);
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+int qwen_asr_session_set_prompt(qwen_asr_session_t *session, const char *prompt) {
+    if (!session) return -1;
+    return qwen_set_prompt(session->ctx, prompt);
+}
+
+int qwen_asr_session_set_language(qwen_asr_session_t *session, const char *language) {
+    if (!session) return -1;
+    return qwen_set_force_language(session->ctx, language);
+}
+
+void qwen_asr_session_set_callbacks(qwen_asr_session_t *session,
+                                    qwen_asr_text_cb on_token,
+                                    qwen_asr_text_cb on_partial,
+                                    qwen_asr_text_cb on_endpoint,
+                                    void *userdata) {
+    if (!session) return;
+    qwen_set_token_callback(session->ctx, on_token, userdata);
+    qwen_set_partial_callback(session->ctx, on_partial, userdata);
+    qwen_set_endpoint_callback(session->ctx, on_endpoint, userdata);
+}
+
+char *qwen_asr_transcribe_pcm(qwen_asr_session_t *session,
+                              const float *samples, size_t n_samples) {
+    if (!session || !samples || n_samples > INT_MAX || session->stream) return NULL;
+    SESSION_ENTER(session);
+    char *text = qwen_transcribe_audio(session->ctx, samples, (int)n_samples);
+    SESSION_LEAVE();
+    return text;
+}
+
+char *qwen_asr_transcribe_wav(qwen_asr_session_t *session,
+                              const void *data, size_t size) {
+    if (!session || !data || session->stream) return NULL;
+    SESSION_ENTER(session);
+    int n_samples = 0;
+    float *samples = qwen_parse_wav_buffer((const uint8_t *)data, size, &n_samples);
+    char *text = samples ? qwen_transcribe_audio(session->ctx, samples, n_samples) : NULL;
+    free(samples);
+    SESSION_LEAVE();
+    return text;
+}
+
+void qwen_asr_free_string(char *text) {
+    free(text);
+}
+
+static void *stream_thread_main(void *arg) {
+    qwen_asr_stream_t *st = (qwen_asr_stream_t *)arg;
+    qwen_verbose = st->session->verbose;
+    qwen_monitor = 0;
+    st->text = qwen_transcribe_stream_live(st->session->ctx, st->live);
+    return NULL;
+}
+
+static qwen_asr_stream_t *stream_start(qwen_asr_session_t *session, const char *shm_path) {
+    if (!session || session->stream) return NULL;
+    qwen_asr_stream_t *st = (qwen_asr_stream_t *)calloc(1, sizeof(qwen_asr_stream_t));
+    if (!st) return NULL;
+    st->session = session;
+    st->live = shm_path ? qwen_live_audio_attach_shm(shm_path) : qwen_live_audio_create();
+    if (!st->live) {
+        free(st);
+        return NULL;
+    }
+    if (pthread_create(&st->thread, NULL, stream_thread_main, st) != 0) {
+        fprintf(stderr, "qwen_asr_stream_start: failed to create stream thread\n");
+        qwen_live_audio_free(st->live);
+        free(st);
+        return NULL;
+    }
+    session->stream = st;
+    return st;
+}
+
+qwen_asr_stream_t *qwen_asr_stream_start(qwen_asr_session_t *session) {
+    return stream_start(session, NULL);
+}
+
+qwen_asr_stream_t *qwen_asr_stream_start_shm(qwen_asr_session_t *session, const char *path) {
+    if (!path) return NULL;
+    return stream_start(session, path);
+}
+
+int qwen_asr_stream_push(qwen_asr_stream_t *stream, const float *samples, size_t n_samples) {
+    if (!stream || (!samples && n_samples > 0) || stream->live->ring) return -1;
+    while (n_samples > 0) {
+        int n = n_samples > (size_t)(INT_MAX / 2) ? INT_MAX / 2 : (int)n_samples;
+        qwen_live_audio_push(stream->live, samples, n);
+        samples += n;
+        n_samples -= (size_t)n;
+    }
+    return 0;
+}
+
+char *qwen_asr_stream_finish(qwen_asr_stream_t *stream) {
+    if (!stream) return NULL;
+    qwen_live_audio_close(stream->live);
+    pthread_join(stream->thread, NULL);
+    qwen_live_audio_free(stream->live);
+    char *text = stream->text;
+    stream->session->stream = NULL;
+    free(stream);
+    return text;
+}
+
+int qwen_asr_session_get_stats(const qwen_asr_session_t *session, qwen_asr_stats_t *stats) {
+    if (!session || !stats || stats->struct_size < sizeof(uint32_t)) return -1;
+    const qwen_ctx_t *ctx = session->ctx;
+    qwen_asr_stats_t full;
+    memset(&full, 0, sizeof(full));
+    full.struct_size = stats->struct_size;
+    full.text_tokens = ctx->perf_text_tokens;
+    full.total_ms = ctx->perf_total_ms;
+    full.audio_ms = ctx->perf_audio_ms;
+    full.encode_ms = ctx->perf_encode_ms;
+    full.decode_ms = ctx->perf_decode_ms;
+    size_t n = stats->struct_size < sizeof(full) ? stats->struct_size : sizeof(full);
+    memcpy(stats, &full, n);
+    return 0;
+}
+
+char *qwen_asr_session_flight_json(const qwen_asr_session_t *session) {
+    if (!session) return NULL;
+    return qwen_flight_dump_json(session->ctx);
+}
@@ -0,0 +1,141 @@
+/*
+ * qwen_asr_lib.h - Embeddable C API for libqwen_asr
+ *
+ * Stable ABI over the engine: opaque handles, plain C types, no structs
+ * whose layout can change under the caller (qwen_asr_stats_t carries its
+ * own size). Everything else in the tree is internal and may change.
+ *
+ * A model holds the weights and is shared by any number of sessions.
+ * A session holds per-caller settings, callbacks and decoder buffers;
+ * calls on one session must not overlap, calls on different sessions may
+ * come from different threads (they share the process-wide compute pool,
+ * see the priority and threads options).
+ */
+
+#ifndef QWEN_ASR_LIB_H
+#define QWEN_ASR_LIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped on incompatible changes; the shared object's soname follows it. */
+#define QWEN_ASR_ABI_VERSION 1
+
+typedef struct qwen_asr_model qwen_asr_model_t;
+typedef struct qwen_asr_session qwen_asr_session_t;
+typedef struct qwen_asr_stream qwen_asr_stream_t;
+
+/* Text callback: committed token pieces, interim tails or finalized
+ * utterances depending on where it is installed. */
+typedef void (*qwen_asr_text_cb)(const char *text, void *userdata);
+
+/* Session options (qwen_asr_session_set_option) */
+enum {
+    QWEN_ASR_OPT_VERBOSE = 1,            /* stderr diagnostics level (default 0) */
+    QWEN_ASR_OPT_SEGMENT_SEC,            /* offline segmentation, 0 = off */
+    QWEN_ASR_OPT_SEARCH_SEC,             /* segment boundary search window */
+    QWEN_ASR_OPT_PAST_TEXT,              /* 1 = condition on previous text */
+    QWEN_ASR_OPT_SKIP_SILENCE,           /* 1 = drop long silent spans */
+    QWEN_ASR_OPT_STREAM_CHUNK_SEC,       /* streaming chunk size */
+    QWEN_ASR_OPT_STREAM_MAX_NEW_TOKENS,  /* tokens generated per stream chunk */
+    QWEN_ASR_OPT_STREAM_ENDPOINT_MS,     /* utterance endpoint silence, 0 = off */
+    QWEN_ASR_OPT_STREAM_PIPELINE,        /* 1 = pipelined live encoding */
+    QWEN_ASR_OPT_PRIORITY,               /* 0 = interactive, 1 = batch */
+    QWEN_ASR_OPT_TRIM_POLICY,            /* 0 = none, 1 = trim after each call */
+    QWEN_ASR_OPT_TRIM_BASELINE_TOKENS,   /* decoder positions kept warm */
+    QWEN_ASR_OPT_TRIM_IDLE_SEC,          /* paused stream offload delay, 0 = off */
+    QWEN_ASR_OPT_STREAM_DRAFT_LAYERS,    /* two-pass draft decoder layers, 0 = off */
+    QWEN_ASR_OPT_STREAM_DRAFT_TOKENS,    /* tokens generated per draft, 0 = max_new */
+    QWEN_ASR_OPT_STREAM_FINAL_EVERY,     /* two-pass full-quality chunk interval */
+    QWEN_ASR_OPT_THREADS                 /* compute pool share per call, 0 = whole pool */
+};
+
+typedef struct {
+    uint32_t struct_size;    /* caller sets sizeof(qwen_asr_stats_t) */
+    int32_t text_tokens;
+    double total_ms;
+    double audio_ms;
+    double encode_ms;
+    double decode_ms;
+} qwen_asr_stats_t;
+
+/* Runtime ABI version (compare with QWEN_ASR_ABI_VERSION). */
+int qwen_asr_abi_version(void);
+
+/* Load a model directory. n_threads sizes the process-wide compute pool
+ * (0 = keep the current pool, or all CPUs if none exists yet).
+ * Returns NULL on error. */
+qwen_asr_model_t *qwen_asr_model_load(const char *model_dir, int n_threads);
+
+/* Resize the process-wide compute pool while sessions are running: a
+ * shrink parks the surplus workers, a grow wakes parked ones or adds new
+ * ones; nothing is torn down. 0 = re-read the affinity mask and container
+ * CPU quota now (e.g. after a cgroup resize) and size the pool to it.
+ * Returns the new pool size. */
+int qwen_asr_set_pool_threads(int n_threads);
+
+/* Free a model. All of its sessions must be freed first. */
+void qwen_asr_model_free(qwen_asr_model_t *model);
+
+qwen_asr_session_t *qwen_asr_session_create(qwen_asr_model_t *model);
+void qwen_asr_session_free(qwen_asr_session_t *session);
+
+/* Returns 0 on success, -1 for an unknown option. */
+int qwen_asr_session_set_option(qwen_asr_session_t *session, int option, double value);
+
+/* NULL or "" clears. Returns 0 on success, -1 on error / unknown language. */
+int qwen_asr_session_set_prompt(qwen_asr_session_t *session, const char *prompt);
+int qwen_asr_session_set_language(qwen_asr_session_t *session, const char *language);
+
+/* Any callback may be NULL. Called on the thread running the transcription
+ * (the stream thread for qwen_asr_stream_*). */
+void qwen_asr_session_set_callbacks(qwen_asr_session_t *session,
+                                    qwen_asr_text_cb on_token,
+                                    qwen_asr_text_cb on_partial,
+                                    qwen_asr_text_cb on_endpoint,
+                                    void *userdata);
+
+/* Transcribe mono float32 16 kHz PCM. The buffer is read in place (not
+ * copied). Returns text to release with qwen_asr_free_string(), or NULL. */
+char *qwen_asr_transcribe_pcm(qwen_asr_session_t *session,
+                              const float *samples, size_t n_samples);
+
+/* Transcribe an in-memory WAV or FLAC file (any rate, mixed to mono). */
+char *qwen_asr_transcribe_wav(qwen_asr_session_t *session,
+                              const void *data, size_t size);
+
+void qwen_asr_free_string(char *text);
+
+/* Live streaming: start a stream on the session (one at a time), push
+ * mono float32 16 kHz audio as it arrives, then finish to flush the tail
+ * and get the full text. Token/partial/endpoint callbacks fire from the
+ * stream's own thread while audio is pushed. */
+qwen_asr_stream_t *qwen_asr_stream_start(qwen_asr_session_t *session);
+int qwen_asr_stream_push(qwen_asr_stream_t *stream, const float *samples, size_t n_samples);
+char *qwen_asr_stream_finish(qwen_asr_stream_t *stream);
+
+/* Live stream fed by another process through a shared-memory ring
+ * (qwen_asr_shm.h; the producer links qwen_asr_shm.c). Samples are read
+ * in place, with no push calls; the stream ends when the producer closes
+ * the ring or on qwen_asr_stream_finish(). Linux only. Returns NULL if
+ * path is not a ring. */
+qwen_asr_stream_t *qwen_asr_stream_start_shm(qwen_asr_session_t *session, const char *path);
+
+/* Stats of the last transcription or finished stream on the session.
+ * Fills at most stats->struct_size bytes. Returns 0 on success. */
+int qwen_asr_session_get_stats(const qwen_asr_session_t *session, qwen_asr_stats_t *stats);
+
+/* Per-chunk timings of the session's recent streams (its last 256 chunks)
+ * as JSON. Callable from any thread, also while a stream runs. Free with
+ * qwen_asr_free_string(). */
+char *qwen_asr_session_flight_json(const qwen_asr_session_t *session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QWEN_ASR_LIB_H */
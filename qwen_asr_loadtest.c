@@ -0,0 +1,682 @@
+/*
+ * qwen_asr_loadtest.c - Concurrent live-stream load test
+ *
+ * Replays WAV files at real-time pace into N simultaneous live streams and
+ * reports per-chunk processing latency, caption lag (chunk commit time minus
+ * the time its last audio sample arrived) and CPU utilization. Streams are
+ * qwen_clone() sessions in this process, or with --procs N child processes
+ * running `qwen_asr --stream --stdin --chunk-stats`. --ramp searches for the
+ * largest N whose p95 lag stays within --max-lag. Runs fully offline.
+ */
+
+#include "qwen_asr.h"
+#include "qwen_asr_audio.h"
+#include "qwen_asr_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define LT_BLOCK_SAMPLES 1600          /* 100 ms feed blocks */
+#define LT_READY_TIMEOUT_SEC 300       /* --procs: child model load limit */
+#define LT_MAX_FILES 4096
+
+typedef struct {
+    const char *model_dir;
+    const char *binary;
+    int use_procs;
+    int n_threads;
+    int stream_threads;                /* in-process pool share per stream, 0 = whole pool */
+    double duration_sec;
+    double max_lag_sec;
+    float *audio;                      /* all input WAVs, concatenated */
+    int64_t n_audio;
+} lt_opts_t;
+
+typedef struct {
+    double *lat_ms;                    /* per-chunk processing time */
+    double *lag_ms;                    /* per-chunk caption lag */
+    int n, cap;
+} lt_record_t;
+
+typedef struct {
+    const lt_opts_t *opt;
+    int64_t start_offset;              /* where this stream starts in opt->audio */
+    double t0_ms;                      /* wall time of stream audio time 0 */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int started;                       /* t0_ms valid, feeding may begin */
+    int failed;
+
+    /* in-process */
+    qwen_ctx_t *ctx;
+    qwen_live_audio_t *live;
+    char *text;
+
+    /* --procs */
+    pid_t pid;
+    int in_fd;
+    int err_fd;
+
+    lt_record_t rec;
+    pthread_t feeder, worker;
+} lt_stream_t;
+
+typedef struct {
+    int n_streams;
+    int n_chunks;
+    double lat_p50, lat_p95, lat_p99;
+    double lag_p50, lag_p95, lag_p99, lag_max;
+    double lag_growth_ms;              /* worst last-quarter minus first-quarter mean */
+    double cpu_pct;
+    int ok;
+} lt_result_t;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void sleep_until_ms(double t) {
+    double d = t - now_ms();
+    if (d <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)(d / 1000.0);
+    ts.tv_nsec = (long)((d - ts.tv_sec * 1000.0) * 1e6);
+    nanosleep(&ts, NULL);
+}
+
+static double cpu_seconds(int who) {
+    struct rusage ru;
+    getrusage(who, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+           ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+static void record_chunk(lt_stream_t *st, double total_ms, double audio_sec) {
+    lt_record_t *r = &st->rec;
+    if (r->n == r->cap) {
+        int cap = r->cap ? r->cap * 2 : 256;
+        double *lat = (double *)realloc(r->lat_ms, (size_t)cap * sizeof(double));
+        if (!lat) return;
+        r->lat_ms = lat;
+        double *lag = (double *)realloc(r->lag_ms, (size_t)cap * sizeof(double));
+        if (!lag) return;
+        r->lag_ms = lag;
+        r->cap = cap;
+    }
+    double lag = now_ms() - (st->t0_ms + audio_sec * 1000.0);
+    r->lat_ms[r->n] = total_ms;
+    r->lag_ms[r->n] = lag > 0 ? lag : 0;
+    r->n++;
+}
+
+/* ========================================================================
+ * Input Audio
+ * ======================================================================== */
+
+static int has_wav_suffix(const char *name) {
+    size_t n = strlen(name);
+    return n > 4 && strcmp(name + n - 4, ".wav") == 0;
+}
+
+/* Collect *.wav under dir (and one level of subdirectories). */
+static void collect_wavs(const char *dir, int depth, char **paths, int *n_paths) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL && *n_paths < LT_MAX_FILES) {
+        if (de->d_name[0] == '.') continue;
+        size_t len = strlen(dir) + strlen(de->d_name) + 2;
+        char *path = (char *)malloc(len);
+        if (!path) break;
+        snprintf(path, len, "%s/%s", dir, de->d_name);
+        if (has_wav_suffix(de->d_name)) {
+            paths[(*n_paths)++] = path;
+            continue;
+        }
+        DIR *sub = depth > 0 ? opendir(path) : NULL;
+        if (sub) {
+            closedir(sub);
+            collect_wavs(path, depth - 1, paths, n_paths);
+        }
+        free(path);
+    }
+    closedir(d);
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static int append_wav(lt_opts_t *opt, const char *path) {
+    int n = 0;
+    float *s = qwen_load_wav(path, &n);
+    if (!s || n <= 0) {
+        free(s);
+        fprintf(stderr, "Warning: skipping %s\n", path);
+        return 0;
+    }
+    float *tmp = (float *)realloc(opt->audio, (size_t)(opt->n_audio + n) * sizeof(float));
+    if (!tmp) {
+        free(s);
+        return -1;
+    }
+    memcpy(tmp + opt->n_audio, s, (size_t)n * sizeof(float));
+    opt->audio = tmp;
+    opt->n_audio += n;
+    free(s);
+    return 0;
+}
+
+/* ========================================================================
+ * Feeding
+ * ======================================================================== */
+
+/* Wait until the stream may start (--procs: child loaded its model). */
+static int wait_started(lt_stream_t *st) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += LT_READY_TIMEOUT_SEC;
+    pthread_mutex_lock(&st->mutex);
+    while (!st->started && !st->failed) {
+        if (pthread_cond_timedwait(&st->cond, &st->mutex, &deadline) == ETIMEDOUT) {
+            st->failed = 1;
+            break;
+        }
+    }
+    int ok = st->started && !st->failed;
+    pthread_mutex_unlock(&st->mutex);
+    return ok;
+}
+
+static int write_all(int fd, const void *buf, size_t n) {
+    const uint8_t *p = (const uint8_t *)buf;
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+/* Push audio in 100 ms blocks, each as soon as its last sample is due. */
+static void *feeder_main(void *arg) {
+    lt_stream_t *st = (lt_stream_t *)arg;
+    const lt_opts_t *opt = st->opt;
+    if (!wait_started(st)) goto done;
+
+    int64_t total = (int64_t)(opt->duration_sec * QWEN_SAMPLE_RATE);
+    int64_t pos = st->start_offset;
+    float block[LT_BLOCK_SAMPLES];
+    int16_t pcm[LT_BLOCK_SAMPLES];
+    for (int64_t sent = 0; sent < total; ) {
+        int n = total - sent < LT_BLOCK_SAMPLES ? (int)(total - sent) : LT_BLOCK_SAMPLES;
+        for (int i = 0; i < n; i++) {
+            block[i] = opt->audio[pos];
+            if (++pos >= opt->n_audio) pos = 0;
+        }
+        sent += n;
+        sleep_until_ms(st->t0_ms + 1000.0 * (double)sent / QWEN_SAMPLE_RATE);
+        if (st->live) {
+            qwen_live_audio_push(st->live, block, n);
+        } else {
+            for (int i = 0; i < n; i++) {
+                float v = block[i] * 32767.0f;
+                if (v > 32767.0f) v = 32767.0f;
+                if (v < -32768.0f) v = -32768.0f;
+                pcm[i] = (int16_t)lrintf(v);
+            }
+            if (write_all(st->in_fd, pcm, (size_t)n * sizeof(int16_t)) != 0) break;
+        }
+    }
+
+done:
+    if (st->live) qwen_live_audio_close(st->live);
+    if (st->in_fd >= 0) {
+        close(st->in_fd);
+        st->in_fd = -1;
+    }
+    return NULL;
+}
+
+/* ========================================================================
+ * In-process Streams
+ * ======================================================================== */
+
+static void on_chunk(const qwen_chunk_stats_t *cs, void *userdata) {
+    record_chunk((lt_stream_t *)userdata, cs->total_ms, cs->audio_sec);
+}
+
+static void *stream_worker_main(void *arg) {
+    lt_stream_t *st = (lt_stream_t *)arg;
+    qwen_verbose = 0;
+    st->text = qwen_transcribe_stream_live(st->ctx, st->live);
+    return NULL;
+}
+
+/* ========================================================================
+ * Child Processes (--procs)
+ * ======================================================================== */
+
+static pid_t spawn_child(const lt_opts_t *opt, int threads, int *in_fd, int *err_fd) {
+    int in_pipe[2], err_pipe[2];
+    if (pipe(in_pipe) != 0) return -1;
+    if (pipe(err_pipe) != 0) {
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "spawn_child: fork failed: %s\n", strerror(errno));
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        char tbuf[16];
+        snprintf(tbuf, sizeof(tbuf), "%d", threads);
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(in_pipe[0], 0);
+        dup2(devnull >= 0 ? devnull : err_pipe[1], 1);
+        dup2(err_pipe[1], 2);
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        if (devnull >= 0) close(devnull);
+        execl(opt->binary, opt->binary, "-d", opt->model_dir, "--stream", "--stdin",
+              "--chunk-stats", "-t", tbuf, (char *)NULL);
+        _exit(127);
+    }
+    close(in_pipe[0]);
+    close(err_pipe[1]);
+    fcntl(in_pipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(err_pipe[0], F_SETFD, FD_CLOEXEC);
+    *in_fd = in_pipe[1];
+    *err_fd = err_pipe[0];
+    return pid;
+}
+
+/* Read the child's stderr: start the audio clock at "Model loaded.", then
+ * record chunk_stats lines. */
+static void *child_reader_main(void *arg) {
+    lt_stream_t *st = (lt_stream_t *)arg;
+    FILE *f = fdopen(st->err_fd, "r");
+    if (!f) {
+        close(st->err_fd);
+        pthread_mutex_lock(&st->mutex);
+        st->failed = 1;
+        pthread_cond_broadcast(&st->cond);
+        pthread_mutex_unlock(&st->mutex);
+        return NULL;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (!st->started && strncmp(line, "Model loaded.", 13) == 0) {
+            pthread_mutex_lock(&st->mutex);
+            st->t0_ms = now_ms();
+            st->started = 1;
+            pthread_cond_broadcast(&st->cond);
+            pthread_mutex_unlock(&st->mutex);
+            continue;
+        }
+        int chunk;
+        double audio, enc, dec, total;
+        if (sscanf(line, "chunk_stats chunk=%d audio=%lf enc_ms=%lf dec_ms=%lf total_ms=%lf",
+                   &chunk, &audio, &enc, &dec, &total) == 5)
+            record_chunk(st, total, audio);
+    }
+    fclose(f);
+    pthread_mutex_lock(&st->mutex);
+    if (!st->started) st->failed = 1;
+    pthread_cond_broadcast(&st->cond);
+    pthread_mutex_unlock(&st->mutex);
+    return NULL;
+}
+
+/* ========================================================================
+ * One Load Level
+ * ======================================================================== */
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, double p) {
+    if (n <= 0) return 0;
+    int i = (int)ceil(p * n) - 1;
+    if (i < 0) i = 0;
+    if (i >= n) i = n - 1;
+    return sorted[i];
+}
+
+static void summarize(lt_stream_t *streams, int n, double cpu_pct,
+                      const lt_opts_t *opt, lt_result_t *res) {
+    memset(res, 0, sizeof(*res));
+    res->n_streams = n;
+    res->cpu_pct = cpu_pct;
+    int total = 0;
+    for (int i = 0; i < n; i++) total += streams[i].rec.n;
+    double *lat = (double *)malloc((size_t)(total > 0 ? total : 1) * sizeof(double));
+    double *lag = (double *)malloc((size_t)(total > 0 ? total : 1) * sizeof(double));
+    if (!lat || !lag) {
+        free(lat);
+        free(lag);
+        return;
+    }
+    int k = 0, failed = 0;
+    for (int i = 0; i < n; i++) {
+        lt_record_t *r = &streams[i].rec;
+        if (streams[i].failed || r->n == 0) failed = 1;
+        memcpy(lat + k, r->lat_ms, (size_t)r->n * sizeof(double));
+        memcpy(lag + k, r->lag_ms, (size_t)r->n * sizeof(double));
+        k += r->n;
+
+        /* Backlog growth: mean lag of the last quarter vs the first */
+        int q = r->n / 4;
+        if (q > 0) {
+            double first = 0, last = 0;
+            for (int j = 0; j < q; j++) {
+                first += r->lag_ms[j];
+                last += r->lag_ms[r->n - 1 - j];
+            }
+            double growth = (last - first) / q;
+            if (growth > res->lag_growth_ms) res->lag_growth_ms = growth;
+        }
+    }
+    qsort(lat, (size_t)total, sizeof(double), cmp_double);
+    qsort(lag, (size_t)total, sizeof(double), cmp_double);
+    res->n_chunks = total;
+    res->lat_p50 = percentile(lat, total, 0.50);
+    res->lat_p95 = percentile(lat, total, 0.95);
+    res->lat_p99 = percentile(lat, total, 0.99);
+    res->lag_p50 = percentile(lag, total, 0.50);
+    res->lag_p95 = percentile(lag, total, 0.95);
+    res->lag_p99 = percentile(lag, total, 0.99);
+    res->lag_max = total > 0 ? lag[total - 1] : 0;
+    double max_lag_ms = opt->max_lag_sec * 1000.0;
+    res->ok = !failed && total > 0 && res->lag_p95 <= max_lag_ms &&
+              res->lag_growth_ms <= max_lag_ms / 2;
+    free(lat);
+    free(lag);
+}
+
+static int run_level(const lt_opts_t *opt, qwen_ctx_t *model, int n, lt_result_t *res) {
+    lt_stream_t *streams = (lt_stream_t *)calloc((size_t)n, sizeof(lt_stream_t));
+    if (!streams) return -1;
+    int n_usable = qwen_get_num_cpus();
+    int child_threads = opt->n_threads > 0 ? opt->n_threads
+                      : (n_usable / n > 0 ? n_usable / n : 1);
+
+    double cpu0 = cpu_seconds(opt->use_procs ? RUSAGE_CHILDREN : RUSAGE_SELF);
+    double wall0 = now_ms();
+    int n_started = 0;
+    for (int i = 0; i < n; i++) {
+        lt_stream_t *st = &streams[i];
+        st->opt = opt;
+        st->start_offset = (int64_t)((double)opt->n_audio * i / n);
+        st->in_fd = st->err_fd = -1;
+        pthread_mutex_init(&st->mutex, NULL);
+        pthread_cond_init(&st->cond, NULL);
+
+        if (opt->use_procs) {
+            st->pid = spawn_child(opt, child_threads, &st->in_fd, &st->err_fd);
+            if (st->pid < 0) {
+                fprintf(stderr, "Failed to start %s\n", opt->binary);
+                break;
+            }
+            pthread_create(&st->worker, NULL, child_reader_main, st);
+        } else {
+            st->ctx = qwen_clone(model);
+            st->live = st->ctx ? qwen_live_audio_create() : NULL;
+            if (!st->live) {
+                qwen_free(st->ctx);
+                st->ctx = NULL;
+                fprintf(stderr, "Failed to create stream %d\n", i);
+                break;
+            }
+            qwen_set_past_text_conditioning(st->ctx, 1);
+            qwen_set_job_threads(st->ctx, opt->stream_threads);
+            qwen_set_chunk_callback(st->ctx, on_chunk, st);
+            pthread_create(&st->worker, NULL, stream_worker_main, st);
+        }
+        pthread_create(&st->feeder, NULL, feeder_main, st);
+        n_started++;
+    }
+
+    /* In-process streams share one audio clock */
+    if (!opt->use_procs) {
+        double t0 = now_ms();
+        for (int i = 0; i < n_started; i++) {
+            pthread_mutex_lock(&streams[i].mutex);
+            streams[i].t0_ms = t0;
+            streams[i].started = 1;
+            pthread_cond_broadcast(&streams[i].cond);
+            pthread_mutex_unlock(&streams[i].mutex);
+        }
+    }
+
+    for (int i = 0; i < n_started; i++) {
+        lt_stream_t *st = &streams[i];
+        pthread_join(st->feeder, NULL);
+        pthread_join(st->worker, NULL);
+        if (opt->use_procs) {
+            int status = 0;
+            waitpid(st->pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) st->failed = 1;
+        }
+    }
+    double wall_s = (now_ms() - wall0) / 1000.0;
+    double cpu_s = cpu_seconds(opt->use_procs ? RUSAGE_CHILDREN : RUSAGE_SELF) - cpu0;
+    double cpu_pct = wall_s > 0 ? 100.0 * cpu_s / (wall_s * n_usable) : 0;
+
+    summarize(streams, n_started, cpu_pct, opt, res);
+    if (n_started < n) res->ok = 0;
+    res->n_streams = n;
+
+    for (int i = 0; i < n_started; i++) {
+        lt_stream_t *st = &streams[i];
+        if (st->live) qwen_live_audio_free(st->live);
+        qwen_free(st->ctx);
+        free(st->text);
+        free(st->rec.lat_ms);
+        free(st->rec.lag_ms);
+        pthread_mutex_destroy(&st->mutex);
+        pthread_cond_destroy(&st->cond);
+    }
+    free(streams);
+    return 0;
+}
+
+static void print_header(void) {
+    printf("%7s %7s %9s %9s %9s %9s %9s %9s %9s %6s  %s\n",
+           "streams", "chunks", "lat_p50", "lat_p95", "lat_p99",
+           "lag_p50", "lag_p95", "lag_p99", "lag_max", "cpu%", "status");
+}
+
+static void print_result(const lt_result_t *r) {
+    printf("%7d %7d %9.0f %9.0f %9.0f %9.0f %9.0f %9.0f %9.0f %6.1f  %s\n",
+           r->n_streams, r->n_chunks, r->lat_p50, r->lat_p95, r->lat_p99,
+           r->lag_p50, r->lag_p95, r->lag_p99, r->lag_max, r->cpu_pct,
+           r->ok ? "ok" : "overloaded");
+    fflush(stdout);
+}
+
+/* ========================================================================
+ * Main
+ * ======================================================================== */
+
+static void usage(const char *prog) {
+    fprintf(stderr, "qwen_asr_loadtest — concurrent live-stream load test\n\n");
+    fprintf(stderr, "Usage: %s -d <model_dir> (-n <streams> | --ramp <max>) [options]\n\n", prog);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -n <n>             Run n concurrent streams\n");
+    fprintf(stderr, "  --ramp <max>       Find the largest sustainable stream count <= max\n");
+    fprintf(stderr, "  -i <file.wav>      Input audio (repeatable; default: all WAVs under samples/)\n");
+    fprintf(stderr, "  --samples <dir>    Directory to take WAVs from (default: samples)\n");
+    fprintf(stderr, "  --duration <secs>  Audio replayed per stream and level (default: 60)\n");
+    fprintf(stderr, "  --max-lag <secs>   p95 caption lag a sustainable level may reach (default: 2.0)\n");
+    fprintf(stderr, "  -t <n>             Threads (in-process pool, or per child with --procs;\n");
+    fprintf(stderr, "                     default: all usable CPUs / CPUs per child)\n");
+    fprintf(stderr, "  --stream-threads <n> Pool threads per in-process stream; streams whose\n");
+    fprintf(stderr, "                     shares fit run side by side (default: whole pool)\n");
+    fprintf(stderr, "  --procs            Run each stream as a `qwen_asr --stream --stdin` process\n");
+    fprintf(stderr, "  --binary <path>    qwen_asr binary for --procs (default: ./qwen_asr)\n");
+    fprintf(stderr, "\nLatency is per-chunk processing time; lag is chunk commit time minus\n");
+    fprintf(stderr, "the arrival time of the chunk's last audio sample (both in ms).\n");
+}
+
+int main(int argc, char **argv) {
+    lt_opts_t opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.binary = "./qwen_asr";
+    opt.duration_sec = 60.0;
+    opt.max_lag_sec = 2.0;
+    const char *samples_dir = "samples";
+    const char *inputs[LT_MAX_FILES];
+    int n_inputs = 0;
+    int n_streams = 0, ramp_max = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            opt.model_dir = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n_streams = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ramp") == 0 && i + 1 < argc) {
+            ramp_max = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            if (n_inputs < LT_MAX_FILES) inputs[n_inputs++] = argv[++i];
+            else i++;
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples_dir = argv[++i];
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            opt.duration_sec = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-lag") == 0 && i + 1 < argc) {
+            opt.max_lag_sec = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            opt.n_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stream-threads") == 0 && i + 1 < argc) {
+            opt.stream_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--procs") == 0) {
+            opt.use_procs = 1;
+        } else if (strcmp(argv[i], "--binary") == 0 && i + 1 < argc) {
+            opt.binary = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!opt.model_dir || (n_streams <= 0 && ramp_max <= 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.duration_sec <= 0 || opt.max_lag_sec <= 0) {
+        fprintf(stderr, "Error: --duration and --max-lag must be > 0\n");
+        return 1;
+    }
+
+    /* Input audio */
+    if (n_inputs > 0) {
+        for (int i = 0; i < n_inputs; i++)
+            if (append_wav(&opt, inputs[i]) != 0) return 1;
+    } else {
+        char **paths = (char **)malloc(LT_MAX_FILES * sizeof(char *));
+        int n_paths = 0;
+        if (!paths) return 1;
+        collect_wavs(samples_dir, 1, paths, &n_paths);
+        qsort(paths, (size_t)n_paths, sizeof(char *), cmp_str);
+        for (int i = 0; i < n_paths; i++) {
+            if (append_wav(&opt, paths[i]) != 0) return 1;
+            free(paths[i]);
+        }
+        free(paths);
+    }
+    if (opt.n_audio <= 0) {
+        fprintf(stderr, "No input audio (use -i or --samples)\n");
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    qwen_ctx_t *model = NULL;
+    if (!opt.use_procs) {
+        qwen_set_threads(opt.n_threads > 0 ? opt.n_threads : qwen_get_num_cpus());
+        model = qwen_load(opt.model_dir);
+        if (!model) {
+            fprintf(stderr, "Failed to load model from %s\n", opt.model_dir);
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "Load test: %.0f s of audio per stream, %.1f s of input, %s, max p95 lag %.1f s\n",
+            opt.duration_sec, (double)opt.n_audio / QWEN_SAMPLE_RATE,
+            opt.use_procs ? "one process per stream" : "in-process sessions",
+            opt.max_lag_sec);
+    print_header();
+
+    lt_result_t res;
+    int rc = 0;
+    if (ramp_max <= 0) {
+        run_level(&opt, model, n_streams, &res);
+        print_result(&res);
+        rc = res.ok ? 0 : 2;
+    } else {
+        /* Double until overloaded, then bisect between the last good and
+         * the first overloaded count. */
+        int good = 0, bad = ramp_max + 1;
+        for (int n = 1; n <= ramp_max; n *= 2) {
+            run_level(&opt, model, n, &res);
+            print_result(&res);
+            if (!res.ok) {
+                bad = n;
+                break;
+            }
+            good = n;
+        }
+        if (bad == ramp_max + 1 && good < ramp_max) {
+            run_level(&opt, model, ramp_max, &res);
+            print_result(&res);
+            if (res.ok) good = ramp_max;
+            else bad = ramp_max;
+        }
+        while (bad - good > 1) {
+            int mid = good + (bad - good) / 2;
+            run_level(&opt, model, mid, &res);
+            print_result(&res);
+            if (res.ok) good = mid;
+            else bad = mid;
+        }
+        printf("max sustainable streams: %d\n", good);
+    }
+
+    qwen_free(model);
+    free(opt.audio);
+    return rc;
+}
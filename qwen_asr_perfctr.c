@@ -0,0 +1,150 @@
+/*
+ * qwen_asr_perfctr.c - Hardware performance counters (see qwen_asr_perfctr.h)
+ *
+ * Each counter is its own inherited perf event on this process (user space
+ * only), so reads sum all threads including pool workers started later.
+ * Events are not grouped: inherited groups cannot be read as a whole, and a
+ * PMU short of slots drops one counter rather than all. Multiplexed counts
+ * are scaled by time enabled / time running. Counters are process-wide, so
+ * work overlapping a phase on other threads (the pipelined stream encoder)
+ * is attributed to it too.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "qwen_asr_perfctr.h"
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define PERF_N_COUNTERS 4
+
+static int perf_fd[PERF_N_COUNTERS] = { -1, -1, -1, -1 };
+static unsigned perf_mask = 0;
+static int perf_opened = 0;
+
+static const char *phase_names[QWEN_N_PHASES] = {
+    "mel", "encoder", "prefill", "decode", "argmax"
+};
+
+static double perf_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+#ifdef __linux__
+
+static int perf_open_event(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    return fd >= 0 ? (int)fd : -1;
+}
+
+static uint64_t perf_read_scaled(int fd) {
+    uint64_t buf[3];
+    if (read(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf)) return 0;
+    if (buf[2] == 0) return 0;
+    if (buf[2] >= buf[1]) return buf[0];
+    return (uint64_t)((double)buf[0] * (double)buf[1] / (double)buf[2]);
+}
+
+#endif /* __linux__ */
+
+unsigned qwen_perf_counters_open(void) {
+    if (perf_opened) return perf_mask;
+    perf_opened = 1;
+#ifdef __linux__
+    static const struct { uint32_t type; uint64_t config; } events[PERF_N_COUNTERS] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    };
+    for (int i = 0; i < PERF_N_COUNTERS; i++) {
+        perf_fd[i] = perf_open_event(events[i].type, events[i].config);
+        if (perf_fd[i] >= 0) perf_mask |= 1u << i;
+    }
+#endif
+    return perf_mask;
+}
+
+unsigned qwen_perf_counters_mask(void) {
+    return perf_mask;
+}
+
+void qwen_phase_begin(qwen_perf_sample_t *start) {
+    if (!perf_mask) return;
+    for (int i = 0; i < PERF_N_COUNTERS; i++) {
+#ifdef __linux__
+        start->value[i] = perf_fd[i] >= 0 ? perf_read_scaled(perf_fd[i]) : 0;
+#else
+        start->value[i] = 0;
+#endif
+    }
+    start->t_ms = perf_now_ms();
+}
+
+void qwen_phase_end(qwen_phase_counts_t *acc, const qwen_perf_sample_t *start) {
+    if (!perf_mask) return;
+    double t_ms = perf_now_ms();
+    uint64_t delta[PERF_N_COUNTERS] = { 0 };
+    for (int i = 0; i < PERF_N_COUNTERS; i++) {
+#ifdef __linux__
+        uint64_t v = perf_fd[i] >= 0 ? perf_read_scaled(perf_fd[i]) : 0;
+        if (v > start->value[i]) delta[i] = v - start->value[i];
+#endif
+    }
+    acc->calls++;
+    acc->ms += t_ms - start->t_ms;
+    acc->cycles += delta[0];
+    acc->instructions += delta[1];
+    acc->llc_misses += delta[2];
+    acc->task_clock_ns += delta[3];
+}
+
+const char *qwen_phase_name(int phase) {
+    return phase >= 0 && phase < QWEN_N_PHASES ? phase_names[phase] : "unknown";
+}
+
+void qwen_perf_print_phases(FILE *f, const qwen_phase_counts_t *phases) {
+    if (!perf_mask) return;
+    long line = 64;
+#if defined(__linux__) && defined(_SC_LEVEL1_DCACHE_LINESIZE)
+    long l = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    if (l > 0) line = l;
+#endif
+    for (int p = 0; p < QWEN_N_PHASES; p++) {
+        const qwen_phase_counts_t *c = &phases[p];
+        if (c->calls == 0) continue;
+        fprintf(f, "perf_counters phase=%s calls=%d ms=%.1f", phase_names[p], c->calls, c->ms);
+        if (perf_mask & QWEN_PERF_TASK_CLOCK)
+            fprintf(f, " cpu_ms=%.1f", c->task_clock_ns / 1e6);
+        if (perf_mask & QWEN_PERF_CYCLES)
+            fprintf(f, " cycles=%llu", (unsigned long long)c->cycles);
+        if (perf_mask & QWEN_PERF_INSTRUCTIONS)
+            fprintf(f, " instructions=%llu", (unsigned long long)c->instructions);
+        if ((perf_mask & QWEN_PERF_CYCLES) && (perf_mask & QWEN_PERF_INSTRUCTIONS))
+            fprintf(f, " ipc=%.2f", c->cycles ? (double)c->instructions / (double)c->cycles : 0.0);
+        if (perf_mask & QWEN_PERF_LLC_MISSES) {
+            double gbs = c->ms > 0 ? (double)c->llc_misses * (double)line / (c->ms * 1e6) : 0.0;
+            fprintf(f, " llc_misses=%llu dram_gbs=%.2f", (unsigned long long)c->llc_misses, gbs);
+        }
+        fprintf(f, "\n");
+    }
+    fflush(f);
+}
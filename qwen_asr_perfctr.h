@@ -0,0 +1,69 @@
+/*
+ * qwen_asr_perfctr.h - Hardware performance counters per inference phase
+ *
+ * Optional process-wide counters (Linux perf_event_open): cycles,
+ * instructions, last-level cache misses and task clock, read around the
+ * mel, encoder, prefill, decode and argmax phases. Tells apart memory
+ * bandwidth limited hosts (low IPC, high GB/s) from compute limited ones.
+ */
+
+#ifndef QWEN_ASR_PERFCTR_H
+#define QWEN_ASR_PERFCTR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+enum {
+    QWEN_PHASE_MEL,
+    QWEN_PHASE_ENCODER,
+    QWEN_PHASE_PREFILL,
+    QWEN_PHASE_DECODE,                  /* includes its argmax */
+    QWEN_PHASE_ARGMAX,                  /* final norm + vocab argmax, every token */
+    QWEN_N_PHASES
+};
+
+/* Counters in the qwen_perf_counters_open() mask */
+#define QWEN_PERF_CYCLES       (1u << 0)
+#define QWEN_PERF_INSTRUCTIONS (1u << 1)
+#define QWEN_PERF_LLC_MISSES   (1u << 2)
+#define QWEN_PERF_TASK_CLOCK   (1u << 3)
+
+/* One snapshot of the open counters, taken at the start of a phase */
+typedef struct {
+    double t_ms;
+    uint64_t value[4];                  /* indexed by counter bit */
+} qwen_perf_sample_t;
+
+/* Accumulated counts of one phase */
+typedef struct {
+    int calls;
+    double ms;                          /* wall time */
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t llc_misses;                /* x cache line size ~ DRAM bytes */
+    uint64_t task_clock_ns;             /* CPU time summed over threads */
+} qwen_phase_counts_t;
+
+/* Open the counters for this process. Counting covers the calling thread
+ * and threads created afterwards, so call it before qwen_set_threads().
+ * Returns the mask of counters that could be opened (0 = none: no perf
+ * support, a VM without a PMU or perf_event_paranoid too strict). */
+unsigned qwen_perf_counters_open(void);
+
+/* Mask of open counters (0 = collection off, phase calls are no-ops) */
+unsigned qwen_perf_counters_mask(void);
+
+/* Snapshot the counters at the start of a phase */
+void qwen_phase_begin(qwen_perf_sample_t *start);
+
+/* Add the counts since start to acc */
+void qwen_phase_end(qwen_phase_counts_t *acc, const qwen_perf_sample_t *start);
+
+const char *qwen_phase_name(int phase);
+
+/* One "perf_counters phase=<name> ..." line per phase that ran, with IPC
+ * and approximate DRAM GB/s (LLC misses x line size / wall time). Counters
+ * that are not open are left out. */
+void qwen_perf_print_phases(FILE *f, const qwen_phase_counts_t *phases);
+
+#endif /* QWEN_ASR_PERFCTR_H */
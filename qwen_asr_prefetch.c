@@ -0,0 +1,172 @@
+/*
+ * qwen_asr_prefetch.c - Read-ahead loader (see qwen_asr_prefetch.h)
+ *
+ * Each input gets a sequence number when a reader reserves it, and its
+ * slot is seq % lookahead: no more than lookahead inputs are outstanding
+ * (reserved but not handed out), so live slots never collide. One reader
+ * at a time reads the next path (pf->reading), so inputs keep their order;
+ * both the path read and the load run outside the lock.
+ */
+
+#include "qwen_asr_prefetch.h"
+#include "qwen_asr_audio.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    long seq;                           /* input this slot holds */
+    int done;                           /* loaded (or failed), not handed out */
+    char *path;
+    float *samples;
+    int n_samples;
+} prefetch_slot_t;
+
+struct qwen_prefetch {
+    FILE *paths;
+    int lookahead;
+    size_t mem_cap;
+    pthread_t *threads;
+    int n_threads;
+    prefetch_slot_t *slots;
+
+    pthread_mutex_t lock;
+    pthread_cond_t can_load;            /* readers: a slot or memory freed up */
+    pthread_cond_t ready;               /* consumer: an input finished loading */
+    long next_seq;                      /* taken from the path stream */
+    long out_seq;                       /* handed out */
+    size_t held_bytes;                  /* samples loaded and waiting */
+    int eof;
+    int stop;
+    int reading;                        /* a reader owns the path stream */
+    char *line;                         /* getline buffer, owned by the reader */
+    size_t line_cap;
+};
+
+/* Next non-blank path, or NULL at end of input. Called without the lock,
+ * by the one reader that set pf->reading. */
+static char *read_path(qwen_prefetch_t *pf) {
+    while (getline(&pf->line, &pf->line_cap, pf->paths) > 0) {
+        size_t n = strlen(pf->line);
+        while (n > 0 && (pf->line[n - 1] == '\n' || pf->line[n - 1] == '\r'))
+            pf->line[--n] = '\0';
+        if (n > 0) return strdup(pf->line);
+    }
+    return NULL;
+}
+
+static void *reader_main(void *arg) {
+    qwen_prefetch_t *pf = (qwen_prefetch_t *)arg;
+    pthread_mutex_lock(&pf->lock);
+    for (;;) {
+        while (!pf->stop && !pf->eof &&
+               (pf->reading || pf->next_seq - pf->out_seq >= pf->lookahead ||
+                pf->held_bytes >= pf->mem_cap))
+            pthread_cond_wait(&pf->can_load, &pf->lock);
+        if (pf->stop || pf->eof) break;
+
+        /* Reserve the next input, then read its path unlocked */
+        long seq = pf->next_seq++;
+        pf->reading = 1;
+        pthread_mutex_unlock(&pf->lock);
+        char *path = read_path(pf);
+        pthread_mutex_lock(&pf->lock);
+        pf->reading = 0;
+        pthread_cond_broadcast(&pf->can_load);
+        if (!path) {
+            pf->next_seq--;             /* no reservation was made after ours */
+            pf->eof = 1;
+            pthread_cond_broadcast(&pf->ready);
+            break;
+        }
+        pthread_mutex_unlock(&pf->lock);
+
+        int n = 0;
+        float *samples = qwen_load_wav(path, &n);
+
+        pthread_mutex_lock(&pf->lock);
+        prefetch_slot_t *s = &pf->slots[seq % pf->lookahead];
+        s->seq = seq;
+        s->done = 1;
+        s->path = path;
+        s->samples = samples;
+        s->n_samples = samples ? n : 0;
+        pf->held_bytes += (size_t)s->n_samples * sizeof(float);
+        pthread_cond_broadcast(&pf->ready);
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return NULL;
+}
+
+qwen_prefetch_t *qwen_prefetch_start(FILE *paths, int lookahead, size_t mem_cap) {
+    if (lookahead < 1) return NULL;
+    qwen_prefetch_t *pf = (qwen_prefetch_t *)calloc(1, sizeof(qwen_prefetch_t));
+    if (!pf) return NULL;
+    pf->paths = paths;
+    pf->lookahead = lookahead;
+    pf->mem_cap = mem_cap;
+    pf->slots = (prefetch_slot_t *)calloc((size_t)lookahead, sizeof(prefetch_slot_t));
+    pf->threads = (pthread_t *)calloc((size_t)lookahead, sizeof(pthread_t));
+    if (!pf->slots || !pf->threads) {
+        free(pf->slots);
+        free(pf->threads);
+        free(pf);
+        return NULL;
+    }
+    pthread_mutex_init(&pf->lock, NULL);
+    pthread_cond_init(&pf->can_load, NULL);
+    pthread_cond_init(&pf->ready, NULL);
+
+    for (; pf->n_threads < lookahead; pf->n_threads++) {
+        if (pthread_create(&pf->threads[pf->n_threads], NULL, reader_main, pf) != 0) break;
+    }
+    if (pf->n_threads == 0) {
+        fprintf(stderr, "qwen_prefetch_start: cannot start reader threads\n");
+        qwen_prefetch_free(pf);
+        return NULL;
+    }
+    return pf;
+}
+
+int qwen_prefetch_next(qwen_prefetch_t *pf, char **path, float **samples, int *n_samples) {
+    pthread_mutex_lock(&pf->lock);
+    prefetch_slot_t *s = &pf->slots[pf->out_seq % pf->lookahead];
+    while (!(s->done && s->seq == pf->out_seq) && !(pf->eof && pf->out_seq == pf->next_seq))
+        pthread_cond_wait(&pf->ready, &pf->lock);
+    if (!s->done || s->seq != pf->out_seq) {
+        pthread_mutex_unlock(&pf->lock);
+        return 0;
+    }
+    *path = s->path;
+    *samples = s->samples;
+    *n_samples = s->n_samples;
+    pf->held_bytes -= (size_t)s->n_samples * sizeof(float);
+    s->done = 0;
+    s->path = NULL;
+    s->samples = NULL;
+    pf->out_seq++;
+    pthread_cond_broadcast(&pf->can_load);
+    pthread_mutex_unlock(&pf->lock);
+    return 1;
+}
+
+void qwen_prefetch_free(qwen_prefetch_t *pf) {
+    if (!pf) return;
+    pthread_mutex_lock(&pf->lock);
+    pf->stop = 1;
+    pthread_cond_broadcast(&pf->can_load);
+    pthread_mutex_unlock(&pf->lock);
+    for (int i = 0; i < pf->n_threads; i++) pthread_join(pf->threads[i], NULL);
+
+    for (int i = 0; i < pf->lookahead; i++) {
+        free(pf->slots[i].path);
+        free(pf->slots[i].samples);
+    }
+    pthread_cond_destroy(&pf->ready);
+    pthread_cond_destroy(&pf->can_load);
+    pthread_mutex_destroy(&pf->lock);
+    free(pf->line);
+    free(pf->slots);
+    free(pf->threads);
+    free(pf);
+}
@@ -0,0 +1,34 @@
+/*
+ * qwen_asr_prefetch.h - Read-ahead loader for batch transcription
+ *
+ * Reader threads take input paths (one per line) from a stream and load
+ * them with qwen_load_wav() - read, decode, resample to 16 kHz mono - while
+ * the caller transcribes earlier inputs on the compute pool. At most
+ * lookahead inputs are loading or waiting at a time, and no new load starts
+ * while the waiting ones hold mem_cap bytes of samples or more (a load in
+ * progress can exceed the cap by its own size). Inputs are handed out in
+ * input order.
+ */
+
+#ifndef QWEN_ASR_PREFETCH_H
+#define QWEN_ASR_PREFETCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct qwen_prefetch qwen_prefetch_t;
+
+/* Start lookahead (>= 1) reader threads on paths, which only they read
+ * from now on. Blank lines are skipped. Returns NULL on error. */
+qwen_prefetch_t *qwen_prefetch_start(FILE *paths, int lookahead, size_t mem_cap);
+
+/* Wait for the next input in order. Returns 1 with *path (malloc'd) and
+ * *samples (malloc'd, NULL if the file could not be loaded; the loader has
+ * reported why) owned by the caller, or 0 at end of input. */
+int qwen_prefetch_next(qwen_prefetch_t *pf, char **path, float **samples, int *n_samples);
+
+/* Join the readers and free the loader. Call after qwen_prefetch_next()
+ * returned 0: a reader blocked reading paths is only released by EOF. */
+void qwen_prefetch_free(qwen_prefetch_t *pf);
+
+#endif /* QWEN_ASR_PREFETCH_H */
@@ -5,6 +5,7 @@
  */
 
 #include "qwen_asr_safetensors.h"
+#include "qwen_asr_kernels.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -176,6 +177,7 @@ static safetensor_dtype_t parse_dtype(const char *s) {
     if (strcmp(s, "I32") == 0) return DTYPE_I32;
     if (strcmp(s, "I64") == 0) return DTYPE_I64;
     if (strcmp(s, "BOOL") == 0) return DTYPE_BOOL;
+    if (strcmp(s, "U8") == 0) return DTYPE_U8;
     return DTYPE_UNKNOWN;
 }
 
@@ -452,6 +454,11 @@ float *safetensors_get_f32(const safetensors_file_t *sf, const safetensor_t *t)
             for (int64_t i = 0; i < n; i++) out[i] = bf16_to_f32(src[i]);
             break;
         }
+        case DTYPE_F16: {
+            const uint16_t *src = (const uint16_t *)data;
+            for (int64_t i = 0; i < n; i++) out[i] = qwen_f16_to_f32_scalar(src[i]);
+            break;
+        }
         default:
             free(out);
             return NULL;
@@ -459,6 +466,48 @@ float *safetensors_get_f32(const safetensors_file_t *sf, const safetensor_t *t)
     return out;
 }
 
+const safetensor_t *safetensors_find(const safetensors_file_t *sf, const char *name) {
+    for (int i = 0; i < sf->num_tensors; i++)
+        if (strcmp(sf->tensors[i].name, name) == 0) return &sf->tensors[i];
+    return NULL;
+}
+
+int safetensors_write_header(FILE *f, const safetensor_desc_t *tensors, int n) {
+    static const char *names[] = {"F32", "F16", "BF16", "I32", "I64", "BOOL", "U8"};
+    static const size_t sizes[] = {4, 2, 2, 4, 8, 1, 1};
+    size_t cap = 64 + (size_t)n * 512, len = 0;
+    char *json = malloc(cap);
+    if (!json) return -1;
+    len += (size_t)snprintf(json + len, cap - len, "{");
+    size_t offset = 0;
+    for (int i = 0; i < n; i++) {
+        const safetensor_desc_t *t = &tensors[i];
+        if (t->dtype < 0 || t->dtype > 6 || t->ndim < 0 || t->ndim > 8 ||
+            strlen(t->name) > 255) {
+            free(json);
+            return -1;
+        }
+        size_t bytes = sizes[t->dtype];
+        len += (size_t)snprintf(json + len, cap - len, "%s\"%s\":{\"dtype\":\"%s\",\"shape\":[",
+                                i ? "," : "", t->name, names[t->dtype]);
+        for (int d = 0; d < t->ndim; d++) {
+            len += (size_t)snprintf(json + len, cap - len, "%s%lld", d ? "," : "",
+                                    (long long)t->shape[d]);
+            bytes *= (size_t)t->shape[d];
+        }
+        len += (size_t)snprintf(json + len, cap - len, "],\"data_offsets\":[%zu,%zu]}",
+                                offset, offset + bytes);
+        offset += bytes;
+    }
+    len += (size_t)snprintf(json + len, cap - len, "}");
+    /* Pad with spaces so the data starts 8-byte aligned */
+    while (len % 8) json[len++] = ' ';
+    uint64_t header_size = len;
+    int rc = fwrite(&header_size, 8, 1, f) == 1 && fwrite(json, 1, len, f) == len ? 0 : -1;
+    free(json);
+    return rc;
+}
+
 int safetensor_is_bf16(const safetensor_t *t) {
     return t && t->dtype == DTYPE_BF16;
 }
@@ -468,10 +517,15 @@ uint16_t *safetensors_get_bf16_direct(const safetensors_file_t *sf, const safete
     return (uint16_t *)safetensors_data(sf, t);
 }
 
+uint16_t *safetensors_get_f16_direct(const safetensors_file_t *sf, const safetensor_t *t) {
+    if (!sf || !t || t->dtype != DTYPE_F16) return NULL;
+    return (uint16_t *)safetensors_data(sf, t);
+}
+
 void safetensor_print(const safetensor_t *t) {
-    const char *dtype_names[] = {"F32", "F16", "BF16", "I32", "I64", "BOOL"};
+    const char *dtype_names[] = {"F32", "F16", "BF16", "I32", "I64", "BOOL", "U8"};
     printf("  %s: ", t->name);
-    if (t->dtype >= 0 && t->dtype <= 5) printf("%s", dtype_names[t->dtype]);
+    if (t->dtype >= 0 && t->dtype <= 6) printf("%s", dtype_names[t->dtype]);
     else printf("UNKNOWN(%d)", t->dtype);
     printf(" [");
     for (int i = 0; i < t->ndim; i++) {
@@ -490,6 +544,40 @@ void safetensors_print_all(const safetensors_file_t *sf) {
  * Multi-shard operations
  * ======================================================================== */
 
+static uint32_t name_hash(const char *s) {
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Build the name index. Lookups fall back to a linear scan without it.
+ * Slots pack (shard << 16 | tensor) + 1, so both must fit in 16 bits. */
+static void multi_safetensors_index(multi_safetensors_t *ms) {
+    if (ms->num_shards > 0xFFFF) return;
+    int total = 0;
+    for (int s = 0; s < ms->num_shards; s++) {
+        if (ms->shards[s]->num_tensors > 0xFFFF) return;
+        total += ms->shards[s]->num_tensors;
+    }
+    uint32_t cap = 64;
+    while (cap < (uint32_t)total * 2) cap <<= 1;
+    ms->index = calloc(cap, sizeof(uint32_t));
+    if (!ms->index) return;
+    ms->index_mask = cap - 1;
+
+    for (int s = 0; s < ms->num_shards; s++) {
+        const safetensors_file_t *sf = ms->shards[s];
+        for (int i = 0; i < sf->num_tensors; i++) {
+            uint32_t slot = name_hash(sf->tensors[i].name) & ms->index_mask;
+            while (ms->index[slot]) slot = (slot + 1) & ms->index_mask;
+            ms->index[slot] = ((uint32_t)s << 16 | (uint32_t)i) + 1;
+        }
+    }
+}
+
 multi_safetensors_t *multi_safetensors_open(const char *model_dir) {
     multi_safetensors_t *ms = calloc(1, sizeof(multi_safetensors_t));
     if (!ms) return NULL;
@@ -502,6 +590,7 @@ multi_safetensors_t *multi_safetensors_open(const char *model_dir) {
     if (sf) {
         ms->shards[0] = sf;
         ms->num_shards = 1;
+        multi_safetensors_index(ms);
         return ms;
     }
 
@@ -564,6 +653,7 @@ multi_safetensors_t *multi_safetensors_open(const char *model_dir) {
         }
     }
     ms->num_shards = n_shards;
+    multi_safetensors_index(ms);
     return ms;
 }
 
@@ -572,12 +662,27 @@ void multi_safetensors_close(multi_safetensors_t *ms) {
     for (int i = 0; i < ms->num_shards; i++) {
         safetensors_close(ms->shards[i]);
     }
+    free(ms->index);
     free(ms);
 }
 
 const safetensor_t *multi_safetensors_find(const multi_safetensors_t *ms,
                                             const char *name,
                                             safetensors_file_t **out_sf) {
+    if (ms->index) {
+        uint32_t slot = name_hash(name) & ms->index_mask;
+        while (ms->index[slot]) {
+            uint32_t v = ms->index[slot] - 1;
+            safetensors_file_t *sf = ms->shards[v >> 16];
+            const safetensor_t *t = &sf->tensors[v & 0xffff];
+            if (strcmp(t->name, name) == 0) {
+                if (out_sf) *out_sf = sf;
+                return t;
+            }
+            slot = (slot + 1) & ms->index_mask;
+        }
+        return NULL;
+    }
     for (int s = 0; s < ms->num_shards; s++) {
         safetensors_file_t *sf = ms->shards[s];
         for (int i = 0; i < sf->num_tensors; i++) {
@@ -8,6 +8,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #define SAFETENSORS_MAX_TENSORS 1024
 #define SAFETENSORS_MAX_SHARDS 8
@@ -19,6 +20,7 @@ typedef enum {
     DTYPE_I32 = 3,
     DTYPE_I64 = 4,
     DTYPE_BOOL = 5,
+    DTYPE_U8 = 6,
     DTYPE_UNKNOWN = -1
 } safetensor_dtype_t;
 
@@ -45,6 +47,10 @@ typedef struct {
 typedef struct {
     safetensors_file_t *shards[SAFETENSORS_MAX_SHARDS];
     int num_shards;
+    /* Name hash index over all shards (open addressing, power-of-two size).
+     * Slot value: (shard << 16 | tensor) + 1, 0 = empty. */
+    uint32_t *index;
+    uint32_t index_mask;
 } multi_safetensors_t;
 
 /* Open a single safetensors file (memory-mapped) */
@@ -63,12 +69,31 @@ const safetensor_t *multi_safetensors_find(const multi_safetensors_t *ms,
 /* Get raw pointer to tensor data (within mmap'd region) */
 const void *safetensors_data(const safetensors_file_t *sf, const safetensor_t *t);
 
-/* Get tensor data as float32 (allocates, caller must free) */
+/* Get tensor data as float32 from F32, BF16 or F16 (allocates, caller must free) */
 float *safetensors_get_f32(const safetensors_file_t *sf, const safetensor_t *t);
 
 /* Get direct pointer to bf16 data in mmap'd region (no copy) */
 uint16_t *safetensors_get_bf16_direct(const safetensors_file_t *sf, const safetensor_t *t);
 
+/* Same for IEEE fp16 tensors */
+uint16_t *safetensors_get_f16_direct(const safetensors_file_t *sf, const safetensor_t *t);
+
+/* Find a tensor by name in a single file */
+const safetensor_t *safetensors_find(const safetensors_file_t *sf, const char *name);
+
+/* Tensor description for writing */
+typedef struct {
+    const char *name;
+    safetensor_dtype_t dtype;
+    int ndim;
+    int64_t shape[8];
+} safetensor_desc_t;
+
+/* Write the size prefix and JSON header of a safetensors file holding the
+ * given tensors. Their data must follow, in the same order and without gaps.
+ * Returns 0, or -1 on a write error or unsupported dtype. */
+int safetensors_write_header(FILE *f, const safetensor_desc_t *tensors, int n);
+
 int safetensor_is_bf16(const safetensor_t *t);
 int64_t safetensor_numel(const safetensor_t *t);
 void safetensor_print(const safetensor_t *t);
@@ -0,0 +1,189 @@
+/*
+ * qwen_asr_shm.c - Shared-memory audio rings (see qwen_asr_shm.h)
+ *
+ * Producer and engine synchronize through the shared positions only:
+ * write_pos is published with release after the samples are copied in,
+ * read_pos with release after the engine has copied them out. The wake
+ * handshake is the usual futex one: the engine increments waiters, reads
+ * seq and then the positions; the producer publishes write_pos, increments
+ * seq and then reads waiters (all sequentially consistent), so either the
+ * producer sees the waiter or the waiter sees the new data.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "qwen_asr_shm.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define SHM_MIN_CAPACITY 4096u
+#define SHM_MAX_CAPACITY (1u << 28)
+
+static size_t ring_bytes(uint32_t capacity) {
+    return sizeof(qwen_shm_ring_t) + (size_t)capacity * sizeof(float);
+}
+
+float *qwen_shm_data(qwen_shm_ring_t *r) {
+    return (float *)((char *)r + sizeof(qwen_shm_ring_t));
+}
+
+#ifdef __linux__
+
+qwen_shm_ring_t *qwen_shm_create(const char *path, uint32_t capacity) {
+    if (capacity > SHM_MAX_CAPACITY) {
+        fprintf(stderr, "qwen_shm_create: capacity %u above %u samples\n",
+                capacity, SHM_MAX_CAPACITY);
+        return NULL;
+    }
+    uint32_t cap = SHM_MIN_CAPACITY;
+    while (cap < capacity) cap *= 2;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "qwen_shm_create: cannot create %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    size_t size = ring_bytes(cap);
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0)
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "qwen_shm_create: cannot map %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    /* The file starts zeroed; magic goes last so attachers never see a
+     * half-initialized header. */
+    qwen_shm_ring_t *r = (qwen_shm_ring_t *)map;
+    r->version = QWEN_SHM_VERSION;
+    r->capacity = cap;
+    r->data_offset = (uint32_t)sizeof(qwen_shm_ring_t);
+    __atomic_store_n(&r->magic, QWEN_SHM_MAGIC, __ATOMIC_RELEASE);
+    return r;
+}
+
+qwen_shm_ring_t *qwen_shm_attach(const char *path, uint32_t *capacity) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "qwen_shm_attach: cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(qwen_shm_ring_t))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "qwen_shm_attach: cannot map %s\n", path);
+        return NULL;
+    }
+
+    /* magic first: it is stored last, after the rest of the header */
+    qwen_shm_ring_t *r = (qwen_shm_ring_t *)map;
+    uint32_t magic = __atomic_load_n(&r->magic, __ATOMIC_ACQUIRE);
+    uint32_t cap = r->capacity;
+    if (magic != QWEN_SHM_MAGIC ||
+        r->version != QWEN_SHM_VERSION ||
+        cap < SHM_MIN_CAPACITY || cap > SHM_MAX_CAPACITY || (cap & (cap - 1)) != 0 ||
+        r->data_offset != sizeof(qwen_shm_ring_t) ||
+        (size_t)st.st_size != ring_bytes(cap)) {
+        fprintf(stderr, "qwen_shm_attach: %s is not a version %d audio ring\n",
+                path, QWEN_SHM_VERSION);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    *capacity = cap;
+    return (qwen_shm_ring_t *)map;
+}
+
+void qwen_shm_detach(qwen_shm_ring_t *r, uint32_t capacity) {
+    if (r) munmap(r, ring_bytes(capacity));
+}
+
+int qwen_shm_wait(qwen_shm_ring_t *r, uint32_t seq, const struct timespec *deadline) {
+    long rc;
+    if (deadline)
+        rc = syscall(SYS_futex, &r->seq, FUTEX_WAIT_BITSET | FUTEX_CLOCK_REALTIME,
+                     seq, deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+    else
+        rc = syscall(SYS_futex, &r->seq, FUTEX_WAIT, seq, NULL, NULL, 0);
+    return (rc != 0 && errno == ETIMEDOUT) ? ETIMEDOUT : 0;
+}
+
+void qwen_shm_wake(qwen_shm_ring_t *r) {
+    __atomic_add_fetch(&r->seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->waiters, __ATOMIC_SEQ_CST) > 0)
+        syscall(SYS_futex, &r->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+#else /* !__linux__ */
+
+qwen_shm_ring_t *qwen_shm_create(const char *path, uint32_t capacity) {
+    (void)capacity;
+    fprintf(stderr, "qwen_shm_create: %s: shared-memory rings need Linux\n", path);
+    return NULL;
+}
+
+qwen_shm_ring_t *qwen_shm_attach(const char *path, uint32_t *capacity) {
+    (void)capacity;
+    fprintf(stderr, "qwen_shm_attach: %s: shared-memory rings need Linux\n", path);
+    return NULL;
+}
+
+void qwen_shm_detach(qwen_shm_ring_t *r, uint32_t capacity) {
+    (void)r; (void)capacity;
+}
+
+int qwen_shm_wait(qwen_shm_ring_t *r, uint32_t seq, const struct timespec *deadline) {
+    (void)r; (void)seq; (void)deadline;
+    return 0;
+}
+
+void qwen_shm_wake(qwen_shm_ring_t *r) {
+    (void)r;
+}
+
+#endif /* __linux__ */
+
+size_t qwen_shm_write(qwen_shm_ring_t *r, const float *samples, size_t n) {
+    uint32_t cap = r->capacity;
+    uint64_t wr = r->write_pos;
+    uint64_t rd = __atomic_load_n(&r->read_pos, __ATOMIC_ACQUIRE);
+    uint64_t space = cap - (wr - rd);
+    size_t take = n < space ? n : (size_t)space;
+    size_t at = (size_t)(wr & (cap - 1));
+    size_t first = take < cap - at ? take : cap - at;
+    float *data = qwen_shm_data(r);
+    memcpy(data + at, samples, first * sizeof(float));
+    memcpy(data, samples + first, (take - first) * sizeof(float));
+    if (take < n) __atomic_add_fetch(&r->dropped, (uint64_t)(n - take), __ATOMIC_RELAXED);
+    __atomic_store_n(&r->write_pos, wr + take, __ATOMIC_RELEASE);
+    qwen_shm_wake(r);
+    return take;
+}
+
+void qwen_shm_close(qwen_shm_ring_t *r) {
+    __atomic_store_n(&r->eof, 1, __ATOMIC_RELEASE);
+    qwen_shm_wake(r);
+}
+
+void qwen_shm_read(const float *data, uint32_t capacity, uint64_t pos, float *dst, size_t n) {
+    uint32_t cap = capacity;
+    size_t at = (size_t)(pos & (cap - 1));
+    size_t first = n < cap - at ? n : cap - at;
+    memcpy(dst, data + at, first * sizeof(float));
+    memcpy(dst + first, data, (n - first) * sizeof(float));
+}
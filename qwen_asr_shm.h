@@ -0,0 +1,88 @@
+/*
+ * qwen_asr_shm.h - Shared-memory audio rings for out-of-process producers
+ *
+ * A ring is a file (usually in /dev/shm; a memfd can be reached as
+ * /proc/<pid>/fd/<n>) holding this header followed by a power-of-two array
+ * of float32 16 kHz mono samples. The producer process copies samples in and
+ * advances write_pos; the engine reads them in place and advances read_pos.
+ * Waiting uses a futex on the shared seq word, and the producer only makes
+ * the wake syscall while an engine thread is blocked on it, so a busy
+ * engine costs neither side a syscall per chunk. Linux only.
+ *
+ * The header is self-contained (no other engine headers) so producers can
+ * include it and link qwen_asr_shm.c alone.
+ */
+
+#ifndef QWEN_ASR_SHM_H
+#define QWEN_ASR_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define QWEN_SHM_MAGIC   0x52485351u   /* "QSHR" */
+#define QWEN_SHM_VERSION 1
+
+/* Shared layout: one cache line each for the constants, the producer and
+ * the engine. Positions count samples since creation and never wrap. */
+typedef struct qwen_shm_ring {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;          /* samples in the data array, power of two */
+    uint32_t data_offset;       /* bytes from the ring start to the samples */
+    uint8_t pad0[48];
+
+    uint64_t write_pos;         /* producer: samples written */
+    uint64_t dropped;           /* producer: samples discarded, ring was full */
+    uint32_t seq;               /* futex word, bumped by every write, close and wake */
+    uint32_t eof;               /* producer closed the stream */
+    uint8_t pad1[40];
+
+    uint64_t read_pos;          /* engine: samples consumed */
+    uint32_t waiters;           /* engine threads blocked (or about to block) on seq */
+    uint8_t pad2[52];
+} qwen_shm_ring_t;
+
+/* Producer: create (or truncate) the ring file at path with room for
+ * capacity samples (rounded up to a power of two, at least 4096) and map
+ * it. Returns NULL on error. */
+qwen_shm_ring_t *qwen_shm_create(const char *path, uint32_t capacity);
+
+/* Map an existing ring (either side). Returns NULL if path is not a ring.
+ * *capacity receives the validated capacity. The other side can rewrite
+ * the header at any time, so keep this copy and pass it to
+ * qwen_shm_read() and qwen_shm_detach() instead of re-reading it. */
+qwen_shm_ring_t *qwen_shm_attach(const char *path, uint32_t *capacity);
+
+/* Unmap a ring mapped with the given capacity (the value returned by
+ * qwen_shm_attach(), or r->capacity for the creator). The file stays
+ * until its creator unlinks it. */
+void qwen_shm_detach(qwen_shm_ring_t *r, uint32_t capacity);
+
+/* Sample array of a ring: at a fixed offset after the header, so the
+ * pointer does not depend on shared fields. */
+float *qwen_shm_data(qwen_shm_ring_t *r);
+
+/* Producer: copy up to n samples into the ring and wake a waiting engine.
+ * Never blocks: returns the number written; the rest is counted in
+ * r->dropped. Single producer per ring. */
+size_t qwen_shm_write(qwen_shm_ring_t *r, const float *samples, size_t n);
+
+/* Producer: mark end of stream and wake the engine. */
+void qwen_shm_close(qwen_shm_ring_t *r);
+
+/* Engine: copy n samples starting at position pos (read_pos <= pos and
+ * pos + n <= write_pos, n <= capacity) from the sample array data of a
+ * ring with the given capacity to dst, handling wrap-around. */
+void qwen_shm_read(const float *data, uint32_t capacity, uint64_t pos, float *dst, size_t n);
+
+/* Engine: sleep until seq differs from the given value, a wake, or the
+ * absolute CLOCK_REALTIME deadline (NULL = none). Register in r->waiters
+ * before reading seq. Returns 0, or ETIMEDOUT. */
+int qwen_shm_wait(qwen_shm_ring_t *r, uint32_t seq, const struct timespec *deadline);
+
+/* Bump seq and wake all waiters (used by the producer and by engine
+ * threads that need a blocked reader to re-check its state). */
+void qwen_shm_wake(qwen_shm_ring_t *r);
+
+#endif /* QWEN_ASR_SHM_H */
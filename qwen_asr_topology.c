@@ -0,0 +1,295 @@
+/*
+ * qwen_asr_topology.c - CPU topology discovery (see qwen_asr_topology.h)
+ *
+ * Linux: online CPUs, sched_getaffinity(), the cgroup v2 cpu.max or v1 CFS
+ * quota along the process's cgroup path, SMT siblings and cache sizes from
+ * sysfs. macOS: hw.* sysctls. Elsewhere: online CPU count only.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "qwen_asr_topology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#ifdef __APPLE__
+#include <stdint.h>
+#include <sys/sysctl.h>
+#elif defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+static qwen_topology_t topo;
+static pthread_once_t topo_once = PTHREAD_ONCE_INIT;
+
+/* CPUs the process can keep busy: the affinity count, capped by the quota */
+static int usable_cpus(int n_affinity, double quota) {
+    int usable = n_affinity;
+    if (quota > 0.0) {
+        int q = (int)ceil(quota - 1e-6);
+        if (q < 1) q = 1;
+        if (q < usable) usable = q;
+    }
+    return usable;
+}
+
+#ifdef __linux__
+
+/* Read a small text file into buf (NUL-terminated, trailing newline
+ * stripped). Returns the length, or -1 if it cannot be read. */
+static int read_text(const char *path, char *buf, size_t cap) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    size_t n = fread(buf, 1, cap - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' ')) buf[--n] = '\0';
+    return (int)n;
+}
+
+/* "48K", "2048K", "32M" -> bytes */
+static size_t parse_size(const char *s) {
+    char *end = NULL;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (end == s) return 0;
+    if (*end == 'K' || *end == 'k') v <<= 10;
+    else if (*end == 'M' || *end == 'm') v <<= 20;
+    else if (*end == 'G' || *end == 'g') v <<= 30;
+    return (size_t)v;
+}
+
+/* Smallest quota (in CPUs) along a cgroup path under mount, walking up to
+ * the mount root. With a cgroup namespace the process path is "/" and the
+ * mount root is the container's own cgroup; without one the full host path
+ * may not exist under the mount, so the walk ends at the root too. */
+static double cgroup_walk_quota(const char *mount, const char *cg_path, int v2) {
+    char dir[512], path[1024], buf[128];
+    snprintf(dir, sizeof(dir), "%s", cg_path);
+    double best = 0.0;
+    for (;;) {
+        const char *rel = strcmp(dir, "/") == 0 ? "" : dir;
+        long long quota = -1, period = 0;
+        if (v2) {
+            snprintf(path, sizeof(path), "%s%s/cpu.max", mount, rel);
+            if (read_text(path, buf, sizeof(buf)) > 0 && strncmp(buf, "max", 3) != 0)
+                sscanf(buf, "%lld %lld", &quota, &period);
+        } else {
+            snprintf(path, sizeof(path), "%s%s/cpu.cfs_quota_us", mount, rel);
+            if (read_text(path, buf, sizeof(buf)) > 0) quota = atoll(buf);
+            snprintf(path, sizeof(path), "%s%s/cpu.cfs_period_us", mount, rel);
+            if (read_text(path, buf, sizeof(buf)) > 0) period = atoll(buf);
+        }
+        if (quota > 0 && period > 0) {
+            double q = (double)quota / (double)period;
+            if (best == 0.0 || q < best) best = q;
+        }
+
+        char *slash = strrchr(dir, '/');
+        if (!slash || strcmp(dir, "/") == 0) break;
+        if (slash == dir) slash[1] = '\0';
+        else *slash = '\0';
+    }
+    return best;
+}
+
+/* Does a comma-separated v1 controller list name the cpu controller? */
+static int has_cpu_controller(const char *list, size_t len) {
+    const char *p = list, *end = list + len;
+    while (p < end) {
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        size_t n = comma ? (size_t)(comma - p) : (size_t)(end - p);
+        if (n == 3 && strncmp(p, "cpu", 3) == 0) return 1;
+        p += n + 1;
+    }
+    return 0;
+}
+
+static double cgroup_cpu_quota(void) {
+    FILE *f = fopen("/proc/self/cgroup", "r");
+    if (!f) return 0.0;
+
+    char line[1024];
+    char v2_path[512] = "", v1_path[512] = "";
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char *c1 = strchr(line, ':');
+        char *c2 = c1 ? strchr(c1 + 1, ':') : NULL;
+        if (!c2) continue;
+        if (c2 == c1 + 1)
+            snprintf(v2_path, sizeof(v2_path), "%s", c2 + 1);
+        else if (has_cpu_controller(c1 + 1, (size_t)(c2 - c1 - 1)))
+            snprintf(v1_path, sizeof(v1_path), "%s", c2 + 1);
+    }
+    fclose(f);
+
+    double quota = 0.0;
+    if (v2_path[0])
+        quota = cgroup_walk_quota("/sys/fs/cgroup", v2_path, 1);
+    if (quota == 0.0 && v1_path[0]) {
+        quota = cgroup_walk_quota("/sys/fs/cgroup/cpu,cpuacct", v1_path, 0);
+        if (quota == 0.0) quota = cgroup_walk_quota("/sys/fs/cgroup/cpu", v1_path, 0);
+    }
+    return quota;
+}
+
+static void probe_caches(int cpu) {
+    char path[256], buf[64];
+    for (int idx = 0; idx < 16; idx++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, idx);
+        if (read_text(path, buf, sizeof(buf)) <= 0) break;
+        int level = atoi(buf);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, idx);
+        if (read_text(path, buf, sizeof(buf)) <= 0 || strcmp(buf, "Instruction") == 0) continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/size", cpu, idx);
+        if (read_text(path, buf, sizeof(buf)) <= 0) continue;
+        size_t size = parse_size(buf);
+        if (level == 1) topo.l1d_bytes = size;
+        else if (level == 2) topo.l2_bytes = size;
+        else if (level >= 3 && size > topo.l3_bytes) topo.l3_bytes = size;
+    }
+}
+
+/* "model name" on x86; implementer/part IDs on ARM (e.g. Graviton) */
+static void probe_cpu_model(void) {
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f) return;
+    char line[512];
+    unsigned impl = 0, part = 0;
+    int have_impl = 0, have_part = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+        if (!colon) {
+            if (have_impl && have_part) break;
+            continue;
+        }
+        char *val = colon + 1;
+        while (*val == ' ' || *val == '\t') val++;
+        val[strcspn(val, "\n")] = '\0';
+        if (strncmp(line, "model name", 10) == 0 && val[0]) {
+            snprintf(topo.cpu_model, sizeof(topo.cpu_model), "%s", val);
+            break;
+        } else if (strncmp(line, "CPU implementer", 15) == 0) {
+            impl = (unsigned)strtoul(val, NULL, 0);
+            have_impl = 1;
+        } else if (strncmp(line, "CPU part", 8) == 0) {
+            part = (unsigned)strtoul(val, NULL, 0);
+            have_part = 1;
+        }
+    }
+    fclose(f);
+    if (!topo.cpu_model[0] && have_impl && have_part)
+        snprintf(topo.cpu_model, sizeof(topo.cpu_model), "arm-0x%02x-0x%03x", impl, part);
+}
+
+static void probe_linux(void) {
+    int online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    topo.n_online = online > 0 ? online : 1;
+    topo.n_affinity = topo.n_online;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    int have_mask = sched_getaffinity(0, sizeof(set), &set) == 0;
+    if (have_mask) {
+        int n = CPU_COUNT(&set);
+        if (n > 0) topo.n_affinity = n;
+    }
+
+    topo.cpu_quota = cgroup_cpu_quota();
+
+    /* Physical cores: CPUs in the mask keyed by their lowest SMT sibling */
+    static unsigned char seen[CPU_SETSIZE];
+    memset(seen, 0, sizeof(seen));
+    int cores = 0, first_cpu = -1;
+    char path[128], buf[256];
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (have_mask ? !CPU_ISSET(cpu, &set) : cpu >= topo.n_online) continue;
+        if (first_cpu < 0) first_cpu = cpu;
+        int key = cpu;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (read_text(path, buf, sizeof(buf)) > 0) {
+            int lo = atoi(buf);
+            if (lo >= 0 && lo < CPU_SETSIZE) key = lo;
+        }
+        if (!seen[key]) {
+            seen[key] = 1;
+            cores++;
+        }
+    }
+    topo.n_cores = cores > 0 ? cores : topo.n_affinity;
+
+    probe_caches(first_cpu >= 0 ? first_cpu : 0);
+    probe_cpu_model();
+}
+
+#endif /* __linux__ */
+
+#ifdef __APPLE__
+static int64_t sysctl_i64(const char *name) {
+    int64_t v = 0;
+    size_t len = sizeof(v);
+    if (sysctlbyname(name, &v, &len, NULL, 0) != 0) return 0;
+    if (len == sizeof(int32_t)) return (int64_t)*(int32_t *)&v;
+    return v;
+}
+#endif
+
+static void probe_topology(void) {
+    memset(&topo, 0, sizeof(topo));
+#if defined(__linux__)
+    probe_linux();
+#elif defined(__APPLE__)
+    topo.n_online = (int)sysctl_i64("hw.ncpu");
+    topo.n_cores = (int)sysctl_i64("hw.physicalcpu");
+    topo.l1d_bytes = (size_t)sysctl_i64("hw.l1dcachesize");
+    topo.l2_bytes = (size_t)sysctl_i64("hw.l2cachesize");
+    topo.l3_bytes = (size_t)sysctl_i64("hw.l3cachesize");
+    size_t len = sizeof(topo.cpu_model);
+    if (sysctlbyname("machdep.cpu.brand_string", topo.cpu_model, &len, NULL, 0) != 0)
+        topo.cpu_model[0] = '\0';
+#elif defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    topo.n_online = (int)sysinfo.dwNumberOfProcessors;
+#else
+    topo.n_online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    topo.cpu_model[sizeof(topo.cpu_model) - 1] = '\0';
+    if (!topo.cpu_model[0]) snprintf(topo.cpu_model, sizeof(topo.cpu_model), "unknown");
+    for (char *c = topo.cpu_model; *c; c++)
+        if (*c == '\t' || *c == '\n' || *c == '\r') *c = ' ';
+    if (topo.n_online < 1) topo.n_online = 1;
+    if (topo.n_affinity < 1 || topo.n_affinity > topo.n_online)
+        topo.n_affinity = topo.n_online;
+
+    int usable = usable_cpus(topo.n_affinity, topo.cpu_quota);
+    topo.n_usable = usable;
+    if (topo.n_cores < 1 || topo.n_cores > usable) topo.n_cores = usable;
+}
+
+const qwen_topology_t *qwen_get_topology(void) {
+    pthread_once(&topo_once, probe_topology);
+    return &topo;
+}
+
+int qwen_probe_usable_cpus(void) {
+    const qwen_topology_t *t = qwen_get_topology();
+#ifdef __linux__
+    int n_affinity = t->n_online;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+        n_affinity = CPU_COUNT(&set);
+    return usable_cpus(n_affinity, cgroup_cpu_quota());
+#else
+    return t->n_usable;
+#endif
+}
@@ -0,0 +1,35 @@
+/*
+ * qwen_asr_topology.h - CPU topology discovery
+ *
+ * What the process can actually run on: container CPU quotas, the affinity
+ * mask, physical cores behind SMT siblings and cache sizes. Used to pick
+ * default thread counts and kernel tile sizes.
+ */
+
+#ifndef QWEN_ASR_TOPOLOGY_H
+#define QWEN_ASR_TOPOLOGY_H
+
+#include <stddef.h>
+
+typedef struct {
+    int n_online;       /* online CPUs in the machine */
+    int n_affinity;     /* CPUs in the process affinity mask */
+    double cpu_quota;   /* cgroup CPU quota in CPUs (0 = unlimited) */
+    int n_usable;       /* CPUs the process can keep busy: min of the above */
+    int n_cores;        /* physical cores among them (SMT siblings count once) */
+    size_t l1d_bytes;   /* per-core L1 data cache (0 = unknown) */
+    size_t l2_bytes;    /* L2 cache (0 = unknown) */
+    size_t l3_bytes;    /* last-level cache (0 = unknown / none) */
+    char cpu_model[128]; /* CPU model name ("unknown" if not reported) */
+} qwen_topology_t;
+
+/* Probe once (thread-safe) and return the cached result. */
+const qwen_topology_t *qwen_get_topology(void);
+
+/* Re-read the affinity mask and cgroup quota now (they can change while
+ * the process runs, e.g. a container resized in place) and return the
+ * usable CPU count. The cached topology is not updated. Linux only;
+ * elsewhere returns the cached n_usable. */
+int qwen_probe_usable_cpus(void);
+
+#endif /* QWEN_ASR_TOPOLOGY_H */
@@ -0,0 +1,442 @@
+/*
+ * qwen_asr_tune.c - Kernel autotuner and per-host tuning profiles
+ *
+ * qwen_autotune() times candidate kernel settings (qwen_kernel_tuning_t) on
+ * the loaded model's real weights and shapes and saves the winners to a
+ * profile file. qwen_load() applies the profile entry matching this host
+ * (CPU model + usable CPUs) and model variant.
+ *
+ * Profile format: one entry per line, tab-separated key=value fields:
+ *   cpu=<model>  cpus=<n>  model=<variant>  decode_threads=<n>
+ *   attn_min_seq_k=<n>  gemm_panel_kb=<n>
+ * Lines starting with '#' are comments. Unknown keys are ignored.
+ */
+
+#include "qwen_asr.h"
+#include "qwen_asr_kernels.h"
+#include "qwen_asr_topology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <direct.h>
+#define tune_mkdir(p) _mkdir(p)
+#else
+#define tune_mkdir(p) mkdir((p), 0755)
+#endif
+
+#define TUNE_LINE_MAX 1024
+#define TUNE_NEVER (1 << 30)   /* attn_min_seq_k value: never thread */
+
+static double tune_time_ms(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/* ========================================================================
+ * Profile File
+ * ======================================================================== */
+
+static char tune_path[1024];
+static pthread_once_t tune_path_once = PTHREAD_ONCE_INIT;
+
+static void tune_path_init(void) {
+    const char *env = getenv("QWEN_TUNE_FILE");
+    if (env) {
+        snprintf(tune_path, sizeof(tune_path), "%s", env);
+        return;
+    }
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (xdg && xdg[0])
+        snprintf(tune_path, sizeof(tune_path), "%s/qwen_asr/tuning.txt", xdg);
+    else if (home && home[0])
+        snprintf(tune_path, sizeof(tune_path), "%s/.cache/qwen_asr/tuning.txt", home);
+}
+
+const char *qwen_tune_default_path(void) {
+    pthread_once(&tune_path_once, tune_path_init);
+    return tune_path[0] ? tune_path : NULL;
+}
+
+static void model_variant(const qwen_ctx_t *ctx, char *buf, size_t cap) {
+    const qwen_config_t *c = &ctx->config;
+    snprintf(buf, cap, "dec%dx%d-enc%dx%d",
+             c->dec_hidden, c->dec_layers, c->enc_d_model, c->enc_layers);
+}
+
+/* Find "key=" in a tab-separated entry; returns the value (up to the next
+ * tab) copied into out, or NULL. */
+static const char *entry_get(const char *line, const char *key, char *out, size_t cap) {
+    size_t klen = strlen(key);
+    const char *p = line;
+    while (*p) {
+        const char *end = strchr(p, '\t');
+        size_t n = end ? (size_t)(end - p) : strcspn(p, "\r\n");
+        if (n > klen && strncmp(p, key, klen) == 0 && p[klen] == '=') {
+            size_t vlen = n - klen - 1;
+            if (vlen >= cap) vlen = cap - 1;
+            memcpy(out, p + klen + 1, vlen);
+            out[vlen] = '\0';
+            return out;
+        }
+        if (!end) break;
+        p = end + 1;
+    }
+    return NULL;
+}
+
+/* Is this profile line the entry for (cpu, cpus, variant)? */
+static int entry_matches(const char *line, const char *cpu, int cpus, const char *variant) {
+    char v[256];
+    if (line[0] == '#') return 0;
+    if (!entry_get(line, "cpu", v, sizeof(v)) || strcmp(v, cpu) != 0) return 0;
+    if (!entry_get(line, "cpus", v, sizeof(v)) || atoi(v) != cpus) return 0;
+    if (!entry_get(line, "model", v, sizeof(v)) || strcmp(v, variant) != 0) return 0;
+    return 1;
+}
+
+int qwen_tune_apply(const qwen_ctx_t *ctx, const char *path) {
+    if (!path) path = qwen_tune_default_path();
+    if (!path || !path[0]) return 0;
+    FILE *f = fopen(path, "r");
+    if (!f) return errno == ENOENT ? 0 : -1;
+
+    const qwen_topology_t *topo = qwen_get_topology();
+    char variant[64];
+    model_variant(ctx, variant, sizeof(variant));
+
+    char line[TUNE_LINE_MAX], v[64];
+    int found = 0;
+    qwen_kernel_tuning_t t;
+    memset(&t, 0, sizeof(t));
+    while (fgets(line, sizeof(line), f)) {
+        if (!entry_matches(line, topo->cpu_model, topo->n_usable, variant)) continue;
+        if (entry_get(line, "decode_threads", v, sizeof(v))) t.decode_threads = atoi(v);
+        if (entry_get(line, "attn_min_seq_k", v, sizeof(v))) t.attn_min_seq_k = atoi(v);
+        if (entry_get(line, "gemm_panel_kb", v, sizeof(v))) t.gemm_panel_kb = atoi(v);
+        found = 1;
+    }
+    fclose(f);
+    if (!found) return 0;
+
+    qwen_set_kernel_tuning(&t);
+    if (qwen_verbose >= 1)
+        fprintf(stderr, "Tuning profile: decode_threads=%d attn_min_seq_k=%d gemm_panel_kb=%d (%s)\n",
+                t.decode_threads, t.attn_min_seq_k, t.gemm_panel_kb, path);
+    return 1;
+}
+
+/* Create the profile's parent directory (and its parent) if missing. */
+static void make_parent_dirs(const char *path) {
+    char dir[1024];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (!slash || slash == dir) return;
+    *slash = '\0';
+    char *up = strrchr(dir, '/');
+    if (up && up != dir) {
+        *up = '\0';
+        tune_mkdir(dir);
+        *up = '/';
+    }
+    tune_mkdir(dir);
+}
+
+/* Rewrite path with this host's entry replaced by t. */
+static int tune_save(const qwen_ctx_t *ctx, const char *path, const qwen_kernel_tuning_t *t) {
+    const qwen_topology_t *topo = qwen_get_topology();
+    char variant[64];
+    model_variant(ctx, variant, sizeof(variant));
+
+    make_parent_dirs(path);
+    char tmp_path[1100];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *out = fopen(tmp_path, "w");
+    if (!out) {
+        fprintf(stderr, "qwen_autotune: cannot write %s\n", tmp_path);
+        return -1;
+    }
+
+    FILE *in = fopen(path, "r");
+    char line[TUNE_LINE_MAX];
+    if (in) {
+        while (fgets(line, sizeof(line), in)) {
+            if (entry_matches(line, topo->cpu_model, topo->n_usable, variant)) continue;
+            fputs(line, out);
+        }
+        fclose(in);
+    } else {
+        fprintf(out, "# qwen_asr kernel tuning profile (written by --autotune)\n");
+    }
+    fprintf(out, "cpu=%s\tcpus=%d\tmodel=%s\tdecode_threads=%d\tattn_min_seq_k=%d\tgemm_panel_kb=%d\n",
+            topo->cpu_model, topo->n_usable, variant,
+            t->decode_threads, t->attn_min_seq_k, t->gemm_panel_kb);
+
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "qwen_autotune: cannot write %s\n", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+/* ========================================================================
+ * Benchmarks
+ * ======================================================================== */
+
+#define BENCH_SEQ_K_MAX 2048
+#define BENCH_PREFILL_ROWS 256
+
+typedef struct {
+    qwen_ctx_t *ctx;
+    int seq_k;
+    float attn_scale;
+    float *x, *q, *k, *v, *h, *gu;       /* single-token buffers */
+    float *kv_k, *kv_v;                  /* [BENCH_SEQ_K_MAX, kv_dim] */
+    float *pre_x, *pre_out;              /* prefill-sized GEMM operands */
+} tune_bench_t;
+
+/* Dense decoder projection, bf16 or fp16 to match the checkpoint */
+typedef void (*linear_w16_fn)(float *y, const float *x, const uint16_t *W,
+                              int seq_len, int in_dim, int out_dim);
+
+/* Best per-call time over a few timed batches of >= 30 ms each. */
+static double bench_ms(void (*fn)(tune_bench_t *), tune_bench_t *b) {
+    fn(b);
+    double best = 1e30;
+    for (int rep = 0; rep < 3; rep++) {
+        double t0 = tune_time_ms(), el;
+        int n = 0;
+        do {
+            fn(b);
+            n++;
+            el = tune_time_ms() - t0;
+        } while (el < 30.0 && n < 10000);
+        if (el / n < best) best = el / n;
+    }
+    return best;
+}
+
+/* All single-token matvecs of one decoder step (weights streamed once). */
+static void bench_decode_step(tune_bench_t *b) {
+    const qwen_config_t *c = &b->ctx->config;
+    int q_dim = c->dec_heads * c->dec_head_dim;
+    int kv_dim = c->dec_kv_heads * c->dec_head_dim;
+    int f16 = b->ctx->decoder.f16;
+    linear_w16_fn linear = f16 ? qwen_linear_nobias_f16 : qwen_linear_nobias_bf16;
+    for (int i = 0; i < c->dec_layers; i++) {
+        qwen_dec_layer_t *l = &b->ctx->decoder.layers[i];
+        (f16 ? qwen_linear_nobias_f16_qkv : qwen_linear_nobias_bf16_qkv)(
+            b->q, b->k, b->v, b->x,
+            l->wq_weight_bf16, l->wk_weight_bf16, l->wv_weight_bf16,
+            c->dec_hidden, q_dim, kv_dim);
+        linear(b->h, b->q, l->wo_weight_bf16, 1, q_dim, c->dec_hidden);
+        linear(b->gu, b->x, l->gate_up_fused_bf16,
+               1, c->dec_hidden, 2 * c->dec_intermediate);
+        linear(b->h, b->gu, l->down_weight_bf16,
+               1, c->dec_intermediate, c->dec_hidden);
+    }
+    (void)(f16 ? qwen_argmax_matvec_f16 : qwen_argmax_matvec_bf16)(
+        b->x, b->ctx->decoder.tok_embeddings_bf16, c->dec_hidden, c->vocab_size);
+}
+
+static void bench_decode_attention(tune_bench_t *b) {
+    const qwen_config_t *c = &b->ctx->config;
+    qwen_causal_attention(b->h, b->q, b->kv_k, b->kv_v, 1, b->seq_k,
+                          c->dec_heads, c->dec_kv_heads, c->dec_head_dim,
+                          b->attn_scale, b->seq_k - 1);
+}
+
+#ifdef USE_BLAS
+static void bench_prefill_mlp(tune_bench_t *b) {
+    const qwen_config_t *c = &b->ctx->config;
+    qwen_dec_layer_t *l = &b->ctx->decoder.layers[0];
+    linear_w16_fn linear = b->ctx->decoder.f16 ? qwen_linear_nobias_f16 : qwen_linear_nobias_bf16;
+    linear(b->pre_out, b->pre_x, l->gate_up_fused_bf16,
+           BENCH_PREFILL_ROWS, c->dec_hidden, 2 * c->dec_intermediate);
+    linear(b->pre_out, b->pre_x, l->down_weight_bf16,
+           BENCH_PREFILL_ROWS, c->dec_intermediate, c->dec_hidden);
+}
+#endif
+
+static void fill_pattern(float *p, size_t n) {
+    uint32_t s = 12345u;
+    for (size_t i = 0; i < n; i++) {
+        s = s * 1664525u + 1013904223u;
+        p[i] = ((float)(s >> 8) / 16777216.0f - 0.5f) * 0.1f;
+    }
+}
+
+static void add_candidate(int *list, int *n, int v, int max) {
+    if (v < 1 || v > max) return;
+    for (int i = 0; i < *n; i++)
+        if (list[i] == v) return;
+    int i = (*n)++;
+    while (i > 0 && list[i - 1] > v) {
+        list[i] = list[i - 1];
+        i--;
+    }
+    list[i] = v;
+}
+
+int qwen_autotune(qwen_ctx_t *ctx, const char *path) {
+    if (!ctx) return -1;
+    if (!path) path = qwen_tune_default_path();
+    if (!path || !path[0]) {
+        fprintf(stderr, "qwen_autotune: no profile path (set QWEN_TUNE_FILE or HOME)\n");
+        return -1;
+    }
+    const qwen_config_t *c = &ctx->config;
+    const qwen_topology_t *topo = qwen_get_topology();
+    if (!ctx->decoder.layers[0].gate_up_fused_bf16) {
+        fprintf(stderr, "qwen_autotune: decoder weights not loaded\n");
+        return -1;
+    }
+
+    int hidden = c->dec_hidden, inter = c->dec_intermediate;
+    int q_dim = c->dec_heads * c->dec_head_dim;
+    int kv_dim = c->dec_kv_heads * c->dec_head_dim;
+    int wide = inter > q_dim ? inter : q_dim;
+    if (hidden > wide) wide = hidden;
+
+    tune_bench_t b;
+    memset(&b, 0, sizeof(b));
+    b.ctx = ctx;
+    b.attn_scale = 1.0f / sqrtf((float)c->dec_head_dim);
+    b.x = (float *)malloc((size_t)wide * sizeof(float));
+    b.q = (float *)malloc((size_t)wide * sizeof(float));
+    b.k = (float *)malloc((size_t)kv_dim * sizeof(float));
+    b.v = (float *)malloc((size_t)kv_dim * sizeof(float));
+    b.h = (float *)malloc((size_t)wide * sizeof(float));
+    b.gu = (float *)malloc((size_t)2 * inter * sizeof(float));
+    b.kv_k = (float *)malloc((size_t)BENCH_SEQ_K_MAX * kv_dim * sizeof(float));
+    b.kv_v = (float *)malloc((size_t)BENCH_SEQ_K_MAX * kv_dim * sizeof(float));
+    b.pre_x = (float *)malloc((size_t)BENCH_PREFILL_ROWS * wide * sizeof(float));
+    b.pre_out = (float *)malloc((size_t)BENCH_PREFILL_ROWS * 2 * inter * sizeof(float));
+    int rc = -1;
+    if (!b.x || !b.q || !b.k || !b.v || !b.h || !b.gu || !b.kv_k || !b.kv_v ||
+        !b.pre_x || !b.pre_out) {
+        fprintf(stderr, "qwen_autotune: out of memory\n");
+        goto done;
+    }
+    fill_pattern(b.x, (size_t)wide);
+    fill_pattern(b.q, (size_t)wide);
+    fill_pattern(b.gu, (size_t)2 * inter);
+    fill_pattern(b.kv_k, (size_t)BENCH_SEQ_K_MAX * kv_dim);
+    fill_pattern(b.kv_v, (size_t)BENCH_SEQ_K_MAX * kv_dim);
+    fill_pattern(b.pre_x, (size_t)BENCH_PREFILL_ROWS * wide);
+
+    qwen_sched_acquire(QWEN_PRIORITY_INTERACTIVE, 0);
+
+    qwen_kernel_tuning_t t;
+    memset(&t, 0, sizeof(t));
+    qwen_set_kernel_tuning(&t);
+    int pool = qwen_get_threads();
+
+    if (qwen_verbose >= 1)
+        fprintf(stderr, "Autotune: %s, %d usable CPUs (%d cores), pool %d threads\n",
+                topo->cpu_model, topo->n_usable, topo->n_cores, pool);
+
+    /* 1. Decode matvec threads: fewest threads within 2% of the best */
+    {
+        int cand[16], n_cand = 0;
+        static const int base[] = { 1, 2, 3, 4, 6, 8, 12, 16 };
+        for (size_t i = 0; i < sizeof(base) / sizeof(base[0]); i++)
+            add_candidate(cand, &n_cand, base[i], pool);
+        add_candidate(cand, &n_cand, topo->n_cores, pool);
+        add_candidate(cand, &n_cand, pool, pool);
+        double ms[16], best_ms = 1e30;
+        for (int i = 0; i < n_cand; i++) {
+            t.decode_threads = cand[i];
+            qwen_set_kernel_tuning(&t);
+            ms[i] = bench_ms(bench_decode_step, &b);
+            if (ms[i] < best_ms) best_ms = ms[i];
+            if (qwen_verbose >= 1)
+                fprintf(stderr, "  decode_threads=%-3d %8.2f ms/step\n", cand[i], ms[i]);
+        }
+        for (int i = 0; i < n_cand; i++) {
+            if (ms[i] <= best_ms * 1.02) {
+                t.decode_threads = cand[i];
+                break;
+            }
+        }
+        qwen_set_kernel_tuning(&t);
+    }
+
+    /* 2. Single-query attention: threaded from the shortest KV length after
+     * which the threaded path keeps winning */
+    if (pool > 1 && c->dec_heads >= 2) {
+        static const int lens[] = { 16, 32, 64, 128, 256, 512, 1024, BENCH_SEQ_K_MAX };
+        int n_lens = (int)(sizeof(lens) / sizeof(lens[0]));
+        int threshold = TUNE_NEVER;
+        for (int i = n_lens - 1; i >= 0; i--) {
+            b.seq_k = lens[i];
+            t.attn_min_seq_k = TUNE_NEVER;
+            qwen_set_kernel_tuning(&t);
+            double serial = bench_ms(bench_decode_attention, &b);
+            t.attn_min_seq_k = 1;
+            qwen_set_kernel_tuning(&t);
+            double threaded = bench_ms(bench_decode_attention, &b);
+            if (qwen_verbose >= 1)
+                fprintf(stderr, "  attention seq_k=%-5d serial %7.3f ms, threaded %7.3f ms\n",
+                        lens[i], serial, threaded);
+            if (threaded >= serial) break;
+            threshold = lens[i];
+        }
+        t.attn_min_seq_k = threshold;
+        qwen_set_kernel_tuning(&t);
+    }
+
+    /* 3. Prefill bf16 GEMM panel size (BLAS builds; the fallback GEMM is
+     * compute bound and too slow to time here) */
+#ifdef USE_BLAS
+    {
+        int cand[16], n_cand = 0;
+        int whole_kb = (int)(((size_t)2 * inter * hidden * sizeof(float)) >> 10);
+        int l2_kb = (int)(topo->l2_bytes >> 10), l3_kb = (int)(topo->l3_bytes >> 10);
+        add_candidate(cand, &n_cand, l2_kb * 2, whole_kb);
+        add_candidate(cand, &n_cand, l2_kb * 8, whole_kb);
+        add_candidate(cand, &n_cand, l3_kb / 4, whole_kb);
+        add_candidate(cand, &n_cand, l3_kb / 2, whole_kb);
+        add_candidate(cand, &n_cand, l3_kb, whole_kb);
+        add_candidate(cand, &n_cand, 4096, whole_kb);
+        add_candidate(cand, &n_cand, whole_kb, whole_kb);
+        double best_ms = 1e30;
+        int best_kb = 0;
+        for (int i = 0; i < n_cand; i++) {
+            if (cand[i] < 256) continue;
+            t.gemm_panel_kb = cand[i];
+            qwen_set_kernel_tuning(&t);
+            double ms = bench_ms(bench_prefill_mlp, &b);
+            if (qwen_verbose >= 1)
+                fprintf(stderr, "  gemm_panel_kb=%-7d %8.2f ms\n", cand[i], ms);
+            if (ms < best_ms) {
+                best_ms = ms;
+                best_kb = cand[i];
+            }
+        }
+        t.gemm_panel_kb = best_kb;
+        qwen_set_kernel_tuning(&t);
+    }
+#endif
+
+    qwen_release_scratch();
+    qwen_sched_release();
+
+    rc = tune_save(ctx, path, &t);
+    if (rc == 0 && qwen_verbose >= 1)
+        fprintf(stderr, "Autotune: decode_threads=%d attn_min_seq_k=%d gemm_panel_kb=%d -> %s\n",
+                t.decode_threads, t.attn_min_seq_k, t.gemm_panel_kb, path);
+
+done:
+    free(b.x); free(b.q); free(b.k); free(b.v); free(b.h); free(b.gu);
+    free(b.kv_k); free(b.kv_v); free(b.pre_x); free(b.pre_out);
+    return rc;
+}